@@ -0,0 +1,101 @@
+#!/bin/bash
+# ------------------------------------------------------------------------
+#  file: bench.sh
+#
+#  Description: Throughput benchmarks for mycopy ("make bench"). Every
+#      corpus kind and size (see gen_corpus.py) is copied with each I/O
+#      backend and buffer size, and one CSV line is written per run:
+#
+#          corpus,size_bytes,io,bufsize,threads,seconds,mb_per_s,
+#          syscalls,syscalls_per_mb,peak_rss_kb
+#
+#      The time and peak RSS come from a plain run; the system calls
+#      from a second run traced by benchrun -t. The corpora are kept in
+#      BENCH_DIR and only generated when missing.
+#
+#  Usage:
+#      ./bench.sh [output.csv]
+#
+#      Environment (defaults in brackets):
+#          BENCH_SIZES     corpus sizes [1K 1M 64M 1G 4G]
+#          BENCH_KINDS     corpus kinds [prose binary utf8 longlines nonewline]
+#          BENCH_BUFSIZES  --bufsize values [64 4K 64K 1M 4M]
+#          BENCH_THREADS   -j for the pipeline runs [one per CPU, at least 2]
+#          BENCH_DIR       where the corpora and copies go [/tmp/mycopy-bench]
+#
+#  Created: 2026-10-17
+# ------------------------------------------------------------------------
+set -e
+
+cd "$(dirname "$0")"
+
+SIZES=${BENCH_SIZES:-"1K 1M 64M 1G 4G"}
+KINDS=${BENCH_KINDS:-"prose binary utf8 longlines nonewline"}
+BUFSIZES=${BENCH_BUFSIZES:-"64 4K 64K 1M 4M"}
+THREADS=${BENCH_THREADS:-$(nproc)}
+DIR=${BENCH_DIR:-/tmp/mycopy-bench}
+OUT=${1:-bench.csv}
+
+if [ "$THREADS" -lt 2 ]; then
+        THREADS=2
+fi
+
+mkdir -p "$DIR"
+COPY="$DIR/copy.out"
+
+
+# run corpus size io bufsize threads [mycopy options]
+# Copy the corpus twice (plain and traced) and print its CSV line.
+run()
+{
+        local corpus=$1 size=$2 io=$3 bufsize=$4 threads=$5
+        shift 5
+        local file="$DIR/$corpus-$size"
+        local bytes plain traced
+
+        bytes=$(stat -c %s "$file")
+        rm -f "$COPY"
+        plain=$(./benchrun ./mycopy "$@" "$file" "$COPY" 2>/dev/null | tail -1)
+        rm -f "$COPY"
+        traced=$(./benchrun -t ./mycopy "$@" "$file" "$COPY" 2>/dev/null | tail -1)
+        rm -f "$COPY"
+
+        echo "$plain,$traced" | awk -F, -v prefix="$corpus,$bytes,$io,$bufsize,$threads" \
+                -v bytes="$bytes" '{
+                mb = bytes / 1048576
+                seconds = $1
+                syscalls = $6
+                printf "%s,%.6f,%.2f,%d,%.1f,%d\n", prefix, seconds,
+                       (seconds > 0) ? mb / seconds : 0,
+                       syscalls, syscalls / mb, $2
+        }'
+}
+
+
+echo "corpus,size_bytes,io,bufsize,threads,seconds,mb_per_s,syscalls,syscalls_per_mb,peak_rss_kb" | tee "$OUT"
+
+for size in $SIZES; do
+        for corpus in $KINDS; do
+                file="$DIR/$corpus-$size"
+                if [ ! -f "$file" ]; then
+                        python3 gen_corpus.py "$corpus" "$size" "$file"
+                fi
+                mode=""
+                if [ "$corpus" = utf8 ]; then
+                        mode="-u"
+                fi
+
+                # the defaults of each backend first
+                for io in stdio buffered mmap uring; do
+                        run "$corpus" "$size" "$io" default 1 $mode --io "$io" | tee -a "$OUT"
+                done
+                run "$corpus" "$size" buffered default "$THREADS" $mode --io buffered -j "$THREADS" | tee -a "$OUT"
+
+                # then each buffer size
+                for bufsize in $BUFSIZES; do
+                        for io in stdio buffered; do
+                                run "$corpus" "$size" "$io" "$bufsize" 1 $mode --io "$io" --bufsize "$bufsize" | tee -a "$OUT"
+                        done
+                done
+        done
+done
@@ -0,0 +1,146 @@
+// ----------------------------------------------------------------------
+// File: benchrun.c
+// ----------------------------------------------------------------------
+// Description:
+//              Runs one command for bench.sh and prints what it cost
+//              as one CSV fragment:
+//
+//                  seconds,peak_rss_kb,syscalls
+//
+//              Without -t the command runs untouched, and syscalls
+//              is printed as 0. With -t every thread of the command
+//              is traced with ptrace to count its system calls, which
+//              slows it down, so bench.sh takes the time and memory
+//              from a run without -t.
+//
+// Usage:
+//              ./benchrun [-t] command [argument ...]
+//
+// Created: 2026-10-17
+//
+// ----------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ptrace.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "common.h"
+
+#define SYSCALL_STOP (SIGTRAP | 0x80)   // with PTRACE_O_TRACESYSGOOD
+#define TRACE_OPTIONS (PTRACE_O_TRACESYSGOOD | PTRACE_O_TRACECLONE | \
+                       PTRACE_O_TRACEEXEC | PTRACE_O_EXITKILL)
+
+
+// Seconds since some fixed point.
+static double now(void)
+{
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+
+// Follow pid (stopped at its SIGSTOP) and every thread it starts, and
+// count the system call stops until it exits. Each call stops once
+// going in and once coming out. Returns the exit status from waitpid.
+static int trace(pid_t pid, unsigned long long *stops)
+{
+        int status;
+        int signal;
+        pid_t tid;
+
+        ptrace(PTRACE_SETOPTIONS, pid, 0, TRACE_OPTIONS);
+        ptrace(PTRACE_SYSCALL, pid, 0, 0);
+
+        for (;;) {
+                tid = waitpid(-1, &status, __WALL);
+                if (tid < 0) {
+                        return FAILURE;
+                }
+                if (WIFEXITED(status) || WIFSIGNALED(status)) {
+                        if (tid == pid) {
+                                return status;
+                        }
+                        continue;
+                }
+
+                signal = WSTOPSIG(status);
+                if (signal == SYSCALL_STOP) {
+                        (*stops)++;
+                        signal = 0;
+                } else if ((signal == SIGTRAP) || (signal == SIGSTOP)) {
+                        // clone/exec events, and new threads starting
+                        signal = 0;
+                }
+                ptrace(PTRACE_SYSCALL, tid, 0, signal);
+        }
+}
+
+
+
+// **********************************************************************
+// **************************  M  A  I  N  ******************************
+// **********************************************************************
+int main(int argc, char *argv[])
+{
+        struct rusage usage;
+        unsigned long long stops = 0;
+        double start;
+        double seconds;
+        int traced = 0;
+        int status;
+        int first = 1;
+        pid_t pid;
+
+        if ((argc > 1) && !strcmp(argv[1], "-t")) {
+                traced = 1;
+                first = 2;
+        }
+        if (argc <= first) {
+                fprintf(stderr, "Usage:\n\t\t$>./benchrun [-t] command [argument ...]\n");
+                exit(FAILURE);
+        }
+
+        start = now();
+        pid = fork();
+        if (pid < 0) {
+                perror("fork");
+                exit(FAILURE);
+        }
+        if (pid == 0) {
+                if (traced) {
+                        ptrace(PTRACE_TRACEME, 0, 0, 0);
+                        raise(SIGSTOP);
+                }
+                execvp(argv[first], &argv[first]);
+                perror(argv[first]);
+                _exit(127);
+        }
+
+        if (traced) {
+                waitpid(pid, &status, 0);
+                status = trace(pid, &stops);
+        } else {
+                waitpid(pid, &status, 0);
+        }
+        seconds = now() - start;
+
+        // ru_maxrss is the largest of the children waited for
+        getrusage(RUSAGE_CHILDREN, &usage);
+        printf("%.6f,%ld,%llu\n", seconds, usage.ru_maxrss, (stops + 1) / 2);
+
+        if (!WIFEXITED(status) || (WEXITSTATUS(status) != 0)) {
+                fprintf(stderr, "Error: command failed: %s\n", argv[first]);
+                return FAILURE;
+        }
+        return SUCCESS;
+}
@@ -0,0 +1,401 @@
+// ----------------------------------------------------------------------
+// file: casemap.h
+//
+// Description: Simple Unicode case mappings for the UTF8 module,
+//     generated by gen_casemap.py from Unicode 14.0.0. Do not edit.
+//     Each range maps code points first, first+stride, ... (count of
+//     them) to the code point plus delta.
+// ----------------------------------------------------------------------
+#ifndef CASEMAP_H
+#define CASEMAP_H
+
+#include <stdint.h>
+
+struct case_range {
+        uint32_t first;
+        uint16_t count;
+        uint8_t stride;
+        int32_t delta;
+};
+
+static const struct case_range Upper_ranges[] = {
+        { 0x000B5,     1, 1,     743 },
+        { 0x000E0,    23, 1,     -32 },
+        { 0x000F8,     7, 1,     -32 },
+        { 0x000FF,     1, 1,     121 },
+        { 0x00101,    24, 2,      -1 },
+        { 0x00131,     1, 1,    -232 },
+        { 0x00133,     3, 2,      -1 },
+        { 0x0013A,     8, 2,      -1 },
+        { 0x0014B,    23, 2,      -1 },
+        { 0x0017A,     3, 2,      -1 },
+        { 0x0017F,     1, 1,    -300 },
+        { 0x00180,     1, 1,     195 },
+        { 0x00183,     2, 2,      -1 },
+        { 0x00188,     1, 1,      -1 },
+        { 0x0018C,     1, 1,      -1 },
+        { 0x00192,     1, 1,      -1 },
+        { 0x00195,     1, 1,      97 },
+        { 0x00199,     1, 1,      -1 },
+        { 0x0019A,     1, 1,     163 },
+        { 0x0019E,     1, 1,     130 },
+        { 0x001A1,     3, 2,      -1 },
+        { 0x001A8,     1, 1,      -1 },
+        { 0x001AD,     1, 1,      -1 },
+        { 0x001B0,     1, 1,      -1 },
+        { 0x001B4,     2, 2,      -1 },
+        { 0x001B9,     1, 1,      -1 },
+        { 0x001BD,     1, 1,      -1 },
+        { 0x001BF,     1, 1,      56 },
+        { 0x001C5,     1, 1,      -1 },
+        { 0x001C6,     1, 1,      -2 },
+        { 0x001C8,     1, 1,      -1 },
+        { 0x001C9,     1, 1,      -2 },
+        { 0x001CB,     1, 1,      -1 },
+        { 0x001CC,     1, 1,      -2 },
+        { 0x001CE,     8, 2,      -1 },
+        { 0x001DD,     1, 1,     -79 },
+        { 0x001DF,     9, 2,      -1 },
+        { 0x001F2,     1, 1,      -1 },
+        { 0x001F3,     1, 1,      -2 },
+        { 0x001F5,     1, 1,      -1 },
+        { 0x001F9,    20, 2,      -1 },
+        { 0x00223,     9, 2,      -1 },
+        { 0x0023C,     1, 1,      -1 },
+        { 0x0023F,     2, 1,   10815 },
+        { 0x00242,     1, 1,      -1 },
+        { 0x00247,     5, 2,      -1 },
+        { 0x00250,     1, 1,   10783 },
+        { 0x00251,     1, 1,   10780 },
+        { 0x00252,     1, 1,   10782 },
+        { 0x00253,     1, 1,    -210 },
+        { 0x00254,     1, 1,    -206 },
+        { 0x00256,     2, 1,    -205 },
+        { 0x00259,     1, 1,    -202 },
+        { 0x0025B,     1, 1,    -203 },
+        { 0x0025C,     1, 1,   42319 },
+        { 0x00260,     1, 1,    -205 },
+        { 0x00261,     1, 1,   42315 },
+        { 0x00263,     1, 1,    -207 },
+        { 0x00265,     1, 1,   42280 },
+        { 0x00266,     1, 1,   42308 },
+        { 0x00268,     1, 1,    -209 },
+        { 0x00269,     1, 1,    -211 },
+        { 0x0026A,     1, 1,   42308 },
+        { 0x0026B,     1, 1,   10743 },
+        { 0x0026C,     1, 1,   42305 },
+        { 0x0026F,     1, 1,    -211 },
+        { 0x00271,     1, 1,   10749 },
+        { 0x00272,     1, 1,    -213 },
+        { 0x00275,     1, 1,    -214 },
+        { 0x0027D,     1, 1,   10727 },
+        { 0x00280,     1, 1,    -218 },
+        { 0x00282,     1, 1,   42307 },
+        { 0x00283,     1, 1,    -218 },
+        { 0x00287,     1, 1,   42282 },
+        { 0x00288,     1, 1,    -218 },
+        { 0x00289,     1, 1,     -69 },
+        { 0x0028A,     2, 1,    -217 },
+        { 0x0028C,     1, 1,     -71 },
+        { 0x00292,     1, 1,    -219 },
+        { 0x0029D,     1, 1,   42261 },
+        { 0x0029E,     1, 1,   42258 },
+        { 0x00345,     1, 1,      84 },
+        { 0x00371,     2, 2,      -1 },
+        { 0x00377,     1, 1,      -1 },
+        { 0x0037B,     3, 1,     130 },
+        { 0x003AC,     1, 1,     -38 },
+        { 0x003AD,     3, 1,     -37 },
+        { 0x003B1,    17, 1,     -32 },
+        { 0x003C2,     1, 1,     -31 },
+        { 0x003C3,     9, 1,     -32 },
+        { 0x003CC,     1, 1,     -64 },
+        { 0x003CD,     2, 1,     -63 },
+        { 0x003D0,     1, 1,     -62 },
+        { 0x003D1,     1, 1,     -57 },
+        { 0x003D5,     1, 1,     -47 },
+        { 0x003D6,     1, 1,     -54 },
+        { 0x003D7,     1, 1,      -8 },
+        { 0x003D9,    12, 2,      -1 },
+        { 0x003F0,     1, 1,     -86 },
+        { 0x003F1,     1, 1,     -80 },
+        { 0x003F2,     1, 1,       7 },
+        { 0x003F3,     1, 1,    -116 },
+        { 0x003F5,     1, 1,     -96 },
+        { 0x003F8,     1, 1,      -1 },
+        { 0x003FB,     1, 1,      -1 },
+        { 0x00430,    32, 1,     -32 },
+        { 0x00450,    16, 1,     -80 },
+        { 0x00461,    17, 2,      -1 },
+        { 0x0048B,    27, 2,      -1 },
+        { 0x004C2,     7, 2,      -1 },
+        { 0x004CF,     1, 1,     -15 },
+        { 0x004D1,    48, 2,      -1 },
+        { 0x00561,    38, 1,     -48 },
+        { 0x010D0,    43, 1,    3008 },
+        { 0x010FD,     3, 1,    3008 },
+        { 0x013F8,     6, 1,      -8 },
+        { 0x01C80,     1, 1,   -6254 },
+        { 0x01C81,     1, 1,   -6253 },
+        { 0x01C82,     1, 1,   -6244 },
+        { 0x01C83,     2, 1,   -6242 },
+        { 0x01C85,     1, 1,   -6243 },
+        { 0x01C86,     1, 1,   -6236 },
+        { 0x01C87,     1, 1,   -6181 },
+        { 0x01C88,     1, 1,   35266 },
+        { 0x01D79,     1, 1,   35332 },
+        { 0x01D7D,     1, 1,    3814 },
+        { 0x01D8E,     1, 1,   35384 },
+        { 0x01E01,    75, 2,      -1 },
+        { 0x01E9B,     1, 1,     -59 },
+        { 0x01EA1,    48, 2,      -1 },
+        { 0x01F00,     8, 1,       8 },
+        { 0x01F10,     6, 1,       8 },
+        { 0x01F20,     8, 1,       8 },
+        { 0x01F30,     8, 1,       8 },
+        { 0x01F40,     6, 1,       8 },
+        { 0x01F51,     4, 2,       8 },
+        { 0x01F60,     8, 1,       8 },
+        { 0x01F70,     2, 1,      74 },
+        { 0x01F72,     4, 1,      86 },
+        { 0x01F76,     2, 1,     100 },
+        { 0x01F78,     2, 1,     128 },
+        { 0x01F7A,     2, 1,     112 },
+        { 0x01F7C,     2, 1,     126 },
+        { 0x01FB0,     2, 1,       8 },
+        { 0x01FBE,     1, 1,   -7205 },
+        { 0x01FD0,     2, 1,       8 },
+        { 0x01FE0,     2, 1,       8 },
+        { 0x01FE5,     1, 1,       7 },
+        { 0x0214E,     1, 1,     -28 },
+        { 0x02170,    16, 1,     -16 },
+        { 0x02184,     1, 1,      -1 },
+        { 0x024D0,    26, 1,     -26 },
+        { 0x02C30,    48, 1,     -48 },
+        { 0x02C61,     1, 1,      -1 },
+        { 0x02C65,     1, 1,  -10795 },
+        { 0x02C66,     1, 1,  -10792 },
+        { 0x02C68,     3, 2,      -1 },
+        { 0x02C73,     1, 1,      -1 },
+        { 0x02C76,     1, 1,      -1 },
+        { 0x02C81,    50, 2,      -1 },
+        { 0x02CEC,     2, 2,      -1 },
+        { 0x02CF3,     1, 1,      -1 },
+        { 0x02D00,    38, 1,   -7264 },
+        { 0x02D27,     1, 1,   -7264 },
+        { 0x02D2D,     1, 1,   -7264 },
+        { 0x0A641,    23, 2,      -1 },
+        { 0x0A681,    14, 2,      -1 },
+        { 0x0A723,     7, 2,      -1 },
+        { 0x0A733,    31, 2,      -1 },
+        { 0x0A77A,     2, 2,      -1 },
+        { 0x0A77F,     5, 2,      -1 },
+        { 0x0A78C,     1, 1,      -1 },
+        { 0x0A791,     2, 2,      -1 },
+        { 0x0A794,     1, 1,      48 },
+        { 0x0A797,    10, 2,      -1 },
+        { 0x0A7B5,     8, 2,      -1 },
+        { 0x0A7C8,     2, 2,      -1 },
+        { 0x0A7D1,     1, 1,      -1 },
+        { 0x0A7D7,     2, 2,      -1 },
+        { 0x0A7F6,     1, 1,      -1 },
+        { 0x0AB53,     1, 1,    -928 },
+        { 0x0AB70,    80, 1,  -38864 },
+        { 0x0FF41,    26, 1,     -32 },
+        { 0x10428,    40, 1,     -40 },
+        { 0x104D8,    36, 1,     -40 },
+        { 0x10597,    11, 1,     -39 },
+        { 0x105A3,    15, 1,     -39 },
+        { 0x105B3,     7, 1,     -39 },
+        { 0x105BB,     2, 1,     -39 },
+        { 0x10CC0,    51, 1,     -64 },
+        { 0x118C0,    32, 1,     -32 },
+        { 0x16E60,    32, 1,     -32 },
+        { 0x1E922,    34, 1,     -34 },
+};
+
+static const struct case_range Lower_ranges[] = {
+        { 0x000C0,    23, 1,      32 },
+        { 0x000D8,     7, 1,      32 },
+        { 0x00100,    24, 2,       1 },
+        { 0x00132,     3, 2,       1 },
+        { 0x00139,     8, 2,       1 },
+        { 0x0014A,    23, 2,       1 },
+        { 0x00178,     1, 1,    -121 },
+        { 0x00179,     3, 2,       1 },
+        { 0x00181,     1, 1,     210 },
+        { 0x00182,     2, 2,       1 },
+        { 0x00186,     1, 1,     206 },
+        { 0x00187,     1, 1,       1 },
+        { 0x00189,     2, 1,     205 },
+        { 0x0018B,     1, 1,       1 },
+        { 0x0018E,     1, 1,      79 },
+        { 0x0018F,     1, 1,     202 },
+        { 0x00190,     1, 1,     203 },
+        { 0x00191,     1, 1,       1 },
+        { 0x00193,     1, 1,     205 },
+        { 0x00194,     1, 1,     207 },
+        { 0x00196,     1, 1,     211 },
+        { 0x00197,     1, 1,     209 },
+        { 0x00198,     1, 1,       1 },
+        { 0x0019C,     1, 1,     211 },
+        { 0x0019D,     1, 1,     213 },
+        { 0x0019F,     1, 1,     214 },
+        { 0x001A0,     3, 2,       1 },
+        { 0x001A6,     1, 1,     218 },
+        { 0x001A7,     1, 1,       1 },
+        { 0x001A9,     1, 1,     218 },
+        { 0x001AC,     1, 1,       1 },
+        { 0x001AE,     1, 1,     218 },
+        { 0x001AF,     1, 1,       1 },
+        { 0x001B1,     2, 1,     217 },
+        { 0x001B3,     2, 2,       1 },
+        { 0x001B7,     1, 1,     219 },
+        { 0x001B8,     1, 1,       1 },
+        { 0x001BC,     1, 1,       1 },
+        { 0x001C4,     1, 1,       2 },
+        { 0x001C5,     1, 1,       1 },
+        { 0x001C7,     1, 1,       2 },
+        { 0x001C8,     1, 1,       1 },
+        { 0x001CA,     1, 1,       2 },
+        { 0x001CB,     9, 2,       1 },
+        { 0x001DE,     9, 2,       1 },
+        { 0x001F1,     1, 1,       2 },
+        { 0x001F2,     2, 2,       1 },
+        { 0x001F6,     1, 1,     -97 },
+        { 0x001F7,     1, 1,     -56 },
+        { 0x001F8,    20, 2,       1 },
+        { 0x00220,     1, 1,    -130 },
+        { 0x00222,     9, 2,       1 },
+        { 0x0023A,     1, 1,   10795 },
+        { 0x0023B,     1, 1,       1 },
+        { 0x0023D,     1, 1,    -163 },
+        { 0x0023E,     1, 1,   10792 },
+        { 0x00241,     1, 1,       1 },
+        { 0x00243,     1, 1,    -195 },
+        { 0x00244,     1, 1,      69 },
+        { 0x00245,     1, 1,      71 },
+        { 0x00246,     5, 2,       1 },
+        { 0x00370,     2, 2,       1 },
+        { 0x00376,     1, 1,       1 },
+        { 0x0037F,     1, 1,     116 },
+        { 0x00386,     1, 1,      38 },
+        { 0x00388,     3, 1,      37 },
+        { 0x0038C,     1, 1,      64 },
+        { 0x0038E,     2, 1,      63 },
+        { 0x00391,    17, 1,      32 },
+        { 0x003A3,     9, 1,      32 },
+        { 0x003CF,     1, 1,       8 },
+        { 0x003D8,    12, 2,       1 },
+        { 0x003F4,     1, 1,     -60 },
+        { 0x003F7,     1, 1,       1 },
+        { 0x003F9,     1, 1,      -7 },
+        { 0x003FA,     1, 1,       1 },
+        { 0x003FD,     3, 1,    -130 },
+        { 0x00400,    16, 1,      80 },
+        { 0x00410,    32, 1,      32 },
+        { 0x00460,    17, 2,       1 },
+        { 0x0048A,    27, 2,       1 },
+        { 0x004C0,     1, 1,      15 },
+        { 0x004C1,     7, 2,       1 },
+        { 0x004D0,    48, 2,       1 },
+        { 0x00531,    38, 1,      48 },
+        { 0x010A0,    38, 1,    7264 },
+        { 0x010C7,     1, 1,    7264 },
+        { 0x010CD,     1, 1,    7264 },
+        { 0x013A0,    80, 1,   38864 },
+        { 0x013F0,     6, 1,       8 },
+        { 0x01C90,    43, 1,   -3008 },
+        { 0x01CBD,     3, 1,   -3008 },
+        { 0x01E00,    75, 2,       1 },
+        { 0x01E9E,     1, 1,   -7615 },
+        { 0x01EA0,    48, 2,       1 },
+        { 0x01F08,     8, 1,      -8 },
+        { 0x01F18,     6, 1,      -8 },
+        { 0x01F28,     8, 1,      -8 },
+        { 0x01F38,     8, 1,      -8 },
+        { 0x01F48,     6, 1,      -8 },
+        { 0x01F59,     4, 2,      -8 },
+        { 0x01F68,     8, 1,      -8 },
+        { 0x01F88,     8, 1,      -8 },
+        { 0x01F98,     8, 1,      -8 },
+        { 0x01FA8,     8, 1,      -8 },
+        { 0x01FB8,     2, 1,      -8 },
+        { 0x01FBA,     2, 1,     -74 },
+        { 0x01FBC,     1, 1,      -9 },
+        { 0x01FC8,     4, 1,     -86 },
+        { 0x01FCC,     1, 1,      -9 },
+        { 0x01FD8,     2, 1,      -8 },
+        { 0x01FDA,     2, 1,    -100 },
+        { 0x01FE8,     2, 1,      -8 },
+        { 0x01FEA,     2, 1,    -112 },
+        { 0x01FEC,     1, 1,      -7 },
+        { 0x01FF8,     2, 1,    -128 },
+        { 0x01FFA,     2, 1,    -126 },
+        { 0x01FFC,     1, 1,      -9 },
+        { 0x02126,     1, 1,   -7517 },
+        { 0x0212A,     1, 1,   -8383 },
+        { 0x0212B,     1, 1,   -8262 },
+        { 0x02132,     1, 1,      28 },
+        { 0x02160,    16, 1,      16 },
+        { 0x02183,     1, 1,       1 },
+        { 0x024B6,    26, 1,      26 },
+        { 0x02C00,    48, 1,      48 },
+        { 0x02C60,     1, 1,       1 },
+        { 0x02C62,     1, 1,  -10743 },
+        { 0x02C63,     1, 1,   -3814 },
+        { 0x02C64,     1, 1,  -10727 },
+        { 0x02C67,     3, 2,       1 },
+        { 0x02C6D,     1, 1,  -10780 },
+        { 0x02C6E,     1, 1,  -10749 },
+        { 0x02C6F,     1, 1,  -10783 },
+        { 0x02C70,     1, 1,  -10782 },
+        { 0x02C72,     1, 1,       1 },
+        { 0x02C75,     1, 1,       1 },
+        { 0x02C7E,     2, 1,  -10815 },
+        { 0x02C80,    50, 2,       1 },
+        { 0x02CEB,     2, 2,       1 },
+        { 0x02CF2,     1, 1,       1 },
+        { 0x0A640,    23, 2,       1 },
+        { 0x0A680,    14, 2,       1 },
+        { 0x0A722,     7, 2,       1 },
+        { 0x0A732,    31, 2,       1 },
+        { 0x0A779,     2, 2,       1 },
+        { 0x0A77D,     1, 1,  -35332 },
+        { 0x0A77E,     5, 2,       1 },
+        { 0x0A78B,     1, 1,       1 },
+        { 0x0A78D,     1, 1,  -42280 },
+        { 0x0A790,     2, 2,       1 },
+        { 0x0A796,    10, 2,       1 },
+        { 0x0A7AA,     1, 1,  -42308 },
+        { 0x0A7AB,     1, 1,  -42319 },
+        { 0x0A7AC,     1, 1,  -42315 },
+        { 0x0A7AD,     1, 1,  -42305 },
+        { 0x0A7AE,     1, 1,  -42308 },
+        { 0x0A7B0,     1, 1,  -42258 },
+        { 0x0A7B1,     1, 1,  -42282 },
+        { 0x0A7B2,     1, 1,  -42261 },
+        { 0x0A7B3,     1, 1,     928 },
+        { 0x0A7B4,     8, 2,       1 },
+        { 0x0A7C4,     1, 1,     -48 },
+        { 0x0A7C5,     1, 1,  -42307 },
+        { 0x0A7C6,     1, 1,  -35384 },
+        { 0x0A7C7,     2, 2,       1 },
+        { 0x0A7D0,     1, 1,       1 },
+        { 0x0A7D6,     2, 2,       1 },
+        { 0x0A7F5,     1, 1,       1 },
+        { 0x0FF21,    26, 1,      32 },
+        { 0x10400,    40, 1,      40 },
+        { 0x104B0,    36, 1,      40 },
+        { 0x10570,    11, 1,      39 },
+        { 0x1057C,    15, 1,      39 },
+        { 0x1058C,     7, 1,      39 },
+        { 0x10594,     2, 1,      39 },
+        { 0x10C80,    51, 1,      64 },
+        { 0x118A0,    32, 1,      32 },
+        { 0x16E40,    32, 1,      32 },
+        { 0x1E900,    34, 1,      34 },
+};
+
+#endif
+// end of casemap.h
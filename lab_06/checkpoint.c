@@ -0,0 +1,224 @@
+// ----------------------------------------------------------------------
+// file: checkpoint.c
+//
+// Description: This file implements the CHECKPOINT module. The sidecar
+//     is plain text, one "name=value" line per field, so it can be
+//     looked at (or deleted) by hand. Rather than checksumming the
+//     whole prefix of a 50 GB file, a checkpoint only keeps rolling
+//     Adler-32 sums of the last CHECKPOINT_WINDOW bytes before each
+//     offset, which are cheap to check again on restart.
+//
+// Created: 2026-10-17
+//
+// ----------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <unistd.h>
+#include "checkpoint.h"
+#include "common.h"
+
+#define MAGIC "mycopy-checkpoint 1"
+#define TMP_SUFFIX ".tmp"
+#define MAX_LINE 128
+#define ADLER_MOD 65521
+#define ADLER_BLOCK 5552     // bytes that can be summed before a mod
+
+
+// The sidecar for target_name, in newly allocated memory.
+static char *sidecar_name(const char *target_name, const char *suffix)
+{
+        size_t len = strlen(target_name) + strlen(CHECKPOINT_SUFFIX) +
+                     strlen(suffix) + 1;
+        char *name = malloc(len);
+
+        if (name != NULL) {
+                snprintf(name, len, "%s%s%s", target_name, CHECKPOINT_SUFFIX, suffix);
+        }
+        return name;
+}
+
+
+
+// Read the checkpoint for target_name into ck.
+// Returns SUCCESS, or ERR_CHECKPOINT if there is none or it is bad.
+extern int checkpoint_load(const char *target_name, struct checkpoint *ck)
+{
+        char line[MAX_LINE];
+        char *name;
+        FILE *file;
+        int fields = 0;
+
+        name = sidecar_name(target_name, "");
+        if (name == NULL) {
+                return ERR_CHECKPOINT;
+        }
+        file = fopen(name, "r");
+        free(name);
+        if (file == NULL) {
+                return ERR_CHECKPOINT;
+        }
+
+        memset(ck, 0, sizeof(*ck));
+        if ((fgets(line, sizeof(line), file) == NULL) ||
+            strncmp(line, MAGIC, strlen(MAGIC))) {
+                fclose(file);
+                return ERR_CHECKPOINT;
+        }
+        while (fgets(line, sizeof(line), file) != NULL) {
+                fields += sscanf(line, "source_size=%llu", &ck->source_size);
+                fields += sscanf(line, "source_mtime=%lld", &ck->source_mtime);
+                fields += sscanf(line, "config=%" SCNx32, &ck->config);
+                fields += sscanf(line, "source_offset=%llu", &ck->source_offset);
+                fields += sscanf(line, "target_offset=%llu", &ck->target_offset);
+                fields += sscanf(line, "source_sum=%" SCNx32, &ck->source_sum);
+                fields += sscanf(line, "target_sum=%" SCNx32, &ck->target_sum);
+                fields += sscanf(line, "chars_copied=%llu", &ck->stats.chars_copied);
+                fields += sscanf(line, "chars_changed=%llu", &ck->stats.chars_changed);
+                fields += sscanf(line, "lines=%llu", &ck->stats.lines);
+                fields += sscanf(line, "punct_chars=%llu", &ck->stats.punct_chars);
+        }
+        fclose(file);
+
+        // every field must be there
+        return (fields == 11) ? SUCCESS : ERR_CHECKPOINT;
+}
+
+
+
+// Make a rename in the directory of path durable.
+static void sync_directory(const char *path)
+{
+        char *copy = strdup(path);
+        int fd;
+
+        if (copy == NULL) {
+                return;
+        }
+        fd = open(dirname(copy), O_RDONLY | O_DIRECTORY);
+        if (fd >= 0) {
+                fsync(fd);
+                close(fd);
+        }
+        free(copy);
+}
+
+
+
+// Write ck as the checkpoint for target_name.
+// Returns SUCCESS or ERR_CHECKPOINT.
+extern int checkpoint_save(const char *target_name, const struct checkpoint *ck)
+{
+        char *name = sidecar_name(target_name, "");
+        char *tmp = sidecar_name(target_name, TMP_SUFFIX);
+        FILE *file = NULL;
+        int result = ERR_CHECKPOINT;
+
+        if ((name == NULL) || (tmp == NULL)) {
+                goto cleanup;
+        }
+        file = fopen(tmp, "w");
+        if (file == NULL) {
+                goto cleanup;
+        }
+
+        fprintf(file, "%s\n", MAGIC);
+        fprintf(file, "source_size=%llu\n", ck->source_size);
+        fprintf(file, "source_mtime=%lld\n", ck->source_mtime);
+        fprintf(file, "config=%08" PRIx32 "\n", ck->config);
+        fprintf(file, "source_offset=%llu\n", ck->source_offset);
+        fprintf(file, "target_offset=%llu\n", ck->target_offset);
+        fprintf(file, "source_sum=%08" PRIx32 "\n", ck->source_sum);
+        fprintf(file, "target_sum=%08" PRIx32 "\n", ck->target_sum);
+        fprintf(file, "chars_copied=%llu\n", ck->stats.chars_copied);
+        fprintf(file, "chars_changed=%llu\n", ck->stats.chars_changed);
+        fprintf(file, "lines=%llu\n", ck->stats.lines);
+        fprintf(file, "punct_chars=%llu\n", ck->stats.punct_chars);
+
+        if ((fflush(file) != 0) || (fsync(fileno(file)) != 0)) {
+                fclose(file);
+                goto cleanup;
+        }
+        if (fclose(file) != 0) {
+                goto cleanup;
+        }
+        if (rename(tmp, name) != 0) {
+                goto cleanup;
+        }
+        sync_directory(name);
+        result = SUCCESS;
+
+cleanup:
+        if ((result != SUCCESS) && (tmp != NULL)) {
+                unlink(tmp);
+        }
+        free(tmp);
+        free(name);
+        return result;
+}
+
+
+
+// Remove the checkpoint for target_name, once the copy is complete.
+extern void checkpoint_remove(const char *target_name)
+{
+        char *name = sidecar_name(target_name, "");
+
+        if (name != NULL) {
+                unlink(name);
+                free(name);
+        }
+}
+
+
+
+// The Adler-32 of the (up to) CHECKPOINT_WINDOW bytes of fd that end
+// at offset. Returns SUCCESS, ERR_READ or ERR_MEMORY.
+extern int checkpoint_window_sum(int fd, unsigned long long offset,
+                                 uint32_t *sum)
+{
+        unsigned char *buf;
+        size_t len = (offset < CHECKPOINT_WINDOW) ? offset : CHECKPOINT_WINDOW;
+        size_t done = 0;
+        ssize_t count;
+        uint32_t a = 1;
+        uint32_t b = 0;
+
+        buf = malloc(CHECKPOINT_WINDOW);
+        if (buf == NULL) {
+                return ERR_MEMORY;
+        }
+        while (done < len) {
+                count = pread(fd, buf + done, len - done, offset - len + done);
+                if ((count < 0) && (errno == EINTR)) {
+                        continue;
+                }
+                if (count <= 0) {
+                        free(buf);
+                        return ERR_READ;
+                }
+                done += count;
+        }
+
+        // a and b only need reducing every ADLER_BLOCK bytes
+        for (size_t i = 0; i < len; ) {
+                size_t stop = (len - i > ADLER_BLOCK) ? i + ADLER_BLOCK : len;
+
+                for (; i < stop; i++) {
+                        a += buf[i];
+                        b += a;
+                }
+                a %= ADLER_MOD;
+                b %= ADLER_MOD;
+        }
+
+        free(buf);
+        *sum = (b << 16) | a;
+        return SUCCESS;
+}
+
+// end of checkpoint.c
@@ -0,0 +1,61 @@
+// ----------------------------------------------------------------------
+// file: checkpoint.h
+//
+// Description: This is the header file for the CHECKPOINT module. A
+//     checkpoint is a small sidecar file next to the target of a copy
+//     ("<target>.ckpt") that says how far the copy got and what the
+//     counters were at that point, so an interrupted copy of a very
+//     large file can carry on from there instead of starting over.
+//
+// Created: 2026-10-17
+//
+// ----------------------------------------------------------------------
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include "common.h"
+
+#define CHECKPOINT_SUFFIX ".ckpt"
+#define CHECKPOINT_WINDOW (1024 * 1024)   // bytes covered by each sum
+#define CHECKPOINT_DEFAULT_MB 64
+
+struct checkpoint {
+        // what is being copied, and how
+        unsigned long long source_size;
+        long long source_mtime;
+        uint32_t config;
+        // how far the copy got
+        unsigned long long source_offset;
+        unsigned long long target_offset;
+        // Adler-32 of the CHECKPOINT_WINDOW bytes before each offset
+        uint32_t source_sum;
+        uint32_t target_sum;
+        struct copy_stats stats;
+};
+
+
+// Read the checkpoint for target_name into ck.
+// Returns SUCCESS, or ERR_CHECKPOINT if there is none or it is bad.
+extern int checkpoint_load(const char *target_name, struct checkpoint *ck);
+
+
+// Write ck as the checkpoint for target_name. The new checkpoint is
+// written to a temporary file, flushed to disk and renamed over the
+// old one, so a crash leaves either the old or the new checkpoint.
+// Returns SUCCESS or ERR_CHECKPOINT.
+extern int checkpoint_save(const char *target_name, const struct checkpoint *ck);
+
+
+// Remove the checkpoint for target_name, once the copy is complete.
+extern void checkpoint_remove(const char *target_name);
+
+
+// The Adler-32 of the (up to) CHECKPOINT_WINDOW bytes of fd that end
+// at offset. Returns SUCCESS, ERR_READ or ERR_MEMORY.
+extern int checkpoint_window_sum(int fd, unsigned long long offset,
+                                 uint32_t *sum);
+
+#endif
+// end of checkpoint.h
@@ -0,0 +1,37 @@
+// ----------------------------------------------------------------------
+// file: common.h
+//
+// Description: This header file contains macros and types that are
+//     used by more than one module of the mycopy program.
+//
+// Created: 2026-10-17
+// ----------------------------------------------------------------------
+#ifndef COMMON_H
+#define COMMON_H
+
+#define SUCCESS 0
+#define FAILURE -1
+#define TRUE 1
+#define FALSE 0
+
+#define ERR_OPEN_SOURCE -2    /* unable to open the source file */
+#define ERR_OPEN_TARGET -3    /* unable to create the target file */
+#define ERR_READ -4           /* error reading the source */
+#define ERR_WRITE -5          /* error writing the target */
+#define ERR_CLOSE -6          /* error closing a file */
+#define ERR_MEMORY -7         /* unable to allocate buffers */
+#define ERR_THREAD -8         /* unable to start a thread */
+#define ERR_CHECKPOINT -9     /* checkpoint missing, bad or out of date */
+
+// The four counters that mycopy reports at the end of a copy.
+// They are wide enough to hold the counts for multi-GB files.
+struct copy_stats {
+        unsigned long long chars_copied;
+        unsigned long long chars_changed;
+        unsigned long long lines;
+        unsigned long long punct_chars;
+};
+
+#endif
+
+// end of common.h
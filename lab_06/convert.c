@@ -0,0 +1,474 @@
+// ----------------------------------------------------------------------
+// file: convert.c
+//
+// Description: This file implements the CONVERT module. It holds the
+//     loop that mycopy runs over every buffer it copies: lower-case
+//     characters are changed to upper-case, and the characters,
+//     changes, lines and punctuation are counted.
+//
+//     The scalar kernel uses the ctype functions and is the reference.
+//     The SSE2 and AVX2 kernels do the same job 16 or 32 bytes at a
+//     time. They hard-code the "C" locale rules (mycopy never calls
+//     setlocale), where only 'a'..'z' are lower-case and punctuation
+//     is any printable ASCII character that is not a letter or digit.
+//
+// Created: 2026-10-17
+// ----------------------------------------------------------------------
+#include <ctype.h>
+#include <string.h>
+#include <stdint.h>
+#include "convert.h"
+#include "xform.h"
+#include "utf8.h"
+#include "common.h"
+
+#if defined(__x86_64__)
+#define HAVE_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+// The byte counters used by the SIMD kernels are folded into the
+// 64-bit totals before they can wrap.
+#define MAX_BLOCKS_PER_FOLD 255
+
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME 16777619u
+
+// A kernel converts as many whole blocks of in to out as it can and
+// returns the number of bytes it handled. The rest is left to the
+// scalar kernel. in and out may be the same buffer. If out is NULL
+// the characters are only counted.
+typedef size_t (*kernel_t)(const char *in, char *out, size_t len,
+                           struct copy_stats *stats);
+
+// A NULL kernel means the table kernel, xform_apply(), which can
+// change the length of the output.
+struct kernel_entry {
+        const char *name;
+        kernel_t kernel;
+        int (*supported)(void);
+};
+
+static const struct xform *Xform = NULL;
+static int Utf8 = FALSE;
+static kernel_t Kernel = NULL;
+static const char *Kernel_name = "table";
+
+
+
+// The reference kernel. It handles every byte it is given.
+static size_t convert_scalar(const char *in, char *out, size_t len,
+                             struct copy_stats *stats)
+{
+        unsigned char c;
+
+        // loop over each char
+        for (size_t i = 0; i < len; i++) {
+                // ctype functions need the value as an unsigned char
+                c = (unsigned char)in[i];
+
+                if (islower(c)) {
+                        c = toupper(c);
+                        stats->chars_changed++;
+                }
+                if (out != NULL) {
+                        out[i] = c;
+                }
+
+                if (c == '\n') {
+                        stats->lines++;
+                }
+
+                if (ispunct(c)) {
+                        stats->punct_chars++;
+                }
+        }
+
+        stats->chars_copied += len;
+        return len;
+}
+
+
+
+static int always_supported(void)
+{
+        return 1;
+}
+
+
+
+#ifdef HAVE_X86_KERNELS
+
+static int sse2_supported(void)
+{
+        return __builtin_cpu_supports("sse2");
+}
+
+
+
+static int avx2_supported(void)
+{
+        return __builtin_cpu_supports("avx2");
+}
+
+
+
+// Add up the eight byte counters in each 64-bit half of acc.
+__attribute__((target("sse2")))
+static unsigned long long fold_sse2(__m128i acc)
+{
+        __m128i sums = _mm_sad_epu8(acc, _mm_setzero_si128());
+
+        return (unsigned long long)_mm_cvtsi128_si64(sums) +
+               (unsigned long long)_mm_cvtsi128_si64(_mm_unpackhi_epi64(sums, sums));
+}
+
+
+
+// 16 bytes per step. Bytes 0x80 and above are negative as signed
+// chars, so the signed compares below never call them letters,
+// digits or punctuation, which matches the "C" locale.
+__attribute__((target("sse2")))
+static size_t convert_sse2(const char *in, char *out, size_t len,
+                           struct copy_stats *stats)
+{
+        const __m128i before_a = _mm_set1_epi8('a' - 1);
+        const __m128i after_z = _mm_set1_epi8('z' + 1);
+        const __m128i before_A = _mm_set1_epi8('A' - 1);
+        const __m128i after_Z = _mm_set1_epi8('Z' + 1);
+        const __m128i before_0 = _mm_set1_epi8('0' - 1);
+        const __m128i after_9 = _mm_set1_epi8('9' + 1);
+        const __m128i space = _mm_set1_epi8(' ');
+        const __m128i del = _mm_set1_epi8(0x7f);
+        const __m128i newline = _mm_set1_epi8('\n');
+        const __m128i case_bit = _mm_set1_epi8(0x20);
+        size_t blocks = len / sizeof(__m128i);
+        size_t done = 0;
+
+        while (done < blocks) {
+                __m128i changed = _mm_setzero_si128();
+                __m128i lines = _mm_setzero_si128();
+                __m128i punct = _mm_setzero_si128();
+                size_t stop = done + MAX_BLOCKS_PER_FOLD;
+
+                if (stop > blocks) {
+                        stop = blocks;
+                }
+                for (; done < stop; done++) {
+                        __m128i x = _mm_loadu_si128((const __m128i *)in + done);
+                        __m128i lower = _mm_and_si128(_mm_cmpgt_epi8(x, before_a),
+                                                      _mm_cmpgt_epi8(after_z, x));
+                        __m128i y = _mm_sub_epi8(x, _mm_and_si128(lower, case_bit));
+                        __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(y, before_A),
+                                                      _mm_cmpgt_epi8(after_Z, y));
+                        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(y, before_0),
+                                                      _mm_cmpgt_epi8(after_9, y));
+                        __m128i graph = _mm_and_si128(_mm_cmpgt_epi8(y, space),
+                                                      _mm_cmpgt_epi8(del, y));
+
+                        if (out != NULL) {
+                                _mm_storeu_si128((__m128i *)out + done, y);
+                        }
+                        // each mask byte is -1, so subtracting counts it
+                        changed = _mm_sub_epi8(changed, lower);
+                        lines = _mm_sub_epi8(lines, _mm_cmpeq_epi8(y, newline));
+                        punct = _mm_sub_epi8(punct,
+                                             _mm_andnot_si128(_mm_or_si128(upper, digit), graph));
+                }
+                stats->chars_changed += fold_sse2(changed);
+                stats->lines += fold_sse2(lines);
+                stats->punct_chars += fold_sse2(punct);
+        }
+
+        done *= sizeof(__m128i);
+        stats->chars_copied += done;
+        return done;
+}
+
+
+
+// Add up the byte counters in acc.
+__attribute__((target("avx2")))
+static unsigned long long fold_avx2(__m256i acc)
+{
+        __m256i sums = _mm256_sad_epu8(acc, _mm256_setzero_si256());
+
+        return (unsigned long long)_mm256_extract_epi64(sums, 0) +
+               (unsigned long long)_mm256_extract_epi64(sums, 1) +
+               (unsigned long long)_mm256_extract_epi64(sums, 2) +
+               (unsigned long long)_mm256_extract_epi64(sums, 3);
+}
+
+
+
+// 32 bytes per step, otherwise the same as convert_sse2().
+__attribute__((target("avx2")))
+static size_t convert_avx2(const char *in, char *out, size_t len,
+                           struct copy_stats *stats)
+{
+        const __m256i before_a = _mm256_set1_epi8('a' - 1);
+        const __m256i after_z = _mm256_set1_epi8('z' + 1);
+        const __m256i before_A = _mm256_set1_epi8('A' - 1);
+        const __m256i after_Z = _mm256_set1_epi8('Z' + 1);
+        const __m256i before_0 = _mm256_set1_epi8('0' - 1);
+        const __m256i after_9 = _mm256_set1_epi8('9' + 1);
+        const __m256i space = _mm256_set1_epi8(' ');
+        const __m256i del = _mm256_set1_epi8(0x7f);
+        const __m256i newline = _mm256_set1_epi8('\n');
+        const __m256i case_bit = _mm256_set1_epi8(0x20);
+        size_t blocks = len / sizeof(__m256i);
+        size_t done = 0;
+
+        while (done < blocks) {
+                __m256i changed = _mm256_setzero_si256();
+                __m256i lines = _mm256_setzero_si256();
+                __m256i punct = _mm256_setzero_si256();
+                size_t stop = done + MAX_BLOCKS_PER_FOLD;
+
+                if (stop > blocks) {
+                        stop = blocks;
+                }
+                for (; done < stop; done++) {
+                        __m256i x = _mm256_loadu_si256((const __m256i *)in + done);
+                        __m256i lower = _mm256_and_si256(_mm256_cmpgt_epi8(x, before_a),
+                                                         _mm256_cmpgt_epi8(after_z, x));
+                        __m256i y = _mm256_sub_epi8(x, _mm256_and_si256(lower, case_bit));
+                        __m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(y, before_A),
+                                                         _mm256_cmpgt_epi8(after_Z, y));
+                        __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(y, before_0),
+                                                         _mm256_cmpgt_epi8(after_9, y));
+                        __m256i graph = _mm256_and_si256(_mm256_cmpgt_epi8(y, space),
+                                                         _mm256_cmpgt_epi8(del, y));
+
+                        if (out != NULL) {
+                                _mm256_storeu_si256((__m256i *)out + done, y);
+                        }
+                        changed = _mm256_sub_epi8(changed, lower);
+                        lines = _mm256_sub_epi8(lines, _mm256_cmpeq_epi8(y, newline));
+                        punct = _mm256_sub_epi8(punct,
+                                                _mm256_andnot_si256(_mm256_or_si256(upper, digit), graph));
+                }
+                stats->chars_changed += fold_avx2(changed);
+                stats->lines += fold_avx2(lines);
+                stats->punct_chars += fold_avx2(punct);
+        }
+
+        done *= sizeof(__m256i);
+        stats->chars_copied += done;
+        return done;
+}
+
+#endif // HAVE_X86_KERNELS
+
+
+// Kernels in order of preference, best last.
+static const struct kernel_entry Kernels[] = {
+        { "scalar", convert_scalar, always_supported },
+        { "table", NULL, always_supported },
+#ifdef HAVE_X86_KERNELS
+        { "sse2", convert_sse2, sse2_supported },
+        { "avx2", convert_avx2, avx2_supported },
+#endif
+};
+
+#define NUM_KERNELS (sizeof(Kernels) / sizeof(Kernels[0]))
+
+
+
+// Can this kernel run the current transform?
+static int kernel_usable(const struct kernel_entry *entry)
+{
+        if (!entry->supported()) {
+                return FALSE;
+        }
+        // only the table kernel knows about other transforms
+        return (entry->kernel == NULL) || Xform->is_upper;
+}
+
+
+
+// This function must be called before the first call to
+// convert_buffer(). It sets the transform to use, which must have
+// been through xform_finish() and must stay around, and picks the
+// fastest kernel the CPU supports for it.
+extern void convert_init(const struct xform *x)
+{
+#ifdef HAVE_X86_KERNELS
+        __builtin_cpu_init();
+#endif
+        Xform = x;
+        for (size_t i = 0; i < NUM_KERNELS; i++) {
+                if (kernel_usable(&Kernels[i])) {
+                        Kernel = Kernels[i].kernel;
+                        Kernel_name = Kernels[i].name;
+                }
+        }
+}
+
+
+
+// Force a particular kernel: "scalar", "table", "sse2" or "avx2".
+// Returns SUCCESS, or FAILURE if the name is unknown, the CPU does
+// not support that kernel, or it cannot run the transform.
+extern int convert_select(const char *name)
+{
+        for (size_t i = 0; i < NUM_KERNELS; i++) {
+                if (!strcmp(name, Kernels[i].name)) {
+                        if (!kernel_usable(&Kernels[i])) {
+                                return FAILURE;
+                        }
+                        Kernel = Kernels[i].kernel;
+                        Kernel_name = Kernels[i].name;
+                        return SUCCESS;
+                }
+        }
+        return FAILURE;
+}
+
+
+
+// The name of the kernel that convert_buffer() is currently using.
+extern const char *convert_kernel_name(void)
+{
+        return Kernel_name;
+}
+
+
+
+// Treat the input as UTF-8 from now on. See convert.h.
+extern void convert_use_utf8(void)
+{
+        if (Xform->rule == XFORM_UPPER) {
+                utf8_init(UTF8_UPPER);
+        } else if (Xform->rule == XFORM_LOWER) {
+                utf8_init(UTF8_LOWER);
+        } else {
+                utf8_init(UTF8_NONE);
+        }
+        Utf8 = TRUE;
+}
+
+
+
+// Does the transform delete characters, or work on UTF-8? If so the
+// output of a copy can be a different length than the input.
+extern int convert_changes_length(void)
+{
+        return Xform->deletes || Utf8;
+}
+
+
+
+// The most bytes that converting len bytes can produce.
+extern size_t convert_max_output(size_t len)
+{
+        return Utf8 ? UTF8_MAX_OUTPUT(len) : len;
+}
+
+
+
+// The largest n <= len such that the first n bytes of buf can be
+// converted on their own. See convert.h.
+extern size_t convert_split_point(const char *buf, size_t len)
+{
+        return Utf8 ? utf8_split_point(buf, len) : len;
+}
+
+
+
+// The number of bytes to skip at the start of buf to get to the start
+// of a character. See convert.h.
+extern size_t convert_next_start(const char *buf, size_t len)
+{
+        return Utf8 ? utf8_next_start(buf, len) : 0;
+}
+
+
+
+// The byte converter: the current kernel over in, or only counting if
+// out is NULL. In UTF-8 mode this is what runs over the ASCII runs.
+static size_t convert_bytes(const char *in, char *out, size_t len,
+                            struct copy_stats *stats)
+{
+        size_t done;
+
+        if (Kernel == NULL) {
+                return xform_apply(Xform, in, out, len, stats);
+        }
+
+        done = Kernel(in, out, len, stats);
+        // whatever is left over is less than one block
+        convert_scalar(in + done, (out == NULL) ? NULL : out + done,
+                       len - done, stats);
+        return (out == NULL) ? 0 : len;
+}
+
+
+
+// Run the transform over buf, in place, and add the number of
+// characters copied, changed, newlines seen and punctuation
+// characters seen to the counters in stats. Returns the number of
+// characters now in buf.
+extern size_t convert_buffer(char *buf, size_t len, struct copy_stats *stats)
+{
+        return convert_copy(buf, buf, len, stats);
+}
+
+
+
+// The same as convert_buffer(), but the converted characters are
+// written to out instead of back into in. The buffers may not
+// partially overlap.
+extern size_t convert_copy(const char *in, char *out, size_t len,
+                           struct copy_stats *stats)
+{
+        if (Utf8) {
+                return utf8_convert(in, out, len, convert_bytes, stats);
+        }
+        return convert_bytes(in, out, len, stats);
+}
+
+
+
+// Count the characters in buf the same way convert_buffer() would,
+// without changing anything.
+extern void convert_count(const char *buf, size_t len,
+                          struct copy_stats *stats)
+{
+        if (Utf8) {
+                utf8_convert(buf, NULL, len, convert_bytes, stats);
+        } else {
+                convert_bytes(buf, NULL, len, stats);
+        }
+}
+
+
+
+// A hash (FNV-1a) of the transform table and mode, so that a resumed
+// copy can check that it is converting the same way as before.
+extern uint32_t convert_fingerprint(void)
+{
+        uint32_t hash = FNV_OFFSET;
+
+        for (int c = 0; c < XFORM_BYTES; c++) {
+                hash = (hash ^ Xform->table[c].out) * FNV_PRIME;
+                hash = (hash ^ Xform->table[c].keep) * FNV_PRIME;
+        }
+        hash = (hash ^ Xform->rule) * FNV_PRIME;
+        hash = (hash ^ Utf8) * FNV_PRIME;
+        return hash;
+}
+
+
+
+// Add the counters in part to the counters in total.
+extern void convert_add_stats(struct copy_stats *total,
+                              const struct copy_stats *part)
+{
+        total->chars_copied += part->chars_copied;
+        total->chars_changed += part->chars_changed;
+        total->lines += part->lines;
+        total->punct_chars += part->punct_chars;
+}
+
+// end of convert.c
@@ -0,0 +1,93 @@
+// ----------------------------------------------------------------------
+// file: convert.h
+//
+// Description: This is the header file for the CONVERT module. This
+//     module runs a transform (normally lower-case to upper-case) over
+//     a buffer and counts what it saw while doing so.
+//
+// Created: 2026-10-17
+// ----------------------------------------------------------------------
+#ifndef CONVERT_H
+#define CONVERT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "xform.h"
+#include "common.h"
+
+#define CONVERT_MAX_CARRY 3     // most bytes convert_split_point() keeps
+
+// This function must be called before the first call to
+// convert_buffer(). It sets the transform to use, which must have
+// been through xform_finish() and must stay around, and picks the
+// fastest kernel the CPU supports for it.
+extern void convert_init(const struct xform *x);
+
+
+// Force a particular kernel: "scalar", "table", "sse2" or "avx2".
+// Returns SUCCESS, or FAILURE if the name is unknown, the CPU does
+// not support that kernel, or it cannot run the transform.
+extern int convert_select(const char *name);
+
+
+// The name of the kernel that convert_buffer() is currently using.
+extern const char *convert_kernel_name(void);
+
+
+// Treat the input as UTF-8 from now on: the transform applies to
+// ASCII characters, non-ASCII code points are changed to upper- or
+// lower-case if the transform is "upper" or "lower", and characters
+// are counted as code points. Call it after convert_init().
+extern void convert_use_utf8(void);
+
+
+// Does the transform delete characters, or work on UTF-8? If so the
+// output of a copy can be a different length than the input.
+extern int convert_changes_length(void);
+
+
+// The most bytes that converting len bytes can produce. When this is
+// more than len, convert_buffer() cannot be used; use convert_copy()
+// with an output buffer this big.
+extern size_t convert_max_output(size_t len);
+
+
+// The largest n <= len such that the first n bytes of buf can be
+// converted on their own (len, unless buf ends part-way through a
+// UTF-8 character). The rest should be kept for the next buffer.
+extern size_t convert_split_point(const char *buf, size_t len);
+
+
+// The number of bytes to skip at the start of buf to get to the start
+// of a character (always 0 outside UTF-8 mode). A buffer can be cut
+// there and the two pieces converted separately.
+extern size_t convert_next_start(const char *buf, size_t len);
+
+
+// Run the transform over buf, in place, and add the number of
+// characters copied, changed, newlines seen and punctuation
+// characters seen to the counters in stats. Returns the number of
+// characters now in buf.
+extern size_t convert_buffer(char *buf, size_t len, struct copy_stats *stats);
+
+// The same as convert_buffer(), but the converted characters are
+// written to out instead of back into in. The buffers may not
+// partially overlap.
+extern size_t convert_copy(const char *in, char *out, size_t len,
+                           struct copy_stats *stats);
+
+// Count the characters in buf the same way convert_buffer() would,
+// without changing anything.
+extern void convert_count(const char *buf, size_t len,
+                          struct copy_stats *stats);
+
+// A hash of the transform and mode, so that a resumed copy can check
+// that it is converting the same way as the run it carries on from.
+extern uint32_t convert_fingerprint(void);
+
+// Add the counters in part to the counters in total.
+extern void convert_add_stats(struct copy_stats *total,
+                              const struct copy_stats *part);
+
+#endif
+// end of convert.h
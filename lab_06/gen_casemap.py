@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+# ------------------------------------------------------------------------
+#  file: gen_casemap.py
+#
+#  Description: Generates casemap.h, the compact Unicode case-mapping
+#      tables used by the UTF8 module of mycopy. Only simple one-to-one
+#      mappings are kept (a character whose upper-case form is more
+#      than one character, like U+00DF, is left alone). Runs of
+#      characters that map with the same offset, either every code
+#      point (a-z) or every other one (the Latin Extended pairs), are
+#      stored as one range.
+#
+#  Usage:
+#      python3 gen_casemap.py > casemap.h
+#
+#  Created: 2026-10-17
+# ------------------------------------------------------------------------
+import sys
+import unicodedata
+
+MAX_CODE_POINT = 0x10FFFF
+MAX_RUN = 0xFFFF
+
+
+def utf8_len(cp):
+    return len(chr(cp).encode('utf-8', 'surrogatepass'))
+
+
+def simple_mappings(convert):
+    # every non-ASCII code point whose mapping is a single, different
+    # character (ASCII is handled by the byte tables)
+    pairs = []
+    for cp in range(0x80, MAX_CODE_POINT + 1):
+        if 0xD800 <= cp <= 0xDFFF:
+            continue
+        mapped = convert(chr(cp))
+        if len(mapped) == 1 and mapped != chr(cp):
+            pairs.append((cp, ord(mapped) - cp))
+    return pairs
+
+
+def ranges(pairs):
+    # greedily join mappings into (first, count, stride, delta) runs
+    result = []
+    i = 0
+    while i < len(pairs):
+        first, delta = pairs[i]
+        best = (1, 1)
+        for stride in (1, 2):
+            count = 1
+            j = i + 1
+            while (j < len(pairs) and count < MAX_RUN and
+                   pairs[j][0] == first + count * stride and
+                   pairs[j][1] == delta):
+                count += 1
+                j += 1
+            if count > best[0]:
+                best = (count, stride)
+        result.append((first, best[0], best[1], delta))
+        i += best[0]
+    # the C code finds a range by binary search, so none may overlap
+    for before, after in zip(result, result[1:]):
+        if before[0] + (before[1] - 1) * before[2] >= after[0]:
+            sys.exit('ranges overlap at U+%04X' % after[0])
+    return result
+
+
+def growth(pairs):
+    # the most output bytes one input byte can turn into
+    worst = 1.0
+    for cp, delta in pairs:
+        worst = max(worst, utf8_len(cp + delta) / utf8_len(cp))
+    return worst
+
+
+def table(name, runs):
+    lines = ['static const struct case_range %s[] = {' % name]
+    for first, count, stride, delta in runs:
+        lines.append('        { 0x%05X, %5d, %d, %7d },' %
+                     (first, count, stride, delta))
+    lines.append('};')
+    return '\n'.join(lines)
+
+
+def main():
+    upper = simple_mappings(str.upper)
+    lower = simple_mappings(str.lower)
+    worst = max(growth(upper), growth(lower))
+    if worst > 1.5:
+        sys.exit('a mapping grows by more than 3/2; fix UTF8_MAX_OUTPUT')
+
+    print('// ' + '-' * 70)
+    print('// file: casemap.h')
+    print('//')
+    print('// Description: Simple Unicode case mappings for the UTF8 module,')
+    print('//     generated by gen_casemap.py from Unicode %s. Do not edit.'
+          % unicodedata.unidata_version)
+    print('//     Each range maps code points first, first+stride, ... (count of')
+    print('//     them) to the code point plus delta.')
+    print('// ' + '-' * 70)
+    print('#ifndef CASEMAP_H')
+    print('#define CASEMAP_H')
+    print()
+    print('#include <stdint.h>')
+    print()
+    print('struct case_range {')
+    print('        uint32_t first;')
+    print('        uint16_t count;')
+    print('        uint8_t stride;')
+    print('        int32_t delta;')
+    print('};')
+    print()
+    print(table('Upper_ranges', ranges(upper)))
+    print()
+    print(table('Lower_ranges', ranges(lower)))
+    print()
+    print('#endif')
+    print('// end of casemap.h')
+
+
+if __name__ == '__main__':
+    main()
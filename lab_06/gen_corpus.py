@@ -0,0 +1,100 @@
+#!/usr/bin/env python3
+# ------------------------------------------------------------------------
+#  file: gen_corpus.py
+#
+#  Description: Writes a synthetic test file for the mycopy benchmarks
+#      (bench.sh). The kinds are
+#          prose      ASCII words and punctuation, ~70 character lines
+#          binary     random bytes
+#          utf8       words in several scripts, ~70 character lines
+#          longlines  prose with lines of 64 KB to 1 MB
+#          nonewline  prose with no newlines at all
+#      A 1 MB block is generated from a fixed seed and repeated, so the
+#      same kind and size always gives the same file, and files of
+#      several GB are written at disk speed.
+#
+#  Usage:
+#      python3 gen_corpus.py kind size output_file
+#      (size in bytes, or with a K, M or G suffix)
+#
+#  Created: 2026-10-17
+# ------------------------------------------------------------------------
+import random
+import sys
+
+BLOCK_SIZE = 1024 * 1024
+SEED = 6
+SUFFIXES = {'K': 1024, 'M': 1024 ** 2, 'G': 1024 ** 3}
+
+ASCII_WORDS = ['the', 'quick', 'brown', 'fox', 'jumps', 'over', 'lazy',
+               'dog', 'copy', 'file', 'buffer', 'Lines', 'of', 'Text',
+               'a', 'and', 'is', 'to', 'in', 'C', 'Unix', 'system']
+UTF8_WORDS = ['straße', 'Ünïcödé', 'naïve', 'café', 'Ελληνικά', 'λόγος',
+              'русский', 'Москва', '日本語', '漢字', 'ǅemal', 'Ꙁ',
+              'emoji😀', 'ａｂｃ'] + ASCII_WORDS
+PUNCTUATION = [',', '.', ';', '!', '?', ':', '-', '"']
+
+
+def parse_size(text):
+    suffix = text[-1:].upper()
+    if suffix in SUFFIXES:
+        return int(text[:-1]) * SUFFIXES[suffix]
+    return int(text)
+
+
+def words(rng, vocabulary, line_length):
+    # lines of about line_length characters (None: no newlines)
+    out = []
+    length = 0
+    while length < BLOCK_SIZE:
+        word = rng.choice(vocabulary)
+        if rng.random() < 0.1:
+            word += rng.choice(PUNCTUATION)
+        if line_length is not None and length > 0 and \
+                rng.random() < len(word) / line_length:
+            word += '\n'
+        else:
+            word += ' '
+        out.append(word)
+        length += len(word.encode('utf-8'))
+    return ''.join(out).encode('utf-8')
+
+
+def block(kind, rng):
+    if kind == 'prose':
+        return words(rng, ASCII_WORDS, 70)
+    if kind == 'binary':
+        return bytes(rng.getrandbits(8) for _ in range(BLOCK_SIZE))
+    if kind == 'utf8':
+        return words(rng, UTF8_WORDS, 70)
+    if kind == 'longlines':
+        return words(rng, ASCII_WORDS, rng.randint(64 * 1024, BLOCK_SIZE))
+    if kind == 'nonewline':
+        return words(rng, ASCII_WORDS, None)
+    raise SystemExit('unknown kind: ' + kind)
+
+
+def main():
+    if len(sys.argv) != 4:
+        raise SystemExit('usage: gen_corpus.py kind size output_file')
+    kind, size, name = sys.argv[1], parse_size(sys.argv[2]), sys.argv[3]
+    data = block(kind, random.Random(SEED))
+
+    with open(name, 'wb') as out:
+        left = size
+        while left >= len(data):
+            out.write(data)
+            left -= len(data)
+        tail = data[:left]
+        if kind != 'binary':
+            # do not end part-way through a UTF-8 character
+            while tail and (tail[-1] & 0xC0) == 0x80:
+                tail = tail[:-1]
+            if tail and tail[-1] >= 0xC0:
+                tail = tail[:-1]
+            tail += b' ' * (left - len(tail))
+        out.write(tail)
+
+
+if __name__ == '__main__':
+    main()
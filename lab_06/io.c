@@ -0,0 +1,878 @@
+// ----------------------------------------------------------------------
+// file: io.c
+//
+// Description: This file implements the IO module. Every backend ends
+//     up handing buffers to the CONVERT module; they only differ in
+//     how the bytes get in and out of memory. With more than one
+//     thread, the stdio and buffered backends run the PIPELINE module,
+//     and the mmap backend gives each thread its own slice of the
+//     mapping, since nothing has to be written back in order.
+//
+// Created: 2026-10-17
+// ----------------------------------------------------------------------
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "io.h"
+#include "convert.h"
+#include "pipeline.h"
+#include "checkpoint.h"
+#include "uring.h"
+#include "common.h"
+
+#define BUFSIZE 64                          // stdio backend buffer
+#define SERIAL 1                            // one thread, no pipeline
+#define MIN_SLICE (PIPELINE_CHUNK_SIZE)     // smallest mmap slice
+#define TARGET_MODE 0666                    // before the umask
+
+
+// What a resumable copy needs to write its checkpoints. The offsets
+// passed to save_checkpoint() are from where this run started.
+struct resume {
+        const char *dst_name;
+        int src_fd;
+        int dst_fd;
+        unsigned long long interval;       // bytes between checkpoints
+        unsigned long long next;           // when to write the next one
+        unsigned long long source_start;
+        unsigned long long target_start;
+        struct checkpoint ck;
+};
+
+
+// A slice of a mapped file for one thread to convert.
+struct slice {
+        const char *in;
+        char *out;
+        size_t len;
+        struct copy_stats stats;
+};
+
+// Set by io_set_buffer_size(); 0 means each backend's own size.
+static size_t Buffer_size = 0;
+
+static const char *Backend_names[] = { "auto", "stdio", "buffered", "mmap", "uring" };
+
+#define NUM_BACKENDS (sizeof(Backend_names) / sizeof(Backend_names[0]))
+
+
+
+// Look up a backend by the name used on the command-line ("auto",
+// "stdio", "buffered" or "mmap"). Returns the IO_ value, or FAILURE
+// if the name is unknown.
+extern int io_backend_from_name(const char *name)
+{
+        for (size_t i = 0; i < NUM_BACKENDS; i++) {
+                if (!strcmp(name, Backend_names[i])) {
+                        return i;
+                }
+        }
+        return FAILURE;
+}
+
+
+
+// Use size bytes for every read and write buffer (and pipeline chunk)
+// from now on, instead of each backend's own size. 0 goes back to the
+// defaults.
+extern void io_set_buffer_size(size_t size)
+{
+        Buffer_size = size;
+}
+
+
+
+// The buffer size to use where the default would be fallback.
+static size_t buffer_size(size_t fallback)
+{
+        return (Buffer_size != 0) ? Buffer_size : fallback;
+}
+
+
+
+// pipeline_io callbacks for stdio streams
+static ssize_t stdio_read(void *src, char *buf, size_t len)
+{
+        size_t count = fread(buf, 1, len, src);
+
+        if (ferror((FILE *)src)) {
+                return -1;
+        }
+        return count;
+}
+
+
+
+static ssize_t stdio_write(void *dst, const char *buf, size_t len)
+{
+        if (fwrite(buf, 1, len, dst) != len) {
+                return -1;
+        }
+        return len;
+}
+
+
+
+// pipeline_io callbacks for file descriptors. The handle points at
+// the descriptor. Both keep going after short reads and writes.
+static ssize_t fd_read(void *src, char *buf, size_t len)
+{
+        int fd = *(int *)src;
+        size_t done = 0;
+        ssize_t count;
+
+        while (done < len) {
+                count = read(fd, buf + done, len - done);
+                if (count < 0) {
+                        if (errno == EINTR) {
+                                continue;
+                        }
+                        return -1;
+                }
+                if (count == 0) {
+                        break;
+                }
+                done += count;
+        }
+        return done;
+}
+
+
+
+static ssize_t fd_write(void *dst, const char *buf, size_t len)
+{
+        int fd = *(int *)dst;
+        size_t done = 0;
+        ssize_t count;
+
+        while (done < len) {
+                count = write(fd, buf + done, len - done);
+                if (count < 0) {
+                        if (errno == EINTR) {
+                                continue;
+                        }
+                        return -1;
+                }
+                done += count;
+        }
+        return done;
+}
+
+
+
+// Copy (or, if io->write is NULL, only count) io->src on this thread
+// through a buffer of bufsize bytes. Any part of a character left at
+// the end of a read is carried over to the front of the next one.
+static int stream_copy(const struct pipeline_io *io, size_t bufsize,
+                       struct copy_stats *stats)
+{
+        char *in = NULL;
+        char *out = NULL;
+        size_t carry = 0;
+        unsigned long long read_bytes = 0;
+        unsigned long long written_bytes = 0;
+        size_t avail;
+        size_t split;
+        ssize_t count;
+        ssize_t converted;
+        int result = SUCCESS;
+
+        if (posix_memalign((void **)&in, IO_ALIGNMENT, bufsize) != 0) {
+                return ERR_MEMORY;
+        }
+        // convert in place unless the output can grow
+        out = in;
+        if ((io->write != NULL) && (convert_max_output(bufsize) > bufsize)) {
+                if (posix_memalign((void **)&out, IO_ALIGNMENT,
+                                   convert_max_output(bufsize)) != 0) {
+                        free(in);
+                        return ERR_MEMORY;
+                }
+        }
+
+        for (;;) {
+                count = io->read(io->src, in + carry, bufsize - carry);
+                if (count < 0) {
+                        result = ERR_READ;
+                        break;
+                }
+                avail = carry + count;
+                if (avail == 0) {
+                        break;
+                }
+                // at the end, whatever is left is converted as it is
+                split = (count == 0) ? avail : convert_split_point(in, avail);
+
+                if (io->write == NULL) {
+                        convert_count(in, split, stats);
+                } else {
+                        converted = convert_copy(in, out, split, stats);
+                        if (io->write(io->dst, out, converted) != converted) {
+                                result = ERR_WRITE;
+                                break;
+                        }
+                        read_bytes += split;
+                        written_bytes += converted;
+                        if (io->progress != NULL) {
+                                result = io->progress(io->progress_arg, read_bytes,
+                                                      written_bytes, stats);
+                                if (result != SUCCESS) {
+                                        break;
+                                }
+                        }
+                }
+
+                carry = avail - split;
+                memmove(in, in + split, carry);
+                if (count == 0) {
+                        break;
+                }
+        }
+
+        if (out != in) {
+                free(out);
+        }
+        free(in);
+        return result;
+}
+
+
+
+// The stdio backend: the original lab 6 approach.
+static int copy_stdio(const char *src_name,
+                      const char *dst_name,
+                      int nthreads,
+                      struct copy_stats *stats)
+{
+        FILE *readFilePointer = NULL;
+        FILE *writeFilePointer = NULL;
+        struct pipeline_io io;
+        int result;
+
+        readFilePointer = fopen(src_name, "r");
+        if (readFilePointer == NULL) {
+                return ERR_OPEN_SOURCE;
+        }
+        writeFilePointer = fopen(dst_name, "w");
+        if (writeFilePointer == NULL) {
+                fclose(readFilePointer);
+                return ERR_OPEN_TARGET;
+        }
+
+        // with --bufsize, the streams' own buffers are that size too
+        if (Buffer_size != 0) {
+                setvbuf(readFilePointer, NULL, _IOFBF, Buffer_size);
+                setvbuf(writeFilePointer, NULL, _IOFBF, Buffer_size);
+        }
+
+        // 8. The  program must use the standard C file functions,  not the Unix file functions.
+        // 9. The  program must use the buffer approach rather than reading and writing one character at a time.
+        io.read = stdio_read;
+        io.write = stdio_write;
+        io.src = readFilePointer;
+        io.dst = writeFilePointer;
+        io.progress = NULL;
+        if (nthreads > SERIAL) {
+                result = pipeline_copy(&io, nthreads,
+                                       buffer_size(PIPELINE_CHUNK_SIZE), stats);
+        } else {
+                result = stream_copy(&io, buffer_size(BUFSIZE), stats);
+        }
+
+        if ((fclose(readFilePointer) != 0) && (result == SUCCESS)) {
+                result = ERR_CLOSE;
+        }
+        if ((fclose(writeFilePointer) != 0) && (result == SUCCESS)) {
+                // buffered data that could not be flushed is a write error
+                result = ERR_WRITE;
+        }
+        return result;
+}
+
+
+
+// The buffered backend: large aligned buffers and plain read/write.
+static int copy_buffered(int src_fd, int dst_fd, int nthreads,
+                         struct copy_stats *stats)
+{
+        struct pipeline_io io;
+
+        // only a hint, so a failure (e.g. on a pipe) does not matter
+        posix_fadvise(src_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+        io.read = fd_read;
+        io.write = fd_write;
+        io.src = &src_fd;
+        io.dst = &dst_fd;
+        io.progress = NULL;
+        if (nthreads > SERIAL) {
+                return pipeline_copy(&io, nthreads,
+                                     buffer_size(PIPELINE_CHUNK_SIZE), stats);
+        }
+        return stream_copy(&io, buffer_size(IO_BUFFER_SIZE), stats);
+}
+
+
+
+// Thread body for convert_mapped().
+static void *convert_slice(void *arg)
+{
+        struct slice *s = arg;
+
+        if (s->out == NULL) {
+                convert_count(s->in, s->len, &s->stats);
+        } else {
+                convert_copy(s->in, s->out, s->len, &s->stats);
+        }
+        return NULL;
+}
+
+
+
+// Convert size bytes of a mapped file from in to out (or only count
+// them if out is NULL), with one slice per thread but no slice smaller
+// than MIN_SLICE. Returns SUCCESS, ERR_MEMORY or ERR_THREAD.
+static int convert_mapped(const char *in, char *out, size_t size,
+                          int nthreads, struct copy_stats *stats)
+{
+        struct slice *slices = NULL;
+        pthread_t *threads = NULL;
+        size_t nslices;
+        size_t step;
+        size_t started = 1;
+        int result = SUCCESS;
+
+        nslices = (size + MIN_SLICE - 1) / MIN_SLICE;
+        if (nthreads < 1) {
+                nthreads = 1;
+        }
+        if (nslices > (size_t)nthreads) {
+                nslices = nthreads;
+        }
+        if (nslices == 0) {
+                return SUCCESS;
+        }
+        step = (size + nslices - 1) / nslices;
+
+        slices = calloc(nslices, sizeof(*slices));
+        threads = calloc(nslices, sizeof(*threads));
+        if ((slices == NULL) || (threads == NULL)) {
+                free(threads);
+                free(slices);
+                return ERR_MEMORY;
+        }
+        // each slice starts at a character boundary and runs up to
+        // the start of the next slice
+        for (size_t i = 0; i < nslices; i++) {
+                size_t offset = i * step;
+
+                if (offset > size) {
+                        offset = size;
+                }
+                if (i > 0) {
+                        offset += convert_next_start(in + offset, size - offset);
+                }
+
+                slices[i].in = in + offset;
+                slices[i].out = (out == NULL) ? NULL : out + offset;
+                if (i > 0) {
+                        slices[i - 1].len = slices[i].in - slices[i - 1].in;
+                }
+        }
+        slices[nslices - 1].len = in + size - slices[nslices - 1].in;
+
+        // slice 0 runs on this thread
+        for (started = 1; started < nslices; started++) {
+                if (pthread_create(&threads[started], NULL,
+                                   convert_slice, &slices[started]) != 0) {
+                        result = ERR_THREAD;
+                        break;
+                }
+        }
+        convert_slice(&slices[0]);
+        for (size_t i = 1; i < started; i++) {
+                pthread_join(threads[i], NULL);
+        }
+        for (size_t i = 0; (result == SUCCESS) && (i < nslices); i++) {
+                convert_add_stats(stats, &slices[i].stats);
+        }
+
+        free(threads);
+        free(slices);
+        return result;
+}
+
+
+
+// The mmap backend: size the target, map both files, and convert
+// from one mapping straight into the other.
+static int copy_mmap(int src_fd, int dst_fd, size_t size, int nthreads,
+                     struct copy_stats *stats)
+{
+        char *in = MAP_FAILED;
+        char *out = MAP_FAILED;
+        int result;
+
+        // reserve the blocks now, so a full disk is an error here
+        // rather than a SIGBUS when a page of the mapping is written
+        if ((fallocate(dst_fd, 0, 0, size) != 0) &&
+            (errno != EOPNOTSUPP) && (errno != ENOSYS)) {
+                return ERR_WRITE;
+        }
+        if (ftruncate(dst_fd, size) != 0) {
+                return ERR_WRITE;
+        }
+
+        in = mmap(NULL, size, PROT_READ, MAP_PRIVATE, src_fd, 0);
+        if (in == MAP_FAILED) {
+                return ERR_READ;
+        }
+        out = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, dst_fd, 0);
+        if (out == MAP_FAILED) {
+                munmap(in, size);
+                return ERR_WRITE;
+        }
+        madvise(in, size, MADV_SEQUENTIAL);
+        madvise(out, size, MADV_SEQUENTIAL);
+
+        result = convert_mapped(in, out, size, nthreads, stats);
+
+        if ((munmap(out, size) != 0) && (result == SUCCESS)) {
+                result = ERR_WRITE;
+        }
+        munmap(in, size);
+        return result;
+}
+
+
+
+// The uring backend. Without io_uring, the pipeline (with at least one
+// worker thread) overlaps the reads, conversion and writes instead.
+static int copy_uring(int src_fd, int dst_fd, size_t size, int nthreads,
+                      struct copy_stats *stats)
+{
+        int result;
+
+        result = uring_copy(src_fd, dst_fd, size,
+                            buffer_size(IO_BUFFER_SIZE), stats);
+        if (result == URING_UNAVAILABLE) {
+                result = copy_buffered(src_fd, dst_fd,
+                                       (nthreads > SERIAL) ? nthreads : SERIAL + 1,
+                                       stats);
+        }
+        return result;
+}
+
+
+
+// Count the characters that come from fd, which may be a pipe.
+static int count_buffered(int fd, struct copy_stats *stats)
+{
+        struct pipeline_io io;
+
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+        io.read = fd_read;
+        io.write = NULL;
+        io.src = &fd;
+        io.dst = NULL;
+        io.progress = NULL;
+        return stream_copy(&io, buffer_size(IO_BUFFER_SIZE), stats);
+}
+
+
+
+// Count the characters in a regular file by mapping it.
+static int count_mmap(int fd, size_t size, int nthreads,
+                      struct copy_stats *stats)
+{
+        char *in;
+        int result;
+
+        in = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (in == MAP_FAILED) {
+                return ERR_READ;
+        }
+        madvise(in, size, MADV_SEQUENTIAL);
+
+        result = convert_mapped(in, NULL, size, nthreads, stats);
+
+        munmap(in, size);
+        return result;
+}
+
+
+
+// Count the characters in src_name ("-" for standard input) the same
+// way io_copy() would, but without writing a copy anywhere.
+// Returns SUCCESS, or one of the ERR_ codes from common.h.
+extern int io_count(const char *src_name,
+                    int nthreads,
+                    struct copy_stats *stats)
+{
+        struct stat metadata;
+        int fd = STDIN_FILENO;
+        int result;
+
+        if (strcmp(src_name, IO_STDIN_NAME) != 0) {
+                fd = open(src_name, O_RDONLY);
+                if (fd < 0) {
+                        return ERR_OPEN_SOURCE;
+                }
+        }
+        if (fstat(fd, &metadata) != 0) {
+                result = ERR_OPEN_SOURCE;
+        } else if (S_ISREG(metadata.st_mode) &&
+                   (metadata.st_size >= IO_MMAP_THRESHOLD)) {
+                result = count_mmap(fd, metadata.st_size, nthreads, stats);
+        } else {
+                result = count_buffered(fd, stats);
+        }
+
+        if ((fd != STDIN_FILENO) && (close(fd) != 0) && (result == SUCCESS)) {
+                result = ERR_CLOSE;
+        }
+        return result;
+}
+
+
+
+// Copy the file src_name to the new file dst_name with the given
+// backend, converting it on nthreads threads. The counters for the
+// copy are stored in stats. The target must not already exist.
+// Returns SUCCESS, or one of the ERR_ codes from common.h.
+extern int io_copy(int backend,
+                   const char *src_name,
+                   const char *dst_name,
+                   int nthreads,
+                   struct copy_stats *stats)
+{
+        struct stat metadata;
+        int src_fd;
+        int dst_fd;
+        int flags = O_WRONLY;
+        int result;
+
+        if (backend == IO_STDIO) {
+                return copy_stdio(src_name, dst_name, nthreads, stats);
+        }
+
+        src_fd = open(src_name, O_RDONLY);
+        if (src_fd < 0) {
+                return ERR_OPEN_SOURCE;
+        }
+        if (fstat(src_fd, &metadata) != 0) {
+                close(src_fd);
+                return ERR_OPEN_SOURCE;
+        }
+
+        // Only regular files with something in them can be mapped.
+        // Everything else (pipes, devices, empty or /proc files) is
+        // read until the end instead. The same goes for io_uring, which
+        // reads at offsets up to the size. The target is only mapped
+        // when the transform keeps its size the same as the source.
+        if (!S_ISREG(metadata.st_mode) || (metadata.st_size == 0)) {
+                backend = IO_BUFFERED;
+        } else if (backend == IO_URING) {
+                // any transform will do
+        } else if (convert_changes_length()) {
+                backend = IO_BUFFERED;
+        } else if (backend == IO_AUTO) {
+                backend = (metadata.st_size >= IO_MMAP_THRESHOLD) ?
+                          IO_MMAP : IO_BUFFERED;
+        }
+        if (backend == IO_MMAP) {
+                // the mapping is read as well as written
+                flags = O_RDWR;
+        }
+
+        dst_fd = open(dst_name, flags | O_CREAT | O_EXCL, TARGET_MODE);
+        if (dst_fd < 0) {
+                close(src_fd);
+                return ERR_OPEN_TARGET;
+        }
+
+        if (backend == IO_MMAP) {
+                result = copy_mmap(src_fd, dst_fd, metadata.st_size,
+                                   nthreads, stats);
+        } else if (backend == IO_URING) {
+                result = copy_uring(src_fd, dst_fd, metadata.st_size,
+                                    nthreads, stats);
+        } else {
+                result = copy_buffered(src_fd, dst_fd, nthreads, stats);
+        }
+
+        if ((close(src_fd) != 0) && (result == SUCCESS)) {
+                result = ERR_CLOSE;
+        }
+        if ((close(dst_fd) != 0) && (result == SUCCESS)) {
+                result = ERR_CLOSE;
+        }
+        return result;
+}
+
+
+
+// The progress callback for a resumable copy: every interval bytes,
+// make the target durable up to this point and then record it.
+static int save_checkpoint(void *arg,
+                           unsigned long long read_bytes,
+                           unsigned long long written_bytes,
+                           const struct copy_stats *stats)
+{
+        struct resume *r = arg;
+        int result;
+
+        if (written_bytes < r->next) {
+                return SUCCESS;
+        }
+        r->next = written_bytes + r->interval;
+
+        // the data has to be on disk before the checkpoint that covers it
+        if (fdatasync(r->dst_fd) != 0) {
+                return ERR_WRITE;
+        }
+        r->ck.source_offset = r->source_start + read_bytes;
+        r->ck.target_offset = r->target_start + written_bytes;
+        r->ck.stats = *stats;
+        result = checkpoint_window_sum(r->src_fd, r->ck.source_offset,
+                                       &r->ck.source_sum);
+        if (result != SUCCESS) {
+                return result;
+        }
+        result = checkpoint_window_sum(r->dst_fd, r->ck.target_offset,
+                                       &r->ck.target_sum);
+        if (result != SUCCESS) {
+                return result;
+        }
+        return checkpoint_save(r->dst_name, &r->ck);
+}
+
+
+
+// Check that the checkpoint in r->ck still describes the source and
+// the target, and if it does, cut the target back to the checkpoint
+// and move both files to it.
+static int resume_from(struct resume *r)
+{
+        struct stat metadata;
+        uint32_t sum;
+
+        if ((fstat(r->dst_fd, &metadata) != 0) ||
+            ((unsigned long long)metadata.st_size < r->ck.target_offset)) {
+                return ERR_CHECKPOINT;
+        }
+        if ((checkpoint_window_sum(r->src_fd, r->ck.source_offset, &sum) != SUCCESS) ||
+            (sum != r->ck.source_sum)) {
+                return ERR_CHECKPOINT;
+        }
+        if ((checkpoint_window_sum(r->dst_fd, r->ck.target_offset, &sum) != SUCCESS) ||
+            (sum != r->ck.target_sum)) {
+                return ERR_CHECKPOINT;
+        }
+
+        // anything after the checkpoint may not have reached the disk
+        if (ftruncate(r->dst_fd, r->ck.target_offset) != 0) {
+                return ERR_WRITE;
+        }
+        if ((lseek(r->src_fd, r->ck.source_offset, SEEK_SET) < 0) ||
+            (lseek(r->dst_fd, r->ck.target_offset, SEEK_SET) < 0)) {
+                return ERR_READ;
+        }
+        r->source_start = r->ck.source_offset;
+        r->target_start = r->ck.target_offset;
+        return SUCCESS;
+}
+
+
+
+// Copy src_name to dst_name like io_copy() with the buffered backend,
+// writing a checkpoint every interval bytes of output. If dst_name
+// already exists, its checkpoint must match the source and the target,
+// and the copy carries on from it; the counters in stats are for the
+// whole file either way. The checkpoint is removed once the copy is
+// complete. Returns SUCCESS, or one of the ERR_ codes from common.h.
+extern int io_copy_resumable(const char *src_name,
+                             const char *dst_name,
+                             int nthreads,
+                             unsigned long long interval,
+                             struct copy_stats *stats)
+{
+        struct stat metadata;
+        struct pipeline_io io;
+        struct resume r;
+        int result;
+
+        memset(&r, 0, sizeof(r));
+        r.dst_name = dst_name;
+        r.interval = interval;
+
+        r.src_fd = open(src_name, O_RDONLY);
+        if (r.src_fd < 0) {
+                return ERR_OPEN_SOURCE;
+        }
+        // only a regular file can be read again from the middle
+        if ((fstat(r.src_fd, &metadata) != 0) || !S_ISREG(metadata.st_mode)) {
+                close(r.src_fd);
+                return ERR_OPEN_SOURCE;
+        }
+
+        r.dst_fd = open(dst_name, O_RDWR | O_CREAT | O_EXCL, TARGET_MODE);
+        if ((r.dst_fd < 0) && (errno == EEXIST)) {
+                // carry on from the checkpoint, if there is a good one
+                if ((checkpoint_load(dst_name, &r.ck) != SUCCESS) ||
+                    (r.ck.source_size != (unsigned long long)metadata.st_size) ||
+                    (r.ck.source_mtime != metadata.st_mtime) ||
+                    (r.ck.config != convert_fingerprint())) {
+                        close(r.src_fd);
+                        return ERR_CHECKPOINT;
+                }
+                r.dst_fd = open(dst_name, O_RDWR);
+                if (r.dst_fd < 0) {
+                        close(r.src_fd);
+                        return ERR_OPEN_TARGET;
+                }
+                result = resume_from(&r);
+                if (result != SUCCESS) {
+                        close(r.src_fd);
+                        close(r.dst_fd);
+                        return result;
+                }
+        } else if (r.dst_fd < 0) {
+                close(r.src_fd);
+                return ERR_OPEN_TARGET;
+        }
+
+        r.ck.source_size = metadata.st_size;
+        r.ck.source_mtime = metadata.st_mtime;
+        r.ck.config = convert_fingerprint();
+        *stats = r.ck.stats;
+
+        // a new target gets its checkpoint before any data, so a copy
+        // stopped before the first interval can still be resumed
+        r.next = interval;
+        if (r.ck.target_offset == 0) {
+                r.next = 0;
+                if (save_checkpoint(&r, 0, 0, stats) != SUCCESS) {
+                        close(r.src_fd);
+                        close(r.dst_fd);
+                        unlink(dst_name);
+                        return ERR_CHECKPOINT;
+                }
+        }
+
+        posix_fadvise(r.src_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        io.read = fd_read;
+        io.write = fd_write;
+        io.src = &r.src_fd;
+        io.dst = &r.dst_fd;
+        io.progress = save_checkpoint;
+        io.progress_arg = &r;
+        if (nthreads > SERIAL) {
+                result = pipeline_copy(&io, nthreads,
+                                       buffer_size(PIPELINE_CHUNK_SIZE), stats);
+        } else {
+                result = stream_copy(&io, buffer_size(IO_BUFFER_SIZE), stats);
+        }
+
+        // the checkpoint only goes once the whole copy is on disk
+        if ((result == SUCCESS) && (fsync(r.dst_fd) != 0)) {
+                result = ERR_WRITE;
+        }
+        if ((close(r.src_fd) != 0) && (result == SUCCESS)) {
+                result = ERR_CLOSE;
+        }
+        if ((close(r.dst_fd) != 0) && (result == SUCCESS)) {
+                result = ERR_CLOSE;
+        }
+        if (result == SUCCESS) {
+                checkpoint_remove(dst_name);
+        }
+        return result;
+}
+
+
+
+// Copy and convert len bytes of src_name, starting at offset, into the
+// same place in dst_name, which must already exist. Only usable when
+// the transform keeps the length the same (see convert_changes_length),
+// so that every byte of output has a fixed place in the target. The
+// counters for the range are added to stats.
+// Returns SUCCESS, or one of the ERR_ codes from common.h.
+extern int io_copy_range(const char *src_name,
+                         const char *dst_name,
+                         unsigned long long offset,
+                         unsigned long long len,
+                         struct copy_stats *stats)
+{
+        char *buf = NULL;
+        size_t bufsize = buffer_size(IO_BUFFER_SIZE);
+        size_t want;
+        size_t done;
+        ssize_t count;
+        int src_fd;
+        int dst_fd;
+        int result = SUCCESS;
+
+        src_fd = open(src_name, O_RDONLY);
+        if (src_fd < 0) {
+                return ERR_OPEN_SOURCE;
+        }
+        dst_fd = open(dst_name, O_WRONLY);
+        if (dst_fd < 0) {
+                close(src_fd);
+                return ERR_OPEN_TARGET;
+        }
+        posix_fadvise(src_fd, offset, len, POSIX_FADV_SEQUENTIAL);
+        if (posix_memalign((void **)&buf, IO_ALIGNMENT, bufsize) != 0) {
+                buf = NULL;
+                result = ERR_MEMORY;
+        }
+
+        while ((result == SUCCESS) && (len > 0)) {
+                want = (len < bufsize) ? len : bufsize;
+                count = pread(src_fd, buf, want, offset);
+                if ((count < 0) && (errno == EINTR)) {
+                        continue;
+                }
+                if (count <= 0) {
+                        // the source got shorter since it was looked at
+                        result = ERR_READ;
+                        break;
+                }
+                convert_copy(buf, buf, count, stats);
+                for (done = 0; done < (size_t)count; ) {
+                        ssize_t written = pwrite(dst_fd, buf + done,
+                                                 count - done, offset + done);
+
+                        if ((written < 0) && (errno == EINTR)) {
+                                continue;
+                        }
+                        if (written <= 0) {
+                                result = ERR_WRITE;
+                                break;
+                        }
+                        done += written;
+                }
+                offset += count;
+                len -= count;
+        }
+
+        free(buf);
+        if ((close(src_fd) != 0) && (result == SUCCESS)) {
+                result = ERR_CLOSE;
+        }
+        if ((close(dst_fd) != 0) && (result == SUCCESS)) {
+                result = ERR_CLOSE;
+        }
+        return result;
+}
+
+// end of io.c
@@ -0,0 +1,96 @@
+// ----------------------------------------------------------------------
+// file: io.h
+//
+// Description: This is the header file for the IO module. This module
+//     moves the bytes of a copy between the source and target files.
+//     It has three backends:
+//         stdio     fopen/fread/fwrite with a small buffer (the
+//                   original lab 6 approach)
+//         buffered  read/write with large page-aligned buffers and
+//                   posix_fadvise(SEQUENTIAL) on the source
+//         mmap      the source is mapped and converted straight into
+//                   a mapped, pre-sized target
+//         uring     io_uring keeps several reads and writes in flight
+//                   while buffers are converted (see uring.h), or the
+//                   threaded pipeline if there is no io_uring
+//
+// Created: 2026-10-17
+// ----------------------------------------------------------------------
+#ifndef IO_H
+#define IO_H
+
+#include <stddef.h>
+#include "common.h"
+
+#define IO_AUTO 0         // pick buffered or mmap by the source size
+#define IO_STDIO 1
+#define IO_BUFFERED 2
+#define IO_MMAP 3
+#define IO_URING 4
+
+#define IO_MMAP_THRESHOLD (4 * 1024 * 1024)   // smallest file to mmap
+#define IO_BUFFER_SIZE (1024 * 1024)          // buffered backend size
+#define IO_ALIGNMENT 4096
+#define IO_STDIN_NAME "-"                     // io_count() reads stdin
+#define IO_MIN_BUFFER 16                      // smallest io_set_buffer_size()
+
+
+// Look up a backend by the name used on the command-line ("auto",
+// "stdio", "buffered", "mmap" or "uring"). Returns the IO_ value, or FAILURE
+// if the name is unknown.
+extern int io_backend_from_name(const char *name);
+
+
+// Use size bytes (at least IO_MIN_BUFFER) for every read and write
+// buffer, and every pipeline chunk, instead of each backend's own
+// size. 0 goes back to the defaults. The mmap backend has no buffers.
+extern void io_set_buffer_size(size_t size);
+
+
+// Copy the file src_name to the new file dst_name with the given
+// backend, converting it on nthreads threads. The counters for the
+// copy are stored in stats. The target must not already exist.
+// Returns SUCCESS, or one of the ERR_ codes from common.h.
+extern int io_copy(int backend,
+                   const char *src_name,
+                   const char *dst_name,
+                   int nthreads,
+                   struct copy_stats *stats);
+
+
+// Copy src_name to dst_name like io_copy() with the buffered backend,
+// writing a checkpoint (see checkpoint.h) as soon as the target is
+// made and then every interval bytes of output. If dst_name already exists, its checkpoint must match the
+// source and the target, and the copy carries on from it; the counters
+// in stats are for the whole file either way. The checkpoint is
+// removed once the copy is complete.
+// Returns SUCCESS, or one of the ERR_ codes from common.h.
+extern int io_copy_resumable(const char *src_name,
+                             const char *dst_name,
+                             int nthreads,
+                             unsigned long long interval,
+                             struct copy_stats *stats);
+
+
+
+// Copy and convert len bytes of src_name, starting at offset, into the
+// same place in dst_name, which must already exist. Only usable when
+// the transform keeps the length the same (see convert_changes_length).
+// The counters for the range are added to stats.
+// Returns SUCCESS, or one of the ERR_ codes from common.h.
+extern int io_copy_range(const char *src_name,
+                         const char *dst_name,
+                         unsigned long long offset,
+                         unsigned long long len,
+                         struct copy_stats *stats);
+
+
+// Count the characters in src_name ("-" for standard input) the same
+// way io_copy() would, but without writing a copy anywhere.
+// Returns SUCCESS, or one of the ERR_ codes from common.h.
+extern int io_count(const char *src_name,
+                    int nthreads,
+                    struct copy_stats *stats);
+
+#endif
+// end of io.h
@@ -8,7 +8,56 @@
 //              punctuation tracked.
 //
 // Usage:
-//              ./mycopy source destination
+//              ./mycopy [options] source destination
+//              ./mycopy --stats-only [options] [file ...]
+//              ./mycopy -r [options] source_dir target_dir
+//
+//              -j threads  copy in large chunks, converting them on
+//                          a pool of worker threads (0 = one per CPU)
+//              -k kernel   force the conversion kernel: scalar,
+//                          table, sse2 or avx2 (default: the best
+//                          the CPU has for the transform)
+//              -t transform
+//                          upper (the default), lower, rot13 or none
+//              --tr SET1:SET2
+//                          then map SET1 to SET2 like tr(1), e.g.
+//                          --tr 'A-Z:a-z' or --tr '\n: '
+//              -d SET, --delete SET
+//                          then delete the characters in SET
+//
+//                          -t comes first, and then each --tr and -d
+//                          in the order given, each working on what
+//                          the ones before it produce: --tr a:b -d b
+//                          deletes the a's too, -d b --tr a:b does not.
+//              -u, --utf8  treat the text as UTF-8: non-ASCII letters
+//                          change case too (for -t upper and lower),
+//                          and characters are counted as code points
+//              --io backend
+//                          force the I/O backend: stdio, buffered,
+//                          mmap or uring (default: auto, picked by
+//                          file size). uring overlaps the reads and
+//                          writes with the conversion, using io_uring
+//                          or, without it, the threaded pipeline.
+//              --stats-only
+//                          only print the counters for each file (and
+//                          the total); nothing is written. With no
+//                          files, or "-", standard input is read.
+//                          Files are scanned in parallel, one thread
+//                          per CPU unless -j says otherwise.
+//              -r          copy the directory tree source_dir into
+//                          target_dir (made if it is not there). No
+//                          file in it is overwritten. Files are copied
+//                          in parallel, one thread per CPU unless -j
+//                          says otherwise, and large files are split
+//                          between the threads.
+//              --bufsize N[K|M|G]
+//                          use N-byte buffers (and pipeline chunks)
+//                          instead of each backend's default
+//              --resume    write a checkpoint (target.ckpt) as the
+//                          copy goes; if the target already exists,
+//                          carry on from its checkpoint
+//              --checkpoint-mb N
+//                          checkpoint every N MB of output (default 64)
 //
 // Created: 2017-11-09 (A.Hardt)
 // ----------------------------------------------------------------------
@@ -18,42 +67,408 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <errno.h>
-#include <ctype.h>
+#include <unistd.h>
+#include <getopt.h>
+#include "common.h"
+#include "convert.h"
+#include "io.h"
+#include "scan.h"
+#include "checkpoint.h"
+#include "tree.h"
+
+#define ARGNUM 2
+#define SOURCE_FILE_NAME argv[optind]
+#define TARGET_FILE_NAME argv[optind+1]
+#define SERIAL 1    // number of threads that means "no pipeline"
+#define OPT_IO 256  // long options without a short form
+#define OPT_STATS_ONLY 257
+#define OPT_TR 258
+#define OPT_RESUME 259
+#define OPT_CHECKPOINT_MB 260
+#define OPT_BUFSIZE 261
+#define MEGABYTE (1024ULL * 1024ULL)
+#define DEFAULT_TRANSFORM "upper"
+#define STDIN_LABEL "(standard input)"
+
+static const struct option Long_options[] = {
+        { "io", required_argument, NULL, OPT_IO },
+        { "stats-only", no_argument, NULL, OPT_STATS_ONLY },
+        { "tr", required_argument, NULL, OPT_TR },
+        { "delete", required_argument, NULL, 'd' },
+        { "utf8", no_argument, NULL, 'u' },
+        { "resume", no_argument, NULL, OPT_RESUME },
+        { "checkpoint-mb", required_argument, NULL, OPT_CHECKPOINT_MB },
+        { "bufsize", required_argument, NULL, OPT_BUFSIZE },
+        { NULL, 0, NULL, 0 }
+};
+
+// A --tr or -d, kept until the transform is built.
+struct step {
+        int option;         // OPT_TR or 'd'
+        const char *spec;
+};
+
+
+// Print the usage message and exit with a non-zero value.
+static void usage(void)
+{
+        fprintf(stderr, "Please enter 2 arguments in this format:\n");
+        fprintf(stderr, "\t\t$>./mycopy [options] source_file target_file\n");
+        fprintf(stderr, "\t\t$>./mycopy --stats-only [options] [file ...]\n");
+        fprintf(stderr, "\t\t$>./mycopy -r [options] source_dir target_dir\n");
+        fprintf(stderr, "Options:\n");
+        fprintf(stderr, "\t-j threads, -k scalar|table|sse2|avx2, --io auto|stdio|buffered|mmap|uring\n");
+        fprintf(stderr, "\t-t upper|lower|rot13|none, --tr SET1:SET2, -d SET, -u (UTF-8)\n");
+        fprintf(stderr, "\t--resume, --checkpoint-mb N, --bufsize N[K|M|G]\n");
+        fprintf(stderr, "For example:\n");
+        fprintf(stderr, "\t\t$>./mycopy input.txt output.txt\n");
+        exit(FAILURE);
+}
+
+
+
+// 10. The program shall   also    keep    track   of  the following   information while   performing  its job:
+    // a.The number of characters copied.
+    // b.The number of characters that were changed during  the copy.
+    // c.The number of lines in the file that were copied. For our purposes, we  will simplify the interpretation  of  this requirement to  be  the number of times ‘\n’  is seen in the file.
+    // d. The  number  of  punctuation characters  that    were    copied.
+static void print_stats(const struct copy_stats *stats)
+{
+        printf("Number of characters copied  = %llu\n", stats->chars_copied);
+        printf("Number of characters changed = %llu\n", stats->chars_changed);
+        printf("Number of lines in the file  = %llu\n", stats->lines);
+        printf("Number of punctuation chars  = %llu\n", stats->punct_chars);
+}
+
+
+
+// Parse a size such as "64", "4K" or "1M". Returns 0 if it is not one.
+static size_t parse_size(const char *text)
+{
+        unsigned long long size;
+        char *end;
 
-#define SUCCESS 0
-#define FAILURE -1
-#define ARGNUM 3
-#define SOURCE_FILE_NAME argv[1]
-#define TARGET_FILE_NAME argv[2]
-#define BUFSIZE 64
+        errno = SUCCESS;
+        size = strtoull(text, &end, 10);
+        if (errno || (end == text)) {
+                return 0;
+        }
+        switch (*end) {
+                case 'G':
+                case 'g':
+                        size *= 1024;
+                        // fall through
+                case 'M':
+                case 'm':
+                        size *= 1024;
+                        // fall through
+                case 'K':
+                case 'k':
+                        size *= 1024;
+                        end++;
+                        break;
+        }
+        return (*end == '\0') ? size : 0;
+}
+
+
+
+// Print a useful message for an error code returned by io_copy().
+static void report_error(int error, const char *source, const char *target)
+{
+        switch (error) {
+                case ERR_OPEN_SOURCE:
+                        fprintf(stderr, "Error opening: %s\n", source);
+                        break;
+                case ERR_OPEN_TARGET:
+                        fprintf(stderr, "Error, can not access : %s (likely a permission issue)\n", target);
+                        break;
+                case ERR_READ:
+                        fprintf(stderr, "Error reading: %s\n", source);
+                        break;
+                case ERR_WRITE:
+                        fprintf(stderr, "Error writing to: %s\n", target);
+                        break;
+                case ERR_CLOSE:
+                        fprintf(stderr, "Error attempting to close: %s or %s\n", source, target);
+                        break;
+                case ERR_MEMORY:
+                        fprintf(stderr, "Error: out of memory\n");
+                        break;
+                case ERR_CHECKPOINT:
+                        fprintf(stderr, "Error: %s exists, but has no checkpoint that matches %s\n", target, source);
+                        break;
+                default:
+                        fprintf(stderr, "Error: unable to start the copy threads\n");
+        }
+}
+
+
+
+
+// --stats-only: scan each of the nfiles names (standard input if there
+// are none), then print the counters for each one and, if there is
+// more than one, for all of them together. Returns the exit status.
+static int stats_only(int nfiles, char *names[], int threads)
+{
+        struct scan_file stdin_file = { IO_STDIN_NAME, SUCCESS, {0} };
+        struct scan_file *files = &stdin_file;
+        struct copy_stats total = {0};
+        const char *label;
+        int status = SUCCESS;
+
+        if (nfiles > 0) {
+                files = calloc(nfiles, sizeof(*files));
+                if (files == NULL) {
+                        fprintf(stderr, "Error: out of memory\n");
+                        return FAILURE;
+                }
+                for (int i = 0; i < nfiles; i++) {
+                        files[i].name = names[i];
+                }
+        } else {
+                nfiles = 1;
+        }
+
+        scan_files(files, nfiles, threads);
+
+        for (int i = 0; i < nfiles; i++) {
+                label = strcmp(files[i].name, IO_STDIN_NAME) ? files[i].name : STDIN_LABEL;
+                if (files[i].error != SUCCESS) {
+                        if (files[i].error == ERR_OPEN_SOURCE) {
+                                fprintf(stderr, "Error opening: %s\n", label);
+                        } else if (files[i].error == ERR_MEMORY) {
+                                fprintf(stderr, "Error: out of memory reading: %s\n", label);
+                        } else {
+                                fprintf(stderr, "Error reading: %s\n", label);
+                        }
+                        status = FAILURE;
+                        continue;
+                }
+                printf("%s:\n", label);
+                print_stats(&files[i].stats);
+                convert_add_stats(&total, &files[i].stats);
+        }
+        if (nfiles > 1) {
+                printf("total:\n");
+                print_stats(&total);
+        }
+
+        if (files != &stdin_file) {
+                free(files);
+        }
+        return status;
+}
+
+
+
+
+// -r: copy the tree under src_dir to dst_dir, then print the counters
+// for each file and for all of them together. Returns the exit status.
+static int copy_tree(const char *src_dir, const char *dst_dir,
+                     int backend, int threads)
+{
+        struct tree tree;
+        struct tree_entry *entry;
+        struct copy_stats total = {0};
+        struct stat metadata;
+        int status = SUCCESS;
+        int result;
+
+        if ((stat(src_dir, &metadata) != 0) || !S_ISDIR(metadata.st_mode)) {
+                fprintf(stderr, "Error: not a directory: %s\n", src_dir);
+                return FAILURE;
+        }
+
+        result = tree_walk(src_dir, dst_dir, &tree);
+        if (result != SUCCESS) {
+                report_error(result, src_dir, dst_dir);
+                tree_free(&tree);
+                return FAILURE;
+        }
+        if (tree_copy(&tree, backend, threads) != SUCCESS) {
+                status = FAILURE;
+        }
+
+        for (int i = 0; i < tree.nentries; i++) {
+                entry = &tree.entries[i];
+                if (entry->error != SUCCESS) {
+                        report_error(entry->error, entry->source, entry->target);
+                        continue;
+                }
+                if (entry->is_dir) {
+                        continue;
+                }
+                printf("%s:\n", entry->source);
+                print_stats(&entry->stats);
+                convert_add_stats(&total, &entry->stats);
+        }
+        printf("total:\n");
+        print_stats(&total);
+
+        tree_free(&tree);
+        return status;
+}
 
 // **********************************************************************
 // **************************  M  A  I  N  ******************************
 // **********************************************************************
 int main(int argc, char *argv[])
 {
+        struct copy_stats stats = {0};
+        struct xform xform;
+        const char *transform = DEFAULT_TRANSFORM;
+        const char *kernel = NULL;
+        struct step *steps = NULL;
+        int nsteps = 0;
+        int threads = SERIAL;
+        int backend = IO_AUTO;
+        int stats_mode = 0;
+        int tree_mode = 0;
+        int threads_given = 0;
+        int utf8 = 0;
+        int resume = 0;
+        unsigned long long checkpoint_mb = CHECKPOINT_DEFAULT_MB;
+        size_t bufsize;
+        int option;
+        int result;
+        char *end;
 
-        char current_buf_of_chars[BUFSIZE];
+        struct stat metadata;
 
-        FILE * readFilePointer = NULL;
-        FILE * writeFilePointer = NULL;
+        // there can be no more maps or deletes than arguments
+        steps = calloc(argc, sizeof(*steps));
+        if (steps == NULL) {
+                fprintf(stderr, "Error: out of memory\n");
+                exit(FAILURE);
+        }
 
-        int charsCopied = 0;
-        int linesCopied = 0;
-        int punctChars = 0;
-        int charsChanged = 0;
+        // pick up the options before the two file names
+        while ((option = getopt_long(argc, argv, "j:k:t:d:ur", Long_options, NULL)) != -1) {
+                switch (option) {
+                        case 'j':
+                                errno = SUCCESS;
+                                threads = strtol(optarg, &end, 10);
+                                if (errno || (*end != '\0') || (threads < 0)) {
+                                        fprintf(stderr, "Error: invalid thread count: %s\n", optarg);
+                                        exit(FAILURE);
+                                }
+                                if (threads == 0) {
+                                        threads = sysconf(_SC_NPROCESSORS_ONLN);
+                                }
+                                threads_given = 1;
+                                break;
+                        case 'k':
+                                kernel = optarg;
+                                break;
+                        case 't':
+                                transform = optarg;
+                                break;
+                        case OPT_TR:
+                        case 'd':
+                                steps[nsteps].option = option;
+                                steps[nsteps++].spec = optarg;
+                                break;
+                        case 'u':
+                                utf8 = 1;
+                                break;
+                        case 'r':
+                                tree_mode = 1;
+                                break;
+                        case OPT_IO:
+                                backend = io_backend_from_name(optarg);
+                                if (backend == FAILURE) {
+                                        fprintf(stderr, "Error: unknown I/O backend: %s\n", optarg);
+                                        exit(FAILURE);
+                                }
+                                break;
+                        case OPT_STATS_ONLY:
+                                stats_mode = 1;
+                                break;
+                        case OPT_BUFSIZE:
+                                bufsize = parse_size(optarg);
+                                if (bufsize < IO_MIN_BUFFER) {
+                                        fprintf(stderr, "Error: invalid buffer size (at least %d): %s\n",
+                                                IO_MIN_BUFFER, optarg);
+                                        exit(FAILURE);
+                                }
+                                io_set_buffer_size(bufsize);
+                                break;
+                        case OPT_RESUME:
+                                resume = 1;
+                                break;
+                        case OPT_CHECKPOINT_MB:
+                                errno = SUCCESS;
+                                checkpoint_mb = strtoull(optarg, &end, 10);
+                                if (errno || (*end != '\0') || (checkpoint_mb == 0)) {
+                                        fprintf(stderr, "Error: invalid checkpoint interval: %s\n", optarg);
+                                        exit(FAILURE);
+                                }
+                                resume = 1;
+                                break;
+                        default:
+                                usage();
+                }
+        }
 
-        size_t readFileContents;
-        struct stat metadata;
+        // build the transform table once: -t, then each --tr and -d in
+        // the order given
+        if (xform_init(&xform, transform) != SUCCESS) {
+                fprintf(stderr, "Error: unknown transform: %s\n", transform);
+                exit(FAILURE);
+        }
+        for (int i = 0; i < nsteps; i++) {
+                if (steps[i].option == OPT_TR) {
+                        if (xform_map(&xform, steps[i].spec) != SUCCESS) {
+                                fprintf(stderr, "Error: invalid map (want SET1:SET2): %s\n",
+                                        steps[i].spec);
+                                exit(FAILURE);
+                        }
+                } else if (xform_delete(&xform, steps[i].spec) != SUCCESS) {
+                        fprintf(stderr, "Error: invalid set to delete: %s\n", steps[i].spec);
+                        exit(FAILURE);
+                }
+        }
+        xform_finish(&xform);
+        free(steps);
 
-        //You should get two files on the command-line; otherwise, the program shall print a useful error message and exit with a non-zero value.
-        if(argc != ARGNUM) {
-                fprintf(stderr, "Please enter 2 arguments in this format:\n");
-                fprintf(stderr, "\t\t$>./mycopy source_file target_file\n");
-                fprintf(stderr, "For example:\n");
-                fprintf(stderr, "\t\t$>./mycopy input.txt output.txt\n");
+        // pick the fastest conversion kernel this CPU has for it
+        convert_init(&xform);
+        if ((kernel != NULL) && (convert_select(kernel) != SUCCESS)) {
+                fprintf(stderr, "Error: kernel not available: %s\n", kernel);
                 exit(FAILURE);
         }
+        if (utf8) {
+                convert_use_utf8();
+        }
+
+        // counting only: any number of files, and nothing is written
+        if (stats_mode) {
+                if (!threads_given) {
+                        threads = sysconf(_SC_NPROCESSORS_ONLN);
+                }
+                return stats_only(argc - optind, &argv[optind], threads);
+        }
+
+        // a whole directory tree, in one process
+        if (tree_mode) {
+                if (argc - optind != ARGNUM) {
+                        usage();
+                }
+                if (resume) {
+                        fprintf(stderr, "Error: --resume can not be used with -r\n");
+                        exit(FAILURE);
+                }
+                if (!threads_given) {
+                        threads = sysconf(_SC_NPROCESSORS_ONLN);
+                }
+                return copy_tree(SOURCE_FILE_NAME, TARGET_FILE_NAME, backend, threads);
+        }
+
+        //You should get two files on the command-line; otherwise, the program shall print a useful error message and exit with a non-zero value.
+        if(argc - optind != ARGNUM) {
+                usage();
+        }
 
         // If the source and destination file names are the same, then the program shall print a useful error message and exit with a non-zero value. [Note that comparing the two input strings will be good enough for this exercise, but in  general would not normally be good enough. For example, this simple test would fail to detect that they refer to the same file if one string is an absolute path to a file,   while the other string is a relative path to  the same file].
         if(!strcmp(SOURCE_FILE_NAME, TARGET_FILE_NAME)){
@@ -76,117 +491,28 @@ int main(int argc, char *argv[])
         stat(TARGET_FILE_NAME, &metadata);
         //if there is an error on stat, that is good, we want there to be an error, the file does not exist
         // if there is no error, that means the file exists...and that is bad
-        if (!errno) {
+        // (with --resume, it may be a copy that was interrupted)
+        if (!errno && !resume) {
                 errno = FAILURE;
                 fprintf(stderr, "Error: Target File already exists.\n");
                 exit(FAILURE);
         }
 
-        // Attempt to read source file, check for errors
-        errno = SUCCESS;
-        readFilePointer = fopen(SOURCE_FILE_NAME,"r");
-        if(errno != SUCCESS){
-
-                fprintf(stderr, "Error opening: %s\n", SOURCE_FILE_NAME);
-
-                // No fclose here because that causes a segmentation fault
-                readFilePointer = NULL;
-
-                exit(FAILURE);
+        // 6. If the program cannot  create  the destination file,   then    it  shall   print   a   useful  error message and exit    with    a   non-zero    value.
+        // 7. The  program shall copy the contents of  the source  file into the destination file while also changing any lower-case character to an  upper-case  character   before  it  is  written.
+        if (resume) {
+                result = io_copy_resumable(SOURCE_FILE_NAME, TARGET_FILE_NAME, threads,
+                                           checkpoint_mb * MEGABYTE, &stats);
+        } else {
+                result = io_copy(backend, SOURCE_FILE_NAME, TARGET_FILE_NAME, threads, &stats);
         }
-
-        // attempt to open target file location, check for errors
-        errno = SUCCESS;
-        writeFilePointer = fopen(TARGET_FILE_NAME, "w");
-        if(errno != SUCCESS){
-
-                fprintf(stderr, "Error, can not access : %s (likely a permission issue)\n", TARGET_FILE_NAME);
-
-                fclose(readFilePointer);
-                readFilePointer = NULL;
-
-                // No fclose here because that causes a segmentation fault
-                writeFilePointer = NULL;
-
+        if (result != SUCCESS) {
+                report_error(result, SOURCE_FILE_NAME, TARGET_FILE_NAME);
                 exit(FAILURE);
         }
 
+        print_stats(&stats);
 
-        //loop through file until end of file is reached:
-        while(!feof(readFilePointer)){
-
-                // iterate through file, populate buffer with chars, readFileContents is being updated too
-                readFileContents = fread(current_buf_of_chars,1,BUFSIZE,readFilePointer);
-
-                // loop over each char
-                for(int i = 0; i < readFileContents; i++){
-
-                        // 7. The  program shall copy the contents of  the source  file into the destination file while also changing any lower-case character to an  upper-case  character   before  it  is  written.
-                        if ( islower(current_buf_of_chars[i]) ){
-                                current_buf_of_chars[i] = toupper(current_buf_of_chars[i]);
-                                charsChanged ++;
-                        }
-
-                        if (current_buf_of_chars[i] == '\n'){
-                                linesCopied ++;
-                        }
-
-                        if ( ispunct(current_buf_of_chars[i]) ){
-                                punctChars ++;
-                        }
-
-                        charsCopied ++;
-                }// end for loop
-
-                //6. If the program cannot  create  the destination file,   then    it  shall   print   a   useful  error message and exit    with    a   non-zero    value.
-                // 8. The  program must use the standard C file functions,  not the Unix file functions.
-                // 9. The  program must use the buffer approach rather than reading and writing one character at a time.
-                errno = SUCCESS;
-                fwrite(current_buf_of_chars,1,readFileContents,writeFilePointer);
-                if(errno != SUCCESS){
-                        fprintf(stderr, "Error writing to: %s\n", TARGET_FILE_NAME);
-
-                        fclose(readFilePointer);
-                        readFilePointer = NULL;
-
-                        fclose(writeFilePointer);
-                        writeFilePointer = NULL;
-
-                        exit(FAILURE);
-                }
-
-        }//end while loop
-
-        // 10. The program shall   also    keep    track   of  the following   information while   performing  its job:
-            // a.The number of characters copied.
-            // b.The number of characters that were changed during  the copy.
-            // c.The number of lines in the file that were copied. For our purposes, we  will simplify the interpretation  of  this requirement to  be  the number of times ‘\n’  is seen in the file.
-            // d. The  number  of  punctuation characters  that    were    copied.
-        printf("Number of characters copied  = %d\n", charsCopied);
-        printf("Number of characters changed = %d\n", charsChanged);
-        printf("Number of lines in the file  = %d\n", linesCopied);
-        printf("Number of punctuation chars  = %d\n", punctChars);
-
-
-        //fclose source file:
-
-        errno = SUCCESS;
-        fclose(readFilePointer);
-        if(errno != SUCCESS){
-                fprintf(stderr, "Error attempting to close: %s\n", SOURCE_FILE_NAME);
-                exit(FAILURE);
-        }
-        readFilePointer = NULL;
-
-        // fclose target file
-
-        errno = SUCCESS;
-        fclose(writeFilePointer);
-        if(errno != SUCCESS){
-                fprintf(stderr, "Error attempting to close: %s\n", TARGET_FILE_NAME);
-                exit(FAILURE);
-        }
-        writeFilePointer = NULL;
 
         // if no failures, return 0
         return(SUCCESS);
@@ -0,0 +1,328 @@
+// ----------------------------------------------------------------------
+// file: pipeline.c
+//
+// Description: This file implements the PIPELINE module. The calling
+//     thread reads the source into a ring of chunk slots, a pool of
+//     worker threads converts the filled slots, and a writer thread
+//     writes the converted slots to the destination in order and adds
+//     up their counters. A slot goes FREE -> FILLED -> DONE -> FREE.
+//
+// Created: 2026-10-17
+// ----------------------------------------------------------------------
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "pipeline.h"
+#include "convert.h"
+#include "common.h"
+
+#define CHUNK_ALIGNMENT 4096
+#define SLOTS_PER_THREAD 2
+#define EXTRA_SLOTS 2
+
+#define SLOT_FREE 0      // can be filled by the reader
+#define SLOT_FILLED 1    // waiting for (or being converted by) a worker
+#define SLOT_DONE 2      // converted, waiting for the writer
+
+
+struct slot {
+        char *buf;
+        size_t len;
+        char *out;                 // buf, unless the output can grow
+        size_t out_len;
+        int state;
+        struct copy_stats stats;
+};
+
+struct pipeline {
+        pthread_mutex_t lock;
+        pthread_cond_t filled;     // workers wait on this
+        pthread_cond_t done;       // the writer waits on this
+        pthread_cond_t freed;      // the reader waits on this
+        struct slot *slots;
+        int nslots;
+        long next_read;            // next chunk number to be read
+        long next_work;            // next chunk number to be converted
+        long next_write;           // next chunk number to be written
+        bool eof;                  // the reader has seen the end
+        int error;                 // first error seen, or SUCCESS
+        const struct pipeline_io *io;
+        struct copy_stats total;   // only touched by the writer
+        unsigned long long read_bytes;
+        unsigned long long written_bytes;
+};
+
+
+
+// Record the first error and wake everybody up so they can quit.
+// Must be called with the lock held.
+static void set_error(struct pipeline *p, int error)
+{
+        if (p->error == SUCCESS) {
+                p->error = error;
+        }
+        pthread_cond_broadcast(&p->filled);
+        pthread_cond_broadcast(&p->done);
+        pthread_cond_broadcast(&p->freed);
+}
+
+
+
+// Worker thread: take the oldest filled chunk and convert it.
+static void *worker_main(void *arg)
+{
+        struct pipeline *p = arg;
+        struct slot *s;
+
+        for (;;) {
+                pthread_mutex_lock(&p->lock);
+                while ((p->error == SUCCESS) &&
+                       (p->next_work == p->next_read) && !p->eof) {
+                        pthread_cond_wait(&p->filled, &p->lock);
+                }
+                if ((p->error != SUCCESS) || (p->next_work == p->next_read)) {
+                        // an error, or nothing left to convert
+                        pthread_mutex_unlock(&p->lock);
+                        break;
+                }
+                s = &p->slots[p->next_work % p->nslots];
+                p->next_work++;
+                pthread_mutex_unlock(&p->lock);
+
+                // the transform may change the length of the chunk
+                s->out_len = convert_copy(s->buf, s->out, s->len, &s->stats);
+
+                pthread_mutex_lock(&p->lock);
+                s->state = SLOT_DONE;
+                pthread_cond_broadcast(&p->done);
+                pthread_mutex_unlock(&p->lock);
+        }
+
+        return NULL;
+}
+
+
+
+// Writer thread: write the converted chunks in the order they were read.
+static void *writer_main(void *arg)
+{
+        struct pipeline *p = arg;
+        struct slot *s;
+        ssize_t written;
+        int result;
+
+        for (;;) {
+                pthread_mutex_lock(&p->lock);
+                s = &p->slots[p->next_write % p->nslots];
+                while ((p->error == SUCCESS) &&
+                       !((p->next_write < p->next_read) &&
+                         (s->state == SLOT_DONE)) &&
+                       !(p->eof && (p->next_write == p->next_read))) {
+                        pthread_cond_wait(&p->done, &p->lock);
+                }
+                if ((p->error != SUCCESS) || (p->next_write == p->next_read)) {
+                        // an error, or everything has been written
+                        pthread_mutex_unlock(&p->lock);
+                        break;
+                }
+                pthread_mutex_unlock(&p->lock);
+
+                written = p->io->write(p->io->dst, s->out, s->out_len);
+
+                pthread_mutex_lock(&p->lock);
+                if (written != (ssize_t)s->out_len) {
+                        set_error(p, ERR_WRITE);
+                        pthread_mutex_unlock(&p->lock);
+                        break;
+                }
+                convert_add_stats(&p->total, &s->stats);
+                p->read_bytes += s->len;
+                p->written_bytes += s->out_len;
+                s->state = SLOT_FREE;
+                p->next_write++;
+                pthread_cond_signal(&p->freed);
+                pthread_mutex_unlock(&p->lock);
+
+                if (p->io->progress != NULL) {
+                        result = p->io->progress(p->io->progress_arg,
+                                                 p->read_bytes,
+                                                 p->written_bytes,
+                                                 &p->total);
+                        if (result != SUCCESS) {
+                                pthread_mutex_lock(&p->lock);
+                                set_error(p, result);
+                                pthread_mutex_unlock(&p->lock);
+                                break;
+                        }
+                }
+        }
+
+        return NULL;
+}
+
+
+
+// Read the source into free slots until the end of the file.
+// A chunk that ends part-way through a character is cut short, and
+// the rest of it goes at the front of the next chunk.
+// This runs on the calling thread.
+static void read_chunks(struct pipeline *p, size_t chunk_size)
+{
+        char carry[CONVERT_MAX_CARRY];
+        size_t ncarry = 0;
+        size_t avail;
+        size_t split;
+        struct slot *s;
+        ssize_t count;
+
+        for (;;) {
+                pthread_mutex_lock(&p->lock);
+                while ((p->error == SUCCESS) &&
+                       (p->next_read - p->next_write >= p->nslots)) {
+                        pthread_cond_wait(&p->freed, &p->lock);
+                }
+                if (p->error != SUCCESS) {
+                        pthread_mutex_unlock(&p->lock);
+                        break;
+                }
+                s = &p->slots[p->next_read % p->nslots];
+                pthread_mutex_unlock(&p->lock);
+
+                memcpy(s->buf, carry, ncarry);
+                count = p->io->read(p->io->src, s->buf + ncarry, chunk_size - ncarry);
+                if (count < 0) {
+                        pthread_mutex_lock(&p->lock);
+                        set_error(p, ERR_READ);
+                        pthread_mutex_unlock(&p->lock);
+                        break;
+                }
+                avail = ncarry + count;
+                if (avail == 0) {
+                        break;
+                }
+                // at the end, whatever is left is converted as it is
+                split = (count == 0) ? avail : convert_split_point(s->buf, avail);
+                ncarry = avail - split;
+                memcpy(carry, s->buf + split, ncarry);
+
+                pthread_mutex_lock(&p->lock);
+                s->len = split;
+                s->state = SLOT_FILLED;
+                memset(&s->stats, 0, sizeof(s->stats));
+                p->next_read++;
+                pthread_cond_signal(&p->filled);
+                pthread_mutex_unlock(&p->lock);
+
+                if (count == 0) {
+                        break;
+                }
+        }
+
+        pthread_mutex_lock(&p->lock);
+        p->eof = true;
+        pthread_cond_broadcast(&p->filled);
+        pthread_cond_broadcast(&p->done);
+        pthread_mutex_unlock(&p->lock);
+}
+
+
+
+// Copy io->src to io->dst, converting chunks of chunk_size bytes on
+// nthreads worker threads. The counters for the copy are added to
+// stats. Returns SUCCESS, or ERR_READ, ERR_WRITE, ERR_MEMORY or
+// ERR_THREAD on failure (or the error returned by io->progress).
+extern int pipeline_copy(const struct pipeline_io *io,
+                         int nthreads,
+                         size_t chunk_size,
+                         struct copy_stats *stats)
+{
+        struct pipeline p;
+        pthread_t writer;
+        pthread_t *workers = NULL;
+        int started = 0;
+        int result = SUCCESS;
+
+        if (nthreads < 1) {
+                nthreads = 1;
+        }
+
+        memset(&p, 0, sizeof(p));
+        pthread_mutex_init(&p.lock, NULL);
+        pthread_cond_init(&p.filled, NULL);
+        pthread_cond_init(&p.done, NULL);
+        pthread_cond_init(&p.freed, NULL);
+        p.io = io;
+        p.error = SUCCESS;
+        // progress reports include what was in stats to begin with
+        p.total = *stats;
+        p.nslots = nthreads * SLOTS_PER_THREAD + EXTRA_SLOTS;
+
+        workers = calloc(nthreads, sizeof(*workers));
+        p.slots = calloc(p.nslots, sizeof(*p.slots));
+        if ((workers == NULL) || (p.slots == NULL)) {
+                result = ERR_MEMORY;
+                goto cleanup;
+        }
+        for (int i = 0; i < p.nslots; i++) {
+                if (posix_memalign((void **)&p.slots[i].buf,
+                                   CHUNK_ALIGNMENT, chunk_size) != 0) {
+                        p.slots[i].buf = NULL;
+                        result = ERR_MEMORY;
+                        goto cleanup;
+                }
+                p.slots[i].out = p.slots[i].buf;
+                if (convert_max_output(chunk_size) > chunk_size) {
+                        p.slots[i].out = malloc(convert_max_output(chunk_size));
+                        if (p.slots[i].out == NULL) {
+                                result = ERR_MEMORY;
+                                goto cleanup;
+                        }
+                }
+        }
+
+        // start the writer, then the workers
+        if (pthread_create(&writer, NULL, writer_main, &p) != 0) {
+                result = ERR_THREAD;
+                goto cleanup;
+        }
+        for (started = 0; started < nthreads; started++) {
+                if (pthread_create(&workers[started], NULL,
+                                   worker_main, &p) != 0) {
+                        pthread_mutex_lock(&p.lock);
+                        set_error(&p, ERR_THREAD);
+                        pthread_mutex_unlock(&p.lock);
+                        break;
+                }
+        }
+
+        read_chunks(&p, chunk_size);
+
+        for (int i = 0; i < started; i++) {
+                pthread_join(workers[i], NULL);
+        }
+        pthread_join(writer, NULL);
+
+        result = p.error;
+        *stats = p.total;
+
+cleanup:
+        if (p.slots != NULL) {
+                for (int i = 0; i < p.nslots; i++) {
+                        if (p.slots[i].out != p.slots[i].buf) {
+                                free(p.slots[i].out);
+                        }
+                        free(p.slots[i].buf);
+                }
+                free(p.slots);
+        }
+        free(workers);
+        pthread_cond_destroy(&p.freed);
+        pthread_cond_destroy(&p.done);
+        pthread_cond_destroy(&p.filled);
+        pthread_mutex_destroy(&p.lock);
+
+        return result;
+}
+
+// end of pipeline.c
@@ -0,0 +1,53 @@
+// ----------------------------------------------------------------------
+// file: pipeline.h
+//
+// Description: This is the header file for the PIPELINE module. This
+//     module copies a file in large chunks. The chunks are converted
+//     on a pool of worker threads and written back in their original
+//     order.
+//
+// Created: 2026-10-17
+// ----------------------------------------------------------------------
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stddef.h>
+#include <sys/types.h>
+#include "common.h"
+
+#define PIPELINE_CHUNK_SIZE (4 * 1024 * 1024)
+
+
+// How the pipeline gets at the source and target. read() should fill
+// as much of buf as it can and return the number of bytes read, 0 at
+// the end of the source, or -1 on error. write() should write all of
+// buf and return len, or -1 on error.
+//
+// If progress is not NULL it is called after every write with the
+// number of bytes read and written so far, and the counters up to that
+// point. If it returns anything but SUCCESS, the copy stops and
+// returns that error.
+struct pipeline_io {
+        ssize_t (*read)(void *src, char *buf, size_t len);
+        ssize_t (*write)(void *dst, const char *buf, size_t len);
+        void *src;
+        void *dst;
+        int (*progress)(void *arg,
+                        unsigned long long read_bytes,
+                        unsigned long long written_bytes,
+                        const struct copy_stats *stats);
+        void *progress_arg;
+};
+
+
+// Copy io->src to io->dst, converting chunks of chunk_size bytes on
+// nthreads worker threads. The counters for the copy are added to
+// stats. Returns SUCCESS, or ERR_READ, ERR_WRITE, ERR_MEMORY or
+// ERR_THREAD on failure (or the error returned by io->progress).
+extern int pipeline_copy(const struct pipeline_io *io,
+                         int nthreads,
+                         size_t chunk_size,
+                         struct copy_stats *stats);
+
+#endif
+// end of pipeline.h
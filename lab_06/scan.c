@@ -0,0 +1,105 @@
+// ----------------------------------------------------------------------
+// file: scan.c
+//
+// Description: This file implements the SCAN module. A pool of
+//     threads takes the next unscanned file from the list until none
+//     are left. The calling thread is part of the pool, so the scan
+//     still finishes if no other thread can be started.
+//
+// Created: 2026-10-17
+//
+// ----------------------------------------------------------------------
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "scan.h"
+#include "io.h"
+#include "common.h"
+
+
+struct scan_pool {
+        pthread_mutex_t lock;
+        struct scan_file *files;
+        int nfiles;
+        int next;                  // next file to hand out
+        int threads_per_file;
+};
+
+
+
+// Thread body: scan files until there are none left.
+static void *scan_main(void *arg)
+{
+        struct scan_pool *pool = arg;
+        struct scan_file *file;
+
+        for (;;) {
+                pthread_mutex_lock(&pool->lock);
+                if (pool->next >= pool->nfiles) {
+                        pthread_mutex_unlock(&pool->lock);
+                        break;
+                }
+                file = &pool->files[pool->next++];
+                pthread_mutex_unlock(&pool->lock);
+
+                memset(&file->stats, 0, sizeof(file->stats));
+                file->error = io_count(file->name, pool->threads_per_file,
+                                       &file->stats);
+        }
+
+        return NULL;
+}
+
+
+
+// Fill in the error and stats of each of the nfiles entries in files,
+// using up to nthreads threads. Files are handed out in order to
+// whichever thread is free. A single file gets all of the threads.
+// Returns SUCCESS if every file was scanned, otherwise FAILURE.
+extern int scan_files(struct scan_file *files, int nfiles, int nthreads)
+{
+        struct scan_pool pool;
+        pthread_t *threads = NULL;
+        int started = 0;
+        int nworkers;
+
+        if (nthreads < 1) {
+                nthreads = 1;
+        }
+        nworkers = (nthreads < nfiles) ? nthreads : nfiles;
+
+        pthread_mutex_init(&pool.lock, NULL);
+        pool.files = files;
+        pool.nfiles = nfiles;
+        pool.next = 0;
+        pool.threads_per_file = (nfiles == 1) ? nthreads : 1;
+
+        // the calling thread is worker 0
+        if (nworkers > 1) {
+                threads = calloc(nworkers, sizeof(*threads));
+        }
+        if (threads != NULL) {
+                for (started = 1; started < nworkers; started++) {
+                        if (pthread_create(&threads[started], NULL,
+                                           scan_main, &pool) != 0) {
+                                break;
+                        }
+                }
+        }
+        scan_main(&pool);
+        for (int i = 1; i < started; i++) {
+                pthread_join(threads[i], NULL);
+        }
+
+        free(threads);
+        pthread_mutex_destroy(&pool.lock);
+
+        for (int i = 0; i < nfiles; i++) {
+                if (files[i].error != SUCCESS) {
+                        return FAILURE;
+                }
+        }
+        return SUCCESS;
+}
+
+// end of scan.c
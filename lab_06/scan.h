@@ -0,0 +1,31 @@
+// ----------------------------------------------------------------------
+// file: scan.h
+//
+// Description: This is the header file for the SCAN module. This
+//     module gets the counters for a list of files without copying
+//     them, working on several files at once.
+//
+// Created: 2026-10-17
+//
+// ----------------------------------------------------------------------
+#ifndef SCAN_H
+#define SCAN_H
+
+#include "common.h"
+
+// One file to be scanned, and what was found.
+struct scan_file {
+        const char *name;          // "-" for standard input
+        int error;                 // SUCCESS or one of the ERR_ codes
+        struct copy_stats stats;
+};
+
+
+// Fill in the error and stats of each of the nfiles entries in files,
+// using up to nthreads threads. Files are handed out in order to
+// whichever thread is free. A single file gets all of the threads.
+// Returns SUCCESS if every file was scanned, otherwise FAILURE.
+extern int scan_files(struct scan_file *files, int nfiles, int nthreads);
+
+#endif
+// end of scan.h
@@ -0,0 +1,370 @@
+// ----------------------------------------------------------------------
+// file: test.c
+//
+// Description: This is a program to test the modules of mycopy. Each
+//     check prints a "-Good:" or a "-Bad:" line; the program exits
+//     with a non-zero value if any of them was bad.
+//
+// Created: 2026-10-17
+//
+// ----------------------------------------------------------------------
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "common.h"
+#include "xform.h"
+#include "convert.h"
+#include "checkpoint.h"
+#include "io.h"
+#include "utf8.h"
+
+#define TEST_DIR_TEMPLATE "/tmp/mycopy-test.XXXXXX"
+#define MAX_NAME 256
+#define RESUME_SOURCE_SIZE (4 * 1024 * 1024)
+#define RESUME_LIMIT (1024 * 1024)         // the target may grow this far
+#define RESUME_INTERVAL (64ULL * 1024 * 1024)
+#define TEST_BUFFER 300                    // past two AVX2 vectors, and odd
+
+unsigned int Num_bad = 0;
+char Test_dir[] = TEST_DIR_TEMPLATE;
+struct xform Upper;
+
+
+
+// Print the result of one check.
+void check(int good, const char *what)
+{
+        if (good) {
+                printf("-Good: %s\n", what);
+        } else {
+                printf("-Bad: %s\n", what);
+                ++Num_bad;
+        }
+}
+
+
+
+// The name of file in the test directory.
+void test_name(char *name, const char *file)
+{
+        snprintf(name, MAX_NAME, "%s/%s", Test_dir, file);
+}
+
+
+
+// Write len bytes of text to name. Returns SUCCESS or FAILURE.
+int write_text(const char *name, size_t len)
+{
+        static const char words[] = "the quick brown fox, jumps over the lazy dog.\n";
+        FILE *file = fopen(name, "w");
+
+        if (file == NULL) {
+                return FAILURE;
+        }
+        for (size_t i = 0; i < len; i++) {
+                fputc(words[i % (sizeof(words) - 1)], file);
+        }
+        return (fclose(file) == 0) ? SUCCESS : FAILURE;
+}
+
+
+
+// Is target what "upper" makes of source?
+int is_upper_copy(const char *source, const char *target)
+{
+        FILE *in = fopen(source, "r");
+        FILE *out = fopen(target, "r");
+        int c;
+        int same = (in != NULL) && (out != NULL);
+
+        while (same && ((c = fgetc(in)) != EOF)) {
+                same = (fgetc(out) == toupper(c));
+        }
+        if (same) {
+                same = (fgetc(out) == EOF);
+        }
+        if (in != NULL) {
+                fclose(in);
+        }
+        if (out != NULL) {
+                fclose(out);
+        }
+        return same;
+}
+
+
+
+// The counters a copy of len bytes of in through "upper" should have.
+void upper_stats(const unsigned char *in, size_t len, struct copy_stats *stats)
+{
+        memset(stats, 0, sizeof(*stats));
+        for (size_t i = 0; i < len; i++) {
+                stats->chars_copied++;
+                stats->chars_changed += (islower(in[i]) != 0);
+                stats->lines += (in[i] == '\n');
+                stats->punct_chars += (ispunct(toupper(in[i])) != 0);
+        }
+}
+
+
+
+// Every kernel must give what the byte-at-a-time "upper" does, for
+// every byte value, at every length and alignment around the vector
+// widths.
+void test_kernels(void)
+{
+        static const char *kernels[] = { "scalar", "table", "sse2", "avx2" };
+        unsigned char in[TEST_BUFFER + 64];
+        unsigned char out[TEST_BUFFER + 64];
+        char what[MAX_NAME];
+        struct copy_stats stats;
+        struct copy_stats expected;
+        int good;
+
+        srand(1);
+        for (size_t i = 0; i < sizeof(in); i++) {
+                in[i] = (i < 256) ? i : rand() % 256;
+        }
+        for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+                if (convert_select(kernels[k]) != SUCCESS) {
+                        printf("-Good: kernel %s is not available here\n", kernels[k]);
+                        continue;
+                }
+                good = TRUE;
+                for (size_t start = 0; start < 33; start++) {
+                        for (size_t len = 0; len + start <= TEST_BUFFER; len += 1 + len / 4) {
+                                memset(&stats, 0, sizeof(stats));
+                                convert_copy((char *)in + start, (char *)out, len, &stats);
+                                upper_stats(in + start, len, &expected);
+                                for (size_t i = 0; i < len; i++) {
+                                        good = good && (out[i] == toupper(in[start + i]));
+                                }
+                                good = good && !memcmp(&stats, &expected, sizeof(stats));
+                        }
+                }
+                snprintf(what, sizeof(what), "kernel %s converts and counts like toupper()", kernels[k]);
+                check(good, what);
+        }
+        convert_init(&Upper);
+}
+
+
+
+// The other rules, tr-style maps and deletes.
+void test_xform(void)
+{
+        struct copy_stats stats;
+        struct xform x;
+        char out[MAX_NAME];
+        size_t len;
+
+        xform_init(&x, "rot13");
+        xform_finish(&x);
+        memset(&stats, 0, sizeof(stats));
+        len = xform_apply(&x, "Hello, World", out, strlen("Hello, World"), &stats);
+        check((len == 12) && !memcmp(out, "Uryyb, Jbeyq", len) &&
+              (stats.chars_changed == 10) && (stats.punct_chars == 1), "xform: rot13");
+
+        xform_init(&x, "none");
+        check(xform_map(&x, "a-c:x") == SUCCESS, "xform: a map with a range is taken");
+        check(xform_delete(&x, "\\n") == SUCCESS, "xform: a delete with an escape is taken");
+        xform_finish(&x);
+        len = xform_apply(&x, "abcd\nabc", out, strlen("abcd\nabc"), &stats);
+        check((len == 7) && !memcmp(out, "xxxdxxx", len), "xform: mapped and deleted");
+        check(xform_map(&x, "abc") == FAILURE, "xform: a map with no ':' is refused");
+
+        // each step works on what the ones before it produce
+        xform_init(&x, "none");
+        xform_map(&x, "a:b");
+        xform_delete(&x, "b");
+        xform_finish(&x);
+        len = xform_apply(&x, "abc", out, 3, &stats);
+        check((len == 1) && (out[0] == 'c'), "xform: a delete after a map deletes what it made");
+        xform_init(&x, "none");
+        xform_delete(&x, "b");
+        xform_map(&x, "a:b");
+        xform_finish(&x);
+        len = xform_apply(&x, "abc", out, 3, &stats);
+        check((len == 2) && !memcmp(out, "bc", len), "xform: a map after a delete is kept");
+        xform_init(&x, "upper");
+        xform_delete(&x, "a");
+        xform_finish(&x);
+        len = xform_apply(&x, "abc", out, 3, &stats);
+        check((len == 3) && !memcmp(out, "ABC", len), "xform: a delete comes after the rule");
+        check(xform_init(&x, "sideways") == FAILURE, "xform: an unknown rule is refused");
+}
+
+
+
+// Checkpoints are saved and loaded whole, a bad one is refused, and
+// the window sum is Adler-32.
+void test_checkpoint(void)
+{
+        struct checkpoint ck;
+        struct checkpoint loaded;
+        char target[MAX_NAME];
+        char sidecar[MAX_NAME];
+        uint32_t sum;
+        FILE *file;
+        int fd;
+
+        test_name(target, "ck-target");
+        test_name(sidecar, "ck-target" CHECKPOINT_SUFFIX);
+        memset(&ck, 0, sizeof(ck));
+        ck.source_size = 123456789012ULL;
+        ck.source_mtime = 1700000000;
+        ck.config = 0xdeadbeef;
+        ck.source_offset = 5000000000ULL;
+        ck.target_offset = 5000000001ULL;
+        ck.source_sum = 0x11e60398;
+        ck.target_sum = 1;
+        ck.stats.chars_copied = 42;
+        ck.stats.lines = 7;
+        check((checkpoint_save(target, &ck) == SUCCESS) &&
+              (checkpoint_load(target, &loaded) == SUCCESS) &&
+              !memcmp(&ck, &loaded, sizeof(ck)),
+              "checkpoint: what is saved is loaded");
+
+        file = fopen(sidecar, "w");
+        if (file != NULL) {
+                fputs("source_size=12\ngarbage\n", file);
+                fclose(file);
+        }
+        check(checkpoint_load(target, &loaded) == ERR_CHECKPOINT,
+              "checkpoint: a bad checkpoint is refused");
+        checkpoint_remove(target);
+        check(checkpoint_load(target, &loaded) == ERR_CHECKPOINT,
+              "checkpoint: a removed checkpoint is gone");
+
+        // the Adler-32 of "Wikipedia" is 0x11e60398
+        fd = open(sidecar, O_RDWR | O_CREAT | O_TRUNC, 0600);
+        check((fd >= 0) && (write(fd, "xxWikipedia", 11) == 11) &&
+              (checkpoint_window_sum(fd, 0, &sum) == SUCCESS) && (sum == 1),
+              "checkpoint: the sum of nothing is 1");
+        check((fd >= 0) && (pwrite(fd, "Wikipedia", 9, 0) == 9) &&
+              (checkpoint_window_sum(fd, 9, &sum) == SUCCESS) && (sum == 0x11e60398),
+              "checkpoint: the window sum is Adler-32");
+        if (fd >= 0) {
+                close(fd);
+        }
+}
+
+
+
+// UTF-8 mode: case changes past ASCII, code points counted once, bad
+// bytes passed through, and buffers cut only between characters.
+void test_utf8(void)
+{
+        // "straße é ÿ" and a stray continuation byte
+        const char in[] = "stra\xc3\x9f" "e \xc3\xa9 \xc3\xbf \x80!";
+        const char upper[] = "STRA\xc3\x9f" "E \xc3\x89 \xc5\xb8 \x80!";
+        char out[UTF8_MAX_OUTPUT(sizeof(in))];
+        struct copy_stats stats;
+        size_t len;
+
+        convert_use_utf8();
+        memset(&stats, 0, sizeof(stats));
+        len = convert_copy(in, out, strlen(in), &stats);
+        check((len == strlen(upper)) && !memcmp(out, upper, len),
+              "utf8: non-ASCII letters change case");
+        check((stats.chars_copied == 13) && (stats.chars_changed == 7),
+              "utf8: code points are counted, not bytes");
+        check(convert_split_point("ab\xc3", 3) == 2,
+              "utf8: a buffer is not cut inside a character");
+        check(convert_split_point("ab\xe2\x82\xac", 5) == 5,
+              "utf8: a buffer that ends on a whole character is kept whole");
+        check(convert_next_start("\x82\xac" "ab", 4) == 2,
+              "utf8: continuation bytes at the start are skipped");
+}
+
+
+
+// A resumable copy that is killed before its first interval must
+// leave a checkpoint, and carry on from it when run again.
+void test_resume(void)
+{
+        char source[MAX_NAME];
+        char target[MAX_NAME];
+        char sidecar[MAX_NAME];
+        struct copy_stats stats;
+        struct copy_stats whole;
+        struct rlimit limit = { RESUME_LIMIT, RESUME_LIMIT };
+        struct stat metadata;
+        int status;
+        pid_t pid;
+
+        test_name(source, "resume-source");
+        test_name(target, "resume-target");
+        test_name(sidecar, "resume-target" CHECKPOINT_SUFFIX);
+        if (write_text(source, RESUME_SOURCE_SIZE) != SUCCESS) {
+                check(FALSE, "resume: the source could not be written");
+                return;
+        }
+
+        // the child is killed by SIGXFSZ once the target reaches the limit
+        fflush(stdout);
+        pid = fork();
+        if (pid == 0) {
+                signal(SIGXFSZ, SIG_DFL);
+                setrlimit(RLIMIT_FSIZE, &limit);
+                io_copy_resumable(source, target, 1, RESUME_INTERVAL, &stats);
+                _exit(0);
+        }
+        waitpid(pid, &status, 0);
+        check(WIFSIGNALED(status) && (WTERMSIG(status) == SIGXFSZ),
+              "resume: the first copy was killed part way");
+        check((stat(target, &metadata) == 0) && (metadata.st_size > 0) &&
+              (metadata.st_size < RESUME_SOURCE_SIZE),
+              "resume: the first copy left part of the target");
+        check(stat(sidecar, &metadata) == 0,
+              "resume: the first copy left a checkpoint");
+
+        check(io_copy_resumable(source, target, 1, RESUME_INTERVAL, &stats) == SUCCESS,
+              "resume: the second copy carried on");
+        check(is_upper_copy(source, target), "resume: the target is the whole copy");
+        check(stat(sidecar, &metadata) != 0, "resume: the checkpoint was removed");
+
+        // the counters are for the whole file, as if it was never stopped
+        test_name(target, "resume-whole");
+        io_copy_resumable(source, target, 1, RESUME_INTERVAL, &whole);
+        check(!memcmp(&stats, &whole, sizeof(stats)),
+              "resume: the counters match those of a copy never stopped");
+}
+
+
+
+int main(int argc, const char *argv[])
+{
+        char command[MAX_NAME];
+
+        if (mkdtemp(Test_dir) == NULL) {
+                printf("-Bad: no test directory\n");
+                return 1;
+        }
+        xform_init(&Upper, "upper");
+        xform_finish(&Upper);
+        convert_init(&Upper);
+
+        test_kernels();
+        test_xform();
+        test_checkpoint();
+        test_resume();
+        // last: there is no leaving UTF-8 mode
+        test_utf8();
+
+        snprintf(command, sizeof(command), "rm -rf %s", Test_dir);
+        system(command);
+        printf("--------------------------------\n");
+        printf("%u bad\n", Num_bad);
+        return (Num_bad == 0) ? 0 : 1;
+}
+
+// end of test.c
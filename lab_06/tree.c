@@ -0,0 +1,478 @@
+// ----------------------------------------------------------------------
+// file: tree.c
+//
+// Description: This file implements the TREE module. The walk and the
+//     mkdirs happen on the calling thread, in order, so every
+//     directory exists before anything is copied into it. The copying
+//     is a job list and a pool of threads (like the SCAN module) that
+//     take the next job until none are left.
+//
+// Created: 2026-10-17
+//
+// ----------------------------------------------------------------------
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "tree.h"
+#include "io.h"
+#include "convert.h"
+#include "common.h"
+
+#define DIR_MODE 0777       // before the umask
+#define TARGET_MODE 0666
+#define FIRST_CAPACITY 64
+#define SERIAL 1
+
+
+// A job is either a batch of whole files (entries batch[0..count) of
+// the tree), or one piece of a large file.
+struct tree_job {
+        int *batch;
+        int count;
+        int piece_of;              // the entry, or -1 for a batch
+        unsigned long long offset;
+        unsigned long long len;
+        int error;
+        struct copy_stats stats;
+};
+
+struct tree_pool {
+        pthread_mutex_t lock;
+        struct tree *tree;
+        struct tree_job *jobs;
+        int njobs;
+        int next;                  // next job to hand out
+        int backend;
+};
+
+
+
+// Add an entry to the tree; the names are copied.
+// Returns SUCCESS or ERR_MEMORY.
+static int add_entry(struct tree *tree, const char *source,
+                     const char *target, int is_dir,
+                     unsigned long long size)
+{
+        struct tree_entry *entry;
+        struct tree_entry *bigger;
+        int capacity;
+
+        if (tree->nentries == tree->capacity) {
+                capacity = tree->capacity ? tree->capacity * 2 : FIRST_CAPACITY;
+                bigger = realloc(tree->entries, capacity * sizeof(*bigger));
+                if (bigger == NULL) {
+                        return ERR_MEMORY;
+                }
+                tree->entries = bigger;
+                tree->capacity = capacity;
+        }
+
+        entry = &tree->entries[tree->nentries];
+        memset(entry, 0, sizeof(*entry));
+        entry->source = strdup(source);
+        entry->target = strdup(target);
+        if ((entry->source == NULL) || (entry->target == NULL)) {
+                free(entry->source);
+                free(entry->target);
+                return ERR_MEMORY;
+        }
+        entry->is_dir = is_dir;
+        entry->size = size;
+        entry->error = SUCCESS;
+        tree->nentries++;
+        return SUCCESS;
+}
+
+
+
+// dir/name in newly allocated memory.
+static char *join_path(const char *dir, const char *name)
+{
+        char *path = NULL;
+
+        if (asprintf(&path, "%s/%s", dir, name) < 0) {
+                return NULL;
+        }
+        return path;
+}
+
+
+
+// Skip "." and "..".
+static int not_dot(const struct dirent *entry)
+{
+        return strcmp(entry->d_name, ".") && strcmp(entry->d_name, "..");
+}
+
+
+
+// Add what is in the directory src_dir (whose own entry is at index
+// self) to the tree, going down into subdirectories. A directory that
+// can not be read is marked with ERR_OPEN_SOURCE, and the walk goes on.
+static int walk_dir(struct tree *tree, int self,
+                    const char *src_dir, const char *dst_dir)
+{
+        struct dirent **names = NULL;
+        struct stat metadata;
+        char *source;
+        char *target;
+        int count;
+        int result = SUCCESS;
+
+        // sorted, so the report comes out in the same order every time
+        count = scandir(src_dir, &names, not_dot, alphasort);
+        if (count < 0) {
+                tree->entries[self].error = ERR_OPEN_SOURCE;
+                return SUCCESS;
+        }
+
+        for (int i = 0; i < count; i++) {
+                source = join_path(src_dir, names[i]->d_name);
+                target = join_path(dst_dir, names[i]->d_name);
+                if ((source == NULL) || (target == NULL)) {
+                        result = ERR_MEMORY;
+                } else if (lstat(source, &metadata) != 0) {
+                        fprintf(stderr, "Warning: skipping (can not stat): %s\n", source);
+                } else if (S_ISDIR(metadata.st_mode)) {
+                        result = add_entry(tree, source, target, TRUE, 0);
+                        if (result == SUCCESS) {
+                                result = walk_dir(tree, tree->nentries - 1,
+                                                  source, target);
+                        }
+                } else if (S_ISREG(metadata.st_mode)) {
+                        result = add_entry(tree, source, target, FALSE,
+                                           metadata.st_size);
+                } else {
+                        fprintf(stderr, "Warning: skipping (not a regular file): %s\n", source);
+                }
+                free(source);
+                free(target);
+                free(names[i]);
+                if (result != SUCCESS) {
+                        // the rest of the names still have to be freed
+                        for (i++; i < count; i++) {
+                                free(names[i]);
+                        }
+                }
+        }
+
+        free(names);
+        return result;
+}
+
+
+
+// Walk src_dir, filling tree with an entry for every directory and
+// regular file under it, and where each goes under dst_dir.
+// Returns SUCCESS, or ERR_OPEN_SOURCE or ERR_MEMORY.
+extern int tree_walk(const char *src_dir, const char *dst_dir,
+                     struct tree *tree)
+{
+        int result;
+
+        memset(tree, 0, sizeof(*tree));
+        result = add_entry(tree, src_dir, dst_dir, TRUE, 0);
+        if (result != SUCCESS) {
+                return result;
+        }
+        result = walk_dir(tree, 0, src_dir, dst_dir);
+        if ((result == SUCCESS) && (tree->entries[0].error != SUCCESS)) {
+                result = tree->entries[0].error;
+        }
+        return result;
+}
+
+
+
+// Run one job.
+static void run_job(struct tree_pool *pool, struct tree_job *job)
+{
+        struct tree_entry *entry;
+
+        if (job->piece_of >= 0) {
+                entry = &pool->tree->entries[job->piece_of];
+                job->error = io_copy_range(entry->source, entry->target,
+                                           job->offset, job->len,
+                                           &job->stats);
+                return;
+        }
+        for (int i = 0; i < job->count; i++) {
+                entry = &pool->tree->entries[job->batch[i]];
+                entry->error = io_copy(pool->backend, entry->source,
+                                       entry->target, SERIAL,
+                                       &entry->stats);
+        }
+}
+
+
+
+// Thread body: run jobs until there are none left.
+static void *tree_main(void *arg)
+{
+        struct tree_pool *pool = arg;
+        struct tree_job *job;
+
+        for (;;) {
+                pthread_mutex_lock(&pool->lock);
+                if (pool->next >= pool->njobs) {
+                        pthread_mutex_unlock(&pool->lock);
+                        break;
+                }
+                job = &pool->jobs[pool->next++];
+                pthread_mutex_unlock(&pool->lock);
+
+                run_job(pool, job);
+        }
+
+        return NULL;
+}
+
+
+
+// Make the directories in the tree, in order. One that is already
+// there is fine; the files in it are still never overwritten.
+static void make_dirs(struct tree *tree)
+{
+        struct tree_entry *entry;
+        struct stat metadata;
+
+        for (int i = 0; i < tree->nentries; i++) {
+                entry = &tree->entries[i];
+                if (!entry->is_dir || (entry->error != SUCCESS)) {
+                        continue;
+                }
+                if ((mkdir(entry->target, DIR_MODE) != 0) &&
+                    ((errno != EEXIST) || (stat(entry->target, &metadata) != 0) ||
+                     !S_ISDIR(metadata.st_mode))) {
+                        entry->error = ERR_OPEN_TARGET;
+                }
+        }
+}
+
+
+
+// Create the target of a file that is going to be copied in pieces,
+// at its full size, so each piece can be written in place.
+static int make_target(const struct tree_entry *entry)
+{
+        int fd;
+        int result = SUCCESS;
+
+        fd = open(entry->target, O_WRONLY | O_CREAT | O_EXCL, TARGET_MODE);
+        if (fd < 0) {
+                return ERR_OPEN_TARGET;
+        }
+        if (ftruncate(fd, entry->size) != 0) {
+                result = ERR_WRITE;
+        }
+        if ((close(fd) != 0) && (result == SUCCESS)) {
+                result = ERR_CLOSE;
+        }
+        return result;
+}
+
+
+
+// Turn the files in the tree into jobs. Pieces of large files (and
+// files too big to batch) go in big[], batches of small files in
+// small[], and the two lists are then merged alternately so that
+// small files do not all wait behind the large ones.
+// Returns the number of jobs, or ERR_MEMORY.
+static int plan_jobs(struct tree *tree, int nthreads, int *members,
+                     struct tree_job **jobs_out)
+{
+        struct tree_job *big = NULL;
+        struct tree_job *small = NULL;
+        struct tree_job *jobs = NULL;
+        struct tree_job *batch = NULL;
+        struct tree_entry *entry;
+        unsigned long long batch_bytes = 0;
+        unsigned long long npieces;
+        int nbig = 0;
+        int nsmall = 0;
+        int nmembers = 0;              // batches fill members[] from the front
+        int last = tree->nentries;     // and single files from the back
+        int split;
+        int result;
+
+        // a piece is written at the same offset it was read from
+        split = (nthreads > SERIAL) && !convert_changes_length();
+
+        // count the jobs there can be at most
+        npieces = 0;
+        for (int i = 0; i < tree->nentries; i++) {
+                npieces += tree->entries[i].size / TREE_PIECE_SIZE + 1;
+        }
+        big = calloc(npieces, sizeof(*big));
+        small = calloc(tree->nentries + 1, sizeof(*small));
+        jobs = calloc(npieces + tree->nentries + 1, sizeof(*jobs));
+        if ((big == NULL) || (small == NULL) || (jobs == NULL)) {
+                free(big);
+                free(small);
+                free(jobs);
+                return ERR_MEMORY;
+        }
+
+        for (int i = 0; i < tree->nentries; i++) {
+                entry = &tree->entries[i];
+                if (entry->is_dir) {
+                        continue;
+                }
+
+                if (split && (entry->size >= 2ULL * TREE_PIECE_SIZE)) {
+                        result = make_target(entry);
+                        if (result != SUCCESS) {
+                                entry->error = result;
+                                continue;
+                        }
+                        for (unsigned long long offset = 0; offset < entry->size;
+                             offset += TREE_PIECE_SIZE) {
+                                big[nbig].piece_of = i;
+                                big[nbig].offset = offset;
+                                big[nbig].len = entry->size - offset;
+                                if (big[nbig].len > TREE_PIECE_SIZE) {
+                                        big[nbig].len = TREE_PIECE_SIZE;
+                                }
+                                nbig++;
+                        }
+                } else if (entry->size >= TREE_SMALL_SIZE) {
+                        members[--last] = i;
+                        big[nbig].batch = &members[last];
+                        big[nbig].count = 1;
+                        big[nbig].piece_of = -1;
+                        nbig++;
+                } else {
+                        if ((batch == NULL) || (batch->count == TREE_BATCH_FILES) ||
+                            (batch_bytes + entry->size > TREE_BATCH_BYTES)) {
+                                batch = &small[nsmall++];
+                                batch->batch = &members[nmembers];
+                                batch->piece_of = -1;
+                                batch_bytes = 0;
+                        }
+                        members[nmembers++] = i;
+                        batch->count++;
+                        batch_bytes += entry->size;
+                }
+        }
+
+        // big, small, big, small, ... then whatever is left of either
+        result = 0;
+        for (int b = 0, s = 0; (b < nbig) || (s < nsmall); ) {
+                if (b < nbig) {
+                        jobs[result++] = big[b++];
+                }
+                if (s < nsmall) {
+                        jobs[result++] = small[s++];
+                }
+        }
+
+        free(big);
+        free(small);
+        *jobs_out = jobs;
+        return result;
+}
+
+
+
+// Make the directories, then copy the files, with the given I/O
+// backend on up to nthreads threads. The error and stats of each
+// entry are filled in. Returns SUCCESS if everything was copied,
+// otherwise FAILURE.
+extern int tree_copy(struct tree *tree, int backend, int nthreads)
+{
+        struct tree_pool pool;
+        struct tree_job *jobs = NULL;
+        struct tree_entry *entry;
+        pthread_t *threads = NULL;
+        int *members = NULL;
+        int started = 0;
+        int nworkers;
+        int njobs;
+
+        if (nthreads < 1) {
+                nthreads = 1;
+        }
+
+        make_dirs(tree);
+
+        members = calloc(tree->nentries, sizeof(*members));
+        if (members == NULL) {
+                return FAILURE;
+        }
+        njobs = plan_jobs(tree, nthreads, members, &jobs);
+        if (njobs < 0) {
+                free(members);
+                return FAILURE;
+        }
+        nworkers = (nthreads < njobs) ? nthreads : njobs;
+
+        pthread_mutex_init(&pool.lock, NULL);
+        pool.tree = tree;
+        pool.jobs = jobs;
+        pool.njobs = njobs;
+        pool.next = 0;
+        pool.backend = backend;
+
+        // the calling thread is worker 0
+        if (nworkers > 1) {
+                threads = calloc(nworkers, sizeof(*threads));
+        }
+        if (threads != NULL) {
+                for (started = 1; started < nworkers; started++) {
+                        if (pthread_create(&threads[started], NULL,
+                                           tree_main, &pool) != 0) {
+                                break;
+                        }
+                }
+        }
+        tree_main(&pool);
+        for (int i = 1; i < started; i++) {
+                pthread_join(threads[i], NULL);
+        }
+
+        free(threads);
+        pthread_mutex_destroy(&pool.lock);
+
+        // add the pieces of each large file back together
+        for (int i = 0; i < njobs; i++) {
+                if (jobs[i].piece_of < 0) {
+                        continue;
+                }
+                entry = &tree->entries[jobs[i].piece_of];
+                convert_add_stats(&entry->stats, &jobs[i].stats);
+                if (entry->error == SUCCESS) {
+                        entry->error = jobs[i].error;
+                }
+        }
+        free(jobs);
+        free(members);
+
+        for (int i = 0; i < tree->nentries; i++) {
+                if (tree->entries[i].error != SUCCESS) {
+                        return FAILURE;
+                }
+        }
+        return SUCCESS;
+}
+
+
+
+// Free everything tree_walk() allocated.
+extern void tree_free(struct tree *tree)
+{
+        for (int i = 0; i < tree->nentries; i++) {
+                free(tree->entries[i].source);
+                free(tree->entries[i].target);
+        }
+        free(tree->entries);
+        memset(tree, 0, sizeof(*tree));
+}
+
+// end of tree.c
@@ -0,0 +1,63 @@
+// ----------------------------------------------------------------------
+// file: tree.h
+//
+// Description: This is the header file for the TREE module. This
+//     module copies a whole directory tree (mycopy -r) in one process.
+//     The tree is walked first, then its files are handed to a pool
+//     of threads as jobs:
+//         pieces    a large file is split into TREE_PIECE_SIZE ranges
+//                   that different threads copy at the same time
+//         batches   small files are grouped together, so one job does
+//                   many of them, and batches are queued in between
+//                   the pieces so they are not left until the end
+//
+// Created: 2026-10-17
+//
+// ----------------------------------------------------------------------
+#ifndef TREE_H
+#define TREE_H
+
+#include "common.h"
+
+#define TREE_PIECE_SIZE (16 * 1024 * 1024)   // range of a large file
+#define TREE_SMALL_SIZE (1024 * 1024)        // batch files under this
+#define TREE_BATCH_BYTES (4 * 1024 * 1024)   // most bytes in a batch
+#define TREE_BATCH_FILES 64                  // most files in a batch
+
+// A directory or file in the tree, and what happened to it.
+struct tree_entry {
+        char *source;
+        char *target;
+        int is_dir;
+        unsigned long long size;
+        int error;                 // SUCCESS or one of the ERR_ codes
+        struct copy_stats stats;
+};
+
+struct tree {
+        struct tree_entry *entries;   // parents before their contents
+        int nentries;
+        int capacity;
+};
+
+
+// Walk src_dir, filling tree with an entry for every directory and
+// regular file under it, and where each goes under dst_dir. Anything
+// else (symbolic links, devices, ...) is left out with a warning.
+// Returns SUCCESS, or ERR_OPEN_SOURCE or ERR_MEMORY.
+extern int tree_walk(const char *src_dir, const char *dst_dir,
+                     struct tree *tree);
+
+
+// Make the directories, then copy the files, with the given I/O
+// backend on up to nthreads threads. The error and stats of each
+// entry are filled in. Returns SUCCESS if everything was copied,
+// otherwise FAILURE.
+extern int tree_copy(struct tree *tree, int backend, int nthreads);
+
+
+// Free everything tree_walk() allocated.
+extern void tree_free(struct tree *tree);
+
+#endif
+// end of tree.h
@@ -0,0 +1,568 @@
+// ----------------------------------------------------------------------
+// file: uring.c
+//
+// Description: This file implements the URING module. Each slot of the
+//     ring goes FREE -> READING -> READ -> WRITING -> FREE. Reads are
+//     queued at increasing offsets whenever a slot is free. Buffers
+//     are converted strictly in the order they were read (a character
+//     cut off at the end of one goes at the front of the next, in the
+//     CONVERT_MAX_CARRY bytes kept free before each buffer), and each
+//     one's write is queued straight away at the next output offset.
+//     Between these steps the thread waits in io_uring_enter() for at
+//     least one read or write to finish.
+//
+// Created: 2026-10-17
+//
+// ----------------------------------------------------------------------
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#include "uring.h"
+#include "convert.h"
+#include "common.h"
+
+#define RING_ENTRIES (2 * URING_SLOTS)    // a read and a write per slot
+#define BUFFER_ALIGNMENT 4096
+
+#define SLOT_FREE 0
+#define SLOT_READING 1
+#define SLOT_READ 2          // waiting for its turn to be converted
+#define SLOT_WRITING 3
+
+struct uslot {
+        char *buf;                 // CONVERT_MAX_CARRY bytes, then the data
+        char *out;                 // == buf unless the output can grow
+        int state;
+        unsigned long long seq;    // order of the read
+        unsigned long long offset; // where the read is from
+        size_t want;
+        size_t got;
+        const char *wdata;         // what is being written, and where
+        size_t wlen;
+        size_t wdone;
+        unsigned long long woffset;
+};
+
+// The parts of the kernel's rings that are used here.
+struct ring {
+        int fd;
+        unsigned *sq_head;
+        unsigned *sq_tail;
+        unsigned *sq_mask;
+        unsigned *sq_array;
+        struct io_uring_sqe *sqes;
+        unsigned *cq_head;
+        unsigned *cq_tail;
+        unsigned *cq_mask;
+        struct io_uring_cqe *cqes;
+        void *rings;
+        size_t rings_len;
+        size_t sqes_len;
+        unsigned to_submit;
+        int fixed;                 // the buffers are registered
+};
+
+struct uring_copy {
+        struct ring ring;
+        struct uslot slots[URING_SLOTS];
+        int src_fd;
+        int dst_fd;
+        size_t chunk_size;
+        unsigned long long size;
+        unsigned long long next_offset;   // of the next read
+        unsigned long long next_seq;      // of the next read
+        unsigned long long next_convert;  // seq of the next to convert
+        unsigned long long out_offset;    // of the next write
+        char carry[CONVERT_MAX_CARRY];
+        size_t ncarry;
+        int inflight;
+        int error;
+        struct copy_stats *stats;
+};
+
+
+
+static int sys_setup(unsigned entries, struct io_uring_params *params)
+{
+        return syscall(__NR_io_uring_setup, entries, params);
+}
+
+
+
+static int sys_enter(int fd, unsigned to_submit, unsigned min_complete)
+{
+        return syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+                       IORING_ENTER_GETEVENTS, NULL, 0);
+}
+
+
+
+static int sys_register(int fd, unsigned opcode, void *arg, unsigned nargs)
+{
+        return syscall(__NR_io_uring_register, fd, opcode, arg, nargs);
+}
+
+
+
+// Can this kernel do the reads and writes that are needed?
+static int ops_supported(int fd, int fixed)
+{
+        size_t len = sizeof(struct io_uring_probe) +
+                     IORING_OP_LAST * sizeof(struct io_uring_probe_op);
+        struct io_uring_probe *probe = calloc(1, len);
+        int read_op = fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        int write_op = fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+        int supported = FALSE;
+
+        if (probe == NULL) {
+                return FALSE;
+        }
+        // the probe itself is 5.6, the same as IORING_OP_READ
+        if ((sys_register(fd, IORING_REGISTER_PROBE, probe, IORING_OP_LAST) == 0) &&
+            (probe->last_op >= write_op) && (probe->last_op >= read_op)) {
+                supported = (probe->ops[read_op].flags & IO_URING_OP_SUPPORTED) &&
+                            (probe->ops[write_op].flags & IO_URING_OP_SUPPORTED);
+        }
+        free(probe);
+        return supported;
+}
+
+
+
+// Set up the ring and map its queues. Returns SUCCESS or FAILURE.
+static int ring_open(struct ring *ring)
+{
+        struct io_uring_params params;
+        size_t sq_len;
+        size_t cq_len;
+        char *rings;
+
+        memset(ring, 0, sizeof(*ring));
+        memset(&params, 0, sizeof(params));
+        ring->fd = sys_setup(RING_ENTRIES, &params);
+        if (ring->fd < 0) {
+                return FAILURE;
+        }
+        // both queues in one mapping (5.4), which is all that is handled
+        if (!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+                close(ring->fd);
+                return FAILURE;
+        }
+
+        sq_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_len = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        ring->rings_len = (sq_len > cq_len) ? sq_len : cq_len;
+        ring->sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+
+        ring->rings = mmap(NULL, ring->rings_len, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+        if (ring->rings == MAP_FAILED) {
+                close(ring->fd);
+                return FAILURE;
+        }
+        ring->sqes = mmap(NULL, ring->sqes_len, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+        if (ring->sqes == MAP_FAILED) {
+                munmap(ring->rings, ring->rings_len);
+                close(ring->fd);
+                return FAILURE;
+        }
+
+        rings = ring->rings;
+        ring->sq_head = (unsigned *)(rings + params.sq_off.head);
+        ring->sq_tail = (unsigned *)(rings + params.sq_off.tail);
+        ring->sq_mask = (unsigned *)(rings + params.sq_off.ring_mask);
+        ring->sq_array = (unsigned *)(rings + params.sq_off.array);
+        ring->cq_head = (unsigned *)(rings + params.cq_off.head);
+        ring->cq_tail = (unsigned *)(rings + params.cq_off.tail);
+        ring->cq_mask = (unsigned *)(rings + params.cq_off.ring_mask);
+        ring->cqes = (struct io_uring_cqe *)(rings + params.cq_off.cqes);
+        return SUCCESS;
+}
+
+
+
+static void ring_close(struct ring *ring)
+{
+        munmap(ring->sqes, ring->sqes_len);
+        munmap(ring->rings, ring->rings_len);
+        close(ring->fd);
+}
+
+
+
+// The next free submission entry, cleared. There is always one, since
+// each slot has at most one read or write queued.
+static struct io_uring_sqe *ring_get(struct ring *ring)
+{
+        unsigned tail = *ring->sq_tail;
+        unsigned index = tail & *ring->sq_mask;
+        struct io_uring_sqe *sqe = &ring->sqes[index];
+
+        memset(sqe, 0, sizeof(*sqe));
+        ring->sq_array[index] = index;
+        // the kernel may only see the entry once it is filled in, so
+        // the tail is moved on in ring_queue()
+        return sqe;
+}
+
+
+
+static void ring_queue(struct ring *ring)
+{
+        __atomic_store_n(ring->sq_tail, *ring->sq_tail + 1, __ATOMIC_RELEASE);
+        ring->to_submit++;
+}
+
+
+
+// Queue (the rest of) the read for slot i.
+static void queue_read(struct uring_copy *u, int i)
+{
+        struct uslot *s = &u->slots[i];
+        struct io_uring_sqe *sqe = ring_get(&u->ring);
+
+        sqe->opcode = u->ring.fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        sqe->fd = u->src_fd;
+        sqe->addr = (unsigned long)(s->buf + CONVERT_MAX_CARRY + s->got);
+        sqe->len = s->want - s->got;
+        sqe->off = s->offset + s->got;
+        sqe->buf_index = i;
+        sqe->user_data = i;
+        ring_queue(&u->ring);
+        s->state = SLOT_READING;
+}
+
+
+
+// Queue (the rest of) the write for slot i.
+static void queue_write(struct uring_copy *u, int i)
+{
+        struct uslot *s = &u->slots[i];
+        struct io_uring_sqe *sqe = ring_get(&u->ring);
+
+        sqe->opcode = u->ring.fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+        sqe->fd = u->dst_fd;
+        sqe->addr = (unsigned long)(s->wdata + s->wdone);
+        sqe->len = s->wlen - s->wdone;
+        sqe->off = s->woffset + s->wdone;
+        // out buffers are registered after the in buffers
+        sqe->buf_index = (s->out == s->buf) ? i : URING_SLOTS + i;
+        sqe->user_data = i;
+        ring_queue(&u->ring);
+        s->state = SLOT_WRITING;
+}
+
+
+
+// Start reads into the free slots, while there is anything left.
+static void start_reads(struct uring_copy *u)
+{
+        struct uslot *s;
+
+        for (int i = 0; (i < URING_SLOTS) && (u->next_offset < u->size); i++) {
+                s = &u->slots[i];
+                if (s->state != SLOT_FREE) {
+                        continue;
+                }
+                s->seq = u->next_seq++;
+                s->offset = u->next_offset;
+                s->want = u->chunk_size;
+                if (s->want > u->size - u->next_offset) {
+                        s->want = u->size - u->next_offset;
+                }
+                s->got = 0;
+                u->next_offset += s->want;
+                queue_read(u, i);
+                u->inflight++;
+        }
+}
+
+
+
+// Convert the slot that was read, with whatever was carried over from
+// the one before, and queue its write.
+static void convert_slot(struct uring_copy *u, int i)
+{
+        struct uslot *s = &u->slots[i];
+        char *start = s->buf + CONVERT_MAX_CARRY - u->ncarry;
+        size_t avail = u->ncarry + s->got;
+        size_t split;
+
+        memcpy(start, u->carry, u->ncarry);
+        split = convert_split_point(start, avail);
+        u->ncarry = avail - split;
+        memcpy(u->carry, start + split, u->ncarry);
+
+        if (s->out == s->buf) {
+                s->wlen = convert_copy(start, start, split, u->stats);
+                s->wdata = start;
+        } else {
+                s->wlen = convert_copy(start, s->out, split, u->stats);
+                s->wdata = s->out;
+        }
+        u->next_convert++;
+
+        if (s->wlen == 0) {
+                s->state = SLOT_FREE;
+                return;
+        }
+        s->wdone = 0;
+        s->woffset = u->out_offset;
+        u->out_offset += s->wlen;
+        queue_write(u, i);
+        u->inflight++;
+}
+
+
+
+// Convert every slot whose turn it is.
+static void convert_ready(struct uring_copy *u)
+{
+        int found;
+
+        do {
+                found = FALSE;
+                for (int i = 0; i < URING_SLOTS; i++) {
+                        if ((u->slots[i].state == SLOT_READ) &&
+                            (u->slots[i].seq == u->next_convert)) {
+                                convert_slot(u, i);
+                                found = TRUE;
+                        }
+                }
+        } while (found);
+}
+
+
+
+// Handle one finished read or write.
+static void complete(struct uring_copy *u, int i, int res)
+{
+        struct uslot *s = &u->slots[i];
+
+        u->inflight--;
+        if ((res == -EINTR) || (res == -EAGAIN)) {
+                // try the same thing again
+                u->inflight++;
+                if (s->state == SLOT_READING) {
+                        queue_read(u, i);
+                } else {
+                        queue_write(u, i);
+                }
+                return;
+        }
+
+        if (s->state == SLOT_READING) {
+                if (res < 0) {
+                        u->error = ERR_READ;
+                        s->state = SLOT_FREE;
+                } else if (res == 0) {
+                        // the source got shorter: this is the end
+                        u->size = s->offset + s->got;
+                        u->next_offset = u->size;
+                        s->state = SLOT_READ;
+                } else if (s->got + res < s->want) {
+                        s->got += res;
+                        queue_read(u, i);
+                        u->inflight++;
+                } else {
+                        s->got += res;
+                        s->state = SLOT_READ;
+                }
+        } else {
+                if (res <= 0) {
+                        u->error = ERR_WRITE;
+                        s->state = SLOT_FREE;
+                } else if (s->wdone + res < s->wlen) {
+                        s->wdone += res;
+                        queue_write(u, i);
+                        u->inflight++;
+                } else {
+                        s->state = SLOT_FREE;
+                }
+        }
+}
+
+
+
+// Submit what is queued, wait for at least one thing to finish, and
+// handle everything that has.
+static void wait_and_complete(struct uring_copy *u)
+{
+        struct ring *ring = &u->ring;
+        struct io_uring_cqe *cqe;
+        unsigned head;
+        int submitted;
+
+        submitted = sys_enter(ring->fd, ring->to_submit, 1);
+        if (submitted < 0) {
+                if ((errno != EINTR) && (errno != EAGAIN) && (errno != EBUSY)) {
+                        // nothing more can be done with the ring
+                        u->error = ERR_READ;
+                        u->inflight = 0;
+                }
+                return;
+        }
+        ring->to_submit -= submitted;
+
+        head = *ring->cq_head;
+        while (head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+                cqe = &ring->cqes[head & *ring->cq_mask];
+                complete(u, cqe->user_data, cqe->res);
+                head++;
+                __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+        }
+}
+
+
+
+// Allocate the slot buffers and, if the kernel lets us, register them
+// so that reads and writes do not have to map them every time.
+static int setup_buffers(struct uring_copy *u)
+{
+        struct iovec iov[2 * URING_SLOTS];
+        size_t out_size = convert_max_output(u->chunk_size + CONVERT_MAX_CARRY);
+        int nbufs = URING_SLOTS;
+
+        for (int i = 0; i < URING_SLOTS; i++) {
+                if (posix_memalign((void **)&u->slots[i].buf, BUFFER_ALIGNMENT,
+                                   u->chunk_size + CONVERT_MAX_CARRY) != 0) {
+                        u->slots[i].buf = NULL;
+                        return ERR_MEMORY;
+                }
+                u->slots[i].out = u->slots[i].buf;
+                iov[i].iov_base = u->slots[i].buf;
+                iov[i].iov_len = u->chunk_size + CONVERT_MAX_CARRY;
+        }
+        if (out_size > u->chunk_size) {
+                for (int i = 0; i < URING_SLOTS; i++) {
+                        if (posix_memalign((void **)&u->slots[i].out,
+                                           BUFFER_ALIGNMENT, out_size) != 0) {
+                                u->slots[i].out = u->slots[i].buf;
+                                return ERR_MEMORY;
+                        }
+                        iov[URING_SLOTS + i].iov_base = u->slots[i].out;
+                        iov[URING_SLOTS + i].iov_len = out_size;
+                }
+                nbufs = 2 * URING_SLOTS;
+        }
+
+        // registering can fail on RLIMIT_MEMLOCK; then plain reads do
+        u->ring.fixed = (sys_register(u->ring.fd, IORING_REGISTER_BUFFERS,
+                                      iov, nbufs) == 0);
+        return SUCCESS;
+}
+
+
+
+static void free_buffers(struct uring_copy *u)
+{
+        for (int i = 0; i < URING_SLOTS; i++) {
+                if (u->slots[i].out != u->slots[i].buf) {
+                        free(u->slots[i].out);
+                }
+                free(u->slots[i].buf);
+        }
+}
+
+
+
+// Convert and write whatever was carried over from the last buffer.
+static int flush_carry(struct uring_copy *u)
+{
+        char *out = malloc(convert_max_output(u->ncarry));
+        size_t len;
+        ssize_t written;
+        int result = SUCCESS;
+
+        if (out == NULL) {
+                return ERR_MEMORY;
+        }
+        len = convert_copy(u->carry, out, u->ncarry, u->stats);
+        u->ncarry = 0;
+        for (size_t done = 0; done < len; ) {
+                written = pwrite(u->dst_fd, out + done, len - done,
+                                 u->out_offset + done);
+                if ((written < 0) && (errno == EINTR)) {
+                        continue;
+                }
+                if (written <= 0) {
+                        result = ERR_WRITE;
+                        break;
+                }
+                done += written;
+        }
+        u->out_offset += len;
+        free(out);
+        return result;
+}
+
+
+
+// Copy the first size bytes of src_fd (a regular file) to dst_fd,
+// converting them, in chunks of chunk_size bytes. The counters for
+// the copy are added to stats. Returns SUCCESS, one of the ERR_ codes
+// from common.h, or URING_UNAVAILABLE if io_uring can not be used
+// here, in which case nothing has been read or written.
+extern int uring_copy(int src_fd, int dst_fd, size_t size,
+                      size_t chunk_size, struct copy_stats *stats)
+{
+        struct uring_copy *u;
+        int result;
+
+        u = calloc(1, sizeof(*u));
+        if (u == NULL) {
+                return ERR_MEMORY;
+        }
+        if (ring_open(&u->ring) != SUCCESS) {
+                free(u);
+                return URING_UNAVAILABLE;
+        }
+        u->src_fd = src_fd;
+        u->dst_fd = dst_fd;
+        u->chunk_size = chunk_size;
+        u->size = size;
+        u->stats = stats;
+        u->error = SUCCESS;
+
+        result = setup_buffers(u);
+        if ((result == SUCCESS) && !ops_supported(u->ring.fd, u->ring.fixed)) {
+                result = URING_UNAVAILABLE;
+        }
+        if (result != SUCCESS) {
+                free_buffers(u);
+                ring_close(&u->ring);
+                free(u);
+                return result;
+        }
+
+        for (;;) {
+                if (u->error == SUCCESS) {
+                        start_reads(u);
+                        convert_ready(u);
+                }
+                // after an error, only wait for what is in flight
+                if (u->inflight == 0) {
+                        break;
+                }
+                wait_and_complete(u);
+        }
+
+        result = u->error;
+        if ((result == SUCCESS) && (u->ncarry > 0)) {
+                result = flush_carry(u);
+        }
+
+        ring_close(&u->ring);
+        free_buffers(u);
+        free(u);
+        return result;
+}
+
+// end of uring.c
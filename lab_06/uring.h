@@ -0,0 +1,37 @@
+// ----------------------------------------------------------------------
+// file: uring.h
+//
+// Description: This is the header file for the URING module. This
+//     module copies a regular file with io_uring, so the disk does not
+//     sit idle while a buffer is converted: a ring of URING_SLOTS
+//     registered buffers keeps several reads and writes in flight, and
+//     the calling thread converts each buffer as soon as it (and the
+//     ones before it) have been read.
+//
+//     It talks to the kernel with the raw system calls, so it needs no
+//     library, only a kernel with io_uring (5.6 or later, and not
+//     turned off by a sandbox or sysctl).
+//
+// Created: 2026-10-17
+//
+// ----------------------------------------------------------------------
+#ifndef URING_H
+#define URING_H
+
+#include <stddef.h>
+#include "common.h"
+
+#define URING_SLOTS 8                  // buffers in flight at once
+#define URING_UNAVAILABLE 1            // uring_copy() could not start
+
+
+// Copy the first size bytes of src_fd (a regular file) to dst_fd,
+// converting them, in chunks of chunk_size bytes. The counters for
+// the copy are added to stats. Returns SUCCESS, one of the ERR_ codes
+// from common.h, or URING_UNAVAILABLE if io_uring can not be used
+// here, in which case nothing has been read or written.
+extern int uring_copy(int src_fd, int dst_fd, size_t size,
+                      size_t chunk_size, struct copy_stats *stats);
+
+#endif
+// end of uring.h
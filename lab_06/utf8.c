@@ -0,0 +1,307 @@
+// ----------------------------------------------------------------------
+// file: utf8.c
+//
+// Description: This file implements the UTF8 module. Text is taken as
+//     alternating runs of ASCII, which are found 16 bytes at a time
+//     and handed to the byte converter, and non-ASCII characters,
+//     which are decoded, looked up in the generated case tables from
+//     casemap.h and encoded again.
+//
+//     Every byte that is not a continuation byte (10xxxxxx) starts a
+//     character, valid or not. That is why a buffer can be split at
+//     any such byte and the pieces converted separately with the same
+//     result as converting it all at once.
+//
+// Created: 2026-10-17
+//
+// ----------------------------------------------------------------------
+#include <string.h>
+#include <stdint.h>
+#include "utf8.h"
+#include "casemap.h"
+#include "common.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define ASCII_LIMIT 0x80
+#define CONTINUATION_MASK 0xC0
+#define CONTINUATION 0x80
+#define PAYLOAD_MASK 0x3F
+#define PAYLOAD_BITS 6
+#define MAX_CODE_POINT 0x10FFFF
+#define SURROGATE_FIRST 0xD800
+#define SURROGATE_LAST 0xDFFF
+#define HIGH_BITS 0x8080808080808080ULL
+
+#define NUM_RANGES(table) (sizeof(table) / sizeof(table[0]))
+
+static const struct case_range *Ranges = NULL;
+static size_t Num_ranges = 0;
+
+
+
+// Pick what happens to the case of non-ASCII code points.
+extern void utf8_init(int mapping)
+{
+        if (mapping == UTF8_UPPER) {
+                Ranges = Upper_ranges;
+                Num_ranges = NUM_RANGES(Upper_ranges);
+        } else if (mapping == UTF8_LOWER) {
+                Ranges = Lower_ranges;
+                Num_ranges = NUM_RANGES(Lower_ranges);
+        } else {
+                Ranges = NULL;
+                Num_ranges = 0;
+        }
+}
+
+
+
+static int is_continuation(unsigned char c)
+{
+        return (c & CONTINUATION_MASK) == CONTINUATION;
+}
+
+
+
+// How long a sequence starting with lead should be (1 if it cannot
+// start a multi-byte sequence).
+static size_t sequence_length(unsigned char lead)
+{
+        if (lead < 0xC2) {
+                // ASCII, a continuation byte, or an overlong 2-byte lead
+                return 1;
+        } else if (lead < 0xE0) {
+                return 2;
+        } else if (lead < 0xF0) {
+                return 3;
+        } else if (lead < 0xF5) {
+                return 4;
+        }
+        return 1;
+}
+
+
+
+// Decode the character at s, which has avail bytes. Returns the length
+// of the sequence, or 0 if it is not valid UTF-8.
+static size_t decode(const unsigned char *s, size_t avail, uint32_t *cp)
+{
+        static const uint32_t smallest[] = { 0, 0, 0x80, 0x800, 0x10000 };
+        size_t n = sequence_length(s[0]);
+        uint32_t c;
+
+        if ((n == 1) || (avail < n)) {
+                return 0;
+        }
+
+        // the lead byte keeps 7 - n bits of the code point
+        c = s[0] & (0x7F >> n);
+        for (size_t i = 1; i < n; i++) {
+                if (!is_continuation(s[i])) {
+                        return 0;
+                }
+                c = (c << PAYLOAD_BITS) | (s[i] & PAYLOAD_MASK);
+        }
+
+        // no overlong forms, surrogates or code points past the end
+        if ((c < smallest[n]) || (c > MAX_CODE_POINT) ||
+            ((c >= SURROGATE_FIRST) && (c <= SURROGATE_LAST))) {
+                return 0;
+        }
+
+        *cp = c;
+        return n;
+}
+
+
+
+// Encode cp into out and return the number of bytes used.
+static size_t encode(uint32_t cp, char *out)
+{
+        if (cp < 0x80) {
+                out[0] = cp;
+                return 1;
+        } else if (cp < 0x800) {
+                out[0] = 0xC0 | (cp >> 6);
+                out[1] = CONTINUATION | (cp & PAYLOAD_MASK);
+                return 2;
+        } else if (cp < 0x10000) {
+                out[0] = 0xE0 | (cp >> 12);
+                out[1] = CONTINUATION | ((cp >> 6) & PAYLOAD_MASK);
+                out[2] = CONTINUATION | (cp & PAYLOAD_MASK);
+                return 3;
+        }
+        out[0] = 0xF0 | (cp >> 18);
+        out[1] = CONTINUATION | ((cp >> 12) & PAYLOAD_MASK);
+        out[2] = CONTINUATION | ((cp >> 6) & PAYLOAD_MASK);
+        out[3] = CONTINUATION | (cp & PAYLOAD_MASK);
+        return 4;
+}
+
+
+
+// Look cp up in the case ranges (a binary search for the last range
+// that starts at or before cp).
+static uint32_t map_case(uint32_t cp)
+{
+        const struct case_range *r;
+        size_t low = 0;
+        size_t high = Num_ranges;
+        size_t mid;
+
+        while (low < high) {
+                mid = (low + high) / 2;
+                if (Ranges[mid].first <= cp) {
+                        low = mid + 1;
+                } else {
+                        high = mid;
+                }
+        }
+        if (low == 0) {
+                return cp;
+        }
+
+        r = &Ranges[low - 1];
+        if ((cp - r->first) % r->stride == 0 &&
+            (cp - r->first) / r->stride < r->count) {
+                return cp + r->delta;
+        }
+        return cp;
+}
+
+
+
+// The number of ASCII bytes at the start of s.
+static size_t ascii_run(const unsigned char *s, size_t len)
+{
+        size_t i = 0;
+
+#ifdef __SSE2__
+        // one movemask tells whether any of 16 bytes has its top bit set
+        while (i + sizeof(__m128i) <= len) {
+                int mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(s + i)));
+
+                if (mask != 0) {
+                        return i + __builtin_ctz(mask);
+                }
+                i += sizeof(__m128i);
+        }
+#else
+        uint64_t word;
+
+        while (i + sizeof(word) <= len) {
+                memcpy(&word, s + i, sizeof(word));
+                if (word & HIGH_BITS) {
+                        break;
+                }
+                i += sizeof(word);
+        }
+#endif
+        while ((i < len) && (s[i] < ASCII_LIMIT)) {
+                i++;
+        }
+        return i;
+}
+
+
+
+// Convert len bytes of UTF-8 from in to out. See utf8.h.
+extern size_t utf8_convert(const char *in,
+                           char *out,
+                           size_t len,
+                           utf8_ascii_fn ascii,
+                           struct copy_stats *stats)
+{
+        const unsigned char *s = (const unsigned char *)in;
+        size_t written = 0;
+        size_t i = 0;
+        size_t run;
+        size_t n;
+        uint32_t cp;
+        uint32_t mapped;
+
+        while (i < len) {
+                // the fast path: a run of plain ASCII
+                run = ascii_run(s + i, len - i);
+                if (run > 0) {
+                        written += ascii(in + i, (out == NULL) ? NULL : out + written,
+                                         run, stats);
+                        i += run;
+                        continue;
+                }
+
+                // one non-ASCII character
+                stats->chars_copied++;
+                n = decode(s + i, len - i, &cp);
+                if (n == 0) {
+                        // not valid UTF-8: pass the byte through
+                        if (out != NULL) {
+                                out[written] = in[i];
+                        }
+                        written++;
+                        i++;
+                        continue;
+                }
+
+                mapped = map_case(cp);
+                if (mapped != cp) {
+                        stats->chars_changed++;
+                        if (out != NULL) {
+                                written += encode(mapped, out + written);
+                        }
+                } else {
+                        if (out != NULL) {
+                                memcpy(out + written, in + i, n);
+                                written += n;
+                        }
+                }
+                i += n;
+        }
+
+        return written;
+}
+
+
+
+// The largest n <= len such that the first n bytes of buf do not end
+// in the middle of a character.
+extern size_t utf8_split_point(const char *buf, size_t len)
+{
+        const unsigned char *s = (const unsigned char *)buf;
+        size_t i = len;
+
+        // look back for the start of the last character
+        while ((i > 0) && (len - i < UTF8_MAX_SEQUENCE - 1) &&
+               is_continuation(s[i - 1])) {
+                i--;
+        }
+        if ((i == 0) || is_continuation(s[i - 1])) {
+                // only continuation bytes, which are characters by
+                // themselves as far as the decoder is concerned
+                return len;
+        }
+        i--;
+        if (i + sequence_length(s[i]) > len) {
+                return i;
+        }
+        return len;
+}
+
+
+
+// The number of bytes at the start of buf to skip to get to the first
+// byte that starts a character.
+extern size_t utf8_next_start(const char *buf, size_t len)
+{
+        size_t i = 0;
+
+        while ((i < len) && is_continuation(buf[i])) {
+                i++;
+        }
+        return i;
+}
+
+// end of utf8.c
@@ -0,0 +1,64 @@
+// ----------------------------------------------------------------------
+// file: utf8.h
+//
+// Description: This is the header file for the UTF8 module. This
+//     module converts the case of UTF-8 text one code point at a time
+//     and counts code points rather than bytes. Runs of ASCII are
+//     handed back to a byte converter, so mostly-ASCII text goes
+//     almost as fast as in byte mode.
+//
+// Created: 2026-10-17
+//
+// ----------------------------------------------------------------------
+#ifndef UTF8_H
+#define UTF8_H
+
+#include <stddef.h>
+#include "common.h"
+
+#define UTF8_NONE 0       // leave non-ASCII code points alone
+#define UTF8_UPPER 1
+#define UTF8_LOWER 2
+
+#define UTF8_MAX_SEQUENCE 4
+
+// The most bytes utf8_convert() can write for len input bytes.
+// No simple case mapping grows a character by more than half.
+#define UTF8_MAX_OUTPUT(len) ((len) + (len) / 2 + UTF8_MAX_SEQUENCE)
+
+// Converts (and counts) a run of ASCII bytes, returning the number of
+// bytes written to out, like convert_copy().
+typedef size_t (*utf8_ascii_fn)(const char *in, char *out, size_t len,
+                                struct copy_stats *stats);
+
+
+// Pick what happens to the case of non-ASCII code points.
+extern void utf8_init(int mapping);
+
+
+// Convert len bytes of UTF-8 from in to out, which must have room for
+// UTF8_MAX_OUTPUT(len) bytes (out may be NULL to only count). Runs of
+// ASCII go through ascii. Every other code point counts as one
+// character, and as changed if its case changed. Bytes that are not
+// valid UTF-8 are copied as they are and count as one character each.
+// Returns the number of bytes written to out.
+extern size_t utf8_convert(const char *in,
+                           char *out,
+                           size_t len,
+                           utf8_ascii_fn ascii,
+                           struct copy_stats *stats);
+
+
+// The largest n <= len such that the first n bytes of buf do not end
+// in the middle of a character, so they can be converted on their own.
+// At most UTF8_MAX_SEQUENCE - 1 bytes are held back.
+extern size_t utf8_split_point(const char *buf, size_t len);
+
+
+// The number of bytes at the start of buf to skip to get to the first
+// byte that starts a character (0 unless buf starts with continuation
+// bytes).
+extern size_t utf8_next_start(const char *buf, size_t len);
+
+#endif
+// end of utf8.h
@@ -0,0 +1,295 @@
+// ----------------------------------------------------------------------
+// file: xform.c
+//
+// Description: This file implements the XFORM module. Besides the
+//     output byte, every entry holds the amount it adds to each of the
+//     four counters, packed into one 64-bit word with 16 bits per
+//     counter. xform_apply() adds the words up as it goes and unpacks
+//     them before a field can overflow, so counting costs one add per
+//     byte whatever the transform is.
+//
+// Created: 2026-10-17
+// ----------------------------------------------------------------------
+#include <ctype.h>
+#include <string.h>
+#include "xform.h"
+#include "common.h"
+
+#define ALPHABET 26
+#define ROT 13
+#define MAP_SEPARATOR ':'
+
+// where each counter lives in xform_entry.counts
+#define FIELD_MASK 0xffffULL
+#define COPIED_SHIFT 0
+#define CHANGED_SHIFT 16
+#define LINES_SHIFT 32
+#define PUNCT_SHIFT 48
+#define MAX_BYTES_PER_FOLD 0xffff
+
+
+
+// Start a transform from one of the built-in rules: "upper", "lower",
+// "rot13" or "none". Returns SUCCESS, or FAILURE if the name is unknown.
+extern int xform_init(struct xform *x, const char *name)
+{
+        int c;
+
+        memset(x, 0, sizeof(*x));
+        for (c = 0; c < XFORM_BYTES; c++) {
+                x->table[c].out = c;
+                x->table[c].keep = 1;
+        }
+
+        if (!strcmp(name, "upper")) {
+                x->rule = XFORM_UPPER;
+                for (c = 'a'; c <= 'z'; c++) {
+                        x->table[c].out = toupper(c);
+                }
+        } else if (!strcmp(name, "lower")) {
+                x->rule = XFORM_LOWER;
+                for (c = 'A'; c <= 'Z'; c++) {
+                        x->table[c].out = tolower(c);
+                }
+        } else if (!strcmp(name, "rot13")) {
+                x->rule = XFORM_ROT13;
+                for (c = 0; c < ALPHABET; c++) {
+                        x->table['a' + c].out = 'a' + (c + ROT) % ALPHABET;
+                        x->table['A' + c].out = 'A' + (c + ROT) % ALPHABET;
+                }
+        } else if (!strcmp(name, "none")) {
+                x->rule = XFORM_NONE;
+        } else {
+                return FAILURE;
+        }
+
+        return SUCCESS;
+}
+
+
+
+// Read one character of a set, handling escapes. Returns the number of
+// characters of spec used, or 0 at the end of the set.
+static int set_char(const char *spec, unsigned char *c)
+{
+        if ((spec[0] == '\0') || (spec[0] == MAP_SEPARATOR)) {
+                return 0;
+        }
+        if (spec[0] != '\\') {
+                *c = spec[0];
+                return 1;
+        }
+        switch (spec[1]) {
+                case 'n':
+                        *c = '\n';
+                        return 2;
+                case 't':
+                        *c = '\t';
+                        return 2;
+                case '\0':
+                        // a lone trailing backslash stands for itself
+                        *c = '\\';
+                        return 1;
+                default:
+                        *c = spec[1];
+                        return 2;
+        }
+}
+
+
+
+// Expand a set such as "a-z\n" into chars (at least XFORM_BYTES long).
+// The set ends at the end of spec or at an unescaped ':'. Returns the
+// number of characters in the set, or FAILURE for a backwards range.
+// If end is not NULL it is set to where the set stopped.
+static int parse_set(const char *spec, unsigned char *chars, const char **end)
+{
+        unsigned char first;
+        unsigned char last;
+        int count = 0;
+        int used;
+        int more;
+
+        while ((used = set_char(spec, &first)) > 0) {
+                spec += used;
+                last = first;
+                // a '-' between two characters makes a range
+                if ((spec[0] == '-') && ((more = set_char(spec + 1, &last)) > 0)) {
+                        spec += 1 + more;
+                        if (last < first) {
+                                return FAILURE;
+                        }
+                }
+                for (int c = first; c <= last; c++) {
+                        if (count < XFORM_BYTES) {
+                                chars[count++] = c;
+                        }
+                }
+        }
+
+        if (end != NULL) {
+                *end = spec;
+        }
+        return count;
+}
+
+
+
+// Map the characters of the output like tr(1) does.
+// Returns SUCCESS, or FAILURE if spec is malformed.
+extern int xform_map(struct xform *x, const char *spec)
+{
+        unsigned char from[XFORM_BYTES];
+        unsigned char to[XFORM_BYTES];
+        unsigned char map[XFORM_BYTES];
+        const char *rest;
+        int nfrom;
+        int nto;
+
+        nfrom = parse_set(spec, from, &rest);
+        if ((nfrom <= 0) || (rest[0] != MAP_SEPARATOR)) {
+                return FAILURE;
+        }
+        nto = parse_set(rest + 1, to, &rest);
+        if ((nto <= 0) || (rest[0] != '\0')) {
+                return FAILURE;
+        }
+
+        for (int c = 0; c < XFORM_BYTES; c++) {
+                map[c] = c;
+        }
+        for (int i = 0; i < nfrom; i++) {
+                map[from[i]] = to[(i < nto) ? i : nto - 1];
+        }
+        // the map applies to what the transform already produces
+        for (int c = 0; c < XFORM_BYTES; c++) {
+                x->table[c].out = map[x->table[c].out];
+        }
+
+        return SUCCESS;
+}
+
+
+
+// Delete every character of the output that is in set.
+// Returns SUCCESS, or FAILURE if set is malformed.
+extern int xform_delete(struct xform *x, const char *set)
+{
+        unsigned char chars[XFORM_BYTES];
+        unsigned char in_set[XFORM_BYTES] = {0};
+        const char *rest;
+        int count;
+
+        count = parse_set(set, chars, &rest);
+        if ((count <= 0) || (rest[0] != '\0')) {
+                return FAILURE;
+        }
+        for (int i = 0; i < count; i++) {
+                in_set[chars[i]] = 1;
+        }
+        // like the map, it applies to what the transform already produces
+        for (int c = 0; c < XFORM_BYTES; c++) {
+                if (in_set[x->table[c].out]) {
+                        x->table[c].keep = 0;
+                }
+        }
+
+        return SUCCESS;
+}
+
+
+
+// Work out the flags and counter increments of every entry. This must
+// be called after the last change and before the first xform_apply().
+extern void xform_finish(struct xform *x)
+{
+        struct xform_entry *e;
+
+        x->deletes = FALSE;
+        x->is_upper = TRUE;
+
+        for (int c = 0; c < XFORM_BYTES; c++) {
+                e = &x->table[c];
+                e->flags = 0;
+                if (!e->keep) {
+                        // a deleted character counts as changed, and
+                        // as nothing else
+                        e->flags |= XF_DELETE | XF_CHANGED;
+                        x->deletes = TRUE;
+                } else {
+                        if (e->out != c) {
+                                e->flags |= XF_CHANGED;
+                        }
+                        if (e->out == '\n') {
+                                e->flags |= XF_NEWLINE;
+                        }
+                        if (ispunct(e->out)) {
+                                e->flags |= XF_PUNCT;
+                        }
+                }
+
+                e->counts = ((uint64_t)e->keep << COPIED_SHIFT) |
+                            ((uint64_t)!!(e->flags & XF_CHANGED) << CHANGED_SHIFT) |
+                            ((uint64_t)!!(e->flags & XF_NEWLINE) << LINES_SHIFT) |
+                            ((uint64_t)!!(e->flags & XF_PUNCT) << PUNCT_SHIFT);
+
+                if (!e->keep || (e->out != toupper(c))) {
+                        x->is_upper = FALSE;
+                }
+        }
+}
+
+
+
+// Add the packed counters in acc to stats.
+static void unpack(uint64_t acc, struct copy_stats *stats)
+{
+        stats->chars_copied += (acc >> COPIED_SHIFT) & FIELD_MASK;
+        stats->chars_changed += (acc >> CHANGED_SHIFT) & FIELD_MASK;
+        stats->lines += (acc >> LINES_SHIFT) & FIELD_MASK;
+        stats->punct_chars += (acc >> PUNCT_SHIFT) & FIELD_MASK;
+}
+
+
+
+// Transform len bytes from in to out (which may be the same buffer),
+// add the counts to stats and return the number of bytes written to
+// out. If out is NULL the bytes are only counted.
+extern size_t xform_apply(const struct xform *x,
+                          const char *in,
+                          char *out,
+                          size_t len,
+                          struct copy_stats *stats)
+{
+        const unsigned char *src = (const unsigned char *)in;
+        const struct xform_entry *e;
+        size_t written = 0;
+        size_t done = 0;
+        size_t stop;
+        uint64_t acc;
+
+        while (done < len) {
+                stop = (len - done > MAX_BYTES_PER_FOLD) ?
+                       done + MAX_BYTES_PER_FOLD : len;
+                acc = 0;
+                if (out == NULL) {
+                        for (; done < stop; done++) {
+                                acc += x->table[src[done]].counts;
+                        }
+                } else {
+                        // writing before checking keep is safe, since
+                        // written never gets ahead of done
+                        for (; done < stop; done++) {
+                                e = &x->table[src[done]];
+                                out[written] = e->out;
+                                written += e->keep;
+                                acc += e->counts;
+                        }
+                }
+                unpack(acc, stats);
+        }
+
+        return (out == NULL) ? 0 : written;
+}
+
+// end of xform.c
@@ -0,0 +1,83 @@
+// ----------------------------------------------------------------------
+// file: xform.h
+//
+// Description: This is the header file for the XFORM module. A
+//     transform is a 256-entry table, built once at startup, that says
+//     for each input byte what to write (if anything) and how the
+//     byte should be counted. Applying a transform is then one table
+//     lookup per byte, with no branches and no ctype calls.
+//
+// Created: 2026-10-17
+// ----------------------------------------------------------------------
+#ifndef XFORM_H
+#define XFORM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "common.h"
+
+#define XFORM_BYTES 256
+
+// class flags of an entry
+#define XF_CHANGED 0x02     // the output differs from the input
+#define XF_NEWLINE 0x04     // the output is '\n'
+#define XF_PUNCT 0x08       // the output is a punctuation character
+#define XF_DELETE 0x10      // nothing is written for the input byte
+
+// the built-in rules
+#define XFORM_NONE 0
+#define XFORM_UPPER 1
+#define XFORM_LOWER 2
+#define XFORM_ROT13 3
+
+struct xform_entry {
+        uint64_t counts;    // counter increments, packed (see xform.c)
+        unsigned char out;  // the byte to write
+        unsigned char keep; // 1 if out is written, 0 if deleted
+        unsigned char flags;
+};
+
+struct xform {
+        struct xform_entry table[XFORM_BYTES];
+        int deletes;        // true if any byte is deleted
+        int is_upper;       // true if this is exactly the "upper" rule
+        int rule;           // the XFORM_ rule it started from
+};
+
+
+// Start a transform from one of the built-in rules: "upper", "lower",
+// "rot13" or "none". Returns SUCCESS, or FAILURE if the name is unknown.
+extern int xform_init(struct xform *x, const char *name);
+
+
+// Map the characters of the output like tr(1) does. spec is
+// "SET1:SET2": each character of SET1 becomes the character at the
+// same place in SET2, and the last character of SET2 is repeated if
+// SET2 is shorter. Sets may use ranges ("a-z") and the escapes \n, \t,
+// \\, \: and \-. Returns SUCCESS, or FAILURE if spec is malformed.
+extern int xform_map(struct xform *x, const char *spec);
+
+
+// Delete the characters of the output that are in set (same syntax as
+// in xform_map()). Like a map, this applies to what the transform
+// produces so far, so after the "upper" rule "-d a" deletes nothing.
+// Returns SUCCESS, or FAILURE if set is malformed.
+extern int xform_delete(struct xform *x, const char *set);
+
+
+// Work out the flags and counter increments of every entry. This must
+// be called after the last change and before the first xform_apply().
+extern void xform_finish(struct xform *x);
+
+
+// Transform len bytes from in to out (which may be the same buffer),
+// add the counts to stats and return the number of bytes written to
+// out. If out is NULL the bytes are only counted.
+extern size_t xform_apply(const struct xform *x,
+                          const char *in,
+                          char *out,
+                          size_t len,
+                          struct copy_stats *stats);
+
+#endif
+// end of xform.h
@@ -0,0 +1,62 @@
+#!/bin/bash
+# ------------------------------------------------------------------------
+#  file: bench.sh
+#
+#  Description: Command start-up benchmarks for the shell ("make
+#      bench"): how many times a second `true` can be run. One CSV line
+#      is written per run:
+#
+#          mode,ballast_mb,commands,seconds,commands_per_s
+#
+#      The spawn and fork lines come from launchbench, which runs true
+#      through the LAUNCH module with and without a ballast of memory
+#      (see launchbench.c). The shell line is the shell itself, given
+#      BENCH_COMMANDS lines of "true" on its input.
+#
+#  Usage:
+#      ./bench.sh [output.csv]
+#
+#      Environment (defaults in brackets):
+#          BENCH_COMMANDS  commands per run [2000]
+#          BENCH_BALLAST   the ballasts, in MB [0 64 1024]
+#          BENCH_DIR       where the shell runs [/tmp/shell-bench]
+#
+#  Created: 2026-10-17
+#
+# ------------------------------------------------------------------------
+set -e
+
+cd "$(dirname "$0")"
+
+COMMANDS=${BENCH_COMMANDS:-2000}
+BALLAST=${BENCH_BALLAST:-"0 64 1024"}
+DIR=${BENCH_DIR:-/tmp/shell-bench}
+OUT=${1:-bench.csv}
+SHELL_PROGRAM=$PWD/shell
+
+rm -rf "$DIR"
+mkdir -p "$DIR"
+
+
+# run_shell
+# Time the shell through COMMANDS lines of true.
+run_shell()
+{
+        local start end
+
+        yes true | head -n "$COMMANDS" > "$DIR/input"
+        start=$(date +%s.%N)
+        (cd "$DIR" && "$SHELL_PROGRAM" < input > /dev/null)
+        end=$(date +%s.%N)
+        awk -v n="$COMMANDS" -v start="$start" -v end="$end" \
+                'BEGIN { s = end - start; printf "shell,0,%d,%.6f,%.1f\n", n, s, n / s }'
+}
+
+
+echo "mode,ballast_mb,commands,seconds,commands_per_s" | tee "$OUT"
+
+for mb in $BALLAST; do
+        ./launchbench -m "$mb" -n "$COMMANDS" | tee -a "$OUT"
+        ./launchbench -f -m "$mb" -n "$COMMANDS" | tee -a "$OUT"
+done
+run_shell | tee -a "$OUT"
@@ -0,0 +1,208 @@
+// ----------------------------------------------------------------------
+// file: builtin.c
+//
+// Description: This file implements the BUILTIN module.
+//
+// Created: 2026-10-17
+//
+// ----------------------------------------------------------------------
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "builtin.h"
+#include "job.h"
+#include "history.h"
+#include "pathcache.h"
+
+#define PARALLEL_SEPARATOR ":::"
+#define PARALLEL_USAGE "Usage: parallel [-j N] command [argument ...] ::: value ...\n"
+
+
+static const char *builtins[] = { "wait", "hash", "history", "parallel" };
+
+#define NBUILTINS (sizeof(builtins) / sizeof(builtins[0]))
+
+
+
+// Is name one of the builtins?
+static bool is_builtin(const char *name)
+{
+        for (size_t i = 0; i < NBUILTINS; i++) {
+                if (!strcmp(name, builtins[i])) {
+                        return true;
+                }
+        }
+        return false;
+}
+
+
+
+// wait [n ...]
+static int run_wait(const struct stage *stage)
+{
+        char *end;
+        long id;
+        int result = SUCCESS;
+
+        if (stage->argc == 1) {
+                return job_wait(JOB_ALL);
+        }
+        for (int i = 1; i < stage->argc; i++) {
+                // "%2" as well as "2"
+                id = strtol(stage->argv[i] + (stage->argv[i][0] == '%'), &end, 10);
+                if ((*end != '\0') || (id <= 0) || (job_wait(id) != SUCCESS)) {
+                        fprintf(stderr, "wait: no such job: %s\n", stage->argv[i]);
+                        result = ERR_NO_JOB;
+                }
+        }
+        return result;
+}
+
+
+
+// history [n]
+static int run_history(const struct stage *stage)
+{
+        char *end;
+        long lines = HISTORY_LIST;
+
+        if (stage->argc > 2) {
+                fprintf(stderr, "Usage: history [n]\n");
+                return ERR_SYNTAX;
+        }
+        if (stage->argc == 2) {
+                lines = strtol(stage->argv[1], &end, 10);
+                if ((*end != '\0') || (lines < 0)) {
+                        fprintf(stderr, "Usage: history [n]\n");
+                        return ERR_SYNTAX;
+                }
+        }
+        history_list(lines);
+        return SUCCESS;
+}
+
+
+
+// hash [-r] [name ...]
+static int run_hash(const struct stage *stage)
+{
+        bool cached;
+        int first = 1;
+        int result = SUCCESS;
+
+        if ((stage->argc > 1) && !strcmp(stage->argv[1], "-r")) {
+                pathcache_clear();
+                first = 2;
+        } else if (stage->argc == 1) {
+                pathcache_list();
+        }
+        for (int i = first; i < stage->argc; i++) {
+                if (pathcache_lookup(stage->argv[i], &cached) == NULL) {
+                        fprintf(stderr, "hash: %s: not found\n", stage->argv[i]);
+                        result = ERR_START;
+                }
+        }
+        return result;
+}
+
+
+
+// parallel [-j N] command [argument ...] ::: value ...
+static int run_parallel(const struct stage *stage, int *failed)
+{
+        struct stage command = *stage;
+        char *end;
+        char *count = NULL;
+        long njobs = sysconf(_SC_NPROCESSORS_ONLN);
+        int first = 1;            // of the command
+        int separator;
+
+        *failed = 0;
+        if ((stage->argc > 1) && !strncmp(stage->argv[1], "-j", 2)) {
+                // -j N or -jN
+                if (stage->argv[1][2] != '\0') {
+                        count = stage->argv[1] + 2;
+                        first = 2;
+                } else if (stage->argc > 2) {
+                        count = stage->argv[2];
+                        first = 3;
+                }
+                if (count != NULL) {
+                        njobs = strtol(count, &end, 10);
+                }
+                if ((count == NULL) || (*end != '\0') || (njobs < 1)) {
+                        fprintf(stderr, PARALLEL_USAGE);
+                        return ERR_SYNTAX;
+                }
+        }
+        if (njobs < 1) {
+                njobs = 1;
+        }
+
+        for (separator = first; separator < stage->argc; separator++) {
+                if (!strcmp(stage->argv[separator], PARALLEL_SEPARATOR)) {
+                        break;
+                }
+        }
+        if ((separator == first) || (separator == stage->argc)) {
+                fprintf(stderr, PARALLEL_USAGE);
+                return ERR_SYNTAX;
+        }
+
+        // the command is argv[first] up to the separator
+        command.argc = separator - first;
+        memcpy(command.argv, stage->argv + first, command.argc * sizeof(char *));
+        command.argv[command.argc] = NULL;
+
+        return job_parallel(&command, (char **)stage->argv + separator + 1,
+                            stage->argc - separator - 1, njobs, failed);
+}
+
+
+
+// Run pipeline if it is a builtin.
+// Returns SUCCESS, BUILTIN_NONE or an ERR_ code.
+extern int builtin_run(const struct pipeline *pipeline, int *status)
+{
+        const struct stage *stage = &pipeline->stages[0];
+        int failed = 0;
+        int result;
+
+        if ((pipeline->nstages != 1) || !is_builtin(stage->argv[0])) {
+                return BUILTIN_NONE;
+        }
+        // the shell itself would be redirected, or wait for itself
+        if ((stage->input != NULL) || (stage->output != NULL) ||
+            pipeline->background) {
+                fprintf(stderr, "%s: a builtin can not be redirected or run with &\n",
+                        stage->argv[0]);
+                *status = W_EXITCODE(1, 0);
+                return ERR_SYNTAX;
+        }
+
+        if (!strcmp(stage->argv[0], "wait")) {
+                result = run_wait(stage);
+        } else if (!strcmp(stage->argv[0], "hash")) {
+                result = run_hash(stage);
+        } else if (!strcmp(stage->argv[0], "history")) {
+                result = run_history(stage);
+        } else if (!strcmp(stage->argv[0], "parallel")) {
+                result = run_parallel(stage, &failed);
+                if (result == SUCCESS) {
+                        printf("parallel: %d failed\n", failed);
+                        fflush(stdout);
+                } else if (result == ERR_TOO_MANY) {
+                        fprintf(stderr, "parallel: too many arguments\n");
+                }
+        } else {
+                return BUILTIN_NONE;
+        }
+
+        *status = W_EXITCODE(((result == SUCCESS) && (failed == 0)) ? 0 : 1, 0);
+        return result;
+}
+
+// end of builtin.c
@@ -0,0 +1,44 @@
+// ----------------------------------------------------------------------
+// file: builtin.h
+//
+// Description: This is the header file for the BUILTIN module. This
+//     module has the commands the shell runs itself rather than
+//     starting a program for them:
+//
+//         wait [n ...]
+//             wait for background job n, or for every one of them
+//         hash [-r] [name ...]
+//             with nothing, print the commands whose paths are
+//             remembered, and the hits and misses; -r forgets them
+//             all; each name is looked up and remembered
+//         history [n]
+//             print the last n lines of the history (by default 20),
+//             with the numbers !n takes
+//         parallel [-j N] command [argument ...] ::: value ...
+//             run command once with each value added to the end,
+//             N at a time (by default one per CPU), and tell the exit
+//             status of each
+//
+//     A builtin is only a builtin when it is the whole pipeline; in a
+//     pipe it is looked for as a program, as before. A builtin can not
+//     be redirected or run in the background.
+//
+// Created: 2026-10-17
+//
+// ----------------------------------------------------------------------
+#ifndef BUILTIN_H
+#define BUILTIN_H
+
+#include "parse.h"
+#include "common.h"
+
+#define BUILTIN_NONE 1            // the pipeline is not a builtin
+
+
+// Run pipeline if it is a builtin. *status is set to its exit status
+// (as a wait status, like a program's).
+// Returns SUCCESS, BUILTIN_NONE, or the ERR_ code of a builtin that
+// failed, which has already been told of on stderr.
+extern int builtin_run(const struct pipeline *pipeline, int *status);
+
+#endif
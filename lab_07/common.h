@@ -0,0 +1,26 @@
+// ----------------------------------------------------------------------
+// file: common.h
+//
+// Description: This header file contains macros that are used by more
+//     than one module of the shell, mostly its error codes.
+//
+// Created: 2026-10-17
+// ----------------------------------------------------------------------
+#ifndef COMMON_H
+#define COMMON_H
+
+#define SUCCESS 0
+#define MAXARGS 64            /* arguments of one command */
+
+#define ERR_SYNTAX -2         /* a command line that cannot be run */
+#define ERR_TOO_MANY -3       /* too many arguments, stages or files */
+#define ERR_PIPE -4           /* unable to make a pipe */
+#define ERR_START -5          /* a command could not be started */
+#define ERR_SIGNAL -6         /* unable to set up the signal handling */
+#define ERR_NO_JOB -7         /* no such background job */
+#define ERR_HISTORY -8        /* unable to read or write the history */
+#define ERR_NO_EVENT -9       /* no such line in the history */
+
+#endif
+
+// end of common.h
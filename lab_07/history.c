@@ -0,0 +1,915 @@
+// ----------------------------------------------------------------------
+// file: history.c
+//
+// Description: This file implements the HISTORY module. The log and
+//     the index are read through mmap(), and mapped again whenever
+//     they have grown.
+//
+//     A lock file that is never renamed keeps the shells in step: each
+//     holds it shared while it writes or opens the files, and the one
+//     that rotates them holds it alone. A shell that finds the log has
+//     been rotated under it opens the new one. The offset of the lines
+//     of a batch comes from where O_APPEND left the file after the
+//     write, so it is right whoever else wrote before it.
+//
+//     The lines held back are written by whichever comes first: a full
+//     batch, the next line once the batch is old enough, or a POSIX
+//     timer (FLUSH_SIGNAL) set when the first line of the batch is
+//     held back, so a line typed before the shell goes idle still
+//     reaches the other shells. The signals whose handlers write the
+//     history are blocked while the shell is in this module.
+//
+//     The sorted file starts with the inode of the log it was made
+//     for, how many lines it covers and how many records it has. After
+//     the records comes a tree of the newest seq of each run of them,
+//     so the newest line that starts with a prefix is found with two
+//     binary searches and one walk up the tree, however many lines
+//     start with it. The file is made again by a child, which merges
+//     the lines after it into it, in a temporary file renamed into
+//     place, so it is always whole.
+//
+// Created: 2026-10-17
+//
+// ----------------------------------------------------------------------
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "history.h"
+
+#define FILE_MODE 0600
+#define MAX_NAME 4096
+#define SORT_MAGIC "SHSORT2"
+#define INDEX_CHUNK 4096          // offsets written at a time when indexing
+#define FLUSH_SIGNAL SIGRTMIN     // of the timer that writes the lines held back
+
+struct mapping {
+        const char *addr;         // NULL when empty
+        size_t len;
+};
+
+struct sort_header {
+        char magic[8];
+        uint64_t log_inode;
+        uint64_t covered;         // lines 0..covered-1 are in it
+        uint64_t nrecords;        // sort records after the header
+};
+
+struct sort_record {
+        uint64_t offset;          // of the line in the log
+        uint64_t seq;             // its place in the index
+};
+
+struct history {
+        char log_name[MAX_NAME];
+        char index_name[MAX_NAME];
+        char sort_name[MAX_NAME];
+        char lock_name[MAX_NAME];
+        char old_log_name[MAX_NAME];
+        char old_index_name[MAX_NAME];
+        int lock;
+        int log;
+        int index;
+        ino_t log_inode;
+        struct mapping log_map;
+        struct mapping index_map;
+        struct mapping sort_map;
+        ino_t sort_inode;         // of the sort file mapped
+        long sort_requested;      // lines when it was last made again
+        char pending[HISTORY_BATCH * (HISTORY_MAX_LINE + 1)];
+        size_t pending_len;
+        size_t lens[HISTORY_BATCH];    // of each line held back, with '\n'
+        int npending;
+        time_t first_pending;
+        timer_t timer;            // fires HISTORY_FLUSH_SECONDS after the first
+        bool has_timer;
+        sigset_t guarded;         // the signals that may call flush()
+};
+
+static struct history history = { .lock = -1, .log = -1, .index = -1 };
+
+
+
+// Unmap map.
+static void unmap(struct mapping *map)
+{
+        if (map->addr != NULL) {
+                munmap((void *)map->addr, map->len);
+        }
+        map->addr = NULL;
+        map->len = 0;
+}
+
+
+
+// Map all of fd into map, if it has changed size.
+static int map_file(int fd, struct mapping *map)
+{
+        struct stat st;
+        void *addr;
+
+        if (fstat(fd, &st) != 0) {
+                return ERR_HISTORY;
+        }
+        if ((size_t)st.st_size == map->len) {
+                return SUCCESS;
+        }
+        unmap(map);
+        if (st.st_size == 0) {
+                return SUCCESS;
+        }
+        addr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED) {
+                return ERR_HISTORY;
+        }
+        map->addr = addr;
+        map->len = st.st_size;
+        return SUCCESS;
+}
+
+
+
+// Is the log we have open still the one called log_name?
+static bool current(void)
+{
+        struct stat st;
+
+        return (stat(history.log_name, &st) == 0) &&
+               (st.st_ino == history.log_inode);
+}
+
+
+
+// Close the log and the index.
+static void close_files(void)
+{
+        unmap(&history.log_map);
+        unmap(&history.index_map);
+        if (history.log >= 0) {
+                close(history.log);
+        }
+        if (history.index >= 0) {
+                close(history.index);
+        }
+        history.log = -1;
+        history.index = -1;
+}
+
+
+
+// Open the log and the index, with the lock held.
+static int open_files(void)
+{
+        struct stat st;
+        int flags = O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC;
+
+        close_files();
+        history.log = open(history.log_name, flags, FILE_MODE);
+        history.index = open(history.index_name, flags, FILE_MODE);
+        if ((history.log < 0) || (history.index < 0) ||
+            (fstat(history.log, &st) != 0)) {
+                close_files();
+                return ERR_HISTORY;
+        }
+        history.log_inode = st.st_ino;
+        return SUCCESS;
+}
+
+
+
+// With the lock held shared, open the log again if it has been
+// rotated.
+static int keep_current(void)
+{
+        if ((history.log >= 0) && current()) {
+                return SUCCESS;
+        }
+        return open_files();
+}
+
+
+
+// Index a log that has no index, with the lock held alone.
+static int index_log(void)
+{
+        uint64_t offsets[INDEX_CHUNK];
+        const char *start;
+        const char *end;
+        const char *newline;
+        size_t len;
+        int n = 0;
+
+        if ((map_file(history.log, &history.log_map) != SUCCESS) ||
+            (map_file(history.index, &history.index_map) != SUCCESS)) {
+                return ERR_HISTORY;
+        }
+        if ((history.log_map.len == 0) || (history.index_map.len > 0)) {
+                return SUCCESS;
+        }
+
+        start = history.log_map.addr;
+        end = start + history.log_map.len;
+        while (start < end) {
+                newline = memchr(start, '\n', end - start);
+                offsets[n++] = start - history.log_map.addr;
+                start = (newline == NULL) ? end : newline + 1;
+                if ((n == INDEX_CHUNK) || (start == end)) {
+                        len = n * sizeof(uint64_t);
+                        if (write(history.index, offsets, len) != (ssize_t)len) {
+                                return ERR_HISTORY;
+                        }
+                        n = 0;
+                }
+        }
+        return SUCCESS;
+}
+
+
+
+// Rotate the log and the index, unless another shell just has.
+static void rotate(void)
+{
+        struct stat st;
+
+        flock(history.lock, LOCK_EX);
+        if (current() && (fstat(history.log, &st) == 0) &&
+            (st.st_size > HISTORY_MAX_BYTES)) {
+                rename(history.log_name, history.old_log_name);
+                rename(history.index_name, history.old_index_name);
+                unlink(history.sort_name);
+        }
+        open_files();
+        flock(history.lock, LOCK_UN);
+}
+
+
+
+// Write the lines held back, and the index for them.
+static int flush(void)
+{
+        uint64_t offsets[HISTORY_BATCH];
+        size_t len;
+        off_t end = 0;
+        off_t start;
+        int result = ERR_HISTORY;
+
+        if (history.npending == 0) {
+                return SUCCESS;
+        }
+        flock(history.lock, LOCK_SH);
+        if ((keep_current() == SUCCESS) &&
+            (write(history.log, history.pending, history.pending_len) ==
+             (ssize_t)history.pending_len)) {
+                // O_APPEND left the file just after what we wrote
+                end = lseek(history.log, 0, SEEK_CUR);
+                start = end - history.pending_len;
+                for (int i = 0; i < history.npending; i++) {
+                        offsets[i] = start;
+                        start += history.lens[i];
+                }
+                len = history.npending * sizeof(uint64_t);
+                if (write(history.index, offsets, len) == (ssize_t)len) {
+                        result = SUCCESS;
+                }
+        }
+        flock(history.lock, LOCK_UN);
+
+        history.npending = 0;
+        history.pending_len = 0;
+        if ((result == SUCCESS) && (end > HISTORY_MAX_BYTES)) {
+                rotate();
+        }
+        return result;
+}
+
+
+
+// Get the log and the index as they are now, to read them.
+static int refresh(void)
+{
+        int result;
+
+        flush();
+        flock(history.lock, LOCK_SH);
+        result = keep_current();
+        // the index first: every line it has is in the log by then
+        if (result == SUCCESS) {
+                result = map_file(history.index, &history.index_map);
+        }
+        if (result == SUCCESS) {
+                result = map_file(history.log, &history.log_map);
+        }
+        flock(history.lock, LOCK_UN);
+        return result;
+}
+
+
+
+// The number of lines in the index.
+static long count(void)
+{
+        return history.index_map.len / sizeof(uint64_t);
+}
+
+
+
+// The line at offset in the log, and its length. Returns NULL if the
+// log does not reach that far.
+static const char *line_at(uint64_t offset, size_t *len)
+{
+        const char *line;
+        const char *newline;
+
+        if (offset >= history.log_map.len) {
+                return NULL;
+        }
+        line = history.log_map.addr + offset;
+        newline = memchr(line, '\n', history.log_map.len - offset);
+        *len = (newline == NULL) ? history.log_map.len - offset : newline - line;
+        return line;
+}
+
+
+
+// Line seq (from 0) of the index.
+static const char *entry(long seq, size_t *len)
+{
+        const uint64_t *offsets = (const uint64_t *)history.index_map.addr;
+
+        return line_at(offsets[seq], len);
+}
+
+
+
+// Compare the line (of length len) with prefix: 0 if it starts with
+// it, or which way it sorts from it.
+static int compare_prefix(const char *line, size_t len, const char *prefix,
+                          size_t prefix_len)
+{
+        int diff = memcmp(line, prefix, (len < prefix_len) ? len : prefix_len);
+
+        if (diff != 0) {
+                return diff;
+        }
+        return (len < prefix_len) ? -1 : 0;
+}
+
+
+
+// qsort_r() order of the sort records: by line, the newest first.
+static int compare_records(const void *a, const void *b, void *unused)
+{
+        const struct sort_record *x = a;
+        const struct sort_record *y = b;
+        const char *line_x;
+        const char *line_y;
+        size_t len_x = 0;
+        size_t len_y = 0;
+        int diff;
+
+        line_x = line_at(x->offset, &len_x);
+        line_y = line_at(y->offset, &len_y);
+        diff = memcmp(line_x, line_y, (len_x < len_y) ? len_x : len_y);
+        if (diff == 0) {
+                diff = (len_x > len_y) - (len_x < len_y);
+        }
+        if (diff == 0) {
+                diff = (x->seq < y->seq) - (x->seq > y->seq);
+        }
+        return diff;
+}
+
+
+
+// Are the lines of the two records the same?
+static bool same_line(const struct sort_record *x, const struct sort_record *y)
+{
+        const char *line_x;
+        const char *line_y;
+        size_t len_x = 0;
+        size_t len_y = 0;
+
+        line_x = line_at(x->offset, &len_x);
+        line_y = line_at(y->offset, &len_y);
+        return (len_x == len_y) && !memcmp(line_x, line_y, len_x);
+}
+
+
+
+// The sort records in the sorted file, and how many there are.
+static const struct sort_record *sort_records(long *n)
+{
+        const struct sort_header *header;
+
+        header = (const struct sort_header *)history.sort_map.addr;
+        *n = (header == NULL) ? 0 : header->nrecords;
+        return (const struct sort_record *)(history.sort_map.addr + sizeof(*header));
+}
+
+
+
+// The newest seq of the sort records first..last-1, from the tree of
+// the n records after them: tree[n + i] is the seq of record i, and
+// tree[i] the newest of tree[2i] and tree[2i + 1].
+static long newest(const uint64_t *tree, long n, long first, long last)
+{
+        long best = -1;
+
+        for (first += n, last += n; first < last; first /= 2, last /= 2) {
+                if (first & 1) {
+                        if ((long)tree[first] > best) {
+                                best = tree[first];
+                        }
+                        first++;
+                }
+                if (last & 1) {
+                        last--;
+                        if ((long)tree[last] > best) {
+                                best = tree[last];
+                        }
+                }
+        }
+        return best;
+}
+
+
+
+// Write the sorted file for lines 0..count()-1 of the index: the
+// records that cover lines 0..covered-1 (already sorted) merged with
+// the lines after them, then the tree newest() reads. A line that is
+// there more than once is kept only as its newest.
+static int sort_merge(long covered)
+{
+        const uint64_t *offsets = (const uint64_t *)history.index_map.addr;
+        const struct sort_record *old;
+        struct sort_header header;
+        struct sort_record *tail;
+        struct sort_record *records;
+        struct sort_record *next;
+        uint64_t *tree;
+        char temp_name[MAX_NAME + 16];
+        size_t len = 0;
+        long nold = 0;
+        long ntail = 0;
+        long kept = 0;
+        long i = 0;
+        long j = 0;
+        int fd;
+        int result = SUCCESS;
+
+        old = sort_records(&nold);
+        if (covered == 0) {
+                nold = 0;
+        }
+        tail = malloc((count() - covered + 1) * sizeof(*tail));
+        records = malloc((nold + count() - covered + 1) * sizeof(*records));
+        if ((tail == NULL) || (records == NULL)) {
+                free(tail);
+                free(records);
+                return ERR_HISTORY;
+        }
+        for (long seq = covered; seq < count(); seq++) {
+                if (line_at(offsets[seq], &len) != NULL) {
+                        tail[ntail].offset = offsets[seq];
+                        tail[ntail++].seq = seq;
+                }
+        }
+        qsort_r(tail, ntail, sizeof(*tail), compare_records, NULL);
+
+        // the first of each line is its newest
+        while ((i < nold) || (j < ntail)) {
+                if ((j == ntail) ||
+                    ((i < nold) && (compare_records(&old[i], &tail[j], NULL) < 0))) {
+                        next = (struct sort_record *)&old[i++];
+                } else {
+                        next = &tail[j++];
+                }
+                if ((kept == 0) || !same_line(&records[kept - 1], next)) {
+                        records[kept++] = *next;
+                }
+        }
+        free(tail);
+
+        tree = malloc((2 * kept + 1) * sizeof(*tree));
+        if (tree == NULL) {
+                free(records);
+                return ERR_HISTORY;
+        }
+        for (i = 0; i < kept; i++) {
+                tree[kept + i] = records[i].seq;
+        }
+        for (i = kept - 1; i > 0; i--) {
+                tree[i] = (tree[2 * i] > tree[2 * i + 1]) ? tree[2 * i] : tree[2 * i + 1];
+        }
+        tree[0] = 0;
+
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, SORT_MAGIC, sizeof(header.magic));
+        header.log_inode = history.log_inode;
+        header.covered = count();
+        header.nrecords = kept;
+
+        snprintf(temp_name, sizeof(temp_name), "%s.%d", history.sort_name, (int)getpid());
+        fd = open(temp_name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, FILE_MODE);
+        if (fd < 0) {
+                free(records);
+                free(tree);
+                return ERR_HISTORY;
+        }
+        len = kept * sizeof(*records);
+        if ((write(fd, &header, sizeof(header)) != sizeof(header)) ||
+            (write(fd, records, len) != (ssize_t)len) ||
+            (write(fd, tree, 2 * kept * sizeof(*tree)) != (ssize_t)(2 * kept * sizeof(*tree))) ||
+            (close(fd) != 0) || (rename(temp_name, history.sort_name) != 0)) {
+                unlink(temp_name);
+                result = ERR_HISTORY;
+        }
+        free(records);
+        free(tree);
+        return result;
+}
+
+
+
+// Make the sorted file again in a child, so the line being typed does
+// not wait for it; until it is done the lines after the old one are
+// searched one by one. The child is reaped along with the jobs.
+static void sort_in_background(long covered)
+{
+        pid_t pid;
+
+        history.sort_requested = count();
+        pid = fork();
+        if (pid == 0) {
+                // the lines held back are the shell's to write
+                signal(SIGINT, SIG_IGN);
+                history.npending = 0;
+                history.pending_len = 0;
+                _exit((sort_merge(covered) == SUCCESS) ? 0 : 1);
+        }
+}
+
+
+
+// Map the sorted file, if it is there and made for this log. Returns
+// how many lines of the index it covers (0 if none).
+static long sorted(void)
+{
+        const struct sort_header *header;
+        struct stat st;
+        int fd;
+
+        if ((stat(history.sort_name, &st) != 0) || (st.st_ino != history.sort_inode)) {
+                unmap(&history.sort_map);
+                history.sort_inode = 0;
+                fd = open(history.sort_name, O_RDONLY | O_CLOEXEC);
+                if (fd < 0) {
+                        return 0;
+                }
+                if ((fstat(fd, &st) == 0) &&
+                    (map_file(fd, &history.sort_map) == SUCCESS)) {
+                        history.sort_inode = st.st_ino;
+                }
+                close(fd);
+        }
+
+        header = (const struct sort_header *)history.sort_map.addr;
+        if ((history.sort_map.len < sizeof(*header)) ||
+            memcmp(header->magic, SORT_MAGIC, sizeof(header->magic)) ||
+            (header->log_inode != history.log_inode) ||
+            (header->covered > (uint64_t)count()) ||
+            (history.sort_map.len != sizeof(*header) + header->nrecords *
+             (sizeof(struct sort_record) + 2 * sizeof(uint64_t)))) {
+                unmap(&history.sort_map);
+                return 0;
+        }
+        return header->covered;
+}
+
+
+
+// Where prefix sorts among the n records: the first whose line does
+// not sort before it (after is false), or the first whose line sorts
+// after it and does not start with it (after is true).
+static long bound(const struct sort_record *records, long n,
+                  const char *prefix, size_t prefix_len, bool after)
+{
+        const char *line;
+        size_t len;
+        long lo = 0;
+        long hi = n;
+        long mid;
+        int diff;
+
+        while (lo < hi) {
+                mid = lo + (hi - lo) / 2;
+                line = line_at(records[mid].offset, &len);
+                diff = (line == NULL) ? 1 : compare_prefix(line, len, prefix, prefix_len);
+                if ((diff < 0) || (after && (diff == 0))) {
+                        lo = mid + 1;
+                } else {
+                        hi = mid;
+                }
+        }
+        return lo;
+}
+
+
+
+// Find the newest line that starts with prefix. Returns its seq, or -1.
+static long find(const char *prefix)
+{
+        const struct sort_record *records;
+        const char *line;
+        size_t prefix_len = strlen(prefix);
+        size_t len;
+        long covered = sorted();
+        long first;
+        long last;
+        long n;
+
+        if ((count() - covered > HISTORY_SORT_TAIL) &&
+            ((count() < history.sort_requested) ||
+             (count() - history.sort_requested > HISTORY_SORT_TAIL))) {
+                sort_in_background(covered);
+        }
+
+        // the lines since the sorted file, newest first
+        for (long seq = count() - 1; seq >= covered; seq--) {
+                line = entry(seq, &len);
+                if ((line != NULL) && !compare_prefix(line, len, prefix, prefix_len)) {
+                        return seq;
+                }
+        }
+        if (covered == 0) {
+                return -1;
+        }
+
+        // the sorted lines that start with prefix are side by side;
+        // the tree after them gives the newest of them
+        records = sort_records(&n);
+        first = bound(records, n, prefix, prefix_len, false);
+        last = bound(records, n, prefix, prefix_len, true);
+        return newest((const uint64_t *)(records + n), n, first, last);
+}
+
+
+
+// Block the signals whose handlers write the history, keeping the mask
+// there was in old: flush() is not reentrant.
+static void guard(sigset_t *old)
+{
+        sigprocmask(SIG_BLOCK, &history.guarded, old);
+}
+
+static void unguard(const sigset_t *old)
+{
+        sigprocmask(SIG_SETMASK, old, NULL);
+}
+
+
+
+// The timer has fired: write the lines held back, even though the
+// shell is waiting for its next line. The shell is never in this
+// module when it runs, since FLUSH_SIGNAL is guarded there.
+static void flush_handler(int signal)
+{
+        int error = errno;
+
+        flush();
+        errno = error;
+}
+
+
+
+// Catch FLUSH_SIGNAL and make the timer that sends it.
+static void start_timer(void)
+{
+        struct sigaction act;
+        struct sigevent event;
+
+        sigemptyset(&history.guarded);
+        sigaddset(&history.guarded, FLUSH_SIGNAL);
+        sigaddset(&history.guarded, SIGINT);
+        sigaddset(&history.guarded, SIGALRM);
+
+        memset(&act, 0, sizeof(act));
+        act.sa_handler = flush_handler;
+        act.sa_mask = history.guarded;
+        act.sa_flags = SA_RESTART;
+        sigaction(FLUSH_SIGNAL, &act, NULL);
+
+        memset(&event, 0, sizeof(event));
+        event.sigev_notify = SIGEV_SIGNAL;
+        event.sigev_signo = FLUSH_SIGNAL;
+        history.has_timer = (timer_create(CLOCK_MONOTONIC, &event, &history.timer) == 0);
+}
+
+
+
+// Open the history name in the working directory.
+// Returns SUCCESS or ERR_HISTORY.
+extern int history_open(const char *name)
+{
+        int result;
+
+        snprintf(history.log_name, MAX_NAME, "%s", name);
+        snprintf(history.index_name, MAX_NAME, "%s.idx", name);
+        snprintf(history.sort_name, MAX_NAME, "%s.sort", name);
+        snprintf(history.lock_name, MAX_NAME, "%s.lock", name);
+        snprintf(history.old_log_name, MAX_NAME, "%s.1", name);
+        snprintf(history.old_index_name, MAX_NAME, "%s.idx.1", name);
+
+        history.lock = open(history.lock_name, O_RDWR | O_CREAT | O_CLOEXEC, FILE_MODE);
+        if (history.lock < 0) {
+                return ERR_HISTORY;
+        }
+        start_timer();
+        flock(history.lock, LOCK_EX);
+        result = open_files();
+        if (result == SUCCESS) {
+                result = index_log();
+        }
+        flock(history.lock, LOCK_UN);
+        return result;
+}
+
+
+
+// Add line to the history.
+// Returns SUCCESS or ERR_HISTORY.
+extern int history_add(const char *line)
+{
+        struct itimerspec when = { .it_value.tv_sec = HISTORY_FLUSH_SECONDS };
+        size_t len = strlen(line);
+        size_t blanks = strspn(line, " \t");
+        sigset_t old;
+        int result = SUCCESS;
+
+        if (blanks == len) {
+                return SUCCESS;
+        }
+        if (len > HISTORY_MAX_LINE) {
+                len = HISTORY_MAX_LINE;
+        }
+        guard(&old);
+        if (history.npending == 0) {
+                history.first_pending = time(NULL);
+                // the batch is written by then even if no line follows
+                if (history.has_timer) {
+                        timer_settime(history.timer, 0, &when, NULL);
+                }
+        }
+        memcpy(history.pending + history.pending_len, line, len);
+        history.pending[history.pending_len + len] = '\n';
+        history.pending_len += len + 1;
+        history.lens[history.npending++] = len + 1;
+
+        if ((history.npending == HISTORY_BATCH) ||
+            (time(NULL) - history.first_pending >= HISTORY_FLUSH_SECONDS)) {
+                result = flush();
+        }
+        unguard(&old);
+        return result;
+}
+
+
+
+// Write the lines held back.
+// Returns SUCCESS or ERR_HISTORY.
+extern int history_flush(void)
+{
+        sigset_t old;
+        int result;
+
+        guard(&old);
+        result = flush();
+        unguard(&old);
+        return result;
+}
+
+
+
+// Write the lines held back and close the history.
+extern void history_close(void)
+{
+        sigset_t old;
+
+        guard(&old);
+        if (history.has_timer) {
+                timer_delete(history.timer);
+                history.has_timer = false;
+        }
+        flush();
+        unguard(&old);
+        close_files();
+        unmap(&history.sort_map);
+        if (history.lock >= 0) {
+                close(history.lock);
+        }
+        history.lock = -1;
+}
+
+
+
+// Put in place of !!, !n, !-n or !prefix at the start of line the line
+// it stands for.
+// Returns SUCCESS, HISTORY_NOT_EVENT, ERR_NO_EVENT or ERR_TOO_MANY.
+static int expand(char *line, size_t size)
+{
+        char event[HISTORY_MAX_LINE + 1];
+        char rest[HISTORY_MAX_LINE + 1];
+        const char *found;
+        char *end;
+        size_t event_len;
+        size_t len;
+        long seq;
+
+        if ((line[0] != '!') || (line[1] == '\0') || isspace((unsigned char)line[1])) {
+                return HISTORY_NOT_EVENT;
+        }
+        event_len = strcspn(line, " \t\n");
+        snprintf(event, sizeof(event), "%.*s", (int)(event_len - 1), line + 1);
+        snprintf(rest, sizeof(rest), "%s", line + event_len);
+
+        if (refresh() != SUCCESS) {
+                return ERR_NO_EVENT;
+        }
+        if (!strcmp(event, "!")) {
+                seq = count() - 1;
+        } else if (isdigit((unsigned char)event[0]) ||
+                   ((event[0] == '-') && isdigit((unsigned char)event[1]))) {
+                seq = strtol(event, &end, 10);
+                if (*end != '\0') {
+                        return ERR_NO_EVENT;
+                }
+                // !n is line n; !-n is n lines back
+                seq = (seq < 0) ? count() + seq : seq - 1;
+        } else {
+                seq = find(event);
+        }
+        if ((seq < 0) || (seq >= count())) {
+                return ERR_NO_EVENT;
+        }
+
+        found = entry(seq, &len);
+        if (found == NULL) {
+                return ERR_NO_EVENT;
+        }
+        if (len + strlen(rest) + 1 > size) {
+                return ERR_TOO_MANY;
+        }
+        memcpy(line, found, len);
+        strcpy(line + len, rest);
+        return SUCCESS;
+}
+
+extern int history_expand(char *line, size_t size)
+{
+        sigset_t old;
+        int result;
+
+        guard(&old);
+        result = expand(line, size);
+        unguard(&old);
+        return result;
+}
+
+
+
+// Print the last lines lines of the history, with their numbers.
+extern void history_list(long lines)
+{
+        const char *line;
+        sigset_t old;
+        size_t len;
+        long n;
+
+        guard(&old);
+        if (refresh() != SUCCESS) {
+                unguard(&old);
+                return;
+        }
+        n = count();
+        for (long seq = (n > lines) ? n - lines : 0; seq < n; seq++) {
+                line = entry(seq, &len);
+                if (line != NULL) {
+                        printf("%6ld  %.*s\n", seq + 1, (int)len, line);
+                }
+        }
+        fflush(stdout);
+        unguard(&old);
+}
+
+// end of history.c
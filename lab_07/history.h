@@ -0,0 +1,81 @@
+// ----------------------------------------------------------------------
+// file: history.h
+//
+// Description: This is the header file for the HISTORY module. This
+//     module keeps the lines the shell is given, for every shell run
+//     in the same directory, in three files:
+//
+//         shell-history       the lines, one after the other
+//         shell-history.idx   where each line starts, 8 bytes a line
+//         shell-history.sort  the lines in sorted order, as offsets
+//
+//     The first two only ever grow, and are written with O_APPEND, so
+//     the lines of several shells at once do not get mixed up: line n
+//     is wherever entry n of the index says, and is found without
+//     reading any of the others. !prefix is looked up by binary search
+//     in the sorted file, which is made again (in the background) once
+//     enough lines have come after it; those few are searched one by
+//     one.
+//
+//     Lines are held back and written HISTORY_BATCH at a time, with one
+//     write for the lines and one for their index. Once the log is past
+//     HISTORY_MAX_BYTES it is renamed to shell-history.1 (and the index
+//     to shell-history.idx.1) and a new one is begun; the numbers of
+//     the lines start again from 1.
+//
+// Created: 2026-10-17
+//
+// ----------------------------------------------------------------------
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stddef.h>
+#include "common.h"
+
+#define HISTORY_FILE "shell-history"
+#define HISTORY_MAX_LINE 1024
+#define HISTORY_BATCH 16                   // lines held back at most
+#define HISTORY_FLUSH_SECONDS 2            // or held back this long at most (a timer)
+#define HISTORY_MAX_BYTES (64 * 1024 * 1024)  // of the log, before it is rotated
+#define HISTORY_SORT_TAIL 4096             // lines after the sorted file at most
+#define HISTORY_LIST 20                    // lines "history" shows
+
+#define HISTORY_NOT_EVENT 1                // the line does not start with !
+
+
+// Open the history name (and its index) in the working directory,
+// making them if need be. A log that has no index yet, such as one
+// from before there were indexes, is indexed.
+// Returns SUCCESS or ERR_HISTORY.
+extern int history_open(const char *name);
+
+
+// Add line (without its newline) to the history. Blank lines are not
+// kept.
+// Returns SUCCESS or ERR_HISTORY.
+extern int history_add(const char *line);
+
+
+// Write the lines held back. Safe to call from a handler of SIGINT or
+// SIGALRM that then exits: those are blocked while the history is
+// being written.
+// Returns SUCCESS or ERR_HISTORY.
+extern int history_flush(void);
+
+
+// Write the lines held back and close the history.
+extern void history_close(void);
+
+
+// If line starts with !!, !n, !-n or !prefix, put in its place the
+// line it stands for (the last one, line n, the one n back, or the
+// last one that starts with prefix), keeping the rest of the line.
+// Returns SUCCESS, HISTORY_NOT_EVENT, ERR_NO_EVENT (there is no such
+// line) or ERR_TOO_MANY (the result does not fit in size).
+extern int history_expand(char *line, size_t size);
+
+
+// Print the last lines lines of the history, with their numbers.
+extern void history_list(long lines);
+
+#endif
@@ -0,0 +1,460 @@
+// ----------------------------------------------------------------------
+// file: job.c
+//
+// Description: This file implements the JOB module. The pipes are made
+//     with O_CLOEXEC, so a child keeps only the ends that are dup'ed
+//     onto its stdin and stdout; any other end left open in a child
+//     would keep the stage reading from that pipe from ever seeing the
+//     end of its input. The shell closes its copies as soon as the
+//     stages on both sides have them.
+//
+//     All the children are reaped by reap(), with waitpid(-1), and
+//     each is put down to the job it belongs to. When there is nothing
+//     to reap and the caller must wait, it reads the signalfd, which
+//     returns once the next SIGCHLD is pending.
+//
+// Created: 2026-10-17
+// ----------------------------------------------------------------------
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
+#include "job.h"
+#include "launch.h"
+#include "pathcache.h"
+
+// What a job is.
+#define JOB_FOREGROUND 0
+#define JOB_BACKGROUND 1
+#define JOB_PARALLEL 2
+
+#define MAX_TEXT 128              // of the command, for telling of it
+#define MAX_HOW 64
+
+struct job {
+        bool used;
+        int kind;
+        int number;               // of a background job: [1], [2] ...
+        pid_t pids[PARSE_MAX_STAGES];  // -1 for a stage that never ran
+        int npids;
+        int running;              // stages not yet reaped
+        int status;               // of the last stage
+        char text[MAX_TEXT];
+};
+
+static struct job jobs[JOB_MAX];
+static int child_fd = -1;         // the signalfd for SIGCHLD
+
+
+
+// Take a free job of kind. Returns NULL if there is none.
+static struct job *new_job(int kind)
+{
+        struct job *job = NULL;
+        int number = 0;
+
+        for (int i = 0; i < JOB_MAX; i++) {
+                if (!jobs[i].used) {
+                        if (job == NULL) {
+                                job = &jobs[i];
+                        }
+                } else if ((jobs[i].kind == JOB_BACKGROUND) &&
+                           (jobs[i].number > number)) {
+                        number = jobs[i].number;
+                }
+        }
+        if (job == NULL) {
+                return NULL;
+        }
+        memset(job, 0, sizeof(*job));
+        job->used = true;
+        job->kind = kind;
+        job->status = W_EXITCODE(JOB_NOT_STARTED, 0);
+        if (kind == JOB_BACKGROUND) {
+                // one more than the highest in use, as other shells do
+                job->number = number + 1;
+        }
+        return job;
+}
+
+
+
+// Write the commands of pipeline into text, for telling of the job.
+static void describe(const struct pipeline *pipeline, char *text)
+{
+        size_t len = 0;
+
+        text[0] = '\0';
+        for (int i = 0; i < pipeline->nstages; i++) {
+                for (int j = 0; j < pipeline->stages[i].argc; j++) {
+                        len += snprintf(text + len, MAX_TEXT - len, "%s%s",
+                                        ((i > 0) && (j == 0)) ? " | " :
+                                        (j > 0) ? " " : "",
+                                        pipeline->stages[i].argv[j]);
+                        if (len >= MAX_TEXT) {
+                                return;
+                        }
+                }
+        }
+}
+
+
+
+// Write how a job with the wait status status ended into how.
+static void describe_status(int status, char *how)
+{
+        if (WIFSIGNALED(status)) {
+                snprintf(how, MAX_HOW, "%s", strsignal(WTERMSIG(status)));
+        } else if (WEXITSTATUS(status) == 0) {
+                snprintf(how, MAX_HOW, "Done");
+        } else {
+                snprintf(how, MAX_HOW, "Exit %d", WEXITSTATUS(status));
+        }
+}
+
+
+
+// Tell of a background or parallel job that has ended, and free it.
+static void tell(struct job *job)
+{
+        char how[MAX_HOW];
+
+        describe_status(job->status, how);
+        if (job->kind == JOB_BACKGROUND) {
+                printf("[%d] %s\t%s\n", job->number, how, job->text);
+        } else {
+                printf("parallel: %s: %s\n", job->text, how);
+        }
+        fflush(stdout);
+        job->used = false;
+}
+
+
+
+// Put the child pid, which ended with status, down to its job.
+static void record(pid_t pid, int status)
+{
+        struct job *job;
+
+        for (int i = 0; i < JOB_MAX; i++) {
+                job = &jobs[i];
+                if (!job->used) {
+                        continue;
+                }
+                for (int j = 0; j < job->npids; j++) {
+                        if (job->pids[j] != pid) {
+                                continue;
+                        }
+                        job->running--;
+                        if (j == job->npids - 1) {
+                                job->status = status;
+                        }
+                        return;
+                }
+        }
+}
+
+
+
+// Reap every child that has ended. If none has and block is set, wait
+// for one. Returns false if the shell has no children to wait for.
+static bool reap(bool block)
+{
+        struct signalfd_siginfo info;
+        bool reaped = false;
+        int status;
+        pid_t pid;
+
+        for (;;) {
+                pid = waitpid(-1, &status, WNOHANG);
+                if (pid > 0) {
+                        record(pid, status);
+                        reaped = true;
+                        continue;
+                }
+                if (pid < 0) {
+                        // no children at all
+                        return reaped;
+                }
+                if (!block || reaped) {
+                        return true;
+                }
+                // wait for the next SIGCHLD; signals that came together
+                // are read as one, hence the loop around waitpid()
+                if ((read(child_fd, &info, sizeof(info)) < 0) && (errno != EINTR)) {
+                        return false;
+                }
+        }
+}
+
+
+
+// Start one stage, reading from in and writing to out (-1 for the
+// shell's own). Returns the pid, or -1.
+static pid_t start_stage(const struct stage *stage, int in, int out)
+{
+        struct launch l;
+        int flags = O_WRONLY | O_CREAT;
+        bool cached;
+        pid_t pid;
+
+        launch_init(&l, (char **)stage->argv);
+        l.path = pathcache_lookup(stage->argv[0], &cached);
+        if (l.path == NULL) {
+                fprintf(stderr, "Error with command: %s: %s\n",
+                        stage->argv[0], strerror(errno));
+                return -1;
+        }
+        if (in >= 0) {
+                launch_dup(&l, STDIN_FILENO, in);
+        }
+        if (out >= 0) {
+                launch_dup(&l, STDOUT_FILENO, out);
+        }
+        // a file named on the stage wins over the pipe
+        if (stage->input != NULL) {
+                launch_open(&l, STDIN_FILENO, stage->input, O_RDONLY);
+        }
+        if (stage->output != NULL) {
+                flags |= stage->append ? O_APPEND : O_TRUNC;
+                launch_open(&l, STDOUT_FILENO, stage->output, flags);
+        }
+
+        pid = launch_start(&l);
+        if ((pid < 0) && (errno == ENOENT) && cached) {
+                // it has gone from where it was: look for it again
+                pathcache_forget(stage->argv[0]);
+                l.path = pathcache_lookup(stage->argv[0], &cached);
+                pid = (l.path == NULL) ? -1 : launch_start(&l);
+        }
+        if (pid < 0) {
+                fprintf(stderr, "Error with command: %s: %s\n",
+                        stage->argv[0], strerror(errno));
+        }
+        return pid;
+}
+
+
+
+// Start every stage of pipeline as job.
+// Returns SUCCESS, ERR_PIPE or ERR_START.
+static int start(const struct pipeline *pipeline, struct job *job)
+{
+        int pipes[2];
+        int in = -1;              // the read end of the pipe before
+        int result = SUCCESS;
+        pid_t pid;
+
+        describe(pipeline, job->text);
+        for (int i = 0; i < pipeline->nstages; i++) {
+                pipes[0] = -1;
+                pipes[1] = -1;
+                if ((i < pipeline->nstages - 1) &&
+                    (pipe2(pipes, O_CLOEXEC) != 0)) {
+                        result = ERR_PIPE;
+                        break;
+                }
+                pid = start_stage(&pipeline->stages[i], in, pipes[1]);
+                if (pid < 0) {
+                        result = ERR_START;
+                } else {
+                        job->running++;
+                }
+                job->pids[job->npids++] = pid;
+
+                if (in >= 0) {
+                        close(in);
+                }
+                if (pipes[1] >= 0) {
+                        close(pipes[1]);
+                }
+                in = pipes[0];
+        }
+        if (in >= 0) {
+                // the pipes ran out: the stage after never came
+                close(in);
+        }
+        // the stages after a pipe that could not be made never ran
+        while (job->npids < pipeline->nstages) {
+                job->pids[job->npids++] = -1;
+        }
+        return result;
+}
+
+
+
+// Block SIGCHLD and get the signalfd the jobs are reaped with.
+// Returns SUCCESS or ERR_SIGNAL.
+extern int job_init(void)
+{
+        sigset_t mask;
+
+        sigemptyset(&mask);
+        sigaddset(&mask, SIGCHLD);
+        if (sigprocmask(SIG_BLOCK, &mask, NULL) != 0) {
+                return ERR_SIGNAL;
+        }
+        child_fd = signalfd(-1, &mask, SFD_CLOEXEC);
+        if (child_fd < 0) {
+                return ERR_SIGNAL;
+        }
+        return SUCCESS;
+}
+
+
+
+// Run pipeline, in the foreground or the background.
+// Returns SUCCESS, ERR_PIPE, ERR_START or ERR_TOO_MANY.
+extern int job_run(const struct pipeline *pipeline, int *status)
+{
+        struct job *job;
+        int result;
+        int last;
+
+        *status = W_EXITCODE(JOB_NOT_STARTED, 0);
+        job = new_job(pipeline->background ? JOB_BACKGROUND : JOB_FOREGROUND);
+        if (job == NULL) {
+                return ERR_TOO_MANY;
+        }
+        result = start(pipeline, job);
+        last = job->npids - 1;
+
+        if ((job->kind == JOB_BACKGROUND) && (job->running == 0)) {
+                // nothing started, so there is no job to tell of
+                *status = job->status;
+                job->used = false;
+                return result;
+        }
+        if (job->kind == JOB_BACKGROUND) {
+                // the pid of the last stage that started, as other
+                // shells give
+                while (job->pids[last] < 0) {
+                        last--;
+                }
+                printf("[%d] %d\n", job->number, (int)job->pids[last]);
+                fflush(stdout);
+                *status = 0;
+                return result;
+        }
+
+        while ((job->running > 0) && reap(true)) {
+                ;
+        }
+        *status = job->status;
+        job->used = false;
+        return result;
+}
+
+
+
+// Reap whatever children have ended, without waiting, and tell of
+// every background job that is done.
+extern void job_report(void)
+{
+        reap(false);
+        for (int i = 0; i < JOB_MAX; i++) {
+                if (jobs[i].used && (jobs[i].kind == JOB_BACKGROUND) &&
+                    (jobs[i].running == 0)) {
+                        tell(&jobs[i]);
+                }
+        }
+}
+
+
+
+// Wait for background job id, or for all of them if id is JOB_ALL.
+// Returns SUCCESS or ERR_NO_JOB.
+extern int job_wait(int id)
+{
+        struct job *job;
+        bool found = false;
+        bool waiting;
+
+        do {
+                waiting = false;
+                for (int i = 0; i < JOB_MAX; i++) {
+                        job = &jobs[i];
+                        if (!job->used || (job->kind != JOB_BACKGROUND) ||
+                            ((id != JOB_ALL) && (job->number != id))) {
+                                continue;
+                        }
+                        found = true;
+                        if (job->running == 0) {
+                                tell(job);
+                        } else {
+                                waiting = true;
+                        }
+                }
+        } while (waiting && reap(true));
+
+        if ((id != JOB_ALL) && !found) {
+                return ERR_NO_JOB;
+        }
+        return SUCCESS;
+}
+
+
+
+// Run command once for each of the nvalues values, up to njobs at
+// once. Returns SUCCESS or ERR_TOO_MANY.
+extern int job_parallel(const struct stage *command, char **values,
+                        int nvalues, int njobs, int *failed)
+{
+        struct pipeline one;
+        struct stage *stage = &one.stages[0];
+        struct job *job;
+        int next = 0;
+        int running = 0;
+
+        *failed = 0;
+        if (command->argc >= MAXARGS) {
+                return ERR_TOO_MANY;
+        }
+        one.nstages = 1;
+        one.background = false;
+        *stage = *command;
+        stage->argc++;
+        stage->argv[stage->argc] = NULL;
+
+        for (;;) {
+                // tell of the ones that are done
+                for (int i = 0; i < JOB_MAX; i++) {
+                        job = &jobs[i];
+                        if (job->used && (job->kind == JOB_PARALLEL) &&
+                            (job->running == 0)) {
+                                if (job->status != 0) {
+                                        (*failed)++;
+                                }
+                                tell(job);
+                                running--;
+                        }
+                }
+
+                if ((next < nvalues) && (running < njobs)) {
+                        job = new_job(JOB_PARALLEL);
+                        if (job != NULL) {
+                                stage->argv[command->argc] = values[next++];
+                                start(&one, job);
+                                running++;
+                                continue;
+                        }
+                        // the table is full: take fewer at once
+                        njobs = running;
+                        if (running == 0) {
+                                return ERR_TOO_MANY;
+                        }
+                }
+                if ((running == 0) || !reap(true)) {
+                        break;
+                }
+        }
+        return SUCCESS;
+}
+
+// end of job.c
@@ -0,0 +1,64 @@
+// ----------------------------------------------------------------------
+// file: job.h
+//
+// Description: This is the header file for the JOB module. A job is
+//     one pipeline. Every stage of it is started at once, each joined
+//     to the next by a pipe, so the stages run side by side and the
+//     data streams through them.
+//
+//     The shell waits for a job it runs in the foreground. A background
+//     job (one ending in &) runs on while the shell reads more lines,
+//     and is told of once it is done. Children are reaped whenever the
+//     shell gets to it: SIGCHLD is blocked and read from a signalfd,
+//     so no signal handler ever runs in the middle of the shell.
+//
+// Created: 2026-10-17
+// ----------------------------------------------------------------------
+#ifndef JOB_H
+#define JOB_H
+
+#include "parse.h"
+#include "common.h"
+
+#define JOB_NOT_STARTED 127       // the status of a stage that never ran
+#define JOB_MAX 64                // jobs at once
+#define JOB_ALL 0                 // for job_wait(): every background job
+
+
+// Block SIGCHLD and get the signalfd the jobs are reaped with. Call
+// before any other JOB function.
+// Returns SUCCESS or ERR_SIGNAL.
+extern int job_init(void);
+
+
+// Run pipeline. In the foreground the shell waits for all of it, and
+// *status is set to the wait status of the last stage (or
+// JOB_NOT_STARTED as an exit status, if it could not be started). In
+// the background the number and pid of the job are printed and
+// *status is 0. A stage that cannot be started is told of on stderr;
+// the others still run.
+// Returns SUCCESS, ERR_PIPE, ERR_START or ERR_TOO_MANY.
+extern int job_run(const struct pipeline *pipeline, int *status);
+
+
+// Reap whatever children have ended, without waiting, and tell of
+// every background job that is done.
+extern void job_report(void);
+
+
+// Wait for background job id, or for all of them if id is JOB_ALL,
+// telling of each as it ends.
+// Returns SUCCESS, or ERR_NO_JOB if there is no such job.
+extern int job_wait(int id);
+
+
+// Run command (a single stage) once for each of the nvalues values,
+// with the value as its last argument, keeping up to njobs of them
+// running at once. The exit status of each is told as it ends.
+// *failed is set to the number that did not exit with 0.
+// Returns SUCCESS, or ERR_TOO_MANY if command has no room for one more
+// argument.
+extern int job_parallel(const struct stage *command, char **values,
+                        int nvalues, int njobs, int *failed);
+
+#endif
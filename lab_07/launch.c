@@ -0,0 +1,254 @@
+// ----------------------------------------------------------------------
+// file: launch.c
+//
+// Description: This file implements the LAUNCH module. Both ways of
+//     starting a child end the same: either the program is running, or
+//     launch_start() returns -1 with the errno of what went wrong.
+//     posix_spawnp() reports that itself; the forked child writes it
+//     down a close-on-exec pipe, which the exec closes if it works.
+//
+// Created: 2026-10-17
+//
+// ----------------------------------------------------------------------
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "launch.h"
+
+// The signals the shell may catch or ignore; a child gets the default
+// action for each of them.
+static const int child_defaults[] = {
+        SIGINT, SIGQUIT, SIGALRM, SIGSEGV, SIGPIPE, SIGCHLD,
+        SIGTSTP, SIGTTIN, SIGTTOU,
+};
+
+#define NDEFAULTS (sizeof(child_defaults) / sizeof(child_defaults[0]))
+
+
+
+// Add one action to l.
+static int add(struct launch *l, int type, int fd, int from,
+               const char *path, int flags)
+{
+        struct launch_action *action;
+
+        if (l->nactions == LAUNCH_MAX_ACTIONS) {
+                return -1;
+        }
+        action = &l->actions[l->nactions++];
+        action->type = type;
+        action->fd = fd;
+        action->from = from;
+        action->path = path;
+        action->flags = flags;
+        return 0;
+}
+
+
+
+// In a forked child: do the actions of l. Returns 0, or -1 with errno
+// set.
+static int do_actions(const struct launch *l)
+{
+        const struct launch_action *action;
+        int fd;
+
+        for (int i = 0; i < l->nactions; i++) {
+                action = &l->actions[i];
+                if (action->type == LAUNCH_OPEN) {
+                        fd = open(action->path, action->flags, LAUNCH_FILE_MODE);
+                        if (fd < 0) {
+                                return -1;
+                        }
+                        if (fd != action->fd) {
+                                if (dup2(fd, action->fd) < 0) {
+                                        return -1;
+                                }
+                                close(fd);
+                        }
+                } else if (action->type == LAUNCH_DUP) {
+                        // dup2() of an fd onto itself would leave it
+                        // close-on-exec
+                        if (action->from == action->fd) {
+                                fcntl(action->fd, F_SETFD, 0);
+                        } else if (dup2(action->from, action->fd) < 0) {
+                                return -1;
+                        }
+                } else {
+                        close(action->fd);
+                }
+        }
+        return 0;
+}
+
+
+
+// Start l with fork() and execv() or execvp().
+static pid_t start_forked(const struct launch *l)
+{
+        sigset_t none;
+        int pipes[2];
+        int error;
+        ssize_t count;
+        pid_t pid;
+
+        if (pipe2(pipes, O_CLOEXEC) != 0) {
+                return -1;
+        }
+        pid = fork();
+        if (pid < 0) {
+                error = errno;
+                close(pipes[0]);
+                close(pipes[1]);
+                errno = error;
+                return -1;
+        }
+
+        if (pid == 0) {
+                // the child
+                close(pipes[0]);
+                for (size_t i = 0; i < NDEFAULTS; i++) {
+                        signal(child_defaults[i], SIG_DFL);
+                }
+                sigemptyset(&none);
+                sigprocmask(SIG_SETMASK, &none, NULL);
+                if (do_actions(l) == 0) {
+                        if (l->path != NULL) {
+                                execv(l->path, l->argv);
+                        } else {
+                                execvp(l->argv[0], l->argv);
+                        }
+                }
+                error = errno;
+                write(pipes[1], &error, sizeof(error));
+                _exit(127);
+        }
+
+        // the parent: nothing comes down the pipe if the exec worked
+        close(pipes[1]);
+        do {
+                count = read(pipes[0], &error, sizeof(error));
+        } while ((count < 0) && (errno == EINTR));
+        close(pipes[0]);
+        if (count == sizeof(error)) {
+                waitpid(pid, NULL, 0);
+                errno = error;
+                return -1;
+        }
+        return pid;
+}
+
+
+
+// Start l with posix_spawn() or posix_spawnp(). Returns the pid, or -1 with errno set.
+static pid_t start_spawned(const struct launch *l)
+{
+        const struct launch_action *action;
+        posix_spawn_file_actions_t actions;
+        posix_spawnattr_t attr;
+        sigset_t defaults;
+        sigset_t none;
+        short flags = POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK;
+        pid_t pid;
+        int error = 0;
+
+        posix_spawn_file_actions_init(&actions);
+        for (int i = 0; (error == 0) && (i < l->nactions); i++) {
+                action = &l->actions[i];
+                if (action->type == LAUNCH_OPEN) {
+                        error = posix_spawn_file_actions_addopen(&actions,
+                                        action->fd, action->path,
+                                        action->flags, LAUNCH_FILE_MODE);
+                } else if (action->type == LAUNCH_DUP) {
+                        error = posix_spawn_file_actions_adddup2(&actions,
+                                        action->from, action->fd);
+                } else {
+                        error = posix_spawn_file_actions_addclose(&actions,
+                                        action->fd);
+                }
+        }
+
+        posix_spawnattr_init(&attr);
+        sigemptyset(&defaults);
+        for (size_t i = 0; i < NDEFAULTS; i++) {
+                sigaddset(&defaults, child_defaults[i]);
+        }
+        sigemptyset(&none);
+        posix_spawnattr_setsigdefault(&attr, &defaults);
+        posix_spawnattr_setsigmask(&attr, &none);
+#ifdef POSIX_SPAWN_USEVFORK
+        // a no-op since glibc 2.24, which always works this way
+        flags |= POSIX_SPAWN_USEVFORK;
+#endif
+        posix_spawnattr_setflags(&attr, flags);
+
+        if ((error == 0) && (l->path != NULL)) {
+                error = posix_spawn(&pid, l->path, &actions, &attr,
+                                    l->argv, environ);
+        } else if (error == 0) {
+                error = posix_spawnp(&pid, l->argv[0], &actions, &attr,
+                                     l->argv, environ);
+        }
+        posix_spawnattr_destroy(&attr);
+        posix_spawn_file_actions_destroy(&actions);
+        if (error != 0) {
+                errno = error;
+                return -1;
+        }
+        return pid;
+}
+
+
+
+// Get l ready to run argv, looked up in $PATH, with no actions.
+extern void launch_init(struct launch *l, char **argv)
+{
+        l->argv = argv;
+        l->path = NULL;
+        l->nactions = 0;
+        l->fork = false;
+}
+
+
+
+// Add to l an action for the child. Returns 0, or -1 if l has
+// LAUNCH_MAX_ACTIONS already.
+extern int launch_open(struct launch *l, int fd, const char *path, int flags)
+{
+        return add(l, LAUNCH_OPEN, fd, -1, path, flags);
+}
+
+extern int launch_dup(struct launch *l, int fd, int from)
+{
+        return add(l, LAUNCH_DUP, fd, from, NULL, 0);
+}
+
+extern int launch_close(struct launch *l, int fd)
+{
+        return add(l, LAUNCH_CLOSE, fd, -1, NULL, 0);
+}
+
+
+
+// Start the program of l. Returns the pid of the child, or -1 with
+// errno set.
+extern pid_t launch_start(const struct launch *l)
+{
+        pid_t pid;
+
+        if (l->fork) {
+                return start_forked(l);
+        }
+        pid = start_spawned(l);
+        if ((pid < 0) && (errno == ENOSYS)) {
+                // no posix_spawn here
+                pid = start_forked(l);
+        }
+        return pid;
+}
+
+// end of launch.c
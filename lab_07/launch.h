@@ -0,0 +1,68 @@
+// ----------------------------------------------------------------------
+// file: launch.h
+//
+// Description: This is the header file for the LAUNCH module. This
+//     module starts the programs the shell runs. It uses posix_spawnp(),
+//     which glibc does with clone(CLONE_VM | CLONE_VFORK): the child
+//     shares the shell's memory until it execs, so starting it costs the
+//     same however big the shell has grown, where fork() has to copy
+//     the page tables of all of it first. What the child needs done
+//     before the exec (its redirections) is given as a list of actions,
+//     which become spawn file actions.
+//
+//     fork() is only used when the spawn cannot do what is asked:
+//     when the caller sets fork, or when posix_spawn is not there.
+//
+// Created: 2026-10-17
+//
+// ----------------------------------------------------------------------
+#ifndef LAUNCH_H
+#define LAUNCH_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+#define LAUNCH_MAX_ACTIONS 8
+
+// What is done to one descriptor of the child before the exec.
+#define LAUNCH_OPEN 0   // open path with flags as fd
+#define LAUNCH_DUP 1    // make fd a copy of from
+#define LAUNCH_CLOSE 2  // close fd
+
+#define LAUNCH_FILE_MODE 0666  // of a file made by LAUNCH_OPEN, before the umask
+
+struct launch_action {
+        int type;
+        int fd;
+        int from;               // LAUNCH_DUP
+        const char *path;       // LAUNCH_OPEN
+        int flags;              // LAUNCH_OPEN, as for open()
+};
+
+struct launch {
+        char **argv;            // argv[0] is looked up in $PATH
+        const char *path;       // unless this is set: the program to run
+        struct launch_action actions[LAUNCH_MAX_ACTIONS];
+        int nactions;           // done in order
+        bool fork;              // start it with fork() and exec
+};
+
+
+// Get l ready to run argv, looked up in $PATH, with no actions.
+extern void launch_init(struct launch *l, char **argv);
+
+
+// Add to l an action for the child. Returns 0, or -1 if l has
+// LAUNCH_MAX_ACTIONS already.
+extern int launch_open(struct launch *l, int fd, const char *path, int flags);
+extern int launch_dup(struct launch *l, int fd, int from);
+extern int launch_close(struct launch *l, int fd);
+
+
+// Start the program of l. The child has the default action for every
+// signal and no signal blocked, whatever the shell has. Returns the pid
+// of the child, or -1 with errno set if it could not be started (the
+// program was not found, or could not be run, or a redirection failed).
+extern pid_t launch_start(const struct launch *l);
+
+#endif
@@ -0,0 +1,101 @@
+// ----------------------------------------------------------------------
+// File: launchbench.c
+// ----------------------------------------------------------------------
+// Description:
+//              Runs `true` over and over through the LAUNCH module, as
+//              the shell runs its commands, and prints what it did as
+//              one CSV line for bench.sh:
+//
+//                  mode,ballast_mb,commands,seconds,commands_per_s
+//
+//              mode is spawn, or fork with -f. With -m the program
+//              first fills that many MB of memory, which stands in for
+//              a shell that has grown big: fork() must copy the page
+//              tables for all of it for every command, posix_spawn()
+//              none of it.
+//
+// Usage:
+//              ./launchbench [-f] [-m MB] [-n commands]
+//
+// Created: 2026-10-17
+//
+// ----------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "launch.h"
+
+#define DEFAULT_COMMANDS 2000
+#define MB (1024 * 1024)
+
+
+// Seconds since some fixed point.
+static double now(void)
+{
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+
+int main(int argc, char *argv[])
+{
+        char *command[] = { "true", NULL };
+        struct launch l;
+        char *ballast = NULL;
+        long ballast_mb = 0;
+        long commands = DEFAULT_COMMANDS;
+        double start;
+        double seconds;
+        int status;
+        int opt;
+        pid_t pid;
+
+        launch_init(&l, command);
+        while ((opt = getopt(argc, argv, "fm:n:")) != -1) {
+                if (opt == 'f') {
+                        l.fork = true;
+                } else if (opt == 'm') {
+                        ballast_mb = atol(optarg);
+                } else if (opt == 'n') {
+                        commands = atol(optarg);
+                } else {
+                        fprintf(stderr, "Usage: %s [-f] [-m MB] [-n commands]\n", argv[0]);
+                        return 1;
+                }
+        }
+
+        if (ballast_mb > 0) {
+                // touched, so that every page is really there
+                ballast = malloc(ballast_mb * MB);
+                if (ballast == NULL) {
+                        fprintf(stderr, "No memory for %ld MB\n", ballast_mb);
+                        return 1;
+                }
+                memset(ballast, 1, ballast_mb * MB);
+        }
+
+        start = now();
+        for (long i = 0; i < commands; i++) {
+                pid = launch_start(&l);
+                if (pid < 0) {
+                        fprintf(stderr, "Could not start true: %s\n", strerror(errno));
+                        return 1;
+                }
+                waitpid(pid, &status, 0);
+        }
+        seconds = now() - start;
+
+        printf("%s,%ld,%ld,%.6f,%.1f\n", l.fork ? "fork" : "spawn",
+               ballast_mb, commands, seconds,
+               (seconds > 0) ? commands / seconds : 0.0);
+        free(ballast);
+        return 0;
+}
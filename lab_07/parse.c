@@ -0,0 +1,146 @@
+// ----------------------------------------------------------------------
+// file: parse.c
+//
+// Description: This file implements the PARSE module. The line is cut
+//     up in place, as strtok() would: each word is ended by writing a
+//     '\0' over the character after it. When that character is an
+//     operator it is kept in the lexer, so "a|b" needs no spaces.
+//
+// Created: 2026-10-17
+// ----------------------------------------------------------------------
+#include <string.h>
+#include "parse.h"
+
+#define BLANKS " \t\n"
+#define OPERATORS "|<>&"
+
+// The tokens.
+#define TOKEN_END 0
+#define TOKEN_WORD 1
+#define TOKEN_PIPE 2
+#define TOKEN_INPUT 3
+#define TOKEN_OUTPUT 4
+#define TOKEN_APPEND 5
+#define TOKEN_BACKGROUND 6
+
+struct lexer {
+        char *pos;
+        char saved;               // an operator written over, or '\0'
+};
+
+
+
+// Take the next token from the line. For TOKEN_WORD, *word is set.
+static int next_token(struct lexer *lexer, char **word)
+{
+        char *p = lexer->pos;
+        char c = lexer->saved;
+
+        if (c == '\0') {
+                p += strspn(p, BLANKS);
+                c = *p;
+        }
+        lexer->saved = '\0';
+
+        if (c == '\0') {
+                lexer->pos = p;
+                return TOKEN_END;
+        }
+        if (c == '|') {
+                lexer->pos = p + 1;
+                return TOKEN_PIPE;
+        }
+        if (c == '&') {
+                lexer->pos = p + 1;
+                return TOKEN_BACKGROUND;
+        }
+        if (c == '<') {
+                lexer->pos = p + 1;
+                return TOKEN_INPUT;
+        }
+        if (c == '>') {
+                if (p[1] == '>') {
+                        lexer->pos = p + 2;
+                        return TOKEN_APPEND;
+                }
+                lexer->pos = p + 1;
+                return TOKEN_OUTPUT;
+        }
+
+        *word = p;
+        p += strcspn(p, BLANKS OPERATORS);
+        if (*p != '\0') {
+                if (strchr(OPERATORS, *p) != NULL) {
+                        lexer->saved = *p;
+                        *p = '\0';
+                } else {
+                        *p++ = '\0';
+                }
+        }
+        lexer->pos = p;
+        return TOKEN_WORD;
+}
+
+
+
+// Split line, which is changed, into pipeline.
+// Returns SUCCESS, ERR_SYNTAX or ERR_TOO_MANY.
+extern int parse_line(char *line, struct pipeline *pipeline)
+{
+        struct lexer lexer = { line, '\0' };
+        struct stage *stage = &pipeline->stages[0];
+        char *word = NULL;
+        int token;
+
+        memset(stage, 0, sizeof(*stage));
+        pipeline->nstages = 1;
+        pipeline->background = false;
+
+        while ((token = next_token(&lexer, &word)) != TOKEN_END) {
+                if (pipeline->background) {
+                        // only the end may come after &
+                        return ERR_SYNTAX;
+                }
+                if (token == TOKEN_BACKGROUND) {
+                        pipeline->background = true;
+                } else if (token == TOKEN_WORD) {
+                        if (stage->argc == MAXARGS) {
+                                return ERR_TOO_MANY;
+                        }
+                        stage->argv[stage->argc++] = word;
+                } else if (token == TOKEN_PIPE) {
+                        if (stage->argc == 0) {
+                                return ERR_SYNTAX;
+                        }
+                        if (pipeline->nstages == PARSE_MAX_STAGES) {
+                                return ERR_TOO_MANY;
+                        }
+                        stage = &pipeline->stages[pipeline->nstages++];
+                        memset(stage, 0, sizeof(*stage));
+                } else {
+                        // a redirection: the file name comes next
+                        if (next_token(&lexer, &word) != TOKEN_WORD) {
+                                return ERR_SYNTAX;
+                        }
+                        if (token == TOKEN_INPUT) {
+                                stage->input = word;
+                        } else {
+                                stage->output = word;
+                                stage->append = (token == TOKEN_APPEND);
+                        }
+                }
+        }
+
+        if (stage->argc == 0) {
+                if ((pipeline->nstages == 1) && (stage->input == NULL) &&
+                    (stage->output == NULL) && !pipeline->background) {
+                        // nothing at all
+                        pipeline->nstages = 0;
+                        return SUCCESS;
+                }
+                return ERR_SYNTAX;
+        }
+        return SUCCESS;
+}
+
+// end of parse.c
@@ -0,0 +1,44 @@
+// ----------------------------------------------------------------------
+// file: parse.h
+//
+// Description: This is the header file for the PARSE module. This
+//     module splits a command line into a pipeline:
+//
+//         command [< file] [> file | >> file] | command ... | command [&]
+//
+//     Words are separated by spaces and tabs. The operators |, <, >,
+//     >> and & need no spaces around them, and a redirection may be
+//     anywhere in its command. Nothing is quoted.
+//
+// Created: 2026-10-17
+// ----------------------------------------------------------------------
+#ifndef PARSE_H
+#define PARSE_H
+
+#include <stdbool.h>
+#include "common.h"
+
+#define PARSE_MAX_STAGES 16
+
+// One command of a pipeline. The strings point into the line.
+struct stage {
+        char *argv[MAXARGS + 1];  // ends with NULL
+        int argc;
+        char *input;              // < file, or NULL
+        char *output;             // > or >> file, or NULL
+        bool append;              // >>
+};
+
+struct pipeline {
+        struct stage stages[PARSE_MAX_STAGES];
+        int nstages;              // 0 for an empty line
+        bool background;          // it ended with &
+};
+
+
+// Split line, which is changed, into pipeline.
+// Returns SUCCESS, ERR_SYNTAX (a stage with no command, an operator
+// with no file after it, or & before the end) or ERR_TOO_MANY.
+extern int parse_line(char *line, struct pipeline *pipeline);
+
+#endif
@@ -0,0 +1,323 @@
+// ----------------------------------------------------------------------
+// file: pathcache.c
+//
+// Description: This file implements the PATHCACHE module. The commands
+//     are kept in a chained hash table (FNV-1a of the name), and the
+//     directories of $PATH in the order they are searched, each with
+//     the mtime it had when last looked at. A command remembers the
+//     directory it was found in by its place in that list.
+//
+//     A command found in a directory that is not a full path ("" or
+//     "." in $PATH) is not remembered, since where it is depends on the
+//     working directory.
+//
+// Created: 2026-10-17
+//
+// ----------------------------------------------------------------------
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "pathcache.h"
+
+#define DEFAULT_PATH "/bin:/usr/bin"   // as execvp() uses with no $PATH
+
+struct entry {
+        char *name;
+        char *path;
+        int dir;                  // where in $PATH it was found
+        long hits;
+        struct entry *next;
+};
+
+struct dir {
+        char *name;
+        struct timespec mtime;    // zero when it is not there
+};
+
+struct cache {
+        struct entry *buckets[PATHCACHE_SIZE];
+        int count;
+        char *path;               // $PATH as it was when split
+        struct dir dirs[PATHCACHE_MAX_DIRS];
+        int ndirs;
+        long long checked_ms;     // when the mtimes were last looked at
+        long hits;
+        long misses;
+        char found[PATHCACHE_MAX_PATH];    // a path not remembered
+};
+
+static struct cache cache;
+
+
+
+// The monotonic clock, in milliseconds.
+static long long now_ms(void)
+{
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+
+
+// The bucket of name.
+static unsigned bucket(const char *name)
+{
+        uint32_t hash = 2166136261u;
+
+        for (; *name != '\0'; name++) {
+                hash = (hash ^ (unsigned char)*name) * 16777619u;
+        }
+        return hash % PATHCACHE_SIZE;
+}
+
+
+
+// The mtime of directory name, or zero if it is not there.
+static struct timespec dir_mtime(const char *name)
+{
+        struct timespec none = { 0, 0 };
+        struct stat st;
+
+        if ((stat(name, &st) != 0) || !S_ISDIR(st.st_mode)) {
+                return none;
+        }
+        return st.st_mtim;
+}
+
+
+
+// Forget every command found in directory first or after it.
+static void forget_from(int first)
+{
+        struct entry **link;
+        struct entry *e;
+
+        for (int i = 0; i < PATHCACHE_SIZE; i++) {
+                link = &cache.buckets[i];
+                while (*link != NULL) {
+                        e = *link;
+                        if (e->dir >= first) {
+                                *link = e->next;
+                                free(e->name);
+                                free(e->path);
+                                free(e);
+                                cache.count--;
+                        } else {
+                                link = &e->next;
+                        }
+                }
+        }
+}
+
+
+
+// Split path into the directories to search.
+static void split_path(const char *path)
+{
+        char *dir;
+        char *rest;
+
+        for (int i = 0; i < cache.ndirs; i++) {
+                free(cache.dirs[i].name);
+        }
+        cache.ndirs = 0;
+        free(cache.path);
+        cache.path = strdup(path);
+        if (cache.path == NULL) {
+                return;
+        }
+
+        // strsep() and not strtok(): an empty entry is the working
+        // directory
+        rest = strdupa(path);
+        while (((dir = strsep(&rest, ":")) != NULL) &&
+               (cache.ndirs < PATHCACHE_MAX_DIRS)) {
+                cache.dirs[cache.ndirs].name = strdup((*dir == '\0') ? "." : dir);
+                if (cache.dirs[cache.ndirs].name == NULL) {
+                        break;
+                }
+                cache.dirs[cache.ndirs].mtime = dir_mtime(dir);
+                cache.ndirs++;
+        }
+        cache.checked_ms = now_ms();
+}
+
+
+
+// Forget what may no longer be right: everything if $PATH has changed,
+// or what came from a directory that has.
+static void revalidate(void)
+{
+        const char *path = getenv("PATH");
+        struct timespec mtime;
+        long long now;
+        int changed = -1;
+
+        if (path == NULL) {
+                path = DEFAULT_PATH;
+        }
+        if ((cache.path == NULL) || strcmp(cache.path, path)) {
+                forget_from(0);
+                split_path(path);
+                return;
+        }
+
+        now = now_ms();
+        if (now - cache.checked_ms < PATHCACHE_CHECK_MS) {
+                return;
+        }
+        cache.checked_ms = now;
+        for (int i = 0; i < cache.ndirs; i++) {
+                mtime = dir_mtime(cache.dirs[i].name);
+                if ((mtime.tv_sec != cache.dirs[i].mtime.tv_sec) ||
+                    (mtime.tv_nsec != cache.dirs[i].mtime.tv_nsec)) {
+                        cache.dirs[i].mtime = mtime;
+                        if (changed < 0) {
+                                changed = i;
+                        }
+                }
+        }
+        if (changed >= 0) {
+                forget_from(changed);
+        }
+}
+
+
+
+// Look for name in the directories of $PATH, as execvp() would. Puts
+// the path in cache.found and returns the directory it is in, or -1.
+static int search(const char *name)
+{
+        struct stat st;
+        int n;
+
+        for (int i = 0; i < cache.ndirs; i++) {
+                n = snprintf(cache.found, sizeof(cache.found), "%s/%s",
+                             cache.dirs[i].name, name);
+                if ((n < (int)sizeof(cache.found)) &&
+                    (stat(cache.found, &st) == 0) && S_ISREG(st.st_mode) &&
+                    (access(cache.found, X_OK) == 0)) {
+                        return i;
+                }
+        }
+        return -1;
+}
+
+
+
+// Get the full path of the program name would run.
+// Returns the path, or NULL with errno set to ENOENT.
+extern const char *pathcache_lookup(const char *name, bool *cached)
+{
+        struct entry *e;
+        unsigned b;
+        int dir;
+
+        *cached = false;
+        if (strchr(name, '/') != NULL) {
+                return name;
+        }
+        revalidate();
+
+        b = bucket(name);
+        for (e = cache.buckets[b]; e != NULL; e = e->next) {
+                if (!strcmp(e->name, name)) {
+                        e->hits++;
+                        cache.hits++;
+                        *cached = true;
+                        return e->path;
+                }
+        }
+
+        cache.misses++;
+        dir = search(name);
+        if (dir < 0) {
+                errno = ENOENT;
+                return NULL;
+        }
+        if (cache.dirs[dir].name[0] != '/') {
+                return cache.found;
+        }
+
+        if (cache.count == PATHCACHE_SIZE) {
+                forget_from(0);
+        }
+        e = malloc(sizeof(*e));
+        if (e != NULL) {
+                e->name = strdup(name);
+                e->path = strdup(cache.found);
+        }
+        if ((e == NULL) || (e->name == NULL) || (e->path == NULL)) {
+                if (e != NULL) {
+                        free(e->name);
+                        free(e->path);
+                        free(e);
+                }
+                return cache.found;
+        }
+        e->dir = dir;
+        e->hits = 0;
+        e->next = cache.buckets[b];
+        cache.buckets[b] = e;
+        cache.count++;
+        return e->path;
+}
+
+
+
+// Forget where name was found.
+extern void pathcache_forget(const char *name)
+{
+        struct entry **link = &cache.buckets[bucket(name)];
+        struct entry *e;
+
+        for (; *link != NULL; link = &(*link)->next) {
+                e = *link;
+                if (!strcmp(e->name, name)) {
+                        *link = e->next;
+                        free(e->name);
+                        free(e->path);
+                        free(e);
+                        cache.count--;
+                        return;
+                }
+        }
+}
+
+
+
+// Forget every command.
+extern void pathcache_clear(void)
+{
+        forget_from(0);
+}
+
+
+
+// Print each command remembered, then the hits and misses.
+extern void pathcache_list(void)
+{
+        const struct entry *e;
+
+        if (cache.count > 0) {
+                printf("hits\tcommand\n");
+        }
+        for (int i = 0; i < PATHCACHE_SIZE; i++) {
+                for (e = cache.buckets[i]; e != NULL; e = e->next) {
+                        printf("%4ld\t%s\n", e->hits, e->path);
+                }
+        }
+        printf("hash: %ld hits, %ld misses, %d commands\n",
+               cache.hits, cache.misses, cache.count);
+        fflush(stdout);
+}
+
+// end of pathcache.c
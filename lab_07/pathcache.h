@@ -0,0 +1,51 @@
+// ----------------------------------------------------------------------
+// file: pathcache.h
+//
+// Description: This is the header file for the PATHCACHE module. This
+//     module remembers where in $PATH each command was found, as the
+//     hash builtin of bash does, so the shell can exec /usr/bin/ls
+//     itself rather than have every directory before it tried by a
+//     failed execve() each time ls is run.
+//
+//     What it remembers is forgotten when $PATH changes. Every
+//     PATHCACHE_CHECK_MS the directories of $PATH are looked at again:
+//     if one has been changed (its mtime is new), every command found
+//     in it or after it is forgotten, since a program put there may now
+//     come first. A command that no longer runs from where it was found
+//     is forgotten by the caller, with pathcache_forget().
+//
+// Created: 2026-10-17
+//
+// ----------------------------------------------------------------------
+#ifndef PATHCACHE_H
+#define PATHCACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define PATHCACHE_SIZE 256         // buckets; commands remembered at most
+#define PATHCACHE_MAX_DIRS 64      // of $PATH
+#define PATHCACHE_MAX_PATH 4096
+#define PATHCACHE_CHECK_MS 1000    // between looks at the mtimes
+
+
+// Get the full path of the program name would run. A name with a / in
+// it is itself. *cached is set when it was already known.
+// Returns the path (good until the next call), or NULL with errno set
+// to ENOENT if it is nowhere in $PATH.
+extern const char *pathcache_lookup(const char *name, bool *cached);
+
+
+// Forget where name was found.
+extern void pathcache_forget(const char *name);
+
+
+// Forget every command.
+extern void pathcache_clear(void);
+
+
+// Print each command remembered, with its hits and path, then the
+// hits and misses of all of them.
+extern void pathcache_list(void);
+
+#endif
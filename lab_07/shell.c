@@ -19,17 +19,17 @@
 #include <signal.h>
 #include <unistd.h>
 #include <sys/wait.h>
+#include "parse.h"
+#include "job.h"
+#include "builtin.h"
+#include "history.h"
+#include "common.h"
 
 
-#define SUCCESS 0
 #define ALARM_TIME 30
-#define MAXARGS 10
-#define CHAR_LENGTH 80
+#define CHAR_LENGTH 1024
 
 
-//GLOBAL
-FILE * filePointer;
-
 // **************************  signal handler  **************************
 
 void signal_handler(int signal)
@@ -38,9 +38,7 @@ void signal_handler(int signal)
                 fprintf(stderr, "A segmentation fault has been detected.\n");
                 fprintf(stderr, "Exiting...\n");
                 //flush history file
-                fflush(filePointer);
-                //Close the file
-                fclose(filePointer);
+                history_flush();
                 exit(-1);
         }
 
@@ -48,9 +46,7 @@ void signal_handler(int signal)
                 fprintf(stdout, "\nThe interupt signal has been caught\n");
                 fprintf(stdout, "Exiting...\n");
                 //flush history file
-                fflush(filePointer);
-                //Close the file
-                fclose(filePointer);
+                history_flush();
                 exit(-2);
         }
 
@@ -58,9 +54,7 @@ void signal_handler(int signal)
                 fprintf(stdout, "The session has expired.\n");
                 fprintf(stdout, "Exiting...\n");
                 //flush history file
-                fflush(filePointer);
-                //Close the file
-                fclose(filePointer);
+                history_flush();
                 exit(-3);
         }
 
@@ -74,17 +68,15 @@ void signal_handler(int signal)
 int main()
 {
 
-        //reset status,pid
+        //reset status
         int status;
-        int pid;
-        int i = 0;
+        int result;
         int length;
         //allocate space for user input
         char userInput[CHAR_LENGTH];
-        // set array length, reinitilize to null so data isn't left over
-        char *cmdArray[MAXARGS+1] = {NULL};
-        //initialize token
-        char *token = NULL;
+        // the commands of the line
+        struct pipeline pipeline;
+        char *command;
 
         //set up signal handling:
         struct sigaction act;
@@ -97,93 +89,96 @@ int main()
         sigaction(SIGSEGV,&act,NULL);
         sigaction(SIGINT, &act,NULL);
         sigaction(SIGALRM, &act,NULL);
+        // children are reaped through a signalfd
+        if(job_init() != SUCCESS){
+                fprintf(stderr, "Error on setting up SIGCHLD.\n");
+                exit(-1);
+        }
 
 
-        errno = 0;
-        //open file for write:
-        filePointer = fopen("shell-history", "a");
-        if(errno != 0){
-                fprintf(stderr, "Error on opening of shell-history.\n");
+        //open the history (and its index)
+        if(history_open(HISTORY_FILE) != SUCCESS){
+                fprintf(stderr, "Error on opening of %s.\n", HISTORY_FILE);
                 exit(-1);
         }
 
         // set up looping for prompt action
         while(1){
 
-                // querry for input
+                // tell of background jobs that are done, then querry for input
+                job_report();
                 printf("prompt>");
 
                 // get the input, put it into userInput
                 errno = 0;
-                fgets(userInput, sizeof(userInput), stdin);
-                if(errno != 0){
-                        fprintf(stderr, "Error on taking user input.\n");
-                        exit(-1);
+                if(fgets(userInput, sizeof(userInput), stdin) == NULL){
+                        if(errno != 0){
+                                fprintf(stderr, "Error on taking user input.\n");
+                                exit(-1);
+                        }
+                        // end of input: same as "exit"
+                        history_close();
+                        exit(0);
+                }
+
+                //remove carriage return from user input
+                length = strcspn(userInput, "\n");
+                userInput[length] = '\0';
+
+                // put the line it stands for in place of !!, !n or !prefix
+                result = history_expand(userInput, sizeof(userInput));
+                if(result == ERR_NO_EVENT){
+                        fprintf(stderr, "%.*s: event not found\n",
+                                (int)strcspn(userInput, " \t"), userInput);
+                        continue;
+                }
+                if(result == ERR_TOO_MANY){
+                        fprintf(stderr, "The line is too long once expanded.\n");
+                        continue;
+                }
+                if(result == SUCCESS){
+                        printf("%s\n", userInput);
                 }
 
                 // write user input to shell history file
-                errno = 0;
-                fwrite(userInput, sizeof(char), strlen(userInput), filePointer);
-                if(errno != 0){
+                if(history_add(userInput) != SUCCESS){
                         fprintf(stderr, "Error on writing to history file.\n");
                         exit(-1);
                 }
 
-                //remove carriage return from user input
-                length = strlen(userInput)-1;
-                userInput[length] = '\0';
-
-                // start tokenizing input
-                token = strtok(userInput," ");
+                // split the input into its commands
+                result = parse_line(userInput, &pipeline);
+                if(result == ERR_SYNTAX){
+                        fprintf(stderr, "Syntax error: a command or a file name is missing.\n");
+                        continue;
+                }
+                if(result == ERR_TOO_MANY){
+                        fprintf(stderr, "Too many arguments or commands (at most %d and %d).\n",
+                                MAXARGS, PARSE_MAX_STAGES);
+                        continue;
+                }
 
                 //check for user input of "return"
-                if(token == NULL){
+                if(pipeline.nstages == 0){
                         continue;
                 }
+                command = pipeline.stages[0].argv[0];
 
                 // if user wishes to exit, exit(0)
-                if(!strcmp(token, "exit")){
-                        // fprintf(stdout, "exit triggered\n");
-                        fclose(filePointer);
+                if((pipeline.nstages == 1) && !strcmp(command, "exit")){
+                        history_close();
                         exit(0);
                 }
 
                 //if user enters 'explode', cause a segmentation fault
-                if(!strcmp(token, "explode")){
+                if((pipeline.nstages == 1) && !strcmp(command, "explode")){
                         int *bomb = NULL;
                         *bomb = 42;
                 }
 
-                // take the user input, put each space seperated cmd/option into an array
-                while(token != NULL){
-                        cmdArray[i++] = token;
-                        token = strtok(NULL, " ");
-                }
-
-                // set end of array to null so it isn't read past
-                cmdArray[i] = NULL;
-                //reset index value
-                i = 0;
-
-                //fork a child process
-                pid = fork();
-
-                if(pid<0){
-                        // bad parent
-                        fprintf(stderr, "Error with parent process.\n");
-                        fprintf(stderr, "Exiting...\n");
-                        fclose(filePointer);
-                        exit(-1);
-                } else if (pid==0) {
-                        // successfully forked child
-                        status = execvp(cmdArray[0],cmdArray);
-                        fprintf(stderr, "Error with command: (possibly invalid command or file does not exist)\n");
-                        fclose(filePointer);
-                        exit(-1);
-
-                } else {
-                        // wait for child
-                        waitpid(pid, &status, 0);
+                //run a builtin, or start every command of the line
+                if(builtin_run(&pipeline, &status) == BUILTIN_NONE){
+                        job_run(&pipeline, &status);
                 }
 
         } //End While
@@ -0,0 +1,263 @@
+// ----------------------------------------------------------------------
+// file: test.c
+//
+// Description: This is a program to test the PARSE, HISTORY and
+//     PATHCACHE modules of the shell. Each check prints a "-Good:" or a
+//     "-Bad:" line; the program exits with a non-zero value if any of
+//     them was bad. It works in a directory of its own under /tmp.
+//
+// Created: 2026-10-17
+//
+// ----------------------------------------------------------------------
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "parse.h"
+#include "history.h"
+#include "pathcache.h"
+#include "common.h"
+
+#define TEST_DIR_TEMPLATE "/tmp/shell-test.XXXXXX"
+#define MAX_NAME 256
+#define MAX_LINE 2048                      // past what the shell reads
+#define MANY_LINES (2 * HISTORY_SORT_TAIL + 100)
+
+unsigned int Num_bad = 0;
+char Test_dir[] = TEST_DIR_TEMPLATE;
+
+
+
+// Print the result of one check.
+void check(int good, const char *what)
+{
+        if (good) {
+                printf("-Good: %s\n", what);
+        } else {
+                printf("-Bad: %s\n", what);
+                ++Num_bad;
+        }
+}
+
+
+
+// Parse text (copied, since the line is cut up).
+int parse(const char *text, struct pipeline *pipeline)
+{
+        static char line[MAX_LINE];
+
+        snprintf(line, sizeof(line), "%s", text);
+        return parse_line(line, pipeline);
+}
+
+
+
+void test_parse(void)
+{
+        struct pipeline p;
+        char line[MAX_LINE];
+        size_t len = 0;
+
+        check((parse("ls -l | grep x > out &", &p) == SUCCESS) &&
+              (p.nstages == 2) && p.background &&
+              (p.stages[0].argc == 2) && !strcmp(p.stages[0].argv[1], "-l") &&
+              (p.stages[0].argv[2] == NULL) &&
+              !strcmp(p.stages[1].argv[0], "grep") &&
+              !strcmp(p.stages[1].output, "out") && !p.stages[1].append,
+              "parse: a pipe, an output file and &");
+        check((parse("sort<in|uniq>>out", &p) == SUCCESS) && (p.nstages == 2) &&
+              !strcmp(p.stages[0].input, "in") && !strcmp(p.stages[1].output, "out") &&
+              p.stages[1].append && !p.background,
+              "parse: operators need no spaces");
+        check((parse("  \t", &p) == SUCCESS) && (p.nstages == 0),
+              "parse: a blank line has no commands");
+        check(parse("| wc", &p) == ERR_SYNTAX, "parse: a pipe with no command before it");
+        check(parse("ls |", &p) == ERR_SYNTAX, "parse: a pipe with no command after it");
+        check(parse("ls >", &p) == ERR_SYNTAX, "parse: > with no file");
+        check(parse("sleep 1 & ls", &p) == ERR_SYNTAX, "parse: & before the end");
+
+        for (int i = 0; i <= PARSE_MAX_STAGES; i++) {
+                len += snprintf(line + len, sizeof(line) - len, "%sa", (i > 0) ? "|" : "");
+        }
+        check(parse(line, &p) == ERR_TOO_MANY, "parse: too many stages");
+        len = 0;
+        for (int i = 0; i <= MAXARGS; i++) {
+                len += snprintf(line + len, sizeof(line) - len, "a ");
+        }
+        check(parse(line, &p) == ERR_TOO_MANY, "parse: too many arguments");
+}
+
+
+
+// Expand text as the shell would, into line. Returns what
+// history_expand() does.
+int expand(const char *text, char *line)
+{
+        snprintf(line, HISTORY_MAX_LINE, "%s", text);
+        return history_expand(line, HISTORY_MAX_LINE);
+}
+
+
+
+void test_history(void)
+{
+        char line[HISTORY_MAX_LINE];
+        char query[MAX_NAME + 1];
+        char what[MAX_NAME];
+        bool good = true;
+        int status;
+
+        check(history_open("h") == SUCCESS, "history: opened");
+        history_add("echo one");
+        history_add("   ");
+        history_add("ls -l");
+        history_add("echo two");
+
+        check((expand("!!", line) == SUCCESS) && !strcmp(line, "echo two"),
+              "history: !! is the last line");
+        check((expand("!2 /tmp", line) == SUCCESS) && !strcmp(line, "ls -l /tmp"),
+              "history: !n is line n (blank lines are not kept), and the rest stays");
+        check((expand("!-3", line) == SUCCESS) && !strcmp(line, "echo one"),
+              "history: !-n is n lines back");
+        check((expand("!ec", line) == SUCCESS) && !strcmp(line, "echo two"),
+              "history: !prefix is the newest that starts with it");
+        check(expand("!nope", line) == ERR_NO_EVENT, "history: !prefix that is not there");
+        check(expand("!9", line) == ERR_NO_EVENT, "history: !n past the end");
+        check(expand("echo !!", line) == HISTORY_NOT_EVENT, "history: ! only counts at the start");
+        check(expand("! x", line) == HISTORY_NOT_EVENT, "history: ! on its own is left alone");
+
+        // enough lines that the sorted file is made, and a prefix many
+        // of them share; the newest of those is not the newest line
+        for (int i = 0; i < MANY_LINES; i++) {
+                snprintf(line, sizeof(line), "git commit -m %d", i);
+                history_add(line);
+                snprintf(line, sizeof(line), "make-%d", i % 50);
+                history_add(line);
+        }
+        expand("!git", line);
+        while (wait(&status) > 0) {
+                ;
+        }
+        check(access("h.sort", F_OK) == 0, "history: the sorted file was made in the background");
+        for (int i = 0; i < 50; i += 7) {
+                snprintf(what, sizeof(what), "make-%d", (MANY_LINES - 50 + i) % 50);
+                snprintf(query, sizeof(query), "!%s", what);
+                good = good && (expand(query, line) == SUCCESS) && !strcmp(line, what);
+        }
+        check(good, "history: !prefix is right through the sorted file");
+        snprintf(what, sizeof(what), "git commit -m %d", MANY_LINES - 1);
+        check((expand("!git c", line) == SUCCESS) && !strncmp(line, what, strlen(what)),
+              "history: a prefix shared by thousands of lines gives the newest");
+        check((expand("!echo t", line) == SUCCESS) && !strcmp(line, "echo two t"),
+              "history: an old line is found through the sorted file");
+        history_close();
+
+        // another shell sees all of it, numbered the same
+        check((history_open("h") == SUCCESS) &&
+              (expand("!3", line) == SUCCESS) && !strcmp(line, "echo two"),
+              "history: the lines are there for the next shell");
+        history_close();
+}
+
+
+
+// Make name an executable script in dir.
+void make_program(const char *dir, const char *name)
+{
+        char path[MAX_NAME];
+        int fd;
+
+        snprintf(path, sizeof(path), "%s/%s", dir, name);
+        fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0755);
+        if (fd >= 0) {
+                write(fd, "#!/bin/sh\n", 10);
+                close(fd);
+        }
+}
+
+
+
+void test_pathcache(void)
+{
+        char first[MAX_NAME];
+        char second[MAX_NAME];
+        char path[MAX_NAME * 2 + 2];
+        char *old_path = NULL;
+        const char *found;
+        bool cached;
+
+        if (getenv("PATH") != NULL) {
+                old_path = strdup(getenv("PATH"));
+        }
+        snprintf(first, sizeof(first), "%s/first", Test_dir);
+        snprintf(second, sizeof(second), "%s/second", Test_dir);
+        mkdir(first, 0755);
+        mkdir(second, 0755);
+        make_program(second, "prog");
+        snprintf(path, sizeof(path), "%s:%s", first, second);
+        setenv("PATH", path, 1);
+
+        found = pathcache_lookup("prog", &cached);
+        check((found != NULL) && !strncmp(found, second, strlen(second)) && !cached,
+              "pathcache: a command is found in $PATH");
+        found = pathcache_lookup("prog", &cached);
+        check((found != NULL) && cached, "pathcache: and is remembered");
+        found = pathcache_lookup("nothere", &cached);
+        check((found == NULL) && (errno == ENOENT), "pathcache: a missing command is ENOENT");
+        found = pathcache_lookup("./prog", &cached);
+        check((found != NULL) && !strcmp(found, "./prog") && !cached,
+              "pathcache: a name with a / is itself");
+
+        // a program put in an earlier directory wins, once it is seen
+        make_program(first, "prog");
+        usleep((PATHCACHE_CHECK_MS + 100) * 1000);
+        found = pathcache_lookup("prog", &cached);
+        check((found != NULL) && !strncmp(found, first, strlen(first)) && !cached,
+              "pathcache: a changed directory is looked at again");
+
+        pathcache_forget("prog");
+        pathcache_lookup("prog", &cached);
+        check(!cached, "pathcache: a forgotten command is looked up again");
+
+        setenv("PATH", second, 1);
+        found = pathcache_lookup("prog", &cached);
+        check((found != NULL) && !strncmp(found, second, strlen(second)) && !cached,
+              "pathcache: a new $PATH forgets everything");
+        pathcache_clear();
+        pathcache_lookup("prog", &cached);
+        check(!cached, "pathcache: hash -r forgets everything");
+
+        if (old_path != NULL) {
+                setenv("PATH", old_path, 1);
+                free(old_path);
+        }
+}
+
+
+
+int main(int argc, const char *argv[])
+{
+        char command[MAX_NAME];
+
+        if ((mkdtemp(Test_dir) == NULL) || (chdir(Test_dir) != 0)) {
+                printf("-Bad: no test directory\n");
+                return 1;
+        }
+
+        test_parse();
+        test_history();
+        test_pathcache();
+
+        snprintf(command, sizeof(command), "rm -rf %s", Test_dir);
+        system(command);
+        printf("--------------------------------\n");
+        printf("%u bad\n", Num_bad);
+        return (Num_bad == 0) ? 0 : 1;
+}
+
+// end of test.c
@@ -0,0 +1,603 @@
+// ----------------------------------------------------------------------
+// file: batch.c
+//
+// Description: This file implements the BATCH module. The whole list
+//     is read first, and then the files of each host are fetched in
+//     the order they were listed. A new connection carries only one
+//     request; once a response has shown that the server keeps the
+//     connection open, up to BATCH_PIPELINE requests are written to
+//     it at once and their responses read back in order. GET can be
+//     sent again safely, so when a server closes a connection with
+//     requests still unanswered they are simply sent again on the next
+//     one.
+//
+// Created: 2026-10-17
+// ----------------------------------------------------------------------
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "batch.h"
+#include "pool.h"
+#include "http.h"
+#include "net.h"
+#include "metrics.h"
+#include "cache.h"
+#include "common.h"
+
+#define URL_PREFIX "http://"
+#define COMMENT '#'
+#define FILE_MODE 0666            // before the umask
+#define NO_FILE -1
+#define BATCH_RETRY 1             // the connection closed before any of
+                                  // the response arrived
+
+
+
+// What went wrong with a file, for the message.
+static const char *error_message(int code)
+{
+        switch (code) {
+                case ERR_DNS:
+                        return "DNS resolution failed";
+                case ERR_NOT_FOUND:
+                        return "file not found on server";
+                case ERR_BAD_REQUEST:
+                        return "server said 'bad request'";
+                case ERR_UNSUPPORTED:
+                        return "the file type is not text";
+                case ERR_FILE_EXISTS:
+                        return "a copy of the file exists locally";
+                case ERR_FILE:
+                        return "can not create the file";
+                case ERR_ON_WRITE:
+                        return "error writing to the file";
+                case ERR_SOCKET:
+                case ERR_CONNECT:
+                        return "can not connect to the server";
+                case ERR_NO_DATA:
+                        return "the connection closed early";
+                case ERR_INTERNAL:
+                        return "out of memory";
+                default:
+                        return "bad response from server";
+        }
+}
+
+
+
+// Report that the file of path could not be downloaded.
+extern void batch_fail(const char *path, int code, struct batch_stats *stats)
+{
+        fprintf(stderr, "%s: %s\n", path, error_message(code));
+        stats->failed++;
+}
+
+
+
+// The download of item ended with result: write its record.
+static void record(struct batch_item *item, int result, long long bytes,
+                   struct batch_stats *stats)
+{
+        metrics_done(&item->metrics, item->metrics.status, result, bytes);
+        if (stats->records != NULL) {
+                metrics_json(&item->metrics, stats->records);
+        }
+}
+
+
+
+// Report that item could not be downloaded, and write its record.
+extern void batch_fail_item(struct batch_item *item, int code,
+                            struct batch_stats *stats)
+{
+        batch_fail(item->path, code, stats);
+        record(item, code, 0, stats);
+}
+
+
+
+// Start timing item, whose request is about to be sent.
+extern void batch_start(struct batch_item *item)
+{
+        metrics_init(&item->metrics, item->host->name, item->path, false);
+        item->metrics.dns_ms = item->host->dns_ms;
+        item->metrics.dns_cached = item->host->dns.cached;
+}
+
+
+
+// Put the request for item into buf.
+// Returns its length, or ERR_INTERNAL if it is too long.
+extern int batch_request(const struct batch_item *item, char *buf, size_t size)
+{
+        char conditions[CACHE_MAX_CONDITIONS] = "";
+
+        if ((item->cache != NULL) &&
+            (cache_conditions(item->cache, conditions, sizeof(conditions)) < 0)) {
+                return ERR_INTERNAL;
+        }
+        return http_build_request(buf, size, "GET", item->host->name, item->path,
+                                  conditions, true);
+}
+
+
+
+// Make sure there are unread bytes in the buffer of conn, counting a
+// read in metrics. Returns how many there are, 0 if the server
+// closed, or -1.
+static ssize_t fill(struct pool_conn *conn, struct metrics *metrics)
+{
+        ssize_t count;
+
+        if (conn->start < conn->end) {
+                return conn->end - conn->start;
+        }
+        do {
+                count = read(conn->fd, conn->buf, POOL_BUFSIZE);
+        } while ((count < 0) && (errno == EINTR));
+        if (count > 0) {
+                metrics->reads++;
+        }
+        conn->start = 0;
+        conn->end = (count > 0) ? count : 0;
+        return count;
+}
+
+
+
+// Write len bytes of body to fd, or drop them if there is no file.
+extern int batch_sink(int fd, const char *buf, size_t len)
+{
+        ssize_t count;
+
+        while ((fd != NO_FILE) && (len > 0)) {
+                count = write(fd, buf, len);
+                if ((count < 0) && (errno == EINTR)) {
+                        continue;
+                }
+                if (count <= 0) {
+                        return ERR_ON_WRITE;
+                }
+                buf += count;
+                len -= count;
+        }
+        return SUCCESS;
+}
+
+
+
+// Read the body of response from conn into fd.
+// *reusable is set if the connection can carry another response.
+static int read_body(struct pool_conn *conn, const struct http_response *response,
+                     int fd, struct metrics *metrics, long long *bytes,
+                     bool *reusable)
+{
+        struct http_body body;
+        char *data;
+        ssize_t count;
+        size_t used;
+        size_t out;
+        int status;
+        int result = SUCCESS;
+
+        http_body_init(&body, response);
+        *reusable = response->keep_alive && (body.framing != HTTP_BODY_TO_CLOSE);
+        *bytes = 0;
+
+        status = http_body_decode(&body, conn->buf, 0, &used, &out);
+        while ((result == SUCCESS) && (status == HTTP_MORE)) {
+                count = fill(conn, metrics);
+                if (count <= 0) {
+                        if ((count == 0) && (body.framing == HTTP_BODY_TO_CLOSE)) {
+                                return SUCCESS;
+                        }
+                        return ERR_NO_DATA;
+                }
+                data = conn->buf + conn->start;
+                status = http_body_decode(&body, data, count, &used, &out);
+                if (status < 0) {
+                        return status;
+                }
+                conn->start += used;
+                metrics_data(metrics, used);
+                result = batch_sink(fd, data, out);
+                *bytes += out;
+        }
+        return result;
+}
+
+
+
+// Decide what to do with the body of response, the answer for item.
+// Returns SUCCESS if the body is wanted, or why it is not.
+extern int batch_open(struct batch_item *item,
+                      const struct http_response *response, int *fd)
+{
+        char temp[CACHE_MAX_NAME];
+
+        *fd = NO_FILE;
+        item->metrics.status = response->status;
+        if (response->content_length != HTTP_UNKNOWN_LENGTH) {
+                item->metrics.expected = response->header_size +
+                        response->content_length;
+        }
+
+        // the same checks as a single download
+        if ((item->cache != NULL) && (response->status == HTTP_NOT_MODIFIED) &&
+            ((item->cache->etag[0] != '\0') || (item->cache->last_modified[0] != '\0'))) {
+                return BATCH_UNCHANGED;
+        } else if (response->status == HTTP_NOT_FOUND) {
+                return ERR_NOT_FOUND;
+        } else if (response->status == HTTP_BAD_REQUEST) {
+                return ERR_BAD_REQUEST;
+        } else if (response->status != HTTP_OK) {
+                return ERR_BAD_RESPONSE;
+        } else if (!response->is_text) {
+                return ERR_UNSUPPORTED;
+        }
+        if (item->cache != NULL) {
+                // the old copy stays until the new one is all here
+                cache_update(item->cache, response);
+                if (cache_temp_name(item->filename, temp, sizeof(temp)) != SUCCESS) {
+                        return ERR_FILE;
+                }
+                *fd = open(temp, O_WRONLY | O_CREAT | O_TRUNC, FILE_MODE);
+        } else {
+                *fd = open(item->filename, O_WRONLY | O_CREAT | O_EXCL, FILE_MODE);
+        }
+        if (*fd < 0) {
+                *fd = NO_FILE;
+                return (errno == EEXIST) ? ERR_FILE_EXISTS : ERR_FILE;
+        }
+        return SUCCESS;
+}
+
+
+
+// Close the file of item, removing it if result is not SUCCESS, and
+// report how the download went.
+// Returns result, or ERR_ON_WRITE if the file could not be closed.
+extern int batch_finish(struct batch_item *item, int fd, int wanted,
+                        int result, long long bytes, struct batch_stats *stats)
+{
+        char temp[CACHE_MAX_NAME];
+
+        if ((fd != NO_FILE) && (close(fd) != 0) && (result == SUCCESS)) {
+                result = ERR_ON_WRITE;
+        }
+        if ((fd != NO_FILE) && (item->cache != NULL)) {
+                if (result == SUCCESS) {
+                        result = cache_commit(item->filename, item->cache);
+                }
+                if ((result != SUCCESS) &&
+                    (cache_temp_name(item->filename, temp, sizeof(temp)) == SUCCESS)) {
+                        unlink(temp);
+                }
+        } else if ((fd != NO_FILE) && (result != SUCCESS)) {
+                unlink(item->filename);
+        }
+
+        if ((wanted == BATCH_UNCHANGED) && (result == SUCCESS)) {
+                printf("%s: up to date\n", item->filename);
+                stats->unchanged++;
+                record(item, SUCCESS, 0, stats);
+                return SUCCESS;
+        } else if (wanted == BATCH_UNCHANGED) {
+                batch_fail(item->path, result, stats);
+        } else if (wanted != SUCCESS) {
+                batch_fail(item->path, wanted, stats);
+        } else if (result != SUCCESS) {
+                batch_fail(item->path, result, stats);
+        } else {
+                printf("%s: %lld bytes\n", item->filename, bytes);
+                stats->files++;
+                stats->bytes += bytes;
+        }
+        record(item, ((wanted != SUCCESS) && (wanted != BATCH_UNCHANGED)) ?
+               wanted : result, bytes, stats);
+        return result;
+}
+
+
+
+// Read the next response on conn, the one for item, and save it.
+// *reusable is set if the connection can carry another response.
+// Returns SUCCESS if the whole response was read (whether or not the
+// file was wanted), BATCH_RETRY if none of it came, or an ERR_ code
+// (already reported) if the connection is no longer usable.
+static int fetch_one(struct pool_conn *conn, struct batch_item *item,
+                     struct batch_stats *stats, bool *reusable)
+{
+        struct http_response response;
+        long long bytes = 0;
+        bool started = false;
+        ssize_t count;
+        size_t used;
+        int status = HTTP_MORE;
+        int wanted;
+        int result;
+        int fd;
+
+        http_response_init(&response);
+        while (status == HTTP_MORE) {
+                count = fill(conn, &item->metrics);
+                if (count <= 0) {
+                        return started ? ERR_NO_DATA : BATCH_RETRY;
+                }
+                started = true;
+                status = http_parse_header(&response, conn->buf + conn->start,
+                                           count, &used);
+                conn->start += used;
+                metrics_data(&item->metrics, used);
+        }
+        if (status != HTTP_DONE) {
+                batch_fail_item(item, ERR_BAD_RESPONSE, stats);
+                return ERR_BAD_RESPONSE;
+        }
+        conn->responses++;
+
+        // the body is read even if it is not wanted, to get to the next
+        wanted = batch_open(item, &response, &fd);
+        result = read_body(conn, &response, fd, &item->metrics, &bytes, reusable);
+        return batch_finish(item, fd, wanted, result, bytes, stats);
+}
+
+
+
+// Fetch the ntodo items listed in todo, all on host.
+static void fetch_host(struct pool *pool, struct pool_host *host,
+                       struct batch_item *items, const int *todo, int ntodo,
+                       struct batch_stats *stats)
+{
+        char requests[BATCH_PIPELINE * HTTP_MAX_REQUEST];
+        struct pool_conn *conn;
+        struct batch_item *item;
+        bool reusable = false;
+        size_t len;
+        int head = 0;             // todo[head] is the first not yet answered
+        int nsent;
+        int result;
+
+        while (head < ntodo) {
+                // a new connection is timed as part of the first item
+                item = &items[todo[head]];
+                batch_start(item);
+                conn = pool_get(pool, host, &result);
+                if (conn == NULL) {
+                        while (head < ntodo) {
+                                batch_fail_item(&items[todo[head++]], result, stats);
+                        }
+                        return;
+                }
+                if (conn->responses == 0) {
+                        item->metrics.connect_ms = metrics_now(&item->metrics);
+                }
+
+                // only pipeline on a connection that has been kept open
+                nsent = (conn->responses > 0) ? BATCH_PIPELINE : 1;
+                if (nsent > ntodo - head) {
+                        nsent = ntodo - head;
+                }
+                len = 0;
+                for (int i = 0; i < nsent; i++) {
+                        item = &items[todo[head + i]];
+                        if (i > 0) {
+                                batch_start(item);
+                        }
+                        len += batch_request(item, requests + len,
+                                             sizeof(requests) - len);
+                }
+                stats->requests += nsent;
+                result = net_send_all(conn->fd, requests, len);
+                if (result != SUCCESS) {
+                        // as good as no answer
+                        nsent = 0;
+                        result = BATCH_RETRY;
+                }
+                for (int i = 0; i < nsent; i++) {
+                        metrics_sent(&items[todo[head + i]].metrics);
+                }
+
+                for (int i = 0; i < nsent; i++) {
+                        result = fetch_one(conn, &items[todo[head]], stats, &reusable);
+                        if (result != SUCCESS) {
+                                break;
+                        }
+                        head++;
+                        if (!reusable) {
+                                // any requests after this one are sent again
+                                break;
+                        }
+                }
+
+                if ((result == SUCCESS) && reusable) {
+                        pool_put(host, conn);
+                        continue;
+                }
+                pool_drop(conn);
+                item = &items[todo[head]];
+                if ((result == BATCH_RETRY) && (++item->attempts >= BATCH_MAX_ATTEMPTS)) {
+                        batch_fail_item(item, ERR_NO_DATA, stats);
+                        head++;
+                } else if ((result != SUCCESS) && (result != BATCH_RETRY)) {
+                        // fetch_one() has already reported it
+                        head++;
+                }
+        }
+}
+
+
+
+// Turn one line of the list into an item. Returns SUCCESS, ERR_NO_DATA
+// for a line with nothing to download, or the reason it can not be.
+static int parse_line(char *line, const char *default_host, bool update,
+                      struct pool *pool, struct batch_item *item)
+{
+        char request[HTTP_MAX_REQUEST];
+        const char *host_name = default_host;
+        char *end = line + strlen(line);
+        char *path = line;
+        char *slash;
+        int result = SUCCESS;
+
+        while ((end > line) && isspace((unsigned char)end[-1])) {
+                *--end = '\0';
+        }
+        while (isspace((unsigned char)*path)) {
+                path++;
+        }
+        if ((*path == '\0') || (*path == COMMENT)) {
+                return ERR_NO_DATA;
+        }
+
+        if (!strncasecmp(path, URL_PREFIX, strlen(URL_PREFIX))) {
+                host_name = path + strlen(URL_PREFIX);
+                slash = strchr(host_name, '/');
+                if (slash == NULL) {
+                        return ERR_BAD_REQUEST;
+                }
+                *slash = '\0';
+                path = slash + 1;
+        }
+        while (*path == '/') {
+                path++;
+        }
+
+        slash = strrchr(path, '/');
+        item->filename = (slash != NULL) ? slash + 1 : path;
+        if ((*item->filename == '\0') ||
+            (http_build_request(request, sizeof(request), "GET", host_name,
+                                path, NULL, true) < 0)) {
+                return ERR_BAD_REQUEST;
+        }
+        if (!update && (access(item->filename, F_OK) == 0)) {
+                return ERR_FILE_EXISTS;
+        }
+        item->host = pool_host(pool, host_name, &result);
+        if (item->host == NULL) {
+                return result;
+        }
+        item->attempts = 0;
+        item->path = path;
+        item->cache = NULL;
+        if (update) {
+                item->cache = malloc(sizeof(*item->cache));
+                if (item->cache == NULL) {
+                        return ERR_INTERNAL;
+                }
+                cache_load(item->filename, item->cache);
+                // the validators must fit in the request too
+                if (batch_request(item, request, sizeof(request)) < 0) {
+                        free(item->cache);
+                        return ERR_BAD_REQUEST;
+                }
+        }
+        batch_start(item);
+        return SUCCESS;
+}
+
+
+
+// Read the list of files in file into list, using default_host for
+// the lines that are just paths.
+// Returns SUCCESS, or ERR_INTERNAL if the list could not be read.
+extern int batch_read_list(FILE *file, const char *default_host, bool update,
+                           struct pool *pool, struct batch_list *list,
+                           struct batch_stats *stats)
+{
+        struct batch_item *bigger;
+        char **more_lines;
+        char *line = NULL;
+        char *whole;
+        size_t line_size = 0;
+        int result = SUCCESS;
+
+        memset(list, 0, sizeof(*list));
+        while (getline(&line, &line_size, file) >= 0) {
+                bigger = realloc(list->items, (list->nitems + 1) * sizeof(*bigger));
+                more_lines = realloc(list->lines, (list->nlines + 1) * sizeof(*more_lines));
+                if (bigger != NULL) {
+                        list->items = bigger;
+                }
+                if (more_lines != NULL) {
+                        list->lines = more_lines;
+                }
+                if ((bigger == NULL) || (more_lines == NULL)) {
+                        result = ERR_INTERNAL;
+                        break;
+                }
+                list->lines[list->nlines++] = line;
+                // parse_line() cuts the line up, so it is reported
+                // from a copy
+                line[strcspn(line, "\r\n")] = '\0';
+                whole = strdup(line);
+                result = parse_line(line, default_host, update, pool,
+                                    &list->items[list->nitems]);
+                if (result == SUCCESS) {
+                        list->nitems++;
+                } else if (result != ERR_NO_DATA) {
+                        batch_fail((whole != NULL) ? whole : line, result, stats);
+                }
+                free(whole);
+                result = SUCCESS;
+                line = NULL;
+                line_size = 0;
+        }
+        free(line);
+        if (ferror(file)) {
+                result = ERR_INTERNAL;
+        }
+        return result;
+}
+
+
+
+// Free what batch_read_list() allocated.
+extern void batch_free_list(struct batch_list *list)
+{
+        for (int i = 0; i < list->nlines; i++) {
+                free(list->lines[i]);
+        }
+        for (int i = 0; i < list->nitems; i++) {
+                free(list->items[i].cache);
+        }
+        free(list->lines);
+        free(list->items);
+        memset(list, 0, sizeof(*list));
+}
+
+
+
+// Download every file in list, one connection to each host at a time.
+extern void batch_download(struct batch_list *list, struct pool *pool,
+                           struct batch_stats *stats)
+{
+        int *todo;
+        int ntodo;
+
+        todo = malloc((list->nitems + 1) * sizeof(*todo));
+        if (todo == NULL) {
+                for (int i = 0; i < list->nitems; i++) {
+                        batch_fail_item(&list->items[i], ERR_INTERNAL, stats);
+                }
+                return;
+        }
+        for (int h = 0; h < pool->nhosts; h++) {
+                ntodo = 0;
+                for (int i = 0; i < list->nitems; i++) {
+                        if (list->items[i].host == &pool->hosts[h]) {
+                                todo[ntodo++] = i;
+                        }
+                }
+                fetch_host(pool, &pool->hosts[h], list->items, todo, ntodo, stats);
+        }
+        free(todo);
+}
+
+// end of batch.c
@@ -0,0 +1,117 @@
+// ----------------------------------------------------------------------
+// file: batch.h
+//
+// Description: This is the header file for the BATCH module. This
+//     module downloads a list of files, one per line, over keep-alive
+//     connections from the POOL module. A line is either a path on the
+//     default host ("dir/file.txt" or "/dir/file.txt") or a URL on some
+//     other host ("http://host/dir/file.txt"). Blank lines and lines
+//     starting with '#' are skipped. Each file is saved under its base
+//     name, as a single download would be.
+//
+// Created: 2026-10-17
+// ----------------------------------------------------------------------
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdio.h>
+#include "common.h"
+#include "pool.h"
+#include "http.h"
+#include "metrics.h"
+#include "cache.h"
+
+#define BATCH_PIPELINE 8          // requests in flight on a connection
+#define BATCH_MAX_ATTEMPTS 3      // for a request that gets no answer
+#define BATCH_UNCHANGED 1         // from batch_open(): a 304
+
+// One line of the list.
+struct batch_item {
+        struct pool_host *host;
+        char *path;               // without the leading '/'
+        const char *filename;     // the last part of path
+        int attempts;
+        struct cache_entry *cache;  // in update mode, or NULL
+        struct metrics metrics;   // of the last attempt
+};
+
+struct batch_list {
+        struct batch_item *items;
+        int nitems;
+        char **lines;             // the items point into these
+        int nlines;
+};
+
+struct batch_stats {
+        long files;               // downloaded
+        long failed;              // not downloaded, for whatever reason
+        long unchanged;           // not downloaded: the copy here is current
+        long requests;            // sent, including any sent again
+        long long bytes;          // written to the files
+        FILE *records;            // a record of each download, or NULL
+};
+
+
+// Read the list of files in file into list, using default_host for
+// the lines that are just paths, and look up each host in pool. A line
+// that can not be downloaded is reported on stderr and counted in
+// stats, and left out. With update, a file that is here already is
+// not an error: it is only to be fetched if it has changed.
+// Returns SUCCESS, or ERR_INTERNAL if the list could not be read.
+extern int batch_read_list(FILE *file, const char *default_host, bool update,
+                           struct pool *pool, struct batch_list *list,
+                           struct batch_stats *stats);
+
+
+// Free what batch_read_list() allocated.
+extern void batch_free_list(struct batch_list *list);
+
+
+// Report that the file of path could not be downloaded.
+extern void batch_fail(const char *path, int code, struct batch_stats *stats);
+
+
+// Report that item could not be downloaded, and write its record.
+extern void batch_fail_item(struct batch_item *item, int code,
+                            struct batch_stats *stats);
+
+
+// Start timing item, whose request is about to be sent.
+extern void batch_start(struct batch_item *item);
+
+
+// Put the request for item into buf (of size bytes).
+// Returns its length, or ERR_INTERNAL if it is too long.
+extern int batch_request(const struct batch_item *item, char *buf, size_t size);
+
+
+// Decide what to do with the body of response, the answer for item: if
+// it is wanted, create the file and set *fd to it, or else set *fd to
+// -1. Returns SUCCESS if the body is wanted, BATCH_UNCHANGED if it is
+// a 304 for a file that is here already, or why it is not wanted.
+extern int batch_open(struct batch_item *item,
+                      const struct http_response *response, int *fd);
+
+
+// Write len bytes of body to fd, or drop them if fd is -1.
+// Returns SUCCESS or ERR_ON_WRITE.
+extern int batch_sink(int fd, const char *buf, size_t len);
+
+
+// Close the file of item (if fd is not -1), removing it if result is
+// not SUCCESS, and report how the download went (and write its
+// record). wanted is what batch_open() returned and bytes is how much
+// of the body arrived.
+// Returns result, or ERR_ON_WRITE if the file could not be closed.
+extern int batch_finish(struct batch_item *item, int fd, int wanted,
+                        int result, long long bytes, struct batch_stats *stats);
+
+
+// Download every file in list, one connection to each host at a time.
+// A file that can not be downloaded is reported on stderr and counted
+// in stats, and the rest carry on.
+extern void batch_download(struct batch_list *list, struct pool *pool,
+                           struct batch_stats *stats);
+
+#endif
+// end of batch.h
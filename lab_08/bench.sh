@@ -0,0 +1,169 @@
+#!/bin/bash
+# ------------------------------------------------------------------------
+#  file: bench.sh
+#
+#  Description: Load tests for mywget ("make bench") against testserver
+#      on the loopback, so no network is needed. For every file size and
+#      number of clients, mywget downloads the file BENCH_ROUNDS times
+#      per client, in two ways:
+#
+#          single  that many mywget processes at once, each fetching
+#                  the file over and over
+#          engine  one mywget -b with the whole list, and -c clients
+#
+#      One CSV line is written per run:
+#
+#          mode,clients,size_bytes,downloads,failed,seconds,mb_per_s,
+#          downloads_per_s,latency_p50_ms,latency_p99_ms,ttfb_p50_ms
+#
+#      The throughput is the bytes of all the files over the wall time
+#      of the run; the latencies come from the -m record of each
+#      download (total_ms and ttfb_ms).
+#
+#      testserver listens on port 80, since that is the port mywget
+#      uses, so this needs to be run as root (or with
+#      CAP_NET_BIND_SERVICE).
+#
+#  Usage:
+#      ./bench.sh [output.csv]
+#
+#      Environment (defaults in brackets):
+#          BENCH_SIZES     file sizes [4K 1M 16M]
+#          BENCH_CLIENTS   clients at once [1 10 100]
+#          BENCH_ROUNDS    downloads per client [5]
+#          BENCH_ADDR      the address for testserver [127.0.8.1]
+#          BENCH_DIR       where the downloads go [/tmp/mywget-bench]
+#
+#  Created: 2026-10-17
+#
+# ------------------------------------------------------------------------
+set -e
+
+cd "$(dirname "$0")"
+
+SIZES=${BENCH_SIZES:-"4K 1M 16M"}
+CLIENTS=${BENCH_CLIENTS:-"1 10 100"}
+ROUNDS=${BENCH_ROUNDS:-5}
+ADDR=${BENCH_ADDR:-127.0.8.1}
+DIR=${BENCH_DIR:-/tmp/mywget-bench}
+OUT=${1:-bench.csv}
+MYWGET=$PWD/mywget
+
+rm -rf "$DIR"
+mkdir -p "$DIR"
+
+./testserver -a "$ADDR" &
+SERVER=$!
+trap 'kill $SERVER 2>/dev/null' EXIT
+until (exec 3<>"/dev/tcp/$ADDR/80") 2>/dev/null; do
+        sleep 0.1
+done
+
+
+# now
+# Print the time in seconds.
+now()
+{
+        date +%s.%N
+}
+
+
+# elapsed start end
+# Print the seconds from start to end.
+elapsed()
+{
+        awk -v start="$1" -v end="$2" 'BEGIN { printf "%.6f", end - start }'
+}
+
+
+# summarize mode clients seconds records...
+# Print the CSV line for a run from the records of its downloads.
+summarize()
+{
+        python3 - "$@" <<'EOF'
+import json, sys
+
+mode, clients, seconds = sys.argv[1], sys.argv[2], float(sys.argv[3])
+records = []
+for name in sys.argv[4:]:
+        with open(name) as f:
+                records += [json.loads(line) for line in f if line.strip()]
+done = [r for r in records if r["result"] == 0]
+
+def percentile(values, p):
+        values = sorted(v for v in values if v is not None)
+        if not values:
+                return 0.0
+        return values[min(len(values) - 1, int(p / 100.0 * len(values)))]
+
+size = done[0]["body_bytes"] if done else 0
+total = sum(r["body_bytes"] for r in done)
+print("%s,%s,%d,%d,%d,%.6f,%.2f,%.1f,%.3f,%.3f,%.3f" % (
+        mode, clients, size, len(records), len(records) - len(done), seconds,
+        total / 1048576.0 / seconds if seconds > 0 else 0,
+        len(done) / seconds if seconds > 0 else 0,
+        percentile([r["total_ms"] for r in done], 50),
+        percentile([r["total_ms"] for r in done], 99),
+        percentile([r["ttfb_ms"] for r in done], 50)))
+EOF
+}
+
+
+# client number size
+# Download the file ROUNDS times in a directory of its own.
+client()
+{
+        local dir="$DIR/client-$1"
+
+        mkdir -p "$dir"
+        cd "$dir"
+        for round in $(seq "$ROUNDS"); do
+                "$MYWGET" -m records.json "$ADDR" "/$2.txt" >/dev/null 2>&1 || true
+                rm -f "$2.txt"
+        done
+}
+
+
+# run_single clients size
+run_single()
+{
+        local clients=$1 size=$2 start end pids=()
+
+        rm -rf "$DIR"/client-*
+        start=$(now)
+        for i in $(seq "$clients"); do
+                client "$i" "$size" &
+                pids+=($!)
+        done
+        wait "${pids[@]}"
+        end=$(now)
+        summarize single "$clients" "$(elapsed "$start" "$end")" "$DIR"/client-*/records.json
+}
+
+
+# run_engine clients size
+run_engine()
+{
+        local clients=$1 size=$2 dir="$DIR/engine" start end
+
+        rm -rf "$dir"
+        mkdir -p "$dir"
+        # each a different name, since mywget will not overwrite a file
+        for i in $(seq $((clients * ROUNDS))); do
+                echo "/$size.$i.txt"
+        done > "$dir/list"
+        start=$(now)
+        (cd "$dir" && "$MYWGET" -b list -c "$clients" -m records.json "$ADDR" >/dev/null 2>&1 || true)
+        end=$(now)
+        summarize engine "$clients" "$(elapsed "$start" "$end")" "$dir/records.json"
+}
+
+
+echo "mode,clients,size_bytes,downloads,failed,seconds,mb_per_s,downloads_per_s,latency_p50_ms,latency_p99_ms,ttfb_p50_ms" | tee "$OUT"
+
+for size in $SIZES; do
+        for clients in $CLIENTS; do
+                run_single "$clients" "$size" | tee -a "$OUT"
+                run_engine "$clients" "$size" | tee -a "$OUT"
+        done
+done
@@ -0,0 +1,332 @@
+// ----------------------------------------------------------------------
+// file: body.c
+//
+// Description: This file implements the BODY module. splice() from a
+//     socket needs a pipe at the other end, so each chunk is spliced
+//     into the pipe and then from the pipe into the file. If splice()
+//     is refused (an old kernel, or a file system that will not take
+//     it) whatever is in the pipe is copied out of it, and the rest of
+//     the body goes through the buffer instead.
+//
+// Created: 2026-10-17
+// ----------------------------------------------------------------------
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+#include "body.h"
+#include "http.h"
+#include "metrics.h"
+#include "common.h"
+
+#define SPLICE_UNAVAILABLE 1      // the first splice() was refused
+#define SPLICE_FLAGS (SPLICE_F_MOVE | SPLICE_F_MORE)
+#define GZIP_WINDOW_BITS (16 + MAX_WBITS)  // a gzip header, not zlib's
+
+// Where the bytes of the body go.
+struct sink {
+        int fd;
+        z_stream *zs;             // NULL unless the body is gzip
+        char *out;                // BODY_BUFSIZE, for what inflate() gives
+        bool ended;               // the last gzip member is over
+        struct body_stats *stats;
+        struct metrics *metrics;  // or NULL
+};
+
+
+
+// Write all len bytes of buf to fd.
+static int write_all(int fd, const char *buf, size_t len,
+                     struct body_stats *stats)
+{
+        ssize_t count;
+
+        while (len > 0) {
+                count = write(fd, buf, len);
+                stats->writes++;
+                if ((count < 0) && (errno == EINTR)) {
+                        continue;
+                }
+                if (count <= 0) {
+                        return ERR_ON_WRITE;
+                }
+                buf += count;
+                len -= count;
+                stats->bytes += count;
+        }
+        return SUCCESS;
+}
+
+
+
+// Move the body from sock into fd through a pipe. Returns SUCCESS,
+// SPLICE_UNAVAILABLE if nothing could be moved this way, or an ERR_
+// code.
+static int save_spliced(int sock, int fd, struct http_body *body,
+                        struct body_stats *stats, struct metrics *metrics)
+{
+        int pipes[2];
+        ssize_t count;
+        ssize_t moved;
+        size_t want;
+        int result = SUCCESS;
+
+        if (pipe2(pipes, O_CLOEXEC) != 0) {
+                return SPLICE_UNAVAILABLE;
+        }
+        // a bigger pipe means fewer trips; it does not matter if not
+        fcntl(pipes[1], F_SETPIPE_SZ, BODY_PIPE_SIZE);
+
+        for (;;) {
+                want = BODY_PIPE_SIZE;
+                if ((body->framing == HTTP_BODY_LENGTH) &&
+                    (body->remaining < (long long)want)) {
+                        want = body->remaining;
+                }
+                if (want == 0) {
+                        break;
+                }
+
+                if (metrics != NULL) {
+                        metrics_wait(metrics, sock);
+                }
+                count = splice(sock, NULL, pipes[1], NULL, want, SPLICE_FLAGS);
+                stats->reads++;
+                if ((count < 0) && (errno == EINTR)) {
+                        continue;
+                }
+                if ((count < 0) && ((errno == EINVAL) || (errno == ENOSYS))) {
+                        result = SPLICE_UNAVAILABLE;
+                        break;
+                }
+                if (count <= 0) {
+                        if ((count == 0) && (body->framing == HTTP_BODY_TO_CLOSE)) {
+                                break;
+                        }
+                        result = ERR_NO_DATA;
+                        break;
+                }
+                if (body->framing == HTTP_BODY_LENGTH) {
+                        body->remaining -= count;
+                }
+                stats->received += count;
+                if (metrics != NULL) {
+                        metrics_read(metrics, count);
+                }
+
+                // empty the pipe into the file
+                while ((result == SUCCESS) && (count > 0)) {
+                        moved = splice(pipes[0], NULL, fd, NULL, count, SPLICE_FLAGS);
+                        stats->writes++;
+                        if ((moved < 0) && (errno == EINTR)) {
+                                continue;
+                        }
+                        if ((moved < 0) && ((errno == EINVAL) || (errno == ENOSYS))) {
+                                // the file will not take it: the pipe
+                                // still has the data, so finish by hand
+                                result = SPLICE_UNAVAILABLE;
+                                break;
+                        }
+                        if (moved <= 0) {
+                                result = ERR_ON_WRITE;
+                                break;
+                        }
+                        count -= moved;
+                        stats->bytes += moved;
+                        stats->spliced = true;
+                }
+                if (result != SUCCESS) {
+                        break;
+                }
+        }
+
+        if (result == SPLICE_UNAVAILABLE) {
+                // whatever reached the pipe goes to the file the slow way
+                char buf[4096];
+                ssize_t got;
+
+                result = SUCCESS;
+                fcntl(pipes[0], F_SETFL, O_NONBLOCK);
+                while ((result == SUCCESS) && ((got = read(pipes[0], buf, sizeof(buf))) > 0)) {
+                        result = write_all(fd, buf, got, stats);
+                }
+                if (result == SUCCESS) {
+                        result = SPLICE_UNAVAILABLE;
+                }
+        }
+        close(pipes[0]);
+        close(pipes[1]);
+        return result;
+}
+
+
+
+// Write len bytes of the body to the file, inflating them first if
+// it is gzip.
+static int emit(struct sink *sink, char *data, size_t len)
+{
+        z_stream *zs = sink->zs;
+        size_t produced;
+        bool more = true;
+        int status;
+        int result = SUCCESS;
+
+        sink->stats->received += len;
+        if (zs == NULL) {
+                return write_all(sink->fd, data, len, sink->stats);
+        }
+
+        zs->next_in = (Bytef *)data;
+        zs->avail_in = len;
+        while ((result == SUCCESS) && more) {
+                if (sink->ended) {
+                        if (zs->avail_in == 0) {
+                                break;
+                        }
+                        // another member follows the one that ended
+                        inflateReset(zs);
+                        sink->ended = false;
+                }
+                zs->next_out = (Bytef *)sink->out;
+                zs->avail_out = BODY_BUFSIZE;
+                status = inflate(zs, Z_NO_FLUSH);
+                if ((status != Z_OK) && (status != Z_STREAM_END) &&
+                    (status != Z_BUF_ERROR)) {
+                        return ERR_BAD_RESPONSE;
+                }
+                sink->ended = (status == Z_STREAM_END);
+                produced = BODY_BUFSIZE - zs->avail_out;
+                result = write_all(sink->fd, sink->out, produced, sink->stats);
+                // a full buffer may mean there is more to come out
+                more = (zs->avail_in > 0) || (zs->avail_out == 0);
+                if ((status == Z_BUF_ERROR) && (produced == 0)) {
+                        break;
+                }
+        }
+        return result;
+}
+
+
+
+// Read the body from sock and write it to the sink through buf.
+static int save_buffered(int sock, struct sink *sink, struct http_body *body,
+                         char *buf)
+{
+        ssize_t count;
+        size_t used;
+        size_t out;
+        int status = HTTP_MORE;
+        int result = SUCCESS;
+
+        while ((result == SUCCESS) && (status == HTTP_MORE)) {
+                if (sink->metrics != NULL) {
+                        metrics_wait(sink->metrics, sock);
+                }
+                count = read(sock, buf, BODY_BUFSIZE);
+                sink->stats->reads++;
+                if ((count < 0) && (errno == EINTR)) {
+                        continue;
+                }
+                if (count <= 0) {
+                        // nothing is written for a failed read
+                        if ((count == 0) && (body->framing == HTTP_BODY_TO_CLOSE)) {
+                                break;
+                        }
+                        return ERR_NO_DATA;
+                }
+                if (sink->metrics != NULL) {
+                        metrics_read(sink->metrics, count);
+                }
+                status = http_body_decode(body, buf, count, &used, &out);
+                if (status < 0) {
+                        return status;
+                }
+                result = emit(sink, buf, out);
+        }
+        return result;
+}
+
+
+
+// Save the body of response, read from the socket sock, into the file
+// fd.
+// Returns SUCCESS, ERR_NO_DATA, ERR_BAD_RESPONSE, ERR_UNSUPPORTED,
+// ERR_ON_WRITE or ERR_INTERNAL.
+extern int body_save(int sock, int fd, const struct http_response *response,
+                     char *head, size_t head_len, struct body_stats *stats,
+                     struct metrics *metrics)
+{
+        struct http_body body;
+        struct sink sink;
+        z_stream zs;
+        bool gzip = (response->content_encoding == HTTP_ENCODING_GZIP);
+        char *buf = NULL;
+        size_t used;
+        size_t out;
+        int status;
+        int result;
+
+        memset(stats, 0, sizeof(*stats));
+        if (response->content_encoding == HTTP_ENCODING_OTHER) {
+                return ERR_UNSUPPORTED;
+        }
+        http_body_init(&body, response);
+
+        sink.fd = fd;
+        sink.zs = NULL;
+        sink.out = NULL;
+        sink.ended = false;
+        sink.stats = stats;
+        sink.metrics = metrics;
+        if (gzip) {
+                memset(&zs, 0, sizeof(zs));
+                sink.out = malloc(BODY_BUFSIZE);
+                if ((sink.out == NULL) ||
+                    (inflateInit2(&zs, GZIP_WINDOW_BITS) != Z_OK)) {
+                        free(sink.out);
+                        return ERR_INTERNAL;
+                }
+                sink.zs = &zs;
+        } else if ((body.framing == HTTP_BODY_LENGTH) && (body.remaining > 0)) {
+                // the file will be this big, so get the space in one piece
+                fallocate(fd, 0, 0, body.remaining);
+        }
+
+        // what came with the header
+        status = http_body_decode(&body, head, head_len, &used, &out);
+        result = (status < 0) ? status : emit(&sink, head, out);
+
+        // the rest
+        if ((result == SUCCESS) && (status == HTTP_MORE)) {
+                result = SPLICE_UNAVAILABLE;
+                if (!gzip && (body.framing != HTTP_BODY_CHUNKED)) {
+                        result = save_spliced(sock, fd, &body, stats, metrics);
+                }
+                if (result == SPLICE_UNAVAILABLE) {
+                        buf = malloc(BODY_BUFSIZE);
+                        result = (buf != NULL) ?
+                                save_buffered(sock, &sink, &body, buf) : ERR_INTERNAL;
+                        free(buf);
+                }
+        }
+
+        if (gzip) {
+                // the body ended, but the gzip data did not
+                if ((result == SUCCESS) && !sink.ended && (stats->received > 0)) {
+                        result = ERR_BAD_RESPONSE;
+                }
+                inflateEnd(&zs);
+                free(sink.out);
+        }
+
+        // a body cut short leaves the file no bigger than what arrived
+        if ((result != SUCCESS) && !gzip && (body.framing == HTTP_BODY_LENGTH)) {
+                ftruncate(fd, stats->bytes);
+        }
+        return result;
+}
+
+// end of body.c
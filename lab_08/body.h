@@ -0,0 +1,49 @@
+// ----------------------------------------------------------------------
+// file: body.h
+//
+// Description: This is the header file for the BODY module. This
+//     module saves the body of a response from a socket into a file.
+//     A body that is sent as it is (by Content-Length, or up to the end
+//     of the connection) is moved with splice() from the socket through
+//     a pipe into the file, so it never passes through our memory;
+//     anything else, or a body on a system where splice() can not be
+//     used, goes through one large buffer with read() and write().
+//
+// Created: 2026-10-17
+// ----------------------------------------------------------------------
+#ifndef BODY_H
+#define BODY_H
+
+#include <stddef.h>
+#include "common.h"
+#include "http.h"
+#include "metrics.h"
+
+#define BODY_BUFSIZE (1024 * 1024)    // read()/write() at a time
+#define BODY_PIPE_SIZE (1024 * 1024)  // asked for; the kernel may give less
+
+// How a body was saved.
+struct body_stats {
+        long long bytes;          // written to the file
+        long long received;       // of the body, as sent (before inflating)
+        long reads;               // system calls that took data in
+        long writes;              // and that put it out
+        bool spliced;
+};
+
+
+// Save the body of response, read from the socket sock, into the file
+// fd. The first head_len bytes of it already arrived with the header
+// and are in head (which may be changed). When Content-Length is given
+// (and the body is not gzip) the file is allocated at that size first.
+// Returns SUCCESS, ERR_NO_DATA if the connection failed or closed
+// before the end of the body, ERR_BAD_RESPONSE (which includes gzip
+// data that will not inflate), ERR_UNSUPPORTED for a Content-Encoding
+// other than gzip, ERR_ON_WRITE or ERR_INTERNAL. Each read is counted
+// in metrics, unless it is NULL.
+extern int body_save(int sock, int fd, const struct http_response *response,
+                     char *head, size_t head_len, struct body_stats *stats,
+                     struct metrics *metrics);
+
+#endif
+// end of body.h
@@ -0,0 +1,173 @@
+// ----------------------------------------------------------------------
+// file: cache.c
+//
+// Description: This file implements the CACHE module. The validators
+//     are kept as the header lines they came in ("ETag: ..."), and are
+//     written to a temporary file that is renamed into place, so they
+//     are never seen half written. The new copy is renamed into place
+//     before its validators are: if we are stopped in between, the old
+//     validators only make the next --update fetch the file again.
+//
+// Created: 2026-10-17
+//
+// ----------------------------------------------------------------------
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <unistd.h>
+#include "cache.h"
+#include "http.h"
+#include "common.h"
+
+#define SIDECAR_FORMAT ".%s.mywget"
+#define TEMP_FORMAT ".%s.part"
+#define SIDECAR_TEMP_FORMAT ".%s.mywget.part"
+#define ETAG_HEADER "ETag:"
+#define LAST_MODIFIED_HEADER "Last-Modified:"
+
+
+
+// Put the name made from filename by format into buf.
+static int make_name(const char *format, const char *filename, char *buf,
+                     size_t size)
+{
+        int len = snprintf(buf, size, format, filename);
+
+        return ((len < 0) || ((size_t)len >= size)) ? ERR_INTERNAL : SUCCESS;
+}
+
+
+
+// If line is the header name, copy its value into value.
+static void take(const char *line, const char *name, char *value)
+{
+        size_t len = strlen(name);
+
+        if (strncasecmp(line, name, len) != 0) {
+                return;
+        }
+        line += len;
+        line += strspn(line, " \t");
+        len = strcspn(line, "\r\n");
+        if (len < HTTP_MAX_VALUE) {
+                memcpy(value, line, len);
+                value[len] = '\0';
+        }
+}
+
+
+
+// Read the validators of filename into entry.
+extern bool cache_load(const char *filename, struct cache_entry *entry)
+{
+        char name[CACHE_MAX_NAME];
+        char line[HTTP_MAX_VALUE + sizeof(LAST_MODIFIED_HEADER) + 2];
+        FILE *sidecar;
+
+        memset(entry, 0, sizeof(*entry));
+        // validators without the file would make a 304 leave us nothing
+        if ((access(filename, F_OK) != 0) ||
+            (make_name(SIDECAR_FORMAT, filename, name, sizeof(name)) != SUCCESS)) {
+                return false;
+        }
+        sidecar = fopen(name, "r");
+        if (sidecar == NULL) {
+                return false;
+        }
+        while (fgets(line, sizeof(line), sidecar) != NULL) {
+                take(line, ETAG_HEADER, entry->etag);
+                take(line, LAST_MODIFIED_HEADER, entry->last_modified);
+        }
+        fclose(sidecar);
+        return (entry->etag[0] != '\0') || (entry->last_modified[0] != '\0');
+}
+
+
+
+// Put the conditional request lines for entry into buf.
+extern int cache_conditions(const struct cache_entry *entry, char *buf,
+                            size_t size)
+{
+        int len = 0;
+
+        buf[0] = '\0';
+        if (entry->etag[0] != '\0') {
+                len += snprintf(buf + len, size - len, "If-None-Match: %s\r\n",
+                                entry->etag);
+        }
+        if (((size_t)len < size) && (entry->last_modified[0] != '\0')) {
+                len += snprintf(buf + len, size - len, "If-Modified-Since: %s\r\n",
+                                entry->last_modified);
+        }
+        return ((size_t)len < size) ? len : ERR_INTERNAL;
+}
+
+
+
+// Take the validators of response.
+extern void cache_update(struct cache_entry *entry,
+                         const struct http_response *response)
+{
+        strcpy(entry->etag, response->etag);
+        strcpy(entry->last_modified, response->last_modified);
+}
+
+
+
+// The name to download a new copy of filename under.
+extern int cache_temp_name(const char *filename, char *buf, size_t size)
+{
+        return make_name(TEMP_FORMAT, filename, buf, size);
+}
+
+
+
+// Rename the new copy of filename over the old one, and keep the
+// validators of entry beside it.
+extern int cache_commit(const char *filename, const struct cache_entry *entry)
+{
+        char temp[CACHE_MAX_NAME];
+        char name[CACHE_MAX_NAME];
+        FILE *sidecar;
+        int result = SUCCESS;
+
+        if ((cache_temp_name(filename, temp, sizeof(temp)) != SUCCESS) ||
+            (make_name(SIDECAR_FORMAT, filename, name, sizeof(name)) != SUCCESS) ||
+            (rename(temp, filename) != 0)) {
+                return ERR_ON_WRITE;
+        }
+
+        if ((entry->etag[0] == '\0') && (entry->last_modified[0] == '\0')) {
+                // nothing to ask with next time
+                if ((unlink(name) != 0) && (errno != ENOENT)) {
+                        return ERR_ON_WRITE;
+                }
+                return SUCCESS;
+        }
+
+        if (make_name(SIDECAR_TEMP_FORMAT, filename, temp, sizeof(temp)) != SUCCESS) {
+                return ERR_ON_WRITE;
+        }
+        sidecar = fopen(temp, "w");
+        if (sidecar == NULL) {
+                return ERR_ON_WRITE;
+        }
+        if (entry->etag[0] != '\0') {
+                fprintf(sidecar, "%s %s\n", ETAG_HEADER, entry->etag);
+        }
+        if (entry->last_modified[0] != '\0') {
+                fprintf(sidecar, "%s %s\n", LAST_MODIFIED_HEADER, entry->last_modified);
+        }
+        if (ferror(sidecar)) {
+                result = ERR_ON_WRITE;
+        }
+        if ((fclose(sidecar) != 0) || (result != SUCCESS) ||
+            (rename(temp, name) != 0)) {
+                unlink(temp);
+                return ERR_ON_WRITE;
+        }
+        return SUCCESS;
+}
+
+// end of cache.c
@@ -0,0 +1,65 @@
+// ----------------------------------------------------------------------
+// file: cache.h
+//
+// Description: This is the header file for the CACHE module. This
+//     module remembers the validators (ETag and Last-Modified) a file
+//     was downloaded with, in a small file beside it, so that mywget
+//     --update can ask the server for the file only if it has changed
+//     (If-None-Match, If-Modified-Since) and a 304 costs one round
+//     trip. A new copy is downloaded under a temporary name and only
+//     then renamed over the old one, so a failed update leaves the old
+//     copy as it was.
+//
+//     For a file called name the validators are kept in ".name.mywget"
+//     and a new copy is downloaded into ".name.part".
+//
+// Created: 2026-10-17
+//
+// ----------------------------------------------------------------------
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "common.h"
+#include "http.h"
+
+#define CACHE_MAX_NAME 1024       // of the files beside the file
+#define CACHE_MAX_CONDITIONS (2 * HTTP_MAX_VALUE + 64)
+
+// What a file was downloaded with ("" for one not given).
+struct cache_entry {
+        char etag[HTTP_MAX_VALUE];
+        char last_modified[HTTP_MAX_VALUE];
+};
+
+
+// Read the validators of filename into entry. Returns true if there
+// are any (and the file is there); otherwise entry is left empty.
+extern bool cache_load(const char *filename, struct cache_entry *entry);
+
+
+// Put the If-None-Match and If-Modified-Since lines for entry into buf
+// (of size bytes), ready to add to a request. Returns their length
+// (0 if entry is empty), or ERR_INTERNAL if they do not fit.
+extern int cache_conditions(const struct cache_entry *entry, char *buf,
+                            size_t size);
+
+
+// Take the validators of response, which is sending a new copy.
+extern void cache_update(struct cache_entry *entry,
+                         const struct http_response *response);
+
+
+// Put the name to download a new copy of filename under into buf (of
+// size bytes). Returns SUCCESS, or ERR_INTERNAL if it does not fit.
+extern int cache_temp_name(const char *filename, char *buf, size_t size);
+
+
+// The new copy of filename is all there: rename it over the old one,
+// and then keep the validators of entry beside it (or remove the old
+// ones if it has none). Returns SUCCESS or ERR_ON_WRITE.
+extern int cache_commit(const char *filename, const struct cache_entry *entry);
+
+#endif
+// end of cache.h
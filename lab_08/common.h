@@ -0,0 +1,33 @@
+// ----------------------------------------------------------------------
+// file: common.h
+//
+// Description: This header file contains macros that are used by more
+//     than one module of mywget, mostly the error codes that are also
+//     its exit values.
+//
+// Created: 2026-10-17
+//
+// ----------------------------------------------------------------------
+#ifndef COMMON_H
+#define COMMON_H
+
+#define SUCCESS 0
+#define MAXBUF 1024
+
+#define ERR_NUM_INPUTS -1     /* invalid number of args at command-line */
+#define ERR_DNS -3            /* unable to resolve domain name to IP */
+#define ERR_NOT_FOUND -4      /* file not found on the server */
+#define ERR_BAD_RESPONSE -5   /* server gave an unrecognized response */
+#define ERR_ON_WRITE -6       /* error when writing */
+#define ERR_SOCKET -7         /* error getting a socket */
+#define ERR_CONNECT -8        /* error trying to connect to server */
+#define ERR_FILE -9           /* unable to open local file for output */
+#define ERR_FILE_EXISTS -10   /* file exists locally */
+#define ERR_BAD_REQUEST -11   /* server complained of bad client request */
+#define ERR_UNSUPPORTED -12   /* the returned file is not a text file */
+#define ERR_INTERNAL -13      /* unexpected internal problem */
+#define ERR_NO_DATA -14       /* no data received from the server */
+
+#endif
+
+// end of common.h
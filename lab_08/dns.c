@@ -0,0 +1,252 @@
+// ----------------------------------------------------------------------
+// file: dns.c
+//
+// Description: This file implements the DNS module. The cache file
+//     starts with a struct cache_header and is followed by DNS_SLOTS
+//     struct cache_slot. A slot is reused when its host is looked up
+//     again, or else the empty or soonest-to-expire slot is taken.
+//     Runs at the same time may share the file: it is read under a
+//     shared flock() and written under an exclusive one.
+//
+// Created: 2026-10-17
+//
+// ----------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include "dns.h"
+#include "common.h"
+
+#define CACHE_MAGIC 0x4d574e53    // "MWNS"
+#define CACHE_VERSION 1
+#define CACHE_NAME ".mywget_dns_cache"
+#define CACHE_ENV "MYWGET_DNS_CACHE"
+#define TTL_ENV "MYWGET_DNS_TTL"
+#define CACHE_MODE 0600
+#define MAX_PATH 4096
+
+struct cache_header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t slots;
+        uint32_t slot_size;       // so a file from another build is redone
+};
+
+struct cache_slot {
+        int64_t expires;          // time(); 0 for an empty slot
+        uint32_t naddrs;
+        char host[DNS_MAX_HOST];
+        struct dns_addr addrs[DNS_MAX_ADDRS];
+};
+
+struct cache_file {
+        struct cache_header header;
+        struct cache_slot slots[DNS_SLOTS];
+};
+
+static struct cache_file *Cache = NULL;   // the mapped file
+static int Cache_fd = -1;
+
+
+
+// The name of the cache file, in path, or false if there is none.
+static bool cache_path(char *path, size_t size)
+{
+        const char *name = getenv(CACHE_ENV);
+        const char *home = getenv("HOME");
+
+        if (name != NULL) {
+                return (*name != '\0') && (snprintf(path, size, "%s", name) < (int)size);
+        }
+        return (home != NULL) &&
+                (snprintf(path, size, "%s/%s", home, CACHE_NAME) < (int)size);
+}
+
+
+
+// How long entries are kept.
+static int64_t ttl(void)
+{
+        const char *value = getenv(TTL_ENV);
+
+        return (value != NULL) ? strtoll(value, NULL, 10) : DNS_TTL;
+}
+
+
+
+// Map the cache file into memory.
+extern void dns_open(void)
+{
+        struct stat info;
+        char path[MAX_PATH];
+        void *map;
+
+        if ((Cache != NULL) || !cache_path(path, sizeof(path))) {
+                return;
+        }
+        Cache_fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, CACHE_MODE);
+        if (Cache_fd < 0) {
+                return;
+        }
+
+        // a new file, or one of another size, is made over empty
+        flock(Cache_fd, LOCK_EX);
+        if ((fstat(Cache_fd, &info) != 0) ||
+            ((info.st_size != sizeof(struct cache_file)) &&
+             ((ftruncate(Cache_fd, 0) != 0) ||
+              (ftruncate(Cache_fd, sizeof(struct cache_file)) != 0)))) {
+                flock(Cache_fd, LOCK_UN);
+                close(Cache_fd);
+                Cache_fd = -1;
+                return;
+        }
+        map = mmap(NULL, sizeof(struct cache_file), PROT_READ | PROT_WRITE,
+                   MAP_SHARED, Cache_fd, 0);
+        if (map == MAP_FAILED) {
+                flock(Cache_fd, LOCK_UN);
+                close(Cache_fd);
+                Cache_fd = -1;
+                return;
+        }
+        Cache = map;
+        if ((Cache->header.magic != CACHE_MAGIC) ||
+            (Cache->header.version != CACHE_VERSION) ||
+            (Cache->header.slots != DNS_SLOTS) ||
+            (Cache->header.slot_size != sizeof(struct cache_slot))) {
+                memset(Cache, 0, sizeof(*Cache));
+                Cache->header.magic = CACHE_MAGIC;
+                Cache->header.version = CACHE_VERSION;
+                Cache->header.slots = DNS_SLOTS;
+                Cache->header.slot_size = sizeof(struct cache_slot);
+        }
+        flock(Cache_fd, LOCK_UN);
+}
+
+
+
+// Look for host in the cache.
+static bool cache_find(const char *host, struct dns_result *result)
+{
+        const struct cache_slot *slot;
+        int64_t now = time(NULL);
+        bool found = false;
+
+        if (Cache == NULL) {
+                return false;
+        }
+        flock(Cache_fd, LOCK_SH);
+        for (int i = 0; !found && (i < DNS_SLOTS); i++) {
+                slot = &Cache->slots[i];
+                if ((slot->expires > now) && (slot->naddrs > 0) &&
+                    (slot->naddrs <= DNS_MAX_ADDRS) &&
+                    !strncasecmp(slot->host, host, DNS_MAX_HOST)) {
+                        result->naddrs = slot->naddrs;
+                        memcpy(result->addrs, slot->addrs,
+                               slot->naddrs * sizeof(struct dns_addr));
+                        result->cached = true;
+                        found = true;
+                }
+        }
+        flock(Cache_fd, LOCK_UN);
+        return found;
+}
+
+
+
+// Put what was found for host in the cache.
+static void cache_store(const char *host, const struct dns_result *result)
+{
+        struct cache_slot *slot = NULL;
+        struct cache_slot *candidate;
+
+        if ((Cache == NULL) || (strlen(host) >= DNS_MAX_HOST)) {
+                return;
+        }
+        flock(Cache_fd, LOCK_EX);
+        for (int i = 0; i < DNS_SLOTS; i++) {
+                candidate = &Cache->slots[i];
+                if (!strncasecmp(candidate->host, host, DNS_MAX_HOST)) {
+                        slot = candidate;
+                        break;
+                }
+                if ((slot == NULL) || (candidate->expires < slot->expires)) {
+                        slot = candidate;
+                }
+        }
+        strcpy(slot->host, host);
+        slot->naddrs = result->naddrs;
+        memcpy(slot->addrs, result->addrs, result->naddrs * sizeof(struct dns_addr));
+        slot->expires = (int64_t)time(NULL) + ttl();
+        flock(Cache_fd, LOCK_UN);
+}
+
+
+
+// Find the addresses of host (for port 80).
+// Returns SUCCESS or ERR_DNS.
+extern int dns_resolve(const char *host, struct dns_result *result)
+{
+        struct addrinfo hints;
+        struct addrinfo *start = NULL;
+        struct dns_addr *addr;
+        char port[16];
+
+        memset(result, 0, sizeof(*result));
+        if (cache_find(host, result)) {
+                return SUCCESS;
+        }
+
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;          // IPv4 and IPv6 both
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_ADDRCONFIG;       // only what we can reach
+        snprintf(port, sizeof(port), "%d", DNS_HTTP_PORT);
+        if ((getaddrinfo(host, port, &hints, &start) != 0) || (start == NULL)) {
+                return ERR_DNS;
+        }
+        for (struct addrinfo *current = start;
+             (current != NULL) && (result->naddrs < DNS_MAX_ADDRS);
+             current = current->ai_next) {
+                if (((current->ai_family != AF_INET) && (current->ai_family != AF_INET6)) ||
+                    (current->ai_addrlen > sizeof(addr->addr))) {
+                        continue;
+                }
+                addr = &result->addrs[result->naddrs++];
+                addr->family = current->ai_family;
+                addr->len = current->ai_addrlen;
+                memcpy(&addr->addr, current->ai_addr, current->ai_addrlen);
+        }
+        freeaddrinfo(start);
+        if (result->naddrs == 0) {
+                return ERR_DNS;
+        }
+        cache_store(host, result);
+        return SUCCESS;
+}
+
+
+
+// Unmap the cache file.
+extern void dns_close(void)
+{
+        if (Cache != NULL) {
+                munmap(Cache, sizeof(*Cache));
+                Cache = NULL;
+        }
+        if (Cache_fd >= 0) {
+                close(Cache_fd);
+                Cache_fd = -1;
+        }
+}
+
+// end of dns.c
@@ -0,0 +1,60 @@
+// ----------------------------------------------------------------------
+// file: dns.h
+//
+// Description: This is the header file for the DNS module. This module
+//     looks up the addresses of a host, keeping what it finds in a
+//     small cache file so that the next run against the same host does
+//     not have to ask again. The file is a fixed number of fixed-size
+//     slots, mapped into memory when the module starts, so a lookup is
+//     a search of memory and nothing has to be parsed.
+//
+//     The cache is ~/.mywget_dns_cache unless MYWGET_DNS_CACHE names
+//     another file (an empty name turns the cache off). getaddrinfo()
+//     does not give the TTLs of the records, so each entry is kept for
+//     DNS_TTL seconds, or MYWGET_DNS_TTL if that is set.
+//
+// Created: 2026-10-17
+//
+// ----------------------------------------------------------------------
+#ifndef DNS_H
+#define DNS_H
+
+#include <stdbool.h>
+#include <sys/socket.h>
+#include "common.h"
+
+#define DNS_MAX_ADDRS 8           // kept for each host
+#define DNS_MAX_HOST 256
+#define DNS_SLOTS 64              // hosts in the cache file
+#define DNS_TTL 300               // seconds
+#define DNS_HTTP_PORT 80
+
+struct dns_addr {
+        int family;               // AF_INET or AF_INET6
+        socklen_t len;
+        struct sockaddr_storage addr;  // with the port filled in
+};
+
+struct dns_result {
+        int naddrs;
+        struct dns_addr addrs[DNS_MAX_ADDRS];  // in getaddrinfo()'s order
+        bool cached;              // found in the cache file
+};
+
+
+// Map the cache file into memory. Nothing is lost if this fails: every
+// lookup then goes to getaddrinfo().
+extern void dns_open(void);
+
+
+// Find the addresses of host (for port 80), from the cache if it has
+// them and they have not expired, or else from getaddrinfo(), and then
+// put them in the cache. Returns SUCCESS or ERR_DNS.
+extern int dns_resolve(const char *host, struct dns_result *result);
+
+
+// Unmap the cache file.
+extern void dns_close(void);
+
+#endif
+// end of dns.h
@@ -0,0 +1,392 @@
+// ----------------------------------------------------------------------
+// file: engine.c
+//
+// Description: This file implements the ENGINE module. The sockets are
+//     level-triggered: a download waits for EPOLLOUT while it connects
+//     and sends, and for EPOLLIN while it receives, and does one read
+//     or send each time it is woken, so no download can starve the
+//     others. Each host has a queue of the files still to fetch; a
+//     connection that closes is replaced while its queue has files
+//     left, up to the limit for the host.
+//
+// Created: 2026-10-17
+// ----------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include "engine.h"
+#include "batch.h"
+#include "pool.h"
+#include "http.h"
+#include "net.h"
+#include "metrics.h"
+#include "common.h"
+
+// download states
+#define ST_CONNECTING 0
+#define ST_SENDING 1
+#define ST_HEADER 2
+#define ST_BODY 3
+
+#define NO_FILE -1
+
+// The files of one host still to fetch.
+struct queue {
+        struct pool_host *host;
+        int *todo;                // indexes into the list, with room for
+        int ntodo;                // the ones that are sent again
+        int next;
+        int active;               // connections open to the host
+};
+
+// One connection, and the download it is doing.
+struct download {
+        struct queue *queue;
+        struct batch_item *item;
+        int fd;
+        int state;
+        bool reused;              // it carried a response before this one
+        bool started;             // some of this response has arrived
+        char request[HTTP_MAX_REQUEST];
+        size_t request_len;
+        size_t sent;
+        struct http_response response;
+        struct http_body body;
+        int file;                 // from batch_open()
+        int wanted;
+        long long bytes;
+        char buf[ENGINE_BUFSIZE];
+};
+
+struct engine {
+        int epfd;
+        int per_host;
+        int active;               // connections open
+        struct pool *pool;
+        struct batch_list *list;
+        struct batch_stats *stats;
+};
+
+
+
+// Wait for events on the socket of download.
+static int watch(struct engine *engine, struct download *download,
+                 int op, uint32_t events)
+{
+        struct epoll_event event;
+
+        event.events = events;
+        event.data.ptr = download;
+        return (epoll_ctl(engine->epfd, op, download->fd, &event) == 0) ?
+                SUCCESS : ERR_INTERNAL;
+}
+
+
+
+// Give download the next file of its host. Returns false if there
+// are none left.
+static bool next_item(struct engine *engine, struct download *download)
+{
+        struct queue *queue = download->queue;
+
+        if (queue->next == queue->ntodo) {
+                return false;
+        }
+        download->item = &engine->list->items[queue->todo[queue->next++]];
+        batch_start(download->item);
+        download->request_len = batch_request(download->item, download->request,
+                                              sizeof(download->request));
+        download->sent = 0;
+        download->started = false;
+        download->file = NO_FILE;
+        download->wanted = SUCCESS;
+        download->bytes = 0;
+        engine->stats->requests++;
+        return true;
+}
+
+
+
+// Open connections to the host of queue, up to its limit, while it
+// has files left.
+static void start_connections(struct engine *engine, struct queue *queue)
+{
+        struct download *download;
+        int fd;
+
+        while ((queue->active < engine->per_host) && (queue->next < queue->ntodo)) {
+                download = malloc(sizeof(*download));
+                fd = net_connect_start(&queue->host->dns.addrs[queue->host->preferred]);
+                if ((download == NULL) || (fd < 0)) {
+                        batch_fail_item(&engine->list->items[queue->todo[queue->next++]],
+                                        (download == NULL) ? ERR_INTERNAL : fd,
+                                        engine->stats);
+                        free(download);
+                        if (fd >= 0) {
+                                close(fd);
+                        }
+                        continue;
+                }
+
+                download->queue = queue;
+                download->fd = fd;
+                download->state = ST_CONNECTING;
+                download->reused = false;
+                next_item(engine, download);
+                if (watch(engine, download, EPOLL_CTL_ADD, EPOLLOUT) != SUCCESS) {
+                        batch_fail_item(download->item, ERR_INTERNAL, engine->stats);
+                        close(fd);
+                        free(download);
+                        continue;
+                }
+                engine->pool->connects++;
+                queue->active++;
+                engine->active++;
+        }
+}
+
+
+
+// Close the connection of download, and replace it if its host has
+// files left.
+static void close_download(struct engine *engine, struct download *download)
+{
+        struct queue *queue = download->queue;
+
+        close(download->fd);
+        free(download);
+        queue->active--;
+        engine->active--;
+        start_connections(engine, queue);
+}
+
+
+
+// The download failed with result.
+static void end_download(struct engine *engine, struct download *download,
+                         int result)
+{
+        struct batch_item *item = download->item;
+        struct queue *queue = download->queue;
+
+        if (download->state == ST_BODY) {
+                batch_finish(item, download->file, download->wanted, result,
+                             download->bytes, engine->stats);
+        } else if (download->reused && !download->started) {
+                // the server closed a kept connection as we used it:
+                // send it again. Each time follows a response that came
+                // whole on that connection, so it happens no more times
+                // than there are files.
+                queue->todo[queue->ntodo++] = item - engine->list->items;
+        } else {
+                batch_fail_item(item, result, engine->stats);
+        }
+        close_download(engine, download);
+}
+
+
+
+// The whole response has arrived: on to the next file, on the same
+// connection if the server keeps it open.
+static void complete(struct engine *engine, struct download *download,
+                     bool reusable)
+{
+        batch_finish(download->item, download->file, download->wanted, SUCCESS,
+                     download->bytes, engine->stats);
+        download->file = NO_FILE;
+        if (!reusable || !next_item(engine, download)) {
+                close_download(engine, download);
+                return;
+        }
+        download->reused = true;
+        download->state = ST_SENDING;
+        engine->pool->reuses++;
+        if (watch(engine, download, EPOLL_CTL_MOD, EPOLLOUT) != SUCCESS) {
+                end_download(engine, download, ERR_INTERNAL);
+        }
+}
+
+
+
+// Send what is left of the request.
+static int send_request(struct engine *engine, struct download *download)
+{
+        ssize_t count;
+
+        count = send(download->fd, download->request + download->sent,
+                     download->request_len - download->sent, MSG_NOSIGNAL);
+        if (count < 0) {
+                return ((errno == EAGAIN) || (errno == EINTR)) ? SUCCESS : ERR_CONNECT;
+        }
+        download->sent += count;
+        if (download->sent < download->request_len) {
+                return SUCCESS;
+        }
+        download->state = ST_HEADER;
+        metrics_sent(&download->item->metrics);
+        http_response_init(&download->response);
+        return watch(engine, download, EPOLL_CTL_MOD, EPOLLIN);
+}
+
+
+
+// Take what has arrived of the response. The download may be over
+// (and freed) when this returns SUCCESS.
+static int receive(struct engine *engine, struct download *download)
+{
+        struct http_response *response = &download->response;
+        ssize_t count;
+        size_t offset = 0;
+        size_t used;
+        size_t out;
+        int status;
+        int result;
+
+        count = read(download->fd, download->buf, ENGINE_BUFSIZE);
+        if (count < 0) {
+                return ((errno == EAGAIN) || (errno == EINTR)) ? SUCCESS : ERR_NO_DATA;
+        }
+        if (count == 0) {
+                if ((download->state == ST_BODY) &&
+                    (download->body.framing == HTTP_BODY_TO_CLOSE)) {
+                        complete(engine, download, false);
+                        return SUCCESS;
+                }
+                return ERR_NO_DATA;
+        }
+        download->started = true;
+        metrics_read(&download->item->metrics, count);
+
+        if (download->state == ST_HEADER) {
+                status = http_parse_header(response, download->buf, count, &used);
+                if (status != HTTP_DONE) {
+                        return (status == HTTP_MORE) ? SUCCESS : ERR_BAD_RESPONSE;
+                }
+                offset = used;
+                download->state = ST_BODY;
+                http_body_init(&download->body, response);
+                download->wanted = batch_open(download->item, response,
+                                              &download->file);
+        }
+
+        status = http_body_decode(&download->body, download->buf + offset,
+                                  count - offset, &used, &out);
+        if (status < 0) {
+                return status;
+        }
+        result = batch_sink(download->file, download->buf + offset, out);
+        if (result != SUCCESS) {
+                return result;
+        }
+        download->bytes += out;
+        if (status == HTTP_DONE) {
+                complete(engine, download, response->keep_alive &&
+                         (download->body.framing != HTTP_BODY_TO_CLOSE));
+        }
+        return SUCCESS;
+}
+
+
+
+// The socket of download is ready: take the next step.
+static void step(struct engine *engine, struct download *download)
+{
+        int result = SUCCESS;
+
+        switch (download->state) {
+                case ST_CONNECTING:
+                        result = net_connect_result(download->fd);
+                        if (result != SUCCESS) {
+                                break;
+                        }
+                        download->item->metrics.connect_ms =
+                                metrics_now(&download->item->metrics);
+                        download->state = ST_SENDING;
+                        // fall through: it is ready to send
+                case ST_SENDING:
+                        result = send_request(engine, download);
+                        break;
+                case ST_HEADER:
+                case ST_BODY:
+                        result = receive(engine, download);
+                        break;
+        }
+        if (result != SUCCESS) {
+                end_download(engine, download, result);
+        }
+}
+
+
+
+// Download every file in list with up to per_host connections open to
+// each host at once.
+// Returns SUCCESS, or ERR_INTERNAL if epoll could not be used.
+extern int engine_download(struct batch_list *list, struct pool *pool,
+                           int per_host, struct batch_stats *stats)
+{
+        struct epoll_event events[ENGINE_MAX_EVENTS];
+        struct queue queues[POOL_MAX_HOSTS];
+        struct engine engine;
+        int result = SUCCESS;
+        int count;
+
+        engine.epfd = epoll_create1(EPOLL_CLOEXEC);
+        if (engine.epfd < 0) {
+                return ERR_INTERNAL;
+        }
+        engine.per_host = per_host;
+        engine.active = 0;
+        engine.pool = pool;
+        engine.list = list;
+        engine.stats = stats;
+
+        // a queue for each host, with room for every file to be sent
+        // twice
+        for (int h = 0; h < pool->nhosts; h++) {
+                queues[h].host = &pool->hosts[h];
+                queues[h].ntodo = 0;
+                queues[h].next = 0;
+                queues[h].active = 0;
+                queues[h].todo = malloc((2 * list->nitems + 1) *
+                                        sizeof(int));
+                if (queues[h].todo == NULL) {
+                        result = ERR_INTERNAL;
+                        continue;
+                }
+                for (int i = 0; i < list->nitems; i++) {
+                        if (list->items[i].host == queues[h].host) {
+                                queues[h].todo[queues[h].ntodo++] = i;
+                        }
+                }
+        }
+        for (int h = 0; (result == SUCCESS) && (h < pool->nhosts); h++) {
+                start_connections(&engine, &queues[h]);
+        }
+
+        while ((result == SUCCESS) && (engine.active > 0)) {
+                count = epoll_wait(engine.epfd, events, ENGINE_MAX_EVENTS, -1);
+                if ((count < 0) && (errno == EINTR)) {
+                        continue;
+                }
+                if (count < 0) {
+                        result = ERR_INTERNAL;
+                        break;
+                }
+                for (int i = 0; i < count; i++) {
+                        step(&engine, events[i].data.ptr);
+                }
+        }
+
+        for (int h = 0; h < pool->nhosts; h++) {
+                free(queues[h].todo);
+        }
+        close(engine.epfd);
+        return result;
+}
+
+// end of engine.c
@@ -0,0 +1,35 @@
+// ----------------------------------------------------------------------
+// file: engine.h
+//
+// Description: This is the header file for the ENGINE module. This
+//     module fetches a batch list (see batch.h) from one thread with
+//     non-blocking sockets and epoll, so that hundreds of downloads
+//     can be under way at once. Each connection steps through the
+//     states of a download (connect, send the request, parse the
+//     header, stream the body) as its socket becomes ready, and goes
+//     on to the next file of its host while the server keeps it open.
+//
+// Created: 2026-10-17
+//
+// ----------------------------------------------------------------------
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include "common.h"
+#include "pool.h"
+#include "batch.h"
+
+#define ENGINE_MAX_EVENTS 64      // taken from epoll_wait() at a time
+#define ENGINE_BUFSIZE (64 * 1024)    // receive buffer per connection
+
+
+// Download every file in list with up to per_host connections open to
+// each host at once. The hosts come from pool, and its connection
+// counts are kept up to date. A file that can not be downloaded is
+// reported on stderr and counted in stats, and the rest carry on.
+// Returns SUCCESS, or ERR_INTERNAL if epoll could not be used.
+extern int engine_download(struct batch_list *list, struct pool *pool,
+                           int per_host, struct batch_stats *stats);
+
+#endif
+// end of engine.h
@@ -0,0 +1,559 @@
+// ----------------------------------------------------------------------
+// file: http.c
+//
+// Description: This file implements the HTTP module. The header is
+//     taken one byte at a time. The status line and the values of the
+//     headers we care about are gathered into the small fixed buffers
+//     in struct http_response and looked at when their line ends; any
+//     other header is skipped without being copied anywhere, however
+//     long it is. Lines may end in "\r\n" or just "\n".
+//
+// Created: 2026-10-17
+// ----------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include "http.h"
+#include "common.h"
+
+#define ST_STATUS 0       // in the status line
+#define ST_NAME 1         // at the start of, or in, a header name
+#define ST_VALUE 2        // in the value of a header we want
+#define ST_SKIP 3         // in a line we do not want
+#define ST_DONE 4
+
+// http_dechunk() states
+#define CH_SIZE 0         // in the chunk size
+#define CH_EXTENSION 1    // after the size, up to the end of its line
+#define CH_DATA 2         // in the data of a chunk
+#define CH_DATA_END 3     // the line end after the data
+#define CH_TRAILER 4      // at the start of a trailer line
+#define CH_TRAILER_LINE 5 // in a trailer line
+#define CH_DONE 6
+
+#define TOKEN_SEPARATORS ", \t"
+
+// the request, as mywget has always sent it
+#define REQUEST_FORMAT "%s /%s HTTP/1.1\r\n" \
+                       "User-Agent: mywget/0.1 (linux-gnu) \r\n" \
+                       "Accept: text/html\r\n" \
+                       "Host: %s\r\n" \
+                       "%s" \
+                       "Connection: %s\r\n\r\n"
+
+
+// What to do with the value of a header we want.
+struct header_handler {
+        const char *name;
+        int (*handle)(struct http_response *response, char *value);
+};
+
+
+
+static int handle_content_length(struct http_response *response, char *value)
+{
+        char *end;
+
+        errno = SUCCESS;
+        response->content_length = strtoll(value, &end, 10);
+        if (errno || (end == value) || (*end != '\0') ||
+            (response->content_length < 0)) {
+                return ERR_BAD_RESPONSE;
+        }
+        return SUCCESS;
+}
+
+
+
+// Only the last coding matters: if it is chunked, the body is chunked.
+static int handle_transfer_encoding(struct http_response *response, char *value)
+{
+        char *last = NULL;
+        char *saveptr = NULL;
+
+        for (char *token = strtok_r(value, TOKEN_SEPARATORS, &saveptr); token != NULL;
+             token = strtok_r(NULL, TOKEN_SEPARATORS, &saveptr)) {
+                last = token;
+        }
+        response->chunked = (last != NULL) && !strcasecmp(last, "chunked");
+        return SUCCESS;
+}
+
+
+
+// "gzip" (or "x-gzip") is the only coding we ask for; "identity" is
+// the same as none.
+static int handle_content_encoding(struct http_response *response, char *value)
+{
+        if (!strcasecmp(value, "gzip") || !strcasecmp(value, "x-gzip")) {
+                response->content_encoding = HTTP_ENCODING_GZIP;
+        } else if (!strcasecmp(value, "identity")) {
+                response->content_encoding = HTTP_ENCODING_IDENTITY;
+        } else {
+                response->content_encoding = HTTP_ENCODING_OTHER;
+        }
+        return SUCCESS;
+}
+
+
+
+static int handle_content_type(struct http_response *response, char *value)
+{
+        response->is_text = !strncasecmp(value, "text", strlen("text"));
+        return SUCCESS;
+}
+
+
+
+static int handle_connection(struct http_response *response, char *value)
+{
+        char *saveptr = NULL;
+
+        for (char *token = strtok_r(value, TOKEN_SEPARATORS, &saveptr); token != NULL;
+             token = strtok_r(NULL, TOKEN_SEPARATORS, &saveptr)) {
+                if (!strcasecmp(token, "close")) {
+                        response->keep_alive = false;
+                } else if (!strcasecmp(token, "keep-alive")) {
+                        response->keep_alive = true;
+                }
+        }
+        return SUCCESS;
+}
+
+
+
+static int handle_accept_ranges(struct http_response *response, char *value)
+{
+        response->accept_ranges = !strcasecmp(value, "bytes");
+        return SUCCESS;
+}
+
+
+
+// "bytes 0-499/1234" (the total may be "*")
+static int handle_content_range(struct http_response *response, char *value)
+{
+        if (sscanf(value, "bytes %lld-%lld/%lld", &response->range_first,
+                   &response->range_last, &response->range_total) == 3) {
+                return SUCCESS;
+        }
+        if (sscanf(value, "bytes %lld-%lld/*", &response->range_first,
+                   &response->range_last) == 2) {
+                response->range_total = HTTP_UNKNOWN_LENGTH;
+                return SUCCESS;
+        }
+        return ERR_BAD_RESPONSE;
+}
+
+
+
+// A validator is kept only if it fitted whole, since one cut short
+// would never match.
+static int handle_validator(char *kept, const struct http_response *response,
+                            const char *value)
+{
+        if (response->value_len < HTTP_MAX_VALUE - 1) {
+                strcpy(kept, value);
+        }
+        return SUCCESS;
+}
+
+
+
+static int handle_etag(struct http_response *response, char *value)
+{
+        return handle_validator(response->etag, response, value);
+}
+
+
+
+static int handle_last_modified(struct http_response *response, char *value)
+{
+        return handle_validator(response->last_modified, response, value);
+}
+
+
+
+static const struct header_handler Handlers[] = {
+        { "Content-Length", handle_content_length },
+        { "Transfer-Encoding", handle_transfer_encoding },
+        { "Content-Type", handle_content_type },
+        { "Content-Encoding", handle_content_encoding },
+        { "Connection", handle_connection },
+        { "Accept-Ranges", handle_accept_ranges },
+        { "Content-Range", handle_content_range },
+        { "ETag", handle_etag },
+        { "Last-Modified", handle_last_modified },
+};
+
+#define NUM_HANDLERS (sizeof(Handlers) / sizeof(Handlers[0]))
+
+
+
+// The handler for the header name gathered so far, or NULL.
+static const struct header_handler *find_handler(const struct http_response *response)
+{
+        for (size_t i = 0; i < NUM_HANDLERS; i++) {
+                if ((strlen(Handlers[i].name) == response->name_len) &&
+                    !strncasecmp(Handlers[i].name, response->name, response->name_len)) {
+                        return &Handlers[i];
+                }
+        }
+        return NULL;
+}
+
+
+
+// The value gathered so far, as a string without the spaces around it.
+static char *trimmed_value(struct http_response *response)
+{
+        char *value = response->value;
+        size_t len = response->value_len;
+
+        while ((len > 0) && isspace((unsigned char)value[len - 1])) {
+                len--;
+        }
+        value[len] = '\0';
+        while (isspace((unsigned char)*value)) {
+                value++;
+        }
+        return value;
+}
+
+
+
+// "HTTP/1.1 200 OK"
+static int parse_status_line(struct http_response *response)
+{
+        char *line = trimmed_value(response);
+        char *reason;
+        int major;
+        int consumed = 0;
+
+        if ((sscanf(line, "HTTP/%d.%d %3d%n", &major, &response->version_minor,
+                    &response->status, &consumed) != 3) || (major != 1)) {
+                return ERR_BAD_RESPONSE;
+        }
+        reason = line + consumed;
+        while (*reason == ' ') {
+                reason++;
+        }
+        strncpy(response->reason, reason, HTTP_MAX_REASON - 1);
+        response->reason[HTTP_MAX_REASON - 1] = '\0';
+
+        // HTTP/1.1 connections stay open unless they say otherwise
+        response->keep_alive = (response->version_minor >= 1);
+        return SUCCESS;
+}
+
+
+
+// Keep a byte of the status line or of a value we want. Anything past
+// the end of the buffer is dropped; the only value that long that
+// matters (a number) will then not parse.
+static void keep(struct http_response *response, char c)
+{
+        if (response->value_len < HTTP_MAX_VALUE - 1) {
+                response->value[response->value_len++] = c;
+        }
+}
+
+
+
+// Get a response ready for http_parse_header().
+extern void http_response_init(struct http_response *response)
+{
+        memset(response, 0, sizeof(*response));
+        response->content_length = HTTP_UNKNOWN_LENGTH;
+        response->range_first = HTTP_UNKNOWN_LENGTH;
+        response->range_last = HTTP_UNKNOWN_LENGTH;
+        response->range_total = HTTP_UNKNOWN_LENGTH;
+        response->state = ST_STATUS;
+}
+
+
+
+// Parse the next len bytes of the response in buf.
+// Returns HTTP_MORE, HTTP_DONE or ERR_BAD_RESPONSE.
+extern int http_parse_header(struct http_response *response,
+                             const char *buf, size_t len, size_t *used)
+{
+        const struct header_handler *handler;
+        size_t i;
+        char c;
+        int result;
+
+        for (i = 0; (i < len) && (response->state != ST_DONE); i++) {
+                c = buf[i];
+                response->header_size++;
+                if (response->header_size > HTTP_MAX_HEADER) {
+                        return ERR_BAD_RESPONSE;
+                }
+                if (c == '\r') {
+                        continue;
+                }
+
+                switch (response->state) {
+                        case ST_STATUS:
+                                if (c != '\n') {
+                                        keep(response, c);
+                                        break;
+                                }
+                                if (parse_status_line(response) != SUCCESS) {
+                                        return ERR_BAD_RESPONSE;
+                                }
+                                response->name_len = 0;
+                                response->state = ST_NAME;
+                                break;
+
+                        case ST_NAME:
+                                if ((c == '\n') && (response->name_len == 0)) {
+                                        // the blank line: that is the header
+                                        response->state = ST_DONE;
+                                } else if (c == '\n') {
+                                        // a line with no ':' in it
+                                        response->name_len = 0;
+                                } else if (c == ':') {
+                                        handler = find_handler(response);
+                                        response->value_len = 0;
+                                        response->state = (handler != NULL) ? ST_VALUE : ST_SKIP;
+                                } else if ((response->name_len == 0) && ((c == ' ') || (c == '\t'))) {
+                                        // a folded line: not one of ours
+                                        response->state = ST_SKIP;
+                                } else if (response->name_len < HTTP_MAX_NAME) {
+                                        response->name[response->name_len++] = c;
+                                } else {
+                                        response->state = ST_SKIP;
+                                }
+                                break;
+
+                        case ST_VALUE:
+                                if (c != '\n') {
+                                        keep(response, c);
+                                        break;
+                                }
+                                handler = find_handler(response);
+                                result = handler->handle(response, trimmed_value(response));
+                                if (result != SUCCESS) {
+                                        return result;
+                                }
+                                response->name_len = 0;
+                                response->state = ST_NAME;
+                                break;
+
+                        case ST_SKIP:
+                                if (c == '\n') {
+                                        response->name_len = 0;
+                                        response->state = ST_NAME;
+                                }
+                                break;
+                }
+        }
+
+        *used = i;
+        return (response->state == ST_DONE) ? HTTP_DONE : HTTP_MORE;
+}
+
+
+
+// Get a decoder ready for http_dechunk().
+extern void http_chunked_init(struct http_chunked *chunked)
+{
+        chunked->state = CH_SIZE;
+        chunked->remaining = 0;
+        chunked->digits = 0;
+}
+
+
+
+// Decode the next len bytes of a chunked body in buf, in place. The
+// data only ever moves towards the front of buf, so it never runs
+// over bytes that have not been looked at yet.
+// Returns HTTP_MORE, HTTP_DONE or ERR_BAD_RESPONSE.
+extern int http_dechunk(struct http_chunked *chunked, char *buf, size_t len,
+                        size_t *used, size_t *out_len)
+{
+        size_t i = 0;
+        size_t out = 0;
+        size_t count;
+        char c;
+
+        while ((i < len) && (chunked->state != CH_DONE)) {
+                if (chunked->state == CH_DATA) {
+                        count = len - i;
+                        if ((long long)count > chunked->remaining) {
+                                count = chunked->remaining;
+                        }
+                        memmove(buf + out, buf + i, count);
+                        out += count;
+                        i += count;
+                        chunked->remaining -= count;
+                        if (chunked->remaining == 0) {
+                                chunked->state = CH_DATA_END;
+                        }
+                        continue;
+                }
+
+                c = buf[i++];
+                if (c == '\r') {
+                        continue;
+                }
+                switch (chunked->state) {
+                        case CH_SIZE:
+                                if (isxdigit((unsigned char)c)) {
+                                        if (chunked->remaining > (LLONG_MAX >> 4)) {
+                                                return ERR_BAD_RESPONSE;
+                                        }
+                                        chunked->remaining = (chunked->remaining << 4) |
+                                                (isdigit((unsigned char)c) ? c - '0' :
+                                                 tolower((unsigned char)c) - 'a' + 10);
+                                        chunked->digits++;
+                                        break;
+                                }
+                                if (chunked->digits == 0) {
+                                        return ERR_BAD_RESPONSE;
+                                }
+                                chunked->state = CH_EXTENSION;
+                                // fall through: this may be the line end
+                        case CH_EXTENSION:
+                                if (c != '\n') {
+                                        break;
+                                }
+                                // a zero size is the last chunk
+                                chunked->state = (chunked->remaining > 0) ? CH_DATA : CH_TRAILER;
+                                break;
+
+                        case CH_DATA_END:
+                                if (c != '\n') {
+                                        return ERR_BAD_RESPONSE;
+                                }
+                                chunked->digits = 0;
+                                chunked->state = CH_SIZE;
+                                break;
+
+                        case CH_TRAILER:
+                                chunked->state = (c == '\n') ? CH_DONE : CH_TRAILER_LINE;
+                                break;
+
+                        case CH_TRAILER_LINE:
+                                if (c == '\n') {
+                                        chunked->state = CH_TRAILER;
+                                }
+                                break;
+                }
+        }
+
+        *used = i;
+        *out_len = out;
+        return (chunked->state == CH_DONE) ? HTTP_DONE : HTTP_MORE;
+}
+
+
+
+// Get ready for the body of response.
+extern void http_body_init(struct http_body *body,
+                           const struct http_response *response)
+{
+        body->remaining = 0;
+        if ((response->status / 100 == 1) || (response->status == HTTP_NO_CONTENT) ||
+            (response->status == HTTP_NOT_MODIFIED)) {
+                body->framing = HTTP_BODY_NONE;
+        } else if (response->chunked) {
+                body->framing = HTTP_BODY_CHUNKED;
+                http_chunked_init(&body->chunked);
+        } else if (response->content_length != HTTP_UNKNOWN_LENGTH) {
+                body->framing = HTTP_BODY_LENGTH;
+                body->remaining = response->content_length;
+        } else {
+                body->framing = HTTP_BODY_TO_CLOSE;
+        }
+}
+
+
+
+// Take the next len bytes of the body in buf.
+// Returns HTTP_MORE, HTTP_DONE or ERR_BAD_RESPONSE.
+extern int http_body_decode(struct http_body *body, char *buf, size_t len,
+                            size_t *used, size_t *out_len)
+{
+        switch (body->framing) {
+                case HTTP_BODY_CHUNKED:
+                        return http_dechunk(&body->chunked, buf, len, used, out_len);
+
+                case HTTP_BODY_LENGTH:
+                        if ((long long)len > body->remaining) {
+                                len = body->remaining;
+                        }
+                        body->remaining -= len;
+                        *used = len;
+                        *out_len = len;
+                        return (body->remaining == 0) ? HTTP_DONE : HTTP_MORE;
+
+                case HTTP_BODY_TO_CLOSE:
+                        *used = len;
+                        *out_len = len;
+                        return HTTP_MORE;
+
+                default:
+                        *used = 0;
+                        *out_len = 0;
+                        return HTTP_DONE;
+        }
+}
+
+
+
+// Put a request for /path on host into buf (of size bytes).
+// Returns the length of the request, or ERR_INTERNAL if it is too long.
+extern int http_build_request(char *buf, size_t size, const char *method,
+                              const char *host, const char *path,
+                              const char *extra, bool keep_alive)
+{
+        int len;
+
+        len = snprintf(buf, size, REQUEST_FORMAT, method, path, host,
+                       (extra != NULL) ? extra : "",
+                       keep_alive ? "keep-alive" : "Close");
+        if ((len < 0) || ((size_t)len >= size)) {
+                return ERR_INTERNAL;
+        }
+        return len;
+}
+
+
+
+// Read from the socket fd into buf until the whole header of the
+// response has been parsed into response.
+// Returns SUCCESS, ERR_NO_DATA or ERR_BAD_RESPONSE.
+extern int http_read_header(int fd, char *buf, size_t size,
+                            struct http_response *response,
+                            size_t *body_start, size_t *body_len)
+{
+        ssize_t count;
+        size_t used;
+        int status = HTTP_MORE;
+
+        http_response_init(response);
+        while (status == HTTP_MORE) {
+                count = read(fd, buf, size);
+                if ((count < 0) && (errno == EINTR)) {
+                        continue;
+                }
+                if (count <= 0) {
+                        return ERR_NO_DATA;
+                }
+                status = http_parse_header(response, buf, count, &used);
+                if (status == HTTP_DONE) {
+                        *body_start = used;
+                        *body_len = count - used;
+                }
+        }
+        return (status == HTTP_DONE) ? SUCCESS : status;
+}
+
+// end of http.c
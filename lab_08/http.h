@@ -0,0 +1,154 @@
+// ----------------------------------------------------------------------
+// file: http.h
+//
+// Description: This is the header file for the HTTP module. This
+//     module parses the header of an HTTP/1.x response as it arrives.
+//     The parser works straight on the receive buffer and can be given
+//     the header in as many pieces as it takes to arrive; it keeps
+//     where it got to in struct http_response, and never allocates.
+//
+// Created: 2026-10-17
+// ----------------------------------------------------------------------
+#ifndef HTTP_H
+#define HTTP_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "common.h"
+
+#define HTTP_MAX_NAME 64          // longer header names are not ours
+#define HTTP_MAX_VALUE 256        // longest value that is kept
+#define HTTP_MAX_REASON 64
+#define HTTP_MAX_HEADER (64 * 1024)
+#define HTTP_UNKNOWN_LENGTH -1
+#define HTTP_MAX_REQUEST 2048
+
+#define HTTP_OK 200
+#define HTTP_NO_CONTENT 204
+#define HTTP_PARTIAL_CONTENT 206
+#define HTTP_NOT_MODIFIED 304
+#define HTTP_BAD_REQUEST 400
+#define HTTP_NOT_FOUND 404
+
+// Content-Encoding
+#define HTTP_ENCODING_IDENTITY 0
+#define HTTP_ENCODING_GZIP 1
+#define HTTP_ENCODING_OTHER 2     // one we can not decode
+
+// http_parse_header() results (errors are ERR_BAD_RESPONSE)
+#define HTTP_MORE 0               // give it the next piece
+#define HTTP_DONE 1               // the whole header has been seen
+
+struct http_response {
+        // what was found
+        int version_minor;        // HTTP/1.<version_minor>
+        int status;
+        char reason[HTTP_MAX_REASON];
+        long long content_length; // or HTTP_UNKNOWN_LENGTH
+        bool chunked;             // Transfer-Encoding ends in chunked
+        int content_encoding;     // HTTP_ENCODING_...
+        bool is_text;             // Content-Type: text/...
+        bool keep_alive;          // the connection can be used again
+        bool accept_ranges;       // Accept-Ranges: bytes
+        long long range_first;    // Content-Range: bytes first-last/total
+        long long range_last;     // (HTTP_UNKNOWN_LENGTH if not given)
+        long long range_total;
+        char etag[HTTP_MAX_VALUE];          // "" if not given
+        char last_modified[HTTP_MAX_VALUE];
+        size_t header_size;       // bytes up to and including the blank line
+
+        // where the parser got to
+        int state;
+        size_t name_len;
+        size_t value_len;
+        char name[HTTP_MAX_NAME];
+        char value[HTTP_MAX_VALUE];
+};
+
+// Where the chunked decoder got to.
+struct http_chunked {
+        int state;
+        long long remaining;      // of the chunk size, or of the chunk
+        int digits;               // of the chunk size seen so far
+};
+
+// How a body ends (struct http_body)
+#define HTTP_BODY_NONE 0          // there is none (204, 304, 1xx)
+#define HTTP_BODY_LENGTH 1        // after Content-Length bytes
+#define HTTP_BODY_CHUNKED 2       // at the last chunk
+#define HTTP_BODY_TO_CLOSE 3      // when the connection closes
+
+// Where the body of a response got to.
+struct http_body {
+        int framing;              // HTTP_BODY_...
+        long long remaining;      // for HTTP_BODY_LENGTH
+        struct http_chunked chunked;
+};
+
+
+// Get a response ready for http_parse_header().
+extern void http_response_init(struct http_response *response);
+
+
+// Parse the next len bytes of the response in buf. *used is set to the
+// number of bytes that belong to the header: all of them while it
+// returns HTTP_MORE, and up to the end of the header when it returns
+// HTTP_DONE (anything after that is the start of the body).
+// Returns HTTP_MORE, HTTP_DONE or ERR_BAD_RESPONSE.
+extern int http_parse_header(struct http_response *response,
+                             const char *buf, size_t len, size_t *used);
+
+
+// Get a decoder ready for http_dechunk().
+extern void http_chunked_init(struct http_chunked *chunked);
+
+
+// Decode the next len bytes of a chunked body in buf, in place: the
+// data of the chunks is moved to the front of buf and *out_len is set
+// to how much of it there is. *used is set to the number of bytes of
+// buf that belong to the body: all of them while it returns HTTP_MORE,
+// and up to the end of the trailer when it returns HTTP_DONE (anything
+// after that is the next response).
+// Returns HTTP_MORE, HTTP_DONE or ERR_BAD_RESPONSE.
+extern int http_dechunk(struct http_chunked *chunked, char *buf, size_t len,
+                        size_t *used, size_t *out_len);
+
+
+// Get ready for the body of response. A body that ends when the
+// connection does means the connection can not be used again.
+extern void http_body_init(struct http_body *body,
+                           const struct http_response *response);
+
+
+// Take the next len bytes of the body in buf (len may be 0). The data
+// in them is left at the front of buf and *out_len is set to how much
+// there is; *used is set to the number of bytes that belonged to the
+// body (anything after them is the next response). When the
+// connection closes, a HTTP_BODY_TO_CLOSE body is done and any other
+// is cut short.
+// Returns HTTP_MORE, HTTP_DONE or ERR_BAD_RESPONSE.
+extern int http_body_decode(struct http_body *body, char *buf, size_t len,
+                            size_t *used, size_t *out_len);
+
+
+// Put a request for /path on host into buf (of size bytes). extra is
+// more header lines, each ending in "\r\n", or NULL. keep_alive asks
+// the server to keep the connection open after the response.
+// Returns the length of the request, or ERR_INTERNAL if it is too long.
+extern int http_build_request(char *buf, size_t size, const char *method,
+                              const char *host, const char *path,
+                              const char *extra, bool keep_alive);
+
+
+// Read from the socket fd into buf (of size bytes) until the whole
+// header of the response has been parsed into response. The body
+// bytes that came in with the end of the header are left at
+// buf[*body_start], and there are *body_len of them.
+// Returns SUCCESS, ERR_NO_DATA if the connection failed or closed
+// first, or ERR_BAD_RESPONSE.
+extern int http_read_header(int fd, char *buf, size_t size,
+                            struct http_response *response,
+                            size_t *body_start, size_t *body_len);
+
+#endif
+// end of http.h
@@ -0,0 +1,231 @@
+// ----------------------------------------------------------------------
+// file: metrics.c
+//
+// Description: This file implements the METRICS module. Times come
+//     from CLOCK_MONOTONIC. The progress line is redrawn in place with
+//     a carriage return, and no more often than METRICS_PROGRESS_MS, so
+//     drawing it costs nothing next to the reads.
+//
+// Created: 2026-10-17
+//
+// ----------------------------------------------------------------------
+#include <stdio.h>
+#include <string.h>
+#include <poll.h>
+#include "metrics.h"
+#include "common.h"
+
+#define MS_PER_S 1000.0
+#define NS_PER_MS 1000000.0
+#define MEGABYTE (1024.0 * 1024.0)
+#define PERCENT 100.0
+
+
+
+// Start timing a download of /path from host.
+extern void metrics_init(struct metrics *metrics, const char *host,
+                         const char *path, bool progress)
+{
+        memset(metrics, 0, sizeof(*metrics));
+        clock_gettime(CLOCK_MONOTONIC, &metrics->start);
+        metrics->host = host;
+        metrics->path = path;
+        metrics->dns_ms = METRICS_UNSET;
+        metrics->connect_ms = METRICS_UNSET;
+        metrics->ttfb_ms = METRICS_UNSET;
+        metrics->total_ms = METRICS_UNSET;
+        metrics->sent_ms = METRICS_UNSET;
+        metrics->last_data_ms = METRICS_UNSET;
+        // the first line waits a while, so a quick download is
+        // only drawn once, at the end
+        metrics->last_progress_ms = 0;
+        metrics->expected = -1;
+        metrics->progress = progress;
+}
+
+
+
+// Milliseconds since metrics_init().
+extern double metrics_now(const struct metrics *metrics)
+{
+        struct timespec now;
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (now.tv_sec - metrics->start.tv_sec) * MS_PER_S +
+                (now.tv_nsec - metrics->start.tv_nsec) / NS_PER_MS;
+}
+
+
+
+// Draw the progress line, now ms into the download.
+static void draw(struct metrics *metrics, double now)
+{
+        double rate = 0;
+
+        if (now > 0) {
+                rate = metrics->bytes / MEGABYTE / (now / MS_PER_S);
+        }
+        fprintf(stderr, "\r%s: %lld", metrics->path, metrics->bytes);
+        if (metrics->expected > 0) {
+                fprintf(stderr, "/%lld bytes (%.0f%%)", metrics->expected,
+                        PERCENT * metrics->bytes / metrics->expected);
+        } else {
+                fprintf(stderr, " bytes");
+        }
+        fprintf(stderr, "  %.2f MB/s  %ld reads", rate, metrics->reads);
+        if ((metrics->last_data_ms != METRICS_UNSET) &&
+            (now - metrics->last_data_ms >= METRICS_STALL_MS)) {
+                fprintf(stderr, "  stalled %.1fs",
+                        (now - metrics->last_data_ms) / MS_PER_S);
+        } else if ((metrics->last_data_ms == METRICS_UNSET) &&
+                   (metrics->sent_ms != METRICS_UNSET)) {
+                fprintf(stderr, "  waiting %.1fs", (now - metrics->sent_ms) / MS_PER_S);
+        }
+        // clear what is left of a longer line
+        fprintf(stderr, "\033[K");
+        fflush(stderr);
+        metrics->last_progress_ms = now;
+}
+
+
+
+// The request has been sent.
+extern void metrics_sent(struct metrics *metrics)
+{
+        metrics->sent_ms = metrics_now(metrics);
+}
+
+
+
+// A read (or splice) of the response brought in count bytes.
+extern void metrics_read(struct metrics *metrics, long long count)
+{
+        if (count > 0) {
+                metrics->reads++;
+                metrics_data(metrics, count);
+        }
+}
+
+
+
+// count bytes of the response arrived.
+extern void metrics_data(struct metrics *metrics, long long count)
+{
+        double now;
+        double gap;
+
+        if (count <= 0) {
+                return;
+        }
+        now = metrics_now(metrics);
+        if (metrics->last_data_ms == METRICS_UNSET) {
+                // the wait for the first byte is not a stall
+                metrics->ttfb_ms = now - ((metrics->sent_ms != METRICS_UNSET) ?
+                                          metrics->sent_ms : 0);
+        } else {
+                gap = now - metrics->last_data_ms;
+                if (gap >= METRICS_STALL_MS) {
+                        metrics->stalls++;
+                        metrics->stalled_ms += gap;
+                        if (gap > metrics->longest_stall_ms) {
+                                metrics->longest_stall_ms = gap;
+                        }
+                }
+        }
+        metrics->last_data_ms = now;
+        metrics->bytes += count;
+
+        if (metrics->progress &&
+            (now - metrics->last_progress_ms >= METRICS_PROGRESS_MS)) {
+                draw(metrics, now);
+        }
+}
+
+
+
+// Wait until fd can be read, redrawing the progress line meanwhile.
+extern void metrics_wait(struct metrics *metrics, int fd)
+{
+        struct pollfd ready = { .fd = fd, .events = POLLIN };
+
+        if (!metrics->progress) {
+                return;
+        }
+        while (poll(&ready, 1, METRICS_PROGRESS_MS) == 0) {
+                draw(metrics, metrics_now(metrics));
+        }
+}
+
+
+
+// The download is over.
+extern void metrics_done(struct metrics *metrics, int status, int result,
+                         long long body_bytes)
+{
+        metrics->total_ms = metrics_now(metrics);
+        metrics->status = status;
+        metrics->result = result;
+        metrics->body_bytes = body_bytes;
+        if (metrics->progress) {
+                draw(metrics, metrics->total_ms);
+                fprintf(stderr, "\n");
+        }
+}
+
+
+
+// Write s to out as a JSON string.
+static void json_string(FILE *out, const char *s)
+{
+        fputc('"', out);
+        for (; (s != NULL) && (*s != '\0'); s++) {
+                if ((*s == '"') || (*s == '\\')) {
+                        fprintf(out, "\\%c", *s);
+                } else if ((unsigned char)*s < ' ') {
+                        fprintf(out, "\\u%04x", (unsigned char)*s);
+                } else {
+                        fputc(*s, out);
+                }
+        }
+        fputc('"', out);
+}
+
+
+
+// A time, or null if it was never reached.
+static void json_ms(FILE *out, const char *name, double ms)
+{
+        if (ms == METRICS_UNSET) {
+                fprintf(out, ",\"%s\":null", name);
+        } else {
+                fprintf(out, ",\"%s\":%.3f", name, ms);
+        }
+}
+
+
+
+// Write the metrics to out as one line of JSON.
+extern void metrics_json(const struct metrics *metrics, FILE *out)
+{
+        double seconds = metrics->total_ms / MS_PER_S;
+
+        fprintf(out, "{\"host\":");
+        json_string(out, metrics->host);
+        fprintf(out, ",\"path\":");
+        json_string(out, metrics->path);
+        fprintf(out, ",\"status\":%d,\"result\":%d", metrics->status, metrics->result);
+        json_ms(out, "dns_ms", metrics->dns_ms);
+        fprintf(out, ",\"dns_cached\":%s", metrics->dns_cached ? "true" : "false");
+        json_ms(out, "connect_ms", metrics->connect_ms);
+        json_ms(out, "ttfb_ms", metrics->ttfb_ms);
+        json_ms(out, "total_ms", metrics->total_ms);
+        fprintf(out, ",\"bytes\":%lld,\"body_bytes\":%lld,\"bytes_per_s\":%.0f",
+                metrics->bytes, metrics->body_bytes,
+                (seconds > 0) ? metrics->bytes / seconds : 0.0);
+        fprintf(out, ",\"reads\":%ld,\"stalls\":%ld,\"stalled_ms\":%.3f,"
+                "\"longest_stall_ms\":%.3f}\n", metrics->reads, metrics->stalls,
+                metrics->stalled_ms, metrics->longest_stall_ms);
+        fflush(out);
+}
+
+// end of metrics.c
@@ -0,0 +1,92 @@
+// ----------------------------------------------------------------------
+// file: metrics.h
+//
+// Description: This is the header file for the METRICS module. This
+//     module times each download (DNS lookup, connect, time to the
+//     first byte of the response, the whole transfer), counts the
+//     reads that brought data in, and notes the stalls: gaps of at
+//     least METRICS_STALL_MS between one read and the next. It can draw
+//     a progress line on stderr while the download runs, and write one
+//     JSON record for it when it is over.
+//
+// Created: 2026-10-17
+//
+// ----------------------------------------------------------------------
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <time.h>
+#include "common.h"
+
+#define METRICS_STALL_MS 500.0    // a longer gap between reads is a stall
+#define METRICS_PROGRESS_MS 250   // the progress line is redrawn this often
+#define METRICS_UNSET -1.0        // a time that was never reached
+
+struct metrics {
+        const char *host;
+        const char *path;
+        struct timespec start;    // everything else is in ms since this
+        double dns_ms;            // how long each step took
+        double connect_ms;
+        double ttfb_ms;           // from the request to the first byte
+        double total_ms;
+        bool dns_cached;
+        double sent_ms;           // when the request had been sent
+        double last_data_ms;      // when the last data arrived
+        double last_progress_ms;  // when the progress line was drawn
+        long long bytes;          // of the response, header and all
+        long long body_bytes;     // written to the file
+        long long expected;       // bytes, or -1 while unknown
+        long reads;               // that brought data
+        long stalls;
+        double stalled_ms;        // in all the stalls
+        double longest_stall_ms;
+        int status;               // of the response, or 0
+        int result;               // SUCCESS or the ERR_ code
+        bool progress;            // draw the progress line
+};
+
+
+// Start timing a download of /path from host. The strings must last
+// as long as the metrics.
+extern void metrics_init(struct metrics *metrics, const char *host,
+                         const char *path, bool progress);
+
+
+// Milliseconds since metrics_init().
+extern double metrics_now(const struct metrics *metrics);
+
+
+// The request has been sent.
+extern void metrics_sent(struct metrics *metrics);
+
+
+// A read (or splice) of the response brought in count bytes.
+extern void metrics_read(struct metrics *metrics, long long count);
+
+
+// count bytes of the response arrived, without a read of their own
+// (they were read along with something else).
+extern void metrics_data(struct metrics *metrics, long long count);
+
+
+// Wait until fd can be read, redrawing the progress line (with how
+// long it has been since the last data) every METRICS_PROGRESS_MS.
+// Does nothing without the progress line.
+extern void metrics_wait(struct metrics *metrics, int fd);
+
+
+// The download is over: status is the response status (or 0), result
+// is how it ended and body_bytes is what reached the file. The
+// progress line is finished off.
+extern void metrics_done(struct metrics *metrics, int status, int result,
+                         long long body_bytes);
+
+
+// Write the metrics to out as one line of JSON.
+extern void metrics_json(const struct metrics *metrics, FILE *out);
+
+#endif
+// end of metrics.h
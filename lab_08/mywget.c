@@ -5,7 +5,34 @@
 //     is a command-line utility for downloading files from a web server.
 //
 // Syntax:
-//     mywget servername filename
+//     mywget [-j N] [-z] [-P] [-m records] [--update] servername filename
+//     mywget -b listfile [-c N] [-m records] [--update] servername
+//
+//     -j N    download the file over N connections at once, each asking
+//             for its own byte range (only when the server accepts
+//             ranges; otherwise the file comes over one connection)
+//     -z      ask for the file gzip-compressed (Accept-Encoding:
+//             gzip); it is inflated as it arrives. The compressed
+//             stream can not be split into ranges, so -j is ignored
+//     -b listfile
+//             download every file listed in listfile ("-" for the
+//             standard input) over keep-alive connections; see batch.h
+//             for what a line can be
+//     -c N    fetch the batch with the event-driven engine instead,
+//             with up to N connections open to each host at once
+//     -P      draw the progress line on stderr even when it is not a
+//             terminal (it always is drawn on one)
+//     -m records
+//             append one line of JSON for each download to the file
+//             records ("-" for the standard output): how long the DNS
+//             lookup, the connect and the first byte took, the bytes
+//             and bytes/s, the reads, and the stalls (see metrics.h)
+//     -u, --update
+//             the file may already be here: fetch it only if the
+//             server has a newer copy, asking with the ETag and
+//             Last-Modified it was last downloaded with (kept beside
+//             it, see cache.h). A 304 leaves the file as it is; a new
+//             copy replaces it only once it has all arrived
 //
 // Created: 2017-05-24 (P. Clark)
 //
@@ -24,58 +51,73 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <getopt.h>
 #include <libgen.h>
 #include <signal.h>
 #include <errno.h>
 #include <stdbool.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <fcntl.h>
 #include <arpa/inet.h>
 #include <netdb.h>
-
-#define VALID_INPUTS 3
-#define DEST_ARG 1
-#define FILE_ARG 2
-#define SUCCESS 0
+#include "common.h"
+#include "http.h"
+#include "ranged.h"
+#include "pool.h"
+#include "batch.h"
+#include "engine.h"
+#include "body.h"
+#include "dns.h"
+#include "net.h"
+#include "metrics.h"
+#include "cache.h"
+
+#define VALID_INPUTS 2      // after the options
+#define VALID_BATCH_INPUTS 1
+#define STDIN_NAME "-"
 #define FILE_EXISTS 0
-#define MAXBUF 1024
 #define MAXERR 80
-#define RESPONSE_OK "200 OK"
-#define HEADER_END "\r\n\r\n"
-#define GET_REQUEST_PART_1 "GET /"
-#define GET_REQUEST_PART_2 " HTTP/1.1\r\nUser-Agent: mywget/0.1 (linux-gnu) \r\nAccept: text/html\r\nHost: "
-#define GET_REQUEST_PART_3 "\r\nConnection: Close\r\n\r\n"
-#define SERVER_NAME 1
-#define FILE_NAME 2
-
-#define ERR_NUM_INPUTS -1     /* invalid number of args at command-line */
-#define ERR_DNS -3            /* unable to resolve domain name to IP */
-#define ERR_NOT_FOUND -4      /* file not found on the server */
-#define ERR_BAD_RESPONSE -5   /* server gave an unrecognized response */
-#define ERR_ON_WRITE -6       /* error when writing */
-#define ERR_SOCKET -7         /* error getting a socket */
-#define ERR_CONNECT -8        /* error trying to connect to server */
-#define ERR_FILE -9           /* unable to open local file for output */
-#define ERR_FILE_EXISTS -10   /* file exists locally */
-#define ERR_BAD_REQUEST -11   /* server complained of bad client request */
-#define ERR_UNSUPPORTED -12   /* the returned file is not a text file */
-#define ERR_INTERNAL -13      /* unexpected internal problem */
-#define ERR_NO_DATA -14       /* no data received from the server */
+#define SERVER_NAME argv[optind]
+#define FILE_NAME argv[optind+1]
+#define SINGLE_STREAM 1     // -j that means one plain GET
+#define NO_ENGINE 0         // -c not given: the blocking batch
+#define NO_FILE -1
+#define FILE_MODE 0666      // before the umask
+#define ACCEPT_GZIP "Accept-Encoding: gzip\r\n"
+#define RECORDS_MODE "a"    // records pile up from run to run
+#define MAX_EXTRA (sizeof(ACCEPT_GZIP) + CACHE_MAX_CONDITIONS)
 
 
 // Prototypes
 void when_exiting(void);
+void finish_metrics(int status, void *arg);
 void sig_handler(int signal);
-void get_header_info(const char *buffer,
-                     const int count,
-                     int *hdr_size,
-                     bool *istext);
+void get_header_info(const struct http_response *response);
+FILE *open_records(const char *name);
+void commit_update(const char *filename,
+                   const struct http_response *response);
+bool download_ranged(const struct dns_result *dns, const char *host,
+                     const char *path, const char *filename, int jobs);
+int download_batch(const char *list_name, const char *host, int per_host,
+                   FILE *records, bool update);
 
 
 
 // Global variables
 int Sock_fd = 0;              // socket descriptor
-FILE *Myfile = NULL;          // file stream
+int File_fd = NO_FILE;        // file descriptor
+struct metrics Metrics;       // of the single download
+FILE *Records = NULL;         // -m, or NULL
+bool Update = false;          // --update
+struct cache_entry Cache;     // what the file was downloaded with
+char Temp_name[CACHE_MAX_NAME] = "";  // the new copy, until renamed
+
+// Long options
+static const struct option Long_options[] = {
+        { "update", no_argument, NULL, 'u' },
+        { NULL, 0, NULL, 0 }
+};
 
 
 // ***********************************************************************
@@ -83,27 +125,93 @@ FILE *Myfile = NULL;          // file stream
 // ***********************************************************************
 int main(int argc, char *argv[])
 {
-        struct addrinfo *start = NULL;
-        struct addrinfo *current = NULL;
-        struct addrinfo hints;
+        struct dns_result dns;
         int count = 0;
-        int hdr_size = 0;
-        bool istext = false;
+        size_t hdr_size = 0;
+        int status = HTTP_MORE;
         int num = 0;
         int result = 0;
-        char request_buf[MAXBUF+1];
+        int option = 0;
+        int jobs = SINGLE_STREAM;
+        int per_host = NO_ENGINE;
+        bool gzip = false;
+        bool conditional = false;
+        bool progress = isatty(STDERR_FILENO);
+        double started;
+        char *end = NULL;
+        const char *batch_list = NULL;
+        char request_buf[HTTP_MAX_REQUEST];
+        char extra[MAX_EXTRA] = "";
         char response_buf[MAXBUF+1];
+        struct http_response response;
+        struct body_stats body_stats;
         struct sigaction act;
 
+        while ((option = getopt_long(argc, argv, "j:b:c:zPm:u", Long_options,
+                                     NULL)) != -1) {
+                switch (option) {
+                        case 'j':
+                                errno = SUCCESS;
+                                jobs = strtol(optarg, &end, 10);
+                                if (errno || (*end != '\0') || (jobs < 1)) {
+                                        fprintf(stderr, "Error: bad -j value '%s'\n", optarg);
+                                        exit(ERR_NUM_INPUTS);
+                                }
+                                break;
+                        case 'z':
+                                gzip = true;
+                                break;
+                        case 'P':
+                                progress = true;
+                                break;
+                        case 'm':
+                                Records = open_records(optarg);
+                                break;
+                        case 'u':
+                                Update = true;
+                                break;
+                        case 'b':
+                                batch_list = optarg;
+                                break;
+                        case 'c':
+                                errno = SUCCESS;
+                                per_host = strtol(optarg, &end, 10);
+                                if (errno || (*end != '\0') || (per_host < 1)) {
+                                        fprintf(stderr, "Error: bad -c value '%s'\n", optarg);
+                                        exit(ERR_NUM_INPUTS);
+                                }
+                                break;
+                        default:
+                                exit(ERR_NUM_INPUTS);
+                }
+        }
+
+        if (batch_list != NULL) {
+                if (argc - optind != VALID_BATCH_INPUTS) {
+                        fprintf(stderr,"Error: invalid number of inputs.\n");
+                        exit(ERR_NUM_INPUTS);
+                }
+                return download_batch(batch_list, SERVER_NAME, per_host,
+                                      Records, Update);
+        }
+
         // Verify proper number of arguments on the command-line
-        if (argc != VALID_INPUTS) {
+        if (argc - optind != VALID_INPUTS) {
                 fprintf(stderr,"Error: invalid number of inputs.\n");
                 exit(ERR_NUM_INPUTS);
         }
 
         // Verify that the requested file doesn't already exist locally
         // F_OK is one of the "modes" just indicating file existance
-        if (access(argv[FILE_ARG], F_OK) == FILE_EXISTS) {
+        // (with --update it may, and is only asked for if it changed)
+        if (Update) {
+                conditional = cache_load(basename(FILE_NAME), &Cache);
+                if (cache_temp_name(basename(FILE_NAME), Temp_name,
+                                    sizeof(Temp_name)) != SUCCESS) {
+                        fprintf(stderr, "File name too long\n");
+                        exit(ERR_FILE);
+                }
+        } else if (access(basename(FILE_NAME), F_OK) == FILE_EXISTS) {
                 fprintf(stderr,
                         "A copy of the requested file exists locally\n");
                 exit(ERR_FILE_EXISTS);
@@ -122,93 +230,110 @@ int main(int argc, char *argv[])
                 perror("Warning: unable to handle segmentation faults");
         }
 
-        // Fill out the 'hints' with the kind of answers we want.
-        bzero(&hints,sizeof(hints));
-        hints.ai_family   = AF_INET;     // we want IPv4
-        hints.ai_socktype = SOCK_STREAM; // we're going to use TCP
-
+        // From here on, the download is timed, and however it ends
+        // finish_metrics() reports it
+        metrics_init(&Metrics, SERVER_NAME, FILE_NAME, progress);
+        on_exit(finish_metrics, NULL);
 
         // "Resolve DNS for the input server name"
-        result = getaddrinfo(argv[SERVER_NAME], "80", &hints, &start);
-        // error check getaddrinfo
-        if ((result != 0) || (start == NULL)) {
-                fprintf(stderr,
-                        "DNS resolution failed for %s: %s\n",
-                        argv[SERVER_NAME], gai_strerror(result));
-                exit(-1);
-        }
-        // find the ipv4 ip address
-        for (current=start; current != NULL; current = current->ai_next) {
-                if (current->ai_family == AF_INET) {
-                        break;
-                }
+        dns_open();
+        result = dns_resolve(SERVER_NAME, &dns);
+        dns_close();
+        Metrics.dns_ms = metrics_now(&Metrics);
+        Metrics.dns_cached = dns.cached;
+        if (result != SUCCESS) {
+                fprintf(stderr, "DNS resolution failed for %s\n", SERVER_NAME);
+                exit(ERR_DNS);
         }
-        if (current == NULL) {
-                fprintf(stderr, "Could not find an IPv4 address");
-                exit(-1);
+
+        // Several ranges at once, if the server will have it (but not
+        // when a conditional GET may save fetching the file at all, nor
+        // when it is to come gzip-compressed, which has to be one stream)
+        if ((jobs > SINGLE_STREAM) && !conditional && !gzip &&
+            download_ranged(&dns, SERVER_NAME, FILE_NAME,
+                            basename(FILE_NAME), jobs)) {
+                return 0;
         }
 
         // Try to connect to server
         // ** Put the descriptor into the global "Sock_fd" **
-        // Get a descriptor
-        errno = 0;
-        Sock_fd = socket(current->ai_family, current->ai_socktype, 0);
-        if ((Sock_fd < 0) || (errno != 0)) {
-                perror("Unable to get a descriptor");
-                exit(-1);
-        }
-        result = connect(Sock_fd, current->ai_addr, current->ai_addrlen);
-        if (result == 0) {
-                printf("Connection made\n");
-        } else {
+        started = metrics_now(&Metrics);
+        Sock_fd = net_connect(&dns, NULL);
+        Metrics.connect_ms = metrics_now(&Metrics) - started;
+        if (Sock_fd < 0) {
+                result = Sock_fd;
+                Sock_fd = 0;
                 perror("Unable to connect to server");
+                exit(result);
         }
+        printf("Connection made\n");
 
         // Build my request in "request_buf"
-        strcat(request_buf, GET_REQUEST_PART_1);
-        strcat(request_buf, argv[FILE_NAME]);
-        char getRequest[80] = GET_REQUEST_PART_2;
-        strcat(request_buf, getRequest);
-        strcat(request_buf, argv[SERVER_NAME]);
-
-        char getRequest2[40] = GET_REQUEST_PART_3;
-        strcat(request_buf, getRequest2);
+        if (gzip) {
+                strcpy(extra, ACCEPT_GZIP);
+        }
+        if (conditional) {
+                cache_conditions(&Cache, extra + strlen(extra),
+                                 sizeof(extra) - strlen(extra));
+        }
+        num = http_build_request(request_buf, sizeof(request_buf), "GET",
+                                 SERVER_NAME, FILE_NAME, extra, false);
+        if (num < 0) {
+                fprintf(stderr, "Request too long\n");
+                exit(ERR_BAD_REQUEST);
+        }
 
         // Send/write my request to the server
-        num = write(Sock_fd, request_buf, strlen(request_buf));
+        errno = SUCCESS;
+        num = write(Sock_fd, request_buf, num);
+        metrics_sent(&Metrics);
         if ((num > 0) && (errno == 0)) {
-                // Read the server's response.
-                // I'm assuming I get full response in one read,
-                // which is a bad assumption.
-                // Read the response from the server.
-                // Read the data into "response_buf", and the # of bytes into "count"
-                count = read(Sock_fd, response_buf, MAXBUF);
-                if ((errno ==0) && (count > 0)) {
-                        response_buf[count] = '\0';
+                // Read the server's response until the whole header
+                // has been parsed, however many reads that takes.
+                // hdr_size is how much of the last read was header.
+                http_response_init(&response);
+                do {
+                        metrics_wait(&Metrics, Sock_fd);
+                        count = read(Sock_fd, response_buf, MAXBUF);
+                        if (count <= 0) {
+                                break;
+                        }
+                        metrics_read(&Metrics, count);
+                        status = http_parse_header(&response, response_buf,
+                                                   count, &hdr_size);
+                } while (status == HTTP_MORE);
+
+                if (status == HTTP_DONE) {
+                        Metrics.status = response.status;
+                        if (response.content_length != HTTP_UNKNOWN_LENGTH) {
+                                Metrics.expected = response.header_size +
+                                        response.content_length;
+                        }
+                        if (conditional &&
+                            (response.status == HTTP_NOT_MODIFIED)) {
+                                // no body: the copy we have is current
+                                finish_metrics(SUCCESS, NULL);
+                                printf("%s is up to date\n",
+                                       basename(FILE_NAME));
+                                return 0;
+                        }
                         // Analyze the server's response...
                         // Is it a valid response?
-                        // How many bytes is the HTTP header received from the server?
                         // Is this is a text file being returned?
-                        get_header_info(response_buf, count, &hdr_size, &istext);
-                        if (hdr_size <= 0) {
-                                fprintf(stderr,"Unexpected header size\n");
-                                exit(ERR_INTERNAL);
-                        }
-                        if (!istext) {
-                                fprintf(stderr,"Error: The file type is not text\n");
-                                exit(ERR_UNSUPPORTED);
-                        }
-
-                } else if ((errno == 0) && (count == 0)) {
+                        get_header_info(&response);
+                } else if (status != HTTP_MORE) {
+                        fprintf(stderr, "Invalid HTTP header\n");
+                        exit(ERR_BAD_RESPONSE);
+                } else if (count == 0) {
                         fprintf(stderr, "No data received\n");
+                        exit(ERR_NO_DATA);
                 } else {
                         perror("Read failure");
+                        exit(ERR_NO_DATA);
                 }
-                // Close the TCP connection
-                shutdown(Sock_fd, SHUT_RDWR);
-                printf("Connection closed\n\n");
         } else {
                 perror("Write request failed");
+                exit(ERR_CONNECT);
         }
 
 
@@ -216,46 +341,55 @@ int main(int argc, char *argv[])
         // I put this off as long as possible so that I don't leave a
         // created file in place if an error occurred.
         // But if we got this far, there is data to be written out.
-        errno = SUCCESS;
-        Myfile = fopen(basename(argv[FILE_ARG]), "w+");
-        if (errno) {
+        File_fd = open(Update ? Temp_name : basename(FILE_NAME),
+                       O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, FILE_MODE);
+        if (File_fd < 0) {
                 perror("Error opening/creating destination file");
                 exit(ERR_FILE);
         }
 
-        // Write out the part of the buffer that contains file info (if any).
-        errno = SUCCESS;
-        // hdr_size = prob header size
-        fwrite(&(response_buf[hdr_size]), sizeof(char), count-hdr_size, Myfile);
-        if (errno) {
-                perror("Unexpected error writing to file:");
+        // Write out the part of the buffer that contains file info (if
+        // any), and then the rest of the body straight from the socket
+        result = body_save(Sock_fd, File_fd, &response, &response_buf[hdr_size],
+                           count - hdr_size, &body_stats, &Metrics);
+        Metrics.body_bytes = body_stats.bytes;
+        if (result == ERR_NO_DATA) {
+                fprintf(stderr, "Connection closed after %lld bytes of the file\n",
+                        body_stats.bytes);
+                exit(ERR_NO_DATA);
+        } else if (result == ERR_ON_WRITE) {
+                perror("Unexpected error writing to file");
                 exit(ERR_ON_WRITE);
+        } else if (result != SUCCESS) {
+                fprintf(stderr, "Unable to read the body (%d)\n", result);
+                exit(result);
+        }
+        if (response.content_encoding == HTTP_ENCODING_GZIP) {
+                printf("Inflated %lld bytes into %lld\n", body_stats.received,
+                       body_stats.bytes);
         }
 
-        // Now read the rest of the file from the server (if anything)
-        do {
-                // Set "count" as the number of bytes read.
-                count = read(Sock_fd, response_buf, MAXBUF); // MAXBUF+1?
-                fwrite(&(response_buf), sizeof(char), count, Myfile);
-
-        } while (count > 0);
+        // Close the TCP connection
+        shutdown(Sock_fd, SHUT_RDWR);
+        finish_metrics(SUCCESS, NULL);
+        printf("Connection closed\n\n");
 
         // Clean up
-        // Free up linked list
-        if (start != NULL) {
-                freeaddrinfo(start);
-                start = NULL;
-                current = NULL;
-        }
         // check if Sock_fd is still open
         if (Sock_fd) {
                 shutdown(Sock_fd, SHUT_RDWR);
         }
-        // check if MyFile isn't null
-        if (Myfile != NULL) {
-                fflush(Myfile);
-                fclose(Myfile);
-                Myfile = NULL;
+        // check if the file is still open
+        if (File_fd != NO_FILE) {
+                if (close(File_fd) != 0) {
+                        perror("Unexpected error writing to file");
+                        File_fd = NO_FILE;
+                        exit(ERR_ON_WRITE);
+                }
+                File_fd = NO_FILE;
+        }
+        if (Update) {
+                commit_update(basename(FILE_NAME), &response);
         }
 
         fflush(stderr);
@@ -274,116 +408,317 @@ int main(int argc, char *argv[])
 // ----------------------------------------------------------------------
 void when_exiting(void)
 {
-        if (Myfile != NULL) {
+        if (File_fd != NO_FILE) {
                 // close the file
-                fflush(Myfile);
-                fclose(Myfile);
-                Myfile = NULL;
+                close(File_fd);
+                File_fd = NO_FILE;
         }
         if (Sock_fd != 0) {
                 // close the connection
                 shutdown(Sock_fd, SHUT_RDWR);
                 close(Sock_fd);
         }
+        if (Temp_name[0] != '\0') {
+                // an update that did not finish: the old copy stays
+                unlink(Temp_name);
+        }
 }
 
 
 
 // ----------------------------------------------------------------------
 // function
-//     get_header_info
+//     finish_metrics
+// description
+//     Ends the timing of the single download, finishing off its
+//     progress line, and writes its record if -m was given. It is
+//     called (by on_exit(), or by main()) once the download is over,
+//     and does nothing after the first time.
+// inputs
+//     status
+//         How the program is ending: 0 or one of the ERR_ codes.
+//     arg
+//         Not used.
+// ----------------------------------------------------------------------
+void finish_metrics(int status, void *arg)
+{
+        (void)arg;
+        if (Metrics.total_ms != METRICS_UNSET) {
+                return;
+        }
+        metrics_done(&Metrics, Metrics.status, status, Metrics.body_bytes);
+        if (Records != NULL) {
+                metrics_json(&Metrics, Records);
+        }
+}
+
+
+
+// ----------------------------------------------------------------------
+// function
+//     open_records
 // description
-//     Given an initial response from a web server, this function
-//     verifies that it is a valid response with the start of the
-//     requested file, and then returns the number of bytes in the
-//     input that belong to the header (such that the remainder of the
-//     input contains file data). It also verifies that the input
-//     data is from a text file. If an error condition is detected, or
-//     the buffer does not contain the expected format, then this
-//     function will not return to the caller because it will terminate
-//     the program.
+//     Opens the file for -m, to be added to. If it can not be opened
+//     the program ends.
 // inputs
-//     buffer
-//         A buffer with the inital response from a web server
-//     count
-//         The number of bytes in the buffer that were returned by the
-//         server.
-// outputs
-//     hdr_size
-//         The number of bytes in the input buffer that belong to
-//         the HTTP header.
-//     istext
-//         A boolean value indicating whether the data from the requested
-//         file is text-based (true) or not (false).
+//     name
+//         The file, or "-" for the standard output.
+// returns
+//     The open file.
 // ----------------------------------------------------------------------
-void get_header_info(const char *buffer,
-                     const int count,
-                     int *hdr_size,
-                     bool *istext)
+FILE *open_records(const char *name)
 {
-        char *copy = NULL;
-        char *header_end = NULL;
+        FILE *records;
 
+        if (strcmp(name, STDIN_NAME) == 0) {
+                return stdout;
+        }
+        records = fopen(name, RECORDS_MODE);
+        if (records == NULL) {
+                perror("Unable to open the records file");
+                exit(ERR_FILE);
+        }
+        return records;
+}
+
+
+
+// ----------------------------------------------------------------------
+// function
+//     commit_update
+// description
+//     For --update: the new copy of the file (in Temp_name) has all
+//     arrived and been closed, so it replaces the old one, and the
+//     validators of the response that sent it are kept for next time.
+//     If that fails the program ends.
+// inputs
+//     filename
+//         The local file.
+//     response
+//         The header of the response that sent the new copy.
+// ----------------------------------------------------------------------
+void commit_update(const char *filename,
+                   const struct http_response *response)
+{
+        cache_update(&Cache, response);
+        if (cache_commit(filename, &Cache) != SUCCESS) {
+                perror("Unable to replace the file");
+                exit(ERR_ON_WRITE);
+        }
+        Temp_name[0] = '\0';
+}
+
+
+
+// ----------------------------------------------------------------------
+// function
+//     get_header_info
+// description
+//     Given the parsed header of a response from a web server, this
+//     function verifies that it is a valid response with the start of
+//     the requested file, and that the file is a text file. If an
+//     error condition is detected, then this function will not return
+//     to the caller because it will terminate the program.
+// inputs
+//     response
+//         The header, as parsed by http_parse_header().
+// ----------------------------------------------------------------------
+void get_header_info(const struct http_response *response)
+{
         // Verify "good" input
-        if ((buffer == NULL) || (count <= 0)) {
-                fprintf(stderr, "Bad HTTP header info.\n");
-                exit(ERR_BAD_RESPONSE);
-        } else if ((hdr_size == NULL) || (istext == NULL)) {
+        if (response == NULL) {
                 fprintf(stderr, "Bad output pointer(s).\n");
                 exit(ERR_INTERNAL);
         }
 
 #ifdef DEBUG
-        // print out the buffer to see what the server provided
-        fprintf(stderr, "count=%d\n", count);
-        fprintf(stderr,"\n-------------\n");
-        fprintf(stderr, "%s", buffer);
-        fprintf(stderr,"\n-------------\n");
+        // print out what the server provided
+        fprintf(stderr, "status=%d reason=%s\n", response->status, response->reason);
+        fprintf(stderr, "content_length=%lld chunked=%d header_size=%zu\n",
+                response->content_length, response->chunked,
+                response->header_size);
 #endif
-        // Make a copy of the buffer
-        copy = strdup(buffer);
-        if (copy == NULL) {
-                fprintf(stderr, "Unexpected strdup error\n");
-                exit(ERR_INTERNAL);
-        }
-
-        // Look for the end of the header
-        header_end = strstr(copy, HEADER_END);
-        if (header_end == NULL) {
-                free(copy);
-                fprintf(stderr, "Invalid HTTP header\n");
-                exit(ERR_BAD_RESPONSE);
-        }
-
-        // mark the end of header as the end of the string
-        *header_end = '\0';
 
         // Look for some known codes
-        if (strstr(copy, "404 Not Found")!=NULL) {
-                free(copy);
+        if (response->status == HTTP_NOT_FOUND) {
                 fprintf(stderr, "File not found on server\n");
                 exit(ERR_NOT_FOUND);
-        } else if (strstr(copy, "400 Bad Request")!=NULL) {
-                free(copy);
+        } else if (response->status == HTTP_BAD_REQUEST) {
                 fprintf(stderr, "Server said 'bad request'\n");
                 exit(ERR_BAD_REQUEST);
-        } else if (strstr(copy, "200 OK")!=NULL) {
+        } else if (response->status == HTTP_OK) {
                 // File found
-                *hdr_size = strlen(copy) + strlen(HEADER_END);
-                if (strstr(copy, "Content-Type: text")!=NULL) {
-                        *istext = true;
-                } else {
-                        *istext = false;
+                if (!response->is_text) {
+                        fprintf(stderr,"Error: The file type is not text\n");
+                        exit(ERR_UNSUPPORTED);
+                }
+                if (response->content_encoding == HTTP_ENCODING_OTHER) {
+                        fprintf(stderr,"Error: Unsupported content encoding\n");
+                        exit(ERR_UNSUPPORTED);
                 }
         } else {
-                free(copy);
                 fprintf(stderr, "Unsupported header code\n");
                 exit(ERR_BAD_RESPONSE);
         }
+}
+
+
 
-        if (copy != NULL) {
-                free(copy);
+// ----------------------------------------------------------------------
+// function
+//     download_ranged
+// description
+//     Tries to download the file over several connections at once.
+//     A HEAD request is checked like any other response (so a missing
+//     file still ends the program here), and the file is only split if
+//     the server accepts byte ranges and is big enough for more than
+//     one piece. If the server sends the whole file in answer to a
+//     range (as it does when the file has changed since the HEAD), the
+//     ranges are given up on. A range from another version of the file
+//     (one whose server ignores If-Range) ends the program, as does any
+//     other failure, so pieces of two versions are never kept.
+// inputs
+//     dns, host, path
+//         Where the file is.
+//     filename
+//         The local file to create.
+//     jobs
+//         The most connections to use.
+// returns
+//     true if the file was downloaded; false if it should be fetched
+//     with a single GET instead.
+// ----------------------------------------------------------------------
+bool download_ranged(const struct dns_result *dns, const char *host,
+                     const char *path, const char *filename, int jobs)
+{
+        struct http_response response;
+        double started;
+        bool cached;
+        int result;
+
+        result = ranged_probe(dns, host, path, &response);
+        if ((result != SUCCESS) ||
+            ((response.status != HTTP_OK) &&
+             (response.status != HTTP_NOT_FOUND) &&
+             (response.status != HTTP_BAD_REQUEST))) {
+                // some servers do not do HEAD; GET will tell us more
+                return false;
+        }
+        get_header_info(&response);
+        if (!response.accept_ranges ||
+            (response.content_length < 2 * RANGED_MIN_PIECE)) {
+                return false;
+        }
+
+        printf("Downloading %lld bytes in ranges\n", response.content_length);
+        Metrics.status = HTTP_PARTIAL_CONTENT;
+        Metrics.expected = response.content_length;
+        result = ranged_download(dns, host, path, Update ? Temp_name : filename,
+                                 &response, jobs, &Metrics);
+        if (result == RANGED_UNSUPPORTED) {
+                printf("Server ignored the ranges; using one connection\n");
+                // the single GET is timed afresh, keeping the lookup
+                started = Metrics.dns_ms;
+                cached = Metrics.dns_cached;
+                metrics_init(&Metrics, host, path, Metrics.progress);
+                Metrics.dns_ms = started;
+                Metrics.dns_cached = cached;
+                return false;
+        }
+        if (result == RANGED_CHANGED) {
+                fprintf(stderr, "The file changed on the server during the download\n");
+                unlink(Update ? Temp_name : filename);
+                exit(ERR_BAD_RESPONSE);
+        }
+        if (result != SUCCESS) {
+                fprintf(stderr, "Ranged download failed (%d)\n", result);
+                unlink(Update ? Temp_name : filename);
+                exit(result);
+        }
+        if (Update) {
+                commit_update(filename, &response);
+        }
+        Metrics.body_bytes = response.content_length;
+        finish_metrics(SUCCESS, NULL);
+        printf("Connection closed\n\n");
+        return true;
+}
+
+
+
+// ----------------------------------------------------------------------
+// function
+//     download_batch
+// description
+//     Downloads every file listed in the file called list_name (or the
+//     standard input, for "-") and prints how it went. A file that can
+//     not be downloaded does not stop the others.
+// inputs
+//     list_name
+//         The list of files.
+//     host
+//         The server for the lines that are just paths.
+//     per_host
+//         The most connections to each host for the engine, or
+//         NO_ENGINE to fetch them one connection at a time.
+//     records
+//         Where to write a record for each download, or NULL.
+//     update
+//         Files that are here already are fetched only if they have
+//         changed (--update).
+// returns
+//     SUCCESS if every file was downloaded, ERR_FILE if the list could
+//     not be opened, or else ERR_NO_DATA.
+// ----------------------------------------------------------------------
+int download_batch(const char *list_name, const char *host, int per_host,
+                   FILE *records, bool update)
+{
+        struct batch_stats stats;
+        struct batch_list files;
+        struct pool pool;
+        FILE *list = stdin;
+        int result;
+
+        if (strcmp(list_name, STDIN_NAME) != 0) {
+                list = fopen(list_name, "r");
+                if (list == NULL) {
+                        perror("Unable to open the list of files");
+                        return ERR_FILE;
+                }
+        }
+
+        memset(&stats, 0, sizeof(stats));
+        stats.records = records;
+        pool_init(&pool);
+        dns_open();
+        result = batch_read_list(list, host, update, &pool, &files, &stats);
+        dns_close();
+        if ((result == SUCCESS) && (per_host == NO_ENGINE)) {
+                batch_download(&files, &pool, &stats);
+        } else if (result == SUCCESS) {
+                result = engine_download(&files, &pool, per_host, &stats);
+        }
+        batch_free_list(&files);
+        pool_close(&pool);
+        if (list != stdin) {
+                fclose(list);
+        }
+        if (result != SUCCESS) {
+                fprintf(stderr, "Batch failed (%d)\n", result);
+        }
+
+        printf("%ld files, %lld bytes, %ld failed", stats.files,
+               stats.bytes, stats.failed);
+        if (update) {
+                printf(", %ld up to date", stats.unchanged);
+        }
+        printf("\n");
+        printf("%ld requests on %ld connections (%ld reused), %ld DNS lookups\n",
+               stats.requests, pool.connects, pool.reuses, pool.lookups);
+        if ((result == SUCCESS) && (stats.failed > 0)) {
+                result = ERR_NO_DATA;
         }
+        return result;
 }
 
 
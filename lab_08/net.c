@@ -0,0 +1,186 @@
+// ----------------------------------------------------------------------
+// file: net.c
+//
+// Description: This file implements the NET module.
+//
+// Created: 2026-10-17
+// ----------------------------------------------------------------------
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include "net.h"
+#include "common.h"
+
+
+
+// Put the addresses of dns in the order they are to be tried: the
+// first family first, then the two families in turn.
+static int interleave(const struct dns_result *dns, int *order)
+{
+        int taken[DNS_MAX_ADDRS] = { 0 };
+        int want = dns->addrs[0].family;
+        int norder = 0;
+        int i;
+
+        while (norder < dns->naddrs) {
+                for (i = 0; i < dns->naddrs; i++) {
+                        if (!taken[i] && (dns->addrs[i].family == want)) {
+                                break;
+                        }
+                }
+                if (i == dns->naddrs) {
+                        // none of that family left: take the next one
+                        i = 0;
+                        while (taken[i]) {
+                                i++;
+                        }
+                }
+                taken[i] = 1;
+                order[norder++] = i;
+                want = (dns->addrs[i].family == AF_INET6) ? AF_INET : AF_INET6;
+        }
+        return norder;
+}
+
+
+
+// Connect to one of the addresses of a host ("happy eyeballs").
+// Returns the socket, or ERR_SOCKET or ERR_CONNECT.
+extern int net_connect(const struct dns_result *dns, int *winner)
+{
+        struct pollfd pending[DNS_MAX_ADDRS];
+        int which[DNS_MAX_ADDRS];          // the address of each pending
+        int order[DNS_MAX_ADDRS];
+        int npending = 0;
+        int norder;
+        int next = 0;
+        int fd = -1;
+        int ready;
+        int result = ERR_CONNECT;
+
+        if (dns->naddrs == 0) {
+                return ERR_CONNECT;
+        }
+        norder = interleave(dns, order);
+
+        while ((fd < 0) && ((next < norder) || (npending > 0))) {
+                // start the next attempt
+                if (next < norder) {
+                        fd = net_connect_start(&dns->addrs[order[next]]);
+                        if (fd >= 0) {
+                                pending[npending].fd = fd;
+                                pending[npending].events = POLLOUT;
+                                which[npending++] = order[next];
+                        } else {
+                                result = fd;
+                        }
+                        fd = -1;
+                        next++;
+                        if (npending == 0) {
+                                // that one failed at once: on to the next
+                                continue;
+                        }
+                }
+
+                // wait for one to finish, or until it is time for another
+                ready = poll(pending, npending,
+                             (next < norder) ? NET_ATTEMPT_DELAY_MS : -1);
+                if ((ready < 0) && (errno != EINTR)) {
+                        break;
+                }
+                for (int i = 0; (ready > 0) && (i < npending); i++) {
+                        if (pending[i].revents == 0) {
+                                continue;
+                        }
+                        if (net_connect_result(pending[i].fd) == SUCCESS) {
+                                fd = pending[i].fd;
+                                if (winner != NULL) {
+                                        *winner = which[i];
+                                }
+                                pending[i] = pending[--npending];
+                                break;
+                        }
+                        // it failed: drop it, and look at the one moved
+                        // into its place
+                        close(pending[i].fd);
+                        result = ERR_CONNECT;
+                        pending[i] = pending[--npending];
+                        which[i] = which[npending];
+                        i--;
+                }
+        }
+
+        // the ones that lost
+        for (int i = 0; i < npending; i++) {
+                close(pending[i].fd);
+        }
+        if (fd < 0) {
+                return result;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+        return fd;
+}
+
+
+
+// Get a non-blocking TCP socket and start connecting it to addr.
+// Returns the socket, or ERR_SOCKET or ERR_CONNECT.
+extern int net_connect_start(const struct dns_addr *addr)
+{
+        int fd;
+
+        fd = socket(addr->family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+                return ERR_SOCKET;
+        }
+        if ((connect(fd, (const struct sockaddr *)&addr->addr, addr->len) != 0) &&
+            (errno != EINPROGRESS)) {
+                close(fd);
+                return ERR_CONNECT;
+        }
+        return fd;
+}
+
+
+
+// Once the socket fd from net_connect_start() is writable, find out
+// whether it connected. Returns SUCCESS or ERR_CONNECT.
+extern int net_connect_result(int fd)
+{
+        int error = 0;
+        socklen_t len = sizeof(error);
+
+        if ((getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len) != 0) ||
+            (error != 0)) {
+                return ERR_CONNECT;
+        }
+        return SUCCESS;
+}
+
+
+
+// Write all len bytes of buf to the socket fd.
+// Returns SUCCESS or ERR_CONNECT.
+extern int net_send_all(int fd, const char *buf, size_t len)
+{
+        size_t done = 0;
+        ssize_t count;
+
+        while (done < len) {
+                // a server that hangs up must not kill us with SIGPIPE
+                count = send(fd, buf + done, len - done, MSG_NOSIGNAL);
+                if (count < 0) {
+                        if (errno == EINTR) {
+                                continue;
+                        }
+                        return ERR_CONNECT;
+                }
+                done += count;
+        }
+        return SUCCESS;
+}
+
+// end of net.c
@@ -0,0 +1,46 @@
+// ----------------------------------------------------------------------
+// file: net.h
+//
+// Description: This is the header file for the NET module. This module
+//     has the small socket helpers that every way of downloading
+//     needs: connecting to an address and sending a whole request.
+//
+// Created: 2026-10-17
+// ----------------------------------------------------------------------
+#ifndef NET_H
+#define NET_H
+
+#include <stddef.h>
+#include "common.h"
+#include "dns.h"
+
+#define NET_ATTEMPT_DELAY_MS 250  // before the next address is tried too
+
+
+// Connect to one of the addresses of a host ("happy eyeballs"). The
+// addresses are tried in getaddrinfo()'s order, but taking the two
+// families in turn; each attempt gets NET_ATTEMPT_DELAY_MS to connect
+// (or fail) before the next is started alongside it, and the first to
+// connect wins. If winner is not NULL it is set to the index of the
+// address that connected. The socket returned is blocking.
+// Returns the socket, or ERR_SOCKET or ERR_CONNECT.
+extern int net_connect(const struct dns_result *dns, int *winner);
+
+
+// Get a non-blocking TCP socket and start connecting it to addr; it
+// becomes writable once the connect is over, one way or the other.
+// Returns the socket, or ERR_SOCKET or ERR_CONNECT.
+extern int net_connect_start(const struct dns_addr *addr);
+
+
+// Once the socket fd from net_connect_start() is writable, find out
+// whether it connected. Returns SUCCESS or ERR_CONNECT.
+extern int net_connect_result(int fd);
+
+
+// Write all len bytes of buf to the socket fd, however many writes it
+// takes. Returns SUCCESS or ERR_CONNECT.
+extern int net_send_all(int fd, const char *buf, size_t len);
+
+#endif
+// end of net.h
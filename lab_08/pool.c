@@ -0,0 +1,145 @@
+// ----------------------------------------------------------------------
+// file: pool.c
+//
+// Description: This file implements the POOL module. There are few
+//     hosts in a batch, so they are kept in a small array and searched
+//     in order.
+//
+// Created: 2026-10-17
+// ----------------------------------------------------------------------
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include "pool.h"
+#include "net.h"
+#include "common.h"
+
+#define MS_PER_S 1000.0
+#define NS_PER_MS 1000000.0
+
+
+
+// Get an empty pool ready.
+extern void pool_init(struct pool *pool)
+{
+        memset(pool, 0, sizeof(*pool));
+}
+
+
+
+// Find the host called name in the pool, looking it up the first time.
+// Returns NULL if it can not be used.
+extern struct pool_host *pool_host(struct pool *pool, const char *name,
+                                   int *result)
+{
+        struct pool_host *host;
+        struct timespec before;
+        struct timespec after;
+
+        for (int i = 0; i < pool->nhosts; i++) {
+                if (!strcasecmp(pool->hosts[i].name, name)) {
+                        return &pool->hosts[i];
+                }
+        }
+        if ((pool->nhosts == POOL_MAX_HOSTS) ||
+            (strlen(name) >= POOL_MAX_HOST_NAME)) {
+                *result = ERR_INTERNAL;
+                return NULL;
+        }
+
+        host = &pool->hosts[pool->nhosts];
+        memset(host, 0, sizeof(*host));
+        clock_gettime(CLOCK_MONOTONIC, &before);
+        if (dns_resolve(name, &host->dns) != SUCCESS) {
+                *result = ERR_DNS;
+                return NULL;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &after);
+        host->dns_ms = (after.tv_sec - before.tv_sec) * MS_PER_S +
+                (after.tv_nsec - before.tv_nsec) / NS_PER_MS;
+        if (!host->dns.cached) {
+                pool->lookups++;
+        }
+        strcpy(host->name, name);
+        host->preferred = 0;
+        pool->nhosts++;
+        return host;
+}
+
+
+
+// Get a connection to host: an idle one if there is one, or else a
+// new one. Returns NULL if there is none.
+extern struct pool_conn *pool_get(struct pool *pool, struct pool_host *host,
+                                  int *result)
+{
+        struct pool_conn *conn;
+        int fd;
+
+        if (host->nidle > 0) {
+                pool->reuses++;
+                return host->idle[--host->nidle];
+        }
+
+        fd = net_connect(&host->dns, &host->preferred);
+        if (fd < 0) {
+                *result = fd;
+                return NULL;
+        }
+        conn = malloc(sizeof(*conn));
+        if (conn == NULL) {
+                close(fd);
+                *result = ERR_INTERNAL;
+                return NULL;
+        }
+        conn->fd = fd;
+        conn->responses = 0;
+        conn->start = 0;
+        conn->end = 0;
+        pool->connects++;
+        return conn;
+}
+
+
+
+// Give back a connection to be used again. Past POOL_MAX_IDLE it is
+// closed instead.
+extern void pool_put(struct pool_host *host, struct pool_conn *conn)
+{
+        if (host->nidle == POOL_MAX_IDLE) {
+                pool_drop(conn);
+                return;
+        }
+        host->idle[host->nidle++] = conn;
+}
+
+
+
+// Close a connection that can not be used again.
+extern void pool_drop(struct pool_conn *conn)
+{
+        close(conn->fd);
+        free(conn);
+}
+
+
+
+// Close every idle connection and forget every host.
+extern void pool_close(struct pool *pool)
+{
+        struct pool_host *host;
+
+        for (int i = 0; i < pool->nhosts; i++) {
+                host = &pool->hosts[i];
+                while (host->nidle > 0) {
+                        pool_drop(host->idle[--host->nidle]);
+                }
+        }
+        pool->nhosts = 0;
+}
+
+// end of pool.c
@@ -0,0 +1,84 @@
+// ----------------------------------------------------------------------
+// file: pool.h
+//
+// Description: This is the header file for the POOL module. This
+//     module keeps the keep-alive connections to each host open
+//     between requests, so that a batch of downloads pays for the DNS
+//     lookup once per host and for the TCP connect once per connection
+//     rather than once per file. Each connection carries its own
+//     receive buffer, since with pipelined requests one read can hold
+//     the end of one response and the start of the next.
+//
+// Created: 2026-10-17
+// ----------------------------------------------------------------------
+#ifndef POOL_H
+#define POOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "common.h"
+#include "dns.h"
+
+#define POOL_MAX_HOSTS 32
+#define POOL_MAX_HOST_NAME 256
+#define POOL_MAX_IDLE 4           // idle connections kept per host
+#define POOL_BUFSIZE (64 * 1024)  // receive buffer per connection
+
+struct pool_conn {
+        int fd;
+        int responses;            // read on it so far
+        size_t start;             // the unread bytes are buf[start..end)
+        size_t end;
+        char buf[POOL_BUFSIZE];
+};
+
+struct pool_host {
+        char name[POOL_MAX_HOST_NAME];
+        struct dns_result dns;
+        double dns_ms;            // how long the lookup took
+        int preferred;            // the address that last connected
+        struct pool_conn *idle[POOL_MAX_IDLE];
+        int nidle;
+};
+
+struct pool {
+        struct pool_host hosts[POOL_MAX_HOSTS];
+        int nhosts;
+        long lookups;             // DNS lookups done (not from the cache)
+        long connects;            // connections opened
+        long reuses;              // times an idle connection was used again
+};
+
+
+// Get an empty pool ready.
+extern void pool_init(struct pool *pool);
+
+
+// Find the host called name in the pool, looking it up the first time.
+// Returns NULL (with *result set to ERR_DNS, or ERR_INTERNAL if the
+// pool is full) if it can not be used.
+extern struct pool_host *pool_host(struct pool *pool, const char *name,
+                                   int *result);
+
+
+// Get a connection to host: an idle one if there is one, or else a
+// new one. Returns NULL (with *result set to ERR_SOCKET, ERR_CONNECT or
+// ERR_INTERNAL) if there is none.
+extern struct pool_conn *pool_get(struct pool *pool, struct pool_host *host,
+                                  int *result);
+
+
+// Give back a connection with nothing left to read on it, to be used
+// again.
+extern void pool_put(struct pool_host *host, struct pool_conn *conn);
+
+
+// Close a connection that can not be used again.
+extern void pool_drop(struct pool_conn *conn);
+
+
+// Close every idle connection and forget every host.
+extern void pool_close(struct pool *pool);
+
+#endif
+// end of pool.h
@@ -0,0 +1,325 @@
+// ----------------------------------------------------------------------
+// file: ranged.c
+//
+// Description: This file implements the RANGED module. Each range gets
+//     its own thread and its own blocking connection, so a slow range
+//     only holds up itself. Every thread writes with pwrite() at its
+//     own offsets, so no locking is needed around the file.
+//
+// Created: 2026-10-17
+// ----------------------------------------------------------------------
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include "ranged.h"
+#include "http.h"
+#include "net.h"
+#include "metrics.h"
+#include "common.h"
+
+#define FILE_MODE 0666      // before the umask
+#define RANGE_HEADER "Range: bytes=%lld-%lld\r\n"
+#define MAX_RANGE_HEADER 64
+#define IF_RANGE_HEADER "If-Range: %s\r\n"
+#define MAX_IF_RANGE_HEADER (HTTP_MAX_VALUE + 16)
+#define WEAK_ETAG "W/"      // can not be used with If-Range
+
+// What the ranges share.
+struct range_shared {
+        pthread_mutex_t lock;     // for metrics
+        struct metrics *metrics;  // or NULL
+        const struct http_response *probe;
+        char if_range[MAX_IF_RANGE_HEADER];  // the If-Range line, or ""
+};
+
+// One range, and how it went.
+struct range_job {
+        struct range_shared *shared;
+        const struct dns_result *dns;
+        const char *host;
+        const char *path;
+        int fd;                    // the output file
+        long long first;           // the bytes first..last, inclusive
+        long long last;
+        int result;
+};
+
+
+
+// Write all len bytes of buf to fd at offset.
+static int pwrite_all(int fd, const char *buf, size_t len, long long offset)
+{
+        ssize_t count;
+
+        while (len > 0) {
+                count = pwrite(fd, buf, len, offset);
+                if ((count < 0) && (errno == EINTR)) {
+                        continue;
+                }
+                if (count <= 0) {
+                        return ERR_ON_WRITE;
+                }
+                buf += count;
+                len -= count;
+                offset += count;
+        }
+        return SUCCESS;
+}
+
+
+
+// Count a read of count bytes of the body in the shared metrics.
+static void count_read(struct range_shared *shared, long long count)
+{
+        if ((shared->metrics == NULL) || (count <= 0)) {
+                return;
+        }
+        pthread_mutex_lock(&shared->lock);
+        metrics_read(shared->metrics, count);
+        pthread_mutex_unlock(&shared->lock);
+}
+
+
+
+// Fetch one range into its place in the file.
+static int fetch_range(struct range_job *job, char *buf)
+{
+        const struct http_response *probe = job->shared->probe;
+        struct http_response response;
+        char request[HTTP_MAX_REQUEST];
+        char range[MAX_RANGE_HEADER + MAX_IF_RANGE_HEADER];
+        long long offset = job->first;
+        size_t body_start;
+        size_t body_len;
+        ssize_t count;
+        int sock;
+        int len;
+        int result;
+
+        snprintf(range, sizeof(range), RANGE_HEADER "%s", job->first, job->last,
+                 job->shared->if_range);
+        len = http_build_request(request, sizeof(request), "GET",
+                                 job->host, job->path, range, false);
+        if (len < 0) {
+                return len;
+        }
+        sock = net_connect(job->dns, NULL);
+        if (sock < 0) {
+                return sock;
+        }
+
+        result = net_send_all(sock, request, len);
+        if (result == SUCCESS) {
+                result = http_read_header(sock, buf, RANGED_BUFSIZE, &response,
+                                          &body_start, &body_len);
+        }
+        if (result == SUCCESS) {
+                if (response.status == HTTP_OK) {
+                        // the whole file: the server does not do ranges,
+                        // or the file is not the one probed (If-Range)
+                        result = RANGED_UNSUPPORTED;
+                } else if ((response.status != HTTP_PARTIAL_CONTENT) ||
+                           (response.range_first != job->first) ||
+                           (response.range_last != job->last)) {
+                        result = ERR_BAD_RESPONSE;
+                } else if ((response.range_total != probe->content_length) ||
+                           ((probe->etag[0] != '\0') && (response.etag[0] != '\0') &&
+                            strcmp(response.etag, probe->etag))) {
+                        // a server that ignores If-Range sent a piece
+                        // of another version
+                        result = RANGED_CHANGED;
+                }
+        }
+
+        // the body is exactly the range; anything more is ignored
+        count = body_len;
+        if (result == SUCCESS) {
+                count_read(job->shared, count);
+        }
+        while ((result == SUCCESS) && (offset <= job->last)) {
+                if (count > job->last + 1 - offset) {
+                        count = job->last + 1 - offset;
+                }
+                result = pwrite_all(job->fd, buf + body_start, count, offset);
+                offset += count;
+                if ((result != SUCCESS) || (offset > job->last)) {
+                        break;
+                }
+                body_start = 0;
+                count = read(sock, buf, RANGED_BUFSIZE);
+                if ((count < 0) && (errno == EINTR)) {
+                        count = 0;
+                } else if (count <= 0) {
+                        // closed, or failed, before the range was all there
+                        result = ERR_NO_DATA;
+                }
+                count_read(job->shared, count);
+        }
+
+        close(sock);
+        return result;
+}
+
+
+
+// Thread body: fetch one range.
+static void *range_main(void *arg)
+{
+        struct range_job *job = arg;
+        char *buf = malloc(RANGED_BUFSIZE);
+
+        if (buf == NULL) {
+                job->result = ERR_INTERNAL;
+                return NULL;
+        }
+        job->result = fetch_range(job, buf);
+        free(buf);
+        return NULL;
+}
+
+
+
+// Ask the server at dns about /path on host with a HEAD request.
+// Returns SUCCESS, or ERR_SOCKET, ERR_CONNECT, ERR_NO_DATA or
+// ERR_BAD_RESPONSE.
+extern int ranged_probe(const struct dns_result *dns, const char *host,
+                        const char *path, struct http_response *response)
+{
+        char request[HTTP_MAX_REQUEST];
+        char buf[MAXBUF];
+        size_t body_start;
+        size_t body_len;
+        int sock;
+        int len;
+        int result;
+
+        len = http_build_request(request, sizeof(request), "HEAD",
+                                 host, path, NULL, false);
+        if (len < 0) {
+                return len;
+        }
+        sock = net_connect(dns, NULL);
+        if (sock < 0) {
+                return sock;
+        }
+        result = net_send_all(sock, request, len);
+        if (result == SUCCESS) {
+                result = http_read_header(sock, buf, sizeof(buf), response,
+                                          &body_start, &body_len);
+        }
+        close(sock);
+        return result;
+}
+
+
+
+// Download the file probe describes, /path on host, into filename
+// using up to njobs connections. Returns SUCCESS, RANGED_UNSUPPORTED,
+// RANGED_CHANGED, or one of the ERR_ codes.
+extern int ranged_download(const struct dns_result *dns, const char *host,
+                           const char *path, const char *filename,
+                           const struct http_response *probe, int njobs,
+                           struct metrics *metrics)
+{
+        struct range_shared shared = { .metrics = metrics, .probe = probe };
+        long long length = probe->content_length;
+        struct range_job *jobs;
+        pthread_t *threads;
+        long long piece;
+        int started = 0;
+        int result = SUCCESS;
+        int fd;
+
+        // no more ranges than there are RANGED_MIN_PIECE pieces
+        if (njobs > length / RANGED_MIN_PIECE) {
+                njobs = length / RANGED_MIN_PIECE;
+        }
+        if (njobs < 1) {
+                njobs = 1;
+        }
+        piece = (length + njobs - 1) / njobs;
+
+        // a strong ETag names one version exactly; a date is the next
+        // best thing
+        if ((probe->etag[0] != '\0') &&
+            strncmp(probe->etag, WEAK_ETAG, strlen(WEAK_ETAG))) {
+                snprintf(shared.if_range, sizeof(shared.if_range), IF_RANGE_HEADER,
+                         probe->etag);
+        } else if (probe->last_modified[0] != '\0') {
+                snprintf(shared.if_range, sizeof(shared.if_range), IF_RANGE_HEADER,
+                         probe->last_modified);
+        }
+
+        fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, FILE_MODE);
+        if (fd < 0) {
+                return ERR_FILE;
+        }
+        // the space is reserved up front, so the ranges do not
+        // fragment the file as they fill it in
+        if ((length > 0) && (fallocate(fd, 0, 0, length) != 0) &&
+            (ftruncate(fd, length) != 0)) {
+                close(fd);
+                return ERR_ON_WRITE;
+        }
+
+        jobs = calloc(njobs, sizeof(*jobs));
+        threads = calloc(njobs, sizeof(*threads));
+        if ((jobs == NULL) || (threads == NULL)) {
+                free(jobs);
+                free(threads);
+                close(fd);
+                return ERR_INTERNAL;
+        }
+
+        pthread_mutex_init(&shared.lock, NULL);
+        if (metrics != NULL) {
+                metrics_sent(metrics);
+        }
+        for (int i = 0; (i < njobs) && (i * piece < length); i++) {
+                jobs[i].shared = &shared;
+                jobs[i].dns = dns;
+                jobs[i].host = host;
+                jobs[i].path = path;
+                jobs[i].fd = fd;
+                jobs[i].first = i * piece;
+                jobs[i].last = jobs[i].first + piece - 1;
+                if (jobs[i].last >= length) {
+                        jobs[i].last = length - 1;
+                }
+                if (pthread_create(&threads[i], NULL, range_main, &jobs[i]) != 0) {
+                        result = ERR_INTERNAL;
+                        break;
+                }
+                started++;
+        }
+        for (int i = 0; i < started; i++) {
+                pthread_join(threads[i], NULL);
+                // a range sent whole means none of it can be trusted
+                if (jobs[i].result == RANGED_UNSUPPORTED) {
+                        result = RANGED_UNSUPPORTED;
+                } else if ((jobs[i].result != SUCCESS) && (result == SUCCESS)) {
+                        result = jobs[i].result;
+                }
+        }
+
+        free(jobs);
+        free(threads);
+        pthread_mutex_destroy(&shared.lock);
+        if ((close(fd) != 0) && (result == SUCCESS)) {
+                result = ERR_ON_WRITE;
+        }
+        // the caller falls back to one GET, which may fail before it
+        // makes the file again; a file of zeros must not be left
+        if (result == RANGED_UNSUPPORTED) {
+                unlink(filename);
+        }
+        return result;
+}
+
+// end of ranged.c
@@ -0,0 +1,52 @@
+// ----------------------------------------------------------------------
+// file: ranged.h
+//
+// Description: This is the header file for the RANGED module. This
+//     module downloads a large file over several connections at once,
+//     each asking for its own byte range with an HTTP Range request
+//     and writing it straight into its place in the output file.
+//
+// Created: 2026-10-17
+// ----------------------------------------------------------------------
+#ifndef RANGED_H
+#define RANGED_H
+
+#include "dns.h"
+#include "common.h"
+#include "http.h"
+#include "metrics.h"
+
+#define RANGED_MIN_PIECE (256 * 1024)   // no range is smaller than this
+#define RANGED_BUFSIZE (64 * 1024)      // per connection
+#define RANGED_UNSUPPORTED 1            // the server ignored a Range
+#define RANGED_CHANGED 2                // the file changed part way
+
+
+// Ask the server at dns about /path on host with a HEAD request, to
+// find out its size and whether it can be sent in ranges.
+// Returns SUCCESS, or ERR_SOCKET, ERR_CONNECT, ERR_NO_DATA or
+// ERR_BAD_RESPONSE.
+extern int ranged_probe(const struct dns_result *dns, const char *host,
+                        const char *path, struct http_response *response);
+
+
+// Download /path on host into filename using up to njobs connections,
+// each for its own range of at least RANGED_MIN_PIECE bytes. probe is
+// the answer to ranged_probe(): the file is its Content-Length bytes,
+// and each range is asked for with If-Range, so that a file changed
+// since the probe comes back whole instead of in pieces of two
+// versions. The file is created (or emptied) and allocated at its
+// full size first. Returns SUCCESS, RANGED_UNSUPPORTED if the server
+// answered a range with the whole file (the file should then be
+// fetched the ordinary way; filename is removed), RANGED_CHANGED if a
+// range came from another version of the file (a different ETag or
+// size), or one of the ERR_ codes. The reads of every range are
+// counted together in metrics (only the bodies, not the headers),
+// unless it is NULL.
+extern int ranged_download(const struct dns_result *dns, const char *host,
+                           const char *path, const char *filename,
+                           const struct http_response *probe, int njobs,
+                           struct metrics *metrics);
+
+#endif
+// end of ranged.h
@@ -0,0 +1,347 @@
+// ----------------------------------------------------------------------
+// file: test.c
+//
+// Description: This is a program to test the HTTP and CACHE modules of
+//     mywget. The parsers are fed their input whole and then cut at
+//     every place, since a socket can hand it over in any pieces. Each
+//     check prints a "-Good:" or a "-Bad:" line; the program exits with
+//     a non-zero value if any of them was bad. It works in a directory
+//     of its own under /tmp.
+//
+// Created: 2026-10-17
+//
+// ----------------------------------------------------------------------
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "http.h"
+#include "cache.h"
+#include "common.h"
+
+#define TEST_DIR_TEMPLATE "/tmp/mywget-test.XXXXXX"
+#define MAX_NAME 256
+#define MAX_BODY 1024
+
+#define RESPONSE "HTTP/1.1 206 Partial Content\r\n" \
+                 "Content-Type: text/plain; charset=utf-8\r\n" \
+                 "content-length: 100\r\n" \
+                 "Content-Range: bytes 100-199/1000\r\n" \
+                 "Accept-Ranges: bytes\r\n" \
+                 "ETag: \"abc\"\r\n" \
+                 "Last-Modified: Sat, 17 Oct 2026 10:00:00 GMT\r\n" \
+                 "Content-Encoding: gzip\r\n" \
+                 "X-Long: " \
+                 "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx" \
+                 "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx" \
+                 "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx" \
+                 "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx\r\n" \
+                 "\r\n"
+#define BODY_START "body"
+
+// chunk extensions, a chunk split over the pieces, a trailer, and the
+// start of the next response after it
+#define CHUNKED "5;name=value\r\nhello\r\n" \
+                "1a\r\n, and the rest of it, too.\r\n" \
+                "0\r\nX-Trailer: yes\r\n\r\n"
+#define CHUNKED_DATA "hello, and the rest of it, too."
+#define NEXT_RESPONSE "HTTP/1.1"
+
+unsigned int Num_bad = 0;
+char Test_dir[] = TEST_DIR_TEMPLATE;
+
+
+
+// Print the result of one check.
+void check(int good, const char *what)
+{
+        if (good) {
+                printf("-Good: %s\n", what);
+        } else {
+                printf("-Bad: %s\n", what);
+                ++Num_bad;
+        }
+}
+
+
+
+// Parse text into response, cut after the first cut bytes (0 for not
+// cut). Returns what the last call to http_parse_header() did; *used
+// is the header bytes of the whole text.
+int parse(const char *text, size_t cut, struct http_response *response,
+          size_t *used)
+{
+        size_t len = strlen(text);
+        size_t first = 0;
+        int result = HTTP_MORE;
+
+        http_response_init(response);
+        if ((cut > 0) && (cut < len)) {
+                result = http_parse_header(response, text, cut, &first);
+                if (result != HTTP_MORE) {
+                        *used = first;
+                        return result;
+                }
+        } else {
+                cut = 0;
+        }
+        result = http_parse_header(response, text + cut, len - cut, used);
+        *used += first;
+        return result;
+}
+
+
+
+// Is response what RESPONSE says?
+int is_response(const struct http_response *r)
+{
+        return (r->version_minor == 1) && (r->status == HTTP_PARTIAL_CONTENT) &&
+               !strcmp(r->reason, "Partial Content") && (r->content_length == 100) &&
+               !r->chunked && (r->content_encoding == HTTP_ENCODING_GZIP) &&
+               r->is_text && r->keep_alive && r->accept_ranges &&
+               (r->range_first == 100) && (r->range_last == 199) &&
+               (r->range_total == 1000) && !strcmp(r->etag, "\"abc\"") &&
+               !strcmp(r->last_modified, "Sat, 17 Oct 2026 10:00:00 GMT") &&
+               (r->header_size == strlen(RESPONSE));
+}
+
+
+
+void test_header(void)
+{
+        struct http_response r;
+        size_t used;
+        bool good = true;
+
+        check((parse(RESPONSE BODY_START, 0, &r, &used) == HTTP_DONE) &&
+              is_response(&r) && (used == strlen(RESPONSE)),
+              "header: parsed whole, and the body is not taken");
+        for (size_t cut = 1; cut < strlen(RESPONSE); cut++) {
+                good = good && (parse(RESPONSE BODY_START, cut, &r, &used) == HTTP_DONE) &&
+                       is_response(&r) && (used == strlen(RESPONSE));
+        }
+        check(good, "header: parsed the same however it is cut");
+
+        check((parse("HTTP/1.1 200 OK\r\nContent-Type: image/png\r\n", 0, &r, &used) ==
+               HTTP_MORE) && (used == strlen("HTTP/1.1 200 OK\r\nContent-Type: image/png\r\n")),
+              "header: more is wanted until the blank line");
+        check((parse("HTTP/1.0 200 OK\n\n", 0, &r, &used) == HTTP_DONE) &&
+              !r.keep_alive && !r.is_text && (r.content_length == HTTP_UNKNOWN_LENGTH),
+              "header: HTTP/1.0 closes, and bare newlines end lines");
+        check((parse("HTTP/1.1 200 OK\r\nConnection: close\r\n"
+                     "Transfer-Encoding: gzip, chunked\r\n\r\n", 0, &r, &used) == HTTP_DONE) &&
+              !r.keep_alive && r.chunked,
+              "header: Connection: close, and chunked last in Transfer-Encoding");
+        check((parse("HTTP/1.1 206 Partial Content\r\n"
+                     "Content-Range: bytes 0-9/*\r\n\r\n", 0, &r, &used) == HTTP_DONE) &&
+              (r.range_first == 0) && (r.range_last == 9) &&
+              (r.range_total == HTTP_UNKNOWN_LENGTH),
+              "header: a Content-Range with no total");
+        check(parse("SMTP ready\r\n\r\n", 0, &r, &used) == ERR_BAD_RESPONSE,
+              "header: a bad status line is refused");
+}
+
+
+
+// Dechunk CHUNKED NEXT_RESPONSE cut after the first cut bytes (0 for
+// not cut) into data. Returns true if it is all there, and the next
+// response is left.
+bool dechunk(size_t cut, char *data)
+{
+        char buf[MAX_BODY];
+        struct http_chunked chunked;
+        size_t len = strlen(CHUNKED NEXT_RESPONSE);
+        size_t data_len = 0;
+        size_t used;
+        size_t out_len;
+        size_t first = 0;
+        int result = HTTP_MORE;
+
+        strcpy(buf, CHUNKED NEXT_RESPONSE);
+        http_chunked_init(&chunked);
+        if ((cut > 0) && (cut < len)) {
+                result = http_dechunk(&chunked, buf, cut, &first, &out_len);
+                memcpy(data, buf, out_len);
+                data_len = out_len;
+        }
+        if (result == HTTP_MORE) {
+                result = http_dechunk(&chunked, buf + first, len - first, &used, &out_len);
+                memcpy(data + data_len, buf + first, out_len);
+                data_len += out_len;
+                used += first;
+        } else {
+                used = first;
+        }
+        data[data_len] = '\0';
+        return (result == HTTP_DONE) && (used == strlen(CHUNKED)) &&
+               !strcmp(data, CHUNKED_DATA) &&
+               !memcmp(buf + used, NEXT_RESPONSE, strlen(NEXT_RESPONSE));
+}
+
+
+
+void test_chunked(void)
+{
+        struct http_chunked chunked;
+        char data[MAX_BODY];
+        char bad[] = "5\r\nhello\r\nzz\r\n";
+        size_t used;
+        size_t out_len;
+        bool good = true;
+
+        check(dechunk(0, data), "chunked: decoded whole, up to the next response");
+        for (size_t cut = 1; cut < strlen(CHUNKED); cut++) {
+                good = good && dechunk(cut, data);
+        }
+        check(good, "chunked: decoded the same however it is cut");
+
+        http_chunked_init(&chunked);
+        check(http_dechunk(&chunked, bad, strlen(bad), &used, &out_len) == ERR_BAD_RESPONSE,
+              "chunked: a bad chunk size is refused");
+}
+
+
+
+void test_body(void)
+{
+        struct http_response r;
+        struct http_body body;
+        char buf[MAX_BODY];
+        size_t used;
+        size_t out_len;
+
+        http_response_init(&r);
+        r.status = HTTP_OK;
+        r.content_length = 4;
+        http_body_init(&body, &r);
+        strcpy(buf, "abcdHTTP");
+        check((body.framing == HTTP_BODY_LENGTH) &&
+              (http_body_decode(&body, buf, 2, &used, &out_len) == HTTP_MORE) &&
+              (used == 2) &&
+              (http_body_decode(&body, buf + 2, 6, &used, &out_len) == HTTP_DONE) &&
+              (used == 2) && (out_len == 2),
+              "body: a Content-Length body ends after that many bytes");
+
+        r.status = HTTP_NOT_MODIFIED;
+        http_body_init(&body, &r);
+        check((body.framing == HTTP_BODY_NONE) &&
+              (http_body_decode(&body, buf, 8, &used, &out_len) == HTTP_DONE) &&
+              (used == 0),
+              "body: a 304 has none, whatever it says");
+
+        r.status = HTTP_OK;
+        r.content_length = HTTP_UNKNOWN_LENGTH;
+        http_body_init(&body, &r);
+        check((body.framing == HTTP_BODY_TO_CLOSE) &&
+              (http_body_decode(&body, buf, 8, &used, &out_len) == HTTP_MORE) &&
+              (used == 8),
+              "body: with no length it goes on until the connection closes");
+
+        r.chunked = true;
+        http_body_init(&body, &r);
+        check(body.framing == HTTP_BODY_CHUNKED, "body: chunked beats no length");
+}
+
+
+
+void test_request(void)
+{
+        char buf[HTTP_MAX_REQUEST];
+        char path[HTTP_MAX_REQUEST];
+        int len;
+
+        len = http_build_request(buf, sizeof(buf), "GET", "example.com", "a/b.html",
+                                 "Range: bytes=0-9\r\n", true);
+        check((len == (int)strlen(buf)) && !strncmp(buf, "GET /a/b.html HTTP/1.1\r\n", 24) &&
+              (strstr(buf, "\r\nHost: example.com\r\n") != NULL) &&
+              (strstr(buf, "\r\nRange: bytes=0-9\r\n") != NULL) &&
+              (strstr(buf, "\r\nConnection: keep-alive\r\n\r\n") != NULL),
+              "request: the method, path, host, extra lines and keep-alive");
+        len = http_build_request(buf, sizeof(buf), "HEAD", "example.com", "", NULL, false);
+        check((len > 0) && !strncmp(buf, "HEAD / HTTP/1.1\r\n", 17) &&
+              (strstr(buf, "\r\nConnection: Close\r\n\r\n") != NULL),
+              "request: no extra lines, and Connection: Close");
+
+        memset(path, 'x', sizeof(path) - 1);
+        path[sizeof(path) - 1] = '\0';
+        check(http_build_request(buf, sizeof(buf), "GET", "example.com", path, NULL, true) ==
+              ERR_INTERNAL, "request: one too long is refused");
+}
+
+
+
+// The validators are kept beside the file, and only with it.
+void test_cache(void)
+{
+        struct cache_entry entry;
+        struct cache_entry loaded;
+        struct http_response r;
+        char temp[CACHE_MAX_NAME];
+        char conditions[CACHE_MAX_CONDITIONS];
+        size_t used;
+        FILE *file;
+
+        check(!cache_load("page.html", &loaded) && (loaded.etag[0] == '\0'),
+              "cache: nothing is known of a file that is not there");
+
+        parse(RESPONSE, 0, &r, &used);
+        cache_update(&entry, &r);
+        check((cache_temp_name("page.html", temp, sizeof(temp)) == SUCCESS) &&
+              ((file = fopen(temp, "w")) != NULL) && (fclose(file) == 0) &&
+              (cache_commit("page.html", &entry) == SUCCESS) &&
+              (access("page.html", F_OK) == 0) && (access(temp, F_OK) != 0),
+              "cache: the new copy is renamed over the old one");
+        check(cache_load("page.html", &loaded) && !strcmp(loaded.etag, "\"abc\"") &&
+              !strcmp(loaded.last_modified, r.last_modified),
+              "cache: the validators are kept beside the file");
+        check((cache_conditions(&loaded, conditions, sizeof(conditions)) ==
+               (int)strlen(conditions)) &&
+              !strcmp(conditions, "If-None-Match: \"abc\"\r\n"
+                                  "If-Modified-Since: Sat, 17 Oct 2026 10:00:00 GMT\r\n"),
+              "cache: they become If-None-Match and If-Modified-Since");
+        check(cache_conditions(&loaded, conditions, 10) == ERR_INTERNAL,
+              "cache: conditions that do not fit are refused");
+
+        memset(&entry, 0, sizeof(entry));
+        check(((file = fopen(temp, "w")) != NULL) && (fclose(file) == 0) &&
+              (cache_commit("page.html", &entry) == SUCCESS) &&
+              !cache_load("page.html", &loaded),
+              "cache: a copy with no validators forgets the old ones");
+
+        parse(RESPONSE, 0, &r, &used);
+        cache_update(&entry, &r);
+        if ((file = fopen(temp, "w")) != NULL) {
+                fclose(file);
+        }
+        cache_commit("page.html", &entry);
+        unlink("page.html");
+        check(!cache_load("page.html", &loaded),
+              "cache: validators without their file are not used");
+}
+
+
+
+int main(int argc, const char *argv[])
+{
+        char command[MAX_NAME];
+
+        if ((mkdtemp(Test_dir) == NULL) || (chdir(Test_dir) != 0)) {
+                printf("-Bad: no test directory\n");
+                return 1;
+        }
+
+        test_header();
+        test_chunked();
+        test_body();
+        test_request();
+        test_cache();
+
+        snprintf(command, sizeof(command), "rm -rf %s", Test_dir);
+        system(command);
+        printf("--------------------------------\n");
+        printf("%u bad\n", Num_bad);
+        return (Num_bad == 0) ? 0 : 1;
+}
+
+// end of test.c
@@ -0,0 +1,593 @@
+// ----------------------------------------------------------------------
+// File: testserver.c
+// ----------------------------------------------------------------------
+// Description:
+//              A small HTTP/1.1 server to test and benchmark mywget
+//              against, without the internet. It has no files: the
+//              last part of the path is a size, and the file it names
+//              is that many bytes of text, the same 64-byte line over
+//              and over (so any range of it can be checked):
+//
+//                  /1M.txt   /100.txt   /64K   /2G.txt
+//
+//              (K, M and G are powers of 1024.) The directories
+//              before it ask for the response to misbehave, and can be
+//              combined, e.g. /chunked/drip/split/1M.txt:
+//
+//                  chunked   send the body with chunked encoding
+//                  drip      send the body DRIP_BYTES at a time, with
+//                            a pause (-d) between
+//                  split     send the header a few bytes at a time
+//                  norange   ignore Range (and do not advertise it)
+//                  changing  give the file a new ETag every time, as if
+//                            it changed between requests
+//                  404, 400  answer with that status instead
+//
+//              Otherwise a Range: bytes=first-last request gets a 206
+//              (or the whole file, if it has an If-Range that matches
+//              neither the ETag nor the Last-Modified of the file), and
+//              a request with If-None-Match (or If-Modified-Since)
+//              matching the ETag (or Last-Modified) of the file gets a
+//              304.
+//              Connections are kept open (HTTP/1.1, or HTTP/1.0 with
+//              Connection: keep-alive), and pipelined requests are
+//              answered in turn. HEAD is answered without the body.
+//              Each connection has its own thread.
+//
+// Usage:
+//              ./testserver [-a address] [-p port] [-d ms]
+//
+//              -a address  the IPv4 address to listen on [127.0.0.1]
+//              -p port     [80, which is the only port mywget uses]
+//              -d ms       the pause between pieces of a drip [100]
+//
+// Created: 2026-10-17
+// ----------------------------------------------------------------------
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "common.h"
+
+#define DEFAULT_ADDRESS "127.0.0.1"
+#define DEFAULT_PORT 80
+#define DEFAULT_DRIP_MS 100
+#define DRIP_BYTES 512
+#define SPLIT_BYTES 7             // of the header at a time
+#define SPLIT_PAUSE_US 1000       // between them
+#define BACKLOG 1024
+#define MAX_REQUEST 8192          // a longer request gets a 400
+#define MAX_HEADER 512            // of a response
+#define LINE "The quick brown fox jumps over the lazy dog. 0123456789abcdefgh\n"
+#define LINE_LEN 64
+#define PATTERN_SIZE (64 * 1024)  // sent at a time; a multiple of LINE_LEN
+#define CHUNK_HEADER 32           // "<size in hex>\r\n"
+#define NO_RANGE -1
+#define US_PER_MS 1000
+#define MAX_ETAG 64
+#define LAST_MODIFIED "Thu, 01 Jan 2026 00:00:00 GMT"
+
+#define HTTP_OK 200
+#define HTTP_PARTIAL_CONTENT 206
+#define HTTP_NOT_MODIFIED 304
+#define HTTP_BAD_REQUEST 400
+#define HTTP_NOT_FOUND 404
+#define HTTP_RANGE_NOT_SATISFIABLE 416
+
+// What a request asked for.
+struct want {
+        int status;
+        long long size;           // of the file
+        bool chunked;
+        bool drip;
+        bool split;
+        bool norange;
+        bool changing;
+        bool head;                // HEAD: no body
+        bool keep_alive;
+        long long first;          // the Range, or NO_RANGE
+        long long last;
+        char etag[MAX_ETAG];
+};
+
+// Globals
+static char Pattern[PATTERN_SIZE + LINE_LEN];  // the file, from any offset
+static int Drip_ms = DEFAULT_DRIP_MS;
+static unsigned long Versions = 0;   // for the changing ETags
+
+
+
+// Write all len bytes of buf to fd. Returns SUCCESS or ERR_CONNECT.
+static int send_all(int fd, const char *buf, size_t len, int flags)
+{
+        ssize_t count;
+
+        while (len > 0) {
+                count = send(fd, buf, len, flags | MSG_NOSIGNAL);
+                if ((count < 0) && (errno == EINTR)) {
+                        continue;
+                }
+                if (count <= 0) {
+                        return ERR_CONNECT;
+                }
+                buf += count;
+                len -= count;
+        }
+        return SUCCESS;
+}
+
+
+
+// Take a size like "1M.txt" or "100". Returns it, or -1.
+static long long parse_size(const char *name)
+{
+        long long size;
+        char *end;
+
+        errno = SUCCESS;
+        size = strtoll(name, &end, 10);
+        if (errno || (end == name) || (size < 0)) {
+                return -1;
+        }
+        switch (*end) {
+                case 'K':
+                        size <<= 10;
+                        end++;
+                        break;
+                case 'M':
+                        size <<= 20;
+                        end++;
+                        break;
+                case 'G':
+                        size <<= 30;
+                        end++;
+                        break;
+        }
+        // any extension will do
+        return ((*end == '\0') || (*end == '.')) ? size : -1;
+}
+
+
+
+// Work out what path asks for.
+static void parse_path(char *path, struct want *want)
+{
+        char *name;
+        char *next;
+
+        want->status = HTTP_OK;
+        if (*path != '/') {
+                want->status = HTTP_BAD_REQUEST;
+                return;
+        }
+        for (name = path + 1; (next = strchr(name, '/')) != NULL; name = next + 1) {
+                *next = '\0';
+                if (!strcmp(name, "chunked")) {
+                        want->chunked = true;
+                } else if (!strcmp(name, "drip")) {
+                        want->drip = true;
+                } else if (!strcmp(name, "split")) {
+                        want->split = true;
+                } else if (!strcmp(name, "norange")) {
+                        want->norange = true;
+                } else if (!strcmp(name, "changing")) {
+                        want->changing = true;
+                } else if (!strcmp(name, "404")) {
+                        want->status = HTTP_NOT_FOUND;
+                } else if (!strcmp(name, "400")) {
+                        want->status = HTTP_BAD_REQUEST;
+                } else if (*name != '\0') {
+                        want->status = HTTP_NOT_FOUND;
+                }
+        }
+        want->size = parse_size(name);
+        if ((want->size < 0) && (want->status == HTTP_OK)) {
+                want->status = HTTP_NOT_FOUND;
+        }
+}
+
+
+
+// Take a Range header value, "bytes=first-last" or "bytes=first-".
+// A range that is not understood is ignored, as RFC 9110 allows.
+static void parse_range(const char *value, struct want *want)
+{
+        long long first;
+        long long last;
+        char *end;
+
+        if (strncasecmp(value, "bytes=", 6) != 0) {
+                return;
+        }
+        first = strtoll(value + 6, &end, 10);
+        if ((end == value + 6) || (*end != '-') || (first < 0)) {
+                return;
+        }
+        if (end[1] == '\0') {
+                // to the end of the file
+                last = want->size - 1;
+        } else {
+                last = strtoll(end + 1, &end, 10);
+                if ((*end != '\0') || (last < first)) {
+                        return;
+                }
+                if (last >= want->size) {
+                        last = want->size - 1;
+                }
+        }
+        want->first = first;
+        want->last = last;
+}
+
+
+
+// Parse the request in buf (up to the blank line) into want.
+static void parse_request(char *buf, struct want *want)
+{
+        char *line;
+        char *save;
+        char *word;
+        char *method;
+        char *path;
+        char *version;
+        char *value;
+        char *if_none_match = NULL;
+        char *if_modified_since = NULL;
+        char *if_range = NULL;
+
+        memset(want, 0, sizeof(*want));
+        want->first = NO_RANGE;
+        line = strtok_r(buf, "\r\n", &save);
+        method = (line != NULL) ? strtok_r(line, " ", &word) : NULL;
+        path = (method != NULL) ? strtok_r(NULL, " ", &word) : NULL;
+        version = (path != NULL) ? strtok_r(NULL, " ", &word) : NULL;
+        if ((version == NULL) || strncmp(version, "HTTP/1.", 7) ||
+            (strcmp(method, "GET") && strcmp(method, "HEAD"))) {
+                want->status = HTTP_BAD_REQUEST;
+                return;
+        }
+        want->head = !strcmp(method, "HEAD");
+        want->keep_alive = strcmp(version, "HTTP/1.0") != 0;
+        parse_path(path, want);
+        if (want->changing) {
+                snprintf(want->etag, sizeof(want->etag), "\"%llx-%lx\"", want->size,
+                         __sync_fetch_and_add(&Versions, 1));
+        } else {
+                snprintf(want->etag, sizeof(want->etag), "\"%llx\"", want->size);
+        }
+
+        while ((line = strtok_r(NULL, "\r\n", &save)) != NULL) {
+                value = strchr(line, ':');
+                if (value == NULL) {
+                        continue;
+                }
+                *value++ = '\0';
+                value += strspn(value, " \t");
+                if (!strcasecmp(line, "Connection")) {
+                        want->keep_alive = !strcasecmp(value, "keep-alive") ||
+                                (want->keep_alive && strcasecmp(value, "close"));
+                } else if (!strcasecmp(line, "Range") && (want->size >= 0)) {
+                        parse_range(value, want);
+                } else if (!strcasecmp(line, "If-None-Match")) {
+                        if_none_match = value;
+                } else if (!strcasecmp(line, "If-Modified-Since")) {
+                        if_modified_since = value;
+                } else if (!strcasecmp(line, "If-Range")) {
+                        if_range = value;
+                }
+        }
+        // If-Modified-Since only counts without If-None-Match
+        if ((want->status == HTTP_OK) &&
+            ((if_none_match != NULL) ?
+             (!strcmp(if_none_match, want->etag) || !strcmp(if_none_match, "*")) :
+             ((if_modified_since != NULL) && !want->changing &&
+              !strcmp(if_modified_since, LAST_MODIFIED)))) {
+                want->status = HTTP_NOT_MODIFIED;
+                return;
+        }
+        // a Range for another version of the file gets all of this one
+        if (want->norange ||
+            ((if_range != NULL) && strcmp(if_range, want->etag) &&
+             (want->changing || strcmp(if_range, LAST_MODIFIED)))) {
+                want->first = NO_RANGE;
+        }
+        if ((want->status == HTTP_OK) && (want->first != NO_RANGE)) {
+                want->status = (want->first < want->size) ?
+                        HTTP_PARTIAL_CONTENT : HTTP_RANGE_NOT_SATISFIABLE;
+        }
+}
+
+
+
+// Send the header, in small pieces if asked to.
+static int send_header(int fd, const char *header, size_t len, bool split)
+{
+        size_t piece;
+
+        if (!split) {
+                return send_all(fd, header, len, MSG_MORE);
+        }
+        while (len > 0) {
+                piece = (len < SPLIT_BYTES) ? len : SPLIT_BYTES;
+                if (send_all(fd, header, piece, 0) != SUCCESS) {
+                        return ERR_CONNECT;
+                }
+                header += piece;
+                len -= piece;
+                usleep(SPLIT_PAUSE_US);
+        }
+        return SUCCESS;
+}
+
+
+
+// Send the bytes first..last of the file.
+static int send_body(int fd, const struct want *want, long long first,
+                     long long last)
+{
+        char chunk[CHUNK_HEADER];
+        long long offset = first;
+        size_t max = want->drip ? DRIP_BYTES : PATTERN_SIZE;
+        size_t piece;
+        int len;
+        int result = SUCCESS;
+
+        while ((result == SUCCESS) && (offset <= last)) {
+                piece = (last + 1 - offset < (long long)max) ? last + 1 - offset : max;
+                if (want->chunked) {
+                        len = snprintf(chunk, sizeof(chunk), "%zx\r\n", piece);
+                        result = send_all(fd, chunk, len, MSG_MORE);
+                }
+                if (result == SUCCESS) {
+                        result = send_all(fd, Pattern + offset % LINE_LEN, piece,
+                                          want->chunked ? MSG_MORE : 0);
+                }
+                if ((result == SUCCESS) && want->chunked) {
+                        result = send_all(fd, "\r\n", 2, 0);
+                }
+                offset += piece;
+                if (want->drip && (offset <= last)) {
+                        usleep(Drip_ms * US_PER_MS);
+                }
+        }
+        if ((result == SUCCESS) && want->chunked) {
+                result = send_all(fd, "0\r\n\r\n", 5, 0);
+        }
+        return result;
+}
+
+
+
+// Answer one request. Returns SUCCESS, or ERR_CONNECT if the
+// connection has failed.
+static int respond(int fd, struct want *want)
+{
+        char header[MAX_HEADER];
+        const char *reason;
+        long long first = 0;
+        long long last = want->size - 1;
+        int len;
+
+        switch (want->status) {
+                case HTTP_OK:
+                        reason = "OK";
+                        break;
+                case HTTP_PARTIAL_CONTENT:
+                        reason = "Partial Content";
+                        first = want->first;
+                        last = want->last;
+                        break;
+                case HTTP_NOT_MODIFIED:
+                        reason = "Not Modified";
+                        break;
+                case HTTP_RANGE_NOT_SATISFIABLE:
+                        reason = "Range Not Satisfiable";
+                        break;
+                case HTTP_NOT_FOUND:
+                        reason = "Not Found";
+                        break;
+                default:
+                        reason = "Bad Request";
+                        want->keep_alive = false;
+                        break;
+        }
+
+        len = snprintf(header, sizeof(header), "HTTP/1.1 %d %s\r\n"
+                       "Content-Type: text/plain\r\n", want->status, reason);
+        if ((want->status == HTTP_OK) || (want->status == HTTP_PARTIAL_CONTENT) ||
+            (want->status == HTTP_NOT_MODIFIED)) {
+                len += snprintf(header + len, sizeof(header) - len, "ETag: %s\r\n",
+                                want->etag);
+                if (!want->changing) {
+                        len += snprintf(header + len, sizeof(header) - len,
+                                        "Last-Modified: %s\r\n", LAST_MODIFIED);
+                }
+        }
+        if (want->status == HTTP_NOT_MODIFIED) {
+                // no body, and so no Content-Length
+        } else if ((want->status != HTTP_OK) && (want->status != HTTP_PARTIAL_CONTENT)) {
+                // the reason is the body
+                len += snprintf(header + len, sizeof(header) - len,
+                                "Content-Length: %zu\r\n", strlen(reason) + 1);
+                if (want->status == HTTP_RANGE_NOT_SATISFIABLE) {
+                        len += snprintf(header + len, sizeof(header) - len,
+                                        "Content-Range: bytes */%lld\r\n", want->size);
+                }
+        } else {
+                if (!want->norange) {
+                        len += snprintf(header + len, sizeof(header) - len,
+                                        "Accept-Ranges: bytes\r\n");
+                }
+                if (want->status == HTTP_PARTIAL_CONTENT) {
+                        len += snprintf(header + len, sizeof(header) - len,
+                                        "Content-Range: bytes %lld-%lld/%lld\r\n",
+                                        first, last, want->size);
+                }
+                if (want->chunked) {
+                        len += snprintf(header + len, sizeof(header) - len,
+                                        "Transfer-Encoding: chunked\r\n");
+                } else {
+                        len += snprintf(header + len, sizeof(header) - len,
+                                        "Content-Length: %lld\r\n", last + 1 - first);
+                }
+        }
+        len += snprintf(header + len, sizeof(header) - len, "Connection: %s\r\n\r\n",
+                        want->keep_alive ? "keep-alive" : "close");
+
+        if (send_header(fd, header, len, want->split) != SUCCESS) {
+                return ERR_CONNECT;
+        }
+        if (want->head || (want->status == HTTP_NOT_MODIFIED)) {
+                return SUCCESS;
+        }
+        if ((want->status != HTTP_OK) && (want->status != HTTP_PARTIAL_CONTENT)) {
+                if (send_all(fd, reason, strlen(reason), MSG_MORE) != SUCCESS) {
+                        return ERR_CONNECT;
+                }
+                return send_all(fd, "\n", 1, 0);
+        }
+        return send_body(fd, want, first, last);
+}
+
+
+
+// Thread body: answer the requests on one connection until it closes.
+static void *serve(void *arg)
+{
+        int fd = (int)(long)arg;
+        char buf[MAX_REQUEST + 1];
+        struct want want;
+        size_t len = 0;
+        size_t size;
+        ssize_t count;
+        char *end;
+        int result = SUCCESS;
+
+        while (result == SUCCESS) {
+                // the whole of the next request
+                buf[len] = '\0';
+                while ((end = strstr(buf, "\r\n\r\n")) == NULL) {
+                        if (len == MAX_REQUEST) {
+                                want.status = HTTP_BAD_REQUEST;
+                                want.head = false;
+                                respond(fd, &want);
+                                result = ERR_BAD_REQUEST;
+                                break;
+                        }
+                        count = read(fd, buf + len, MAX_REQUEST - len);
+                        if ((count < 0) && (errno == EINTR)) {
+                                continue;
+                        }
+                        if (count <= 0) {
+                                result = ERR_NO_DATA;
+                                break;
+                        }
+                        len += count;
+                        buf[len] = '\0';
+                }
+                if (result != SUCCESS) {
+                        break;
+                }
+
+                size = end + 4 - buf;
+                end[2] = '\0';
+                parse_request(buf, &want);
+                result = respond(fd, &want);
+                if (!want.keep_alive) {
+                        break;
+                }
+                // keep any pipelined requests after it
+                memmove(buf, buf + size, len - size);
+                len -= size;
+        }
+
+        shutdown(fd, SHUT_WR);
+        close(fd);
+        return NULL;
+}
+
+
+
+int main(int argc, char *argv[])
+{
+        struct sockaddr_in addr;
+        const char *address = DEFAULT_ADDRESS;
+        int port = DEFAULT_PORT;
+        int option;
+        int listener;
+        int fd;
+        int on = 1;
+        pthread_attr_t attr;
+        pthread_t thread;
+
+        while ((option = getopt(argc, argv, "a:p:d:")) != -1) {
+                switch (option) {
+                        case 'a':
+                                address = optarg;
+                                break;
+                        case 'p':
+                                port = atoi(optarg);
+                                break;
+                        case 'd':
+                                Drip_ms = atoi(optarg);
+                                break;
+                        default:
+                                fprintf(stderr, "Usage: %s [-a address] [-p port] [-d ms]\n",
+                                        argv[0]);
+                                return ERR_NUM_INPUTS;
+                }
+        }
+
+        for (int i = 0; i < (int)sizeof(Pattern); i++) {
+                Pattern[i] = LINE[i % LINE_LEN];
+        }
+
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        if (inet_pton(AF_INET, address, &addr.sin_addr) != 1) {
+                fprintf(stderr, "Bad address '%s'\n", address);
+                return ERR_NUM_INPUTS;
+        }
+        listener = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listener < 0) {
+                perror("socket");
+                return ERR_SOCKET;
+        }
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        if ((bind(listener, (struct sockaddr *)&addr, sizeof(addr)) != 0) ||
+            (listen(listener, BACKLOG) != 0)) {
+                perror("Unable to listen");
+                return ERR_CONNECT;
+        }
+
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        for (;;) {
+                fd = accept4(listener, NULL, NULL, SOCK_CLOEXEC);
+                if (fd < 0) {
+                        if ((errno != EINTR) && (errno != ECONNABORTED)) {
+                                perror("accept");
+                        }
+                        continue;
+                }
+                // the pieces of a split header or a drip go out at once
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+                if (pthread_create(&thread, &attr, serve, (void *)(long)fd) != 0) {
+                        close(fd);
+                }
+        }
+}
+
+// end of testserver.c